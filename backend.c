@@ -0,0 +1,93 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "level1.h"
+#include "backend.h"
+
+#ifdef HAVE_OPENBLAS
+#include <cblas.h>
+#endif
+
+static int backend = BACKEND_REF;
+static const char *backend_names[] = { "ref", "cblas" };
+
+
+/* Select the backend by name; returns 0, or -1 if it is not in this build */
+int backend_select(const char *name){
+
+  if (strcmp(name, "ref") == 0) {
+    backend = BACKEND_REF;
+    return 0;
+  }
+  if (strcmp(name, "cblas") == 0) {
+#ifdef HAVE_CBLAS
+    backend = BACKEND_CBLAS;
+    return 0;
+#else
+    fprintf(stderr, "ERROR: this build has no CBLAS, install one (e.g. OpenBLAS) and rebuild, or set CBLAS in the Makefile\n");
+    return -1;
+#endif
+  }
+
+  fprintf(stderr, "ERROR: unknown backend \"%s\", expected ref or cblas\n", name);
+  return -1;
+}
+
+const char *backend_name(void){ return backend_names[backend]; }
+
+/* Nonzero if kernels run through an external library */
+int backend_external(void){ return backend != BACKEND_REF; }
+
+/* The library's compute() for kernel k, or NULL if it has none */
+double (*backend_compute(const struct kernel *k))(void *){
+
+#ifdef HAVE_CBLAS
+  const backend_op *o;
+
+  if (backend == BACKEND_CBLAS)
+    for (o = blas_op_cblas; o->bench != NULL; o++)
+      if (strcmp(o->bench, k->bench) == 0 && strcmp(o->op, k->op) == 0 && strcmp(o->dtype, k->dtype) == 0)
+        return o->compute;
+#endif
+
+  return NULL;
+}
+
+/* Ask the library for n threads, where it has a call for it */
+void backend_threads(int n){
+
+#ifdef HAVE_OPENBLAS
+  if (backend == BACKEND_CBLAS) openblas_set_num_threads(n);
+#endif
+}
+
+/* The backends, marking those not in this build */
+void backend_list(FILE *f){
+
+#ifdef HAVE_CBLAS
+  fprintf(f, "%s %s", backend_names[BACKEND_REF], backend_names[BACKEND_CBLAS]);
+#else
+  fprintf(f, "%s %s(n/a)", backend_names[BACKEND_REF], backend_names[BACKEND_CBLAS]);
+#endif
+}
@@ -0,0 +1,61 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * BLAS backends.
+ *
+ * The float and double dot product, AXPY, scaling, norm, dense
+ * matrix-vector products (dmv, dmv_t) and GEMM of blas_op can run
+ * through an external CBLAS, such as OpenBLAS or BLIS, in place of the
+ * in-tree kernels, for a head-to-head comparison on the same data,
+ * timing and verification. The Makefile looks for a CBLAS at build
+ * time and defines HAVE_CBLAS if one links; --backend=cblas then
+ * selects it. "ref", the default, is the in-tree implementation.
+ *
+ * Under cblas the kernels with no library equivalent are skipped, and
+ * the library runs its own threads: backend_threads() asks it for
+ * --threads of them where it can be told (OpenBLAS); other libraries
+ * follow their own settings, e.g. BLIS_NUM_THREADS. The records name
+ * the backend as their runtime.
+ */
+
+enum { BACKEND_REF, BACKEND_CBLAS };
+
+struct kernel;
+
+/* A registered kernel computed through the library */
+typedef struct {
+  const char *bench;
+  const char *op;
+  const char *dtype;
+  double (*compute)(void *state);
+} backend_op;
+
+#ifdef HAVE_CBLAS
+extern const backend_op blas_op_cblas[];   /* terminated by a NULL bench */
+#endif
+
+int backend_select(const char *name);
+const char *backend_name(void);
+int backend_external(void);
+double (*backend_compute(const struct kernel *k))(void *);
+void backend_threads(int n);
+void backend_list(FILE *f);
@@ -0,0 +1,225 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "utils.h"
+#include "report.h"
+#include "baseline.h"
+
+#define BASELINE_LINE_LEN 8192
+
+/* The fields of a baseline record that the comparison needs */
+typedef struct {
+  char kernel[128];
+  unsigned long size;
+  int threads;
+  double median;
+  double ci95;
+  int used;
+} baseline_entry;
+
+
+/* Write the current run's records to path; returns 0 on success */
+int baseline_save(const char *path){
+
+  bench_record *r;
+  char stamp[32];
+  time_t now = time(NULL);
+  int i, n = report_records(&r);
+  FILE *f;
+
+  if ((f = fopen(path, "w")) == NULL) {
+    fprintf(stderr, "ERROR: unable to open baseline file %s\n", path);
+    return 1;
+  }
+
+  strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+  fprintf(f, "{\"baseline\": {\"timestamp\": \"%s\", \"results\": %d},\n \"results\": [", stamp, n);
+  for (i = 0; i < n; i++) {
+    fprintf(f, "%s\n  {\"kernel\": \"%s\", \"size\": %lu, \"threads\": %d, \"reps\": %d",
+            i ? "," : "", r[i].kernel, r[i].size, r[i].threads, r[i].t.n);
+    fprintf(f, ", \"median\": %.9e, \"mean\": %.9e, \"stddev\": %.9e, \"ci95\": %.9e, \"gflops\": %.6f}",
+            r[i].t.median, r[i].t.mean, r[i].t.stddev, r[i].t.ci95, r[i].gflops);
+  }
+  fprintf(f, "%s ]}\n", n ? "\n" : "");
+  fclose(f);
+
+  fprintf(stderr, "Saved %d results as baseline %s.\n", n, path);
+
+  return 0;
+}
+
+/* Start of the value of "key" in a JSON record line, or NULL */
+static const char *json_value(const char *line, const char *key){
+
+  char pattern[64];
+  const char *p;
+
+  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+  if ((p = strstr(line, pattern)) == NULL) return NULL;
+  p += strlen(pattern);
+  while (*p == ' ') p++;
+
+  return p;
+}
+
+static int json_number(const char *line, const char *key, double *v){
+
+  const char *p = json_value(line, key);
+  char *end;
+
+  if (p == NULL) return -1;
+  *v = strtod(p, &end);
+
+  return end == p ? -1 : 0;
+}
+
+static int json_text(const char *line, const char *key, char *buf, size_t len){
+
+  const char *p = json_value(line, key);
+  size_t n = 0;
+
+  if (p == NULL || *p++ != '"') return -1;
+  while (*p != '\0' && *p != '"' && n + 1 < len) {
+    if (*p == '\\' && p[1] != '\0') p++;
+    buf[n++] = *p++;
+  }
+  buf[n] = '\0';
+
+  return *p == '"' ? 0 : -1;
+}
+
+/* Read the records of a baseline; returns their number, or -1 */
+static int baseline_read(const char *path, baseline_entry **entries){
+
+  char *line;
+  baseline_entry *list = NULL, e;
+  int n = 0, max = 0;
+  double v;
+  FILE *f;
+
+  if ((f = fopen(path, "r")) == NULL) {
+    fprintf(stderr, "ERROR: unable to open baseline %s\n", path);
+    return -1;
+  }
+  if ((line = malloc(BASELINE_LINE_LEN)) == NULL) {
+    fclose(f);
+    return -1;
+  }
+
+  while (fgets(line, BASELINE_LINE_LEN, f) != NULL) {
+    if (json_text(line, "kernel", e.kernel, sizeof(e.kernel)) != 0) continue;
+    if (json_number(line, "size", &v) != 0) continue;
+    e.size = (unsigned long)v;
+    if (json_number(line, "median", &e.median) != 0) continue;
+    if (json_number(line, "ci95", &e.ci95) != 0) e.ci95 = 0.0;
+    e.threads = (json_number(line, "threads", &v) == 0) ? (int)v : 1;
+    e.used = 0;
+
+    if (n == max) {
+      baseline_entry *l;
+      max = max ? 2 * max : 64;
+      if ((l = realloc(list, max * sizeof(baseline_entry))) == NULL) break;
+      list = l;
+    }
+    list[n++] = e;
+  }
+
+  free(line);
+  fclose(f);
+  *entries = list;
+
+  return n;
+}
+
+/*
+ * Compare every result of the current run with its baseline record.
+ * A median counts as moved when the change exceeds both the combined
+ * 95% confidence intervals of the two runs and threshold times the
+ * baseline median; slower is a regression, faster an improvement.
+ */
+int baseline_compare(const char *path, double threshold){
+
+  FILE *f = report_stream();
+  baseline_entry *base = NULL;
+  bench_record *r;
+  int i, j, nbase, n = report_records(&r);
+  int regressed = 0, improved = 0, missing = 0, unused = 0;
+
+  if ((nbase = baseline_read(path, &base)) < 0) return 1;
+  if (nbase == 0) {
+    fprintf(stderr, "ERROR: no results in baseline %s\n", path);
+    free(base);
+    return 1;
+  }
+
+  fprintf(f, "\n--- Comparison with baseline %s\n", path);
+  fprintf(f, "------------------------------------------------------------------------------------\n");
+  fprintf(f, "| %-28s %10s %4s %14s %14s %8s %8s  %s\n",
+          "Kernel", "Size", "Thr", "Baseline s", "Median s", "Change %", "Noise %", "Status");
+
+  for (i = 0; i < n; i++) {
+    baseline_entry *b = NULL;
+    double change, noise;
+    const char *status;
+
+    for (j = 0; j < nbase && b == NULL; j++)
+      if (!base[j].used && base[j].size == r[i].size && base[j].threads == r[i].threads
+          && strcmp(base[j].kernel, r[i].kernel) == 0) b = &base[j];
+
+    if (b == NULL || b->median <= 0) {
+      fprintf(f, "| %-28s %10lu %4d %14s %14.9f %8s %8s  %s\n",
+              r[i].kernel, r[i].size, r[i].threads, "-", r[i].t.median, "-", "-", "new");
+      missing++;
+      continue;
+    }
+    b->used = 1;
+
+    change = (r[i].t.median - b->median) / b->median;
+    noise = sqrt(b->ci95 * b->ci95 + r[i].t.ci95 * r[i].t.ci95) / b->median;
+    if (noise < threshold) noise = threshold;
+
+    if (change > noise) { status = "REGRESSED"; regressed++; }
+    else if (change < -noise) { status = "improved"; improved++; }
+    else status = "same";
+
+    fprintf(f, "| %-28s %10lu %4d %14.9f %14.9f %+8.2f %8.2f  %s\n", r[i].kernel, r[i].size, r[i].threads,
+            b->median, r[i].t.median, 100.0 * change, 100.0 * noise, status);
+  }
+
+  for (j = 0; j < nbase; j++) unused += !base[j].used;
+
+  fprintf(f, "------------------------------------------------------------------------------------\n");
+  fprintf(f, "| %d regressed, %d improved, %d not in the baseline, %d baseline results not run\n",
+          regressed, improved, missing, unused);
+  fflush(f);
+
+  if (regressed) fprintf(stderr, "ERROR: %d kernels regressed against baseline %s\n", regressed, path);
+
+  free(base);
+
+  return regressed ? BASELINE_REGRESSED : 0;
+}
@@ -0,0 +1,38 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Performance baselines.
+ *
+ * baseline_save() writes the results of a run as a baseline, one JSON
+ * record per line with the kernel, size, threads and timing statistics.
+ * baseline_compare() matches the results of the current run to a
+ * baseline by kernel, size and threads (a JSON report written with
+ * --format json serves as a baseline too) and flags the medians that
+ * moved by more than the noise: the combined 95% confidence interval
+ * of the two runs, and at least the given fraction of the baseline.
+ * It returns BASELINE_REGRESSED if any kernel got slower.
+ */
+
+#define BASELINE_REGRESSED 4
+
+int baseline_save(const char *path);
+int baseline_compare(const char *path, double threshold);
@@ -26,122 +26,268 @@
 #include <string.h>
 #include <limits.h>
 
+#ifdef HAVE_CBLAS
+#include <cblas.h>
+#endif
+
 #include "level1.h"
+#include "memory.h"
+#include "par.h"
+#include "pool.h"
+#include "rng.h"
+#include "simd.h"
+#include "reduce.h"
+#include "fuse.h"
+#include "gemm.h"
+#include "backend.h"
+#include "half.h"
 #include "utils.h"
 #include "matrix_utils.h"
 
+/* Default timed repetitions; spgemm is much more expensive per call */
+#define REPS 10
+#define SPGEMM_REPS 3
+
 /*
- * Vector dot product, integers
- *
- * result = result + v1_i * v2_i
- *
- * Input: size of the vectors (in number of elements)
- * Output: dot product
- *
+ * Iterations per chunk for the threaded sparse kernels. Rows and
+ * columns differ in their number of nonzeros, so they are balanced
+ * dynamically (par_for_grain()) rather than split once per thread.
  */
-int int_dot_product(unsigned int size) {
+#define SPMV_GRAIN 64
+#define SPGEMM_GRAIN 4
 
-    int i;
+/*
+ * State shared by the vector kernels (dot product, scalar
+ * multiplication, norm and AXPY). x and y point to arrays of the
+ * kernel's data type; y is unused by the single vector kernels. algo
+ * is the reduction algorithm of the float and double dot products and
+ * norms (see reduce.h); bf16 tells the 16-bit kernels their x and y
+ * hold bf16 rather than fp16 values. acc holds the block sums of the
+ * threaded overflow safe norm and fused kernels, allocated in setup
+ * for the largest size.
+ */
+typedef struct {
+    unsigned long n;
+    size_t elem;
+    void *x;
+    void *y;
+    double a;
+    int algo;
+    int bf16;
+    void *acc;
+} vec_state;
+
+/* State for the dense matrix-vector product y = A * x */
+typedef struct {
+    unsigned long n;
+    unsigned long ld;          /* elements from one row of A to the next */
+    size_t elem, yelem;        /* y is wider than A and x for the int16 and int32 kernels */
+    void *A;
+    void *x;
+    void *y;
+} dmv_state;
+
+/* State for the dense matrix-matrix product C = A * B */
+typedef struct {
+    unsigned long n;
+    unsigned long ld;          /* elements from one row to the next, in all three */
+    size_t elem;
+    void *A, *B, *C;
+    void *pa, *pb;             /* packing buffers of gemm, NULL for gemm_naive */
+} gemm_state;
 
-    /* create two vectors */
-    int *v1 = (int *) malloc(size * sizeof (int));
-    int *v2 = (int *) malloc(size * sizeof (int));
+/*
+ * A CSR matrix as read from file, plus the vectors for SpMV. The
+ * values take velem bytes each, x and b elem; they differ only for
+ * the fp16 and bf16 kernels, which keep x and b in float.
+ */
+typedef struct {
+    int m, n, nz;
+    size_t elem, velem;
+    int bf16;
+    int *row_idx;
+    int *col_idx;
+    void *values;
+    void *x;
+    void *b;
+} spmv_state;
+
+/* State for sparse matrix-matrix multiplication C = A * B */
+typedef struct {
+    int m, n, nz;
+    size_t elem;
+    int *row_csr_idx, *col_csr_idx;
+    int *row_csc_idx, *col_csc_idx;
+    void *A_csr, *B_csc, *C;
+    void *temp_vec;             /* m elements for each of threads threads */
+    int threads;
+} spgemm_state;
 
-    /* result variable */
-    unsigned int result = 0;
+/* Change this to matrix_lrg.csr and recompile to use the large matrix */
+static char *csr_filename = "matrix_sml.csr";
 
-    if (v1 == NULL || v2 == NULL) {
-        printf("Out Of Memory: could not allocate space for the two arrays.\n");
-        return 0;
-    }
 
-    srand((int) time(NULL));
+static vec_state *vec_alloc(unsigned long size, size_t elem, int two) {
 
-    struct timespec start, end;
+    vec_state *s = calloc(1, sizeof (vec_state));
 
-    /* fill vectors with random integer values */
-    for (i = 0; i < size; i++) {
-        v1[i] = (int) rand() / (int) (RAND_MAX / 10);
-        v2[i] = (int) rand() / (int) (RAND_MAX / 10);
+    if (s == NULL) return NULL;
+
+    s->n = size;
+    s->elem = elem;
+    s->x = mem_alloc(size * elem);
+    s->y = two ? mem_alloc(size * elem) : NULL;
+
+    if (s->x == NULL || (two && s->y == NULL)) {
+        printf("Out Of Memory: could not allocate space for the arrays.\n");
+        mem_free(s->x);
+        mem_free(s->y);
+        free(s);
+        return NULL;
     }
 
-    clock_gettime(CLOCK, &start);
+    return s;
+}
+
+static void vec_teardown(void *p) {
+
+    vec_state *s = p;
+
+    mem_free(s->x);
+    mem_free(s->y);
+    free(s->acc);
+    free(s);
+}
+
+/* Give s bytes of block sums in acc; tears s down if they cannot be allocated */
+static vec_state *vec_acc_alloc(vec_state *s, size_t bytes) {
+
+    if (s == NULL) return NULL;
 
-    /* perform dot product */
-    for (i = 0; i < size; i++) {
-        result = result + v1[i] * v2[i];
+    s->acc = malloc(bytes);
+    if (s->acc == NULL) {
+        printf("Out Of Memory: could not allocate space for the block sums.\n");
+        vec_teardown(s);
+        return NULL;
     }
 
-    clock_gettime(CLOCK, &end);
+    return s;
+}
+
+static double dot_flops(void *p) { return 2.0 * ((vec_state *) p)->n; }
+static double dot_bytes(void *p) { vec_state *s = p; return 2.0 * s->n * s->elem; }
+static double scal_flops(void *p) { return (double) ((vec_state *) p)->n; }
+static double scal_bytes(void *p) { vec_state *s = p; return 2.0 * s->n * s->elem; }
+static double norm_flops(void *p) { return 2.0 * ((vec_state *) p)->n; }
+static double norm_bytes(void *p) { vec_state *s = p; return (double) s->n * s->elem; }
+static double axpy_flops(void *p) { return 2.0 * ((vec_state *) p)->n; }
+static double axpy_bytes(void *p) { vec_state *s = p; return 3.0 * s->n * s->elem; }
+static double axpy_dot_flops(void *p) { return 4.0 * ((vec_state *) p)->n; }
+static double axpy_dot_bytes(void *p) { vec_state *s = p; return 4.0 * s->n * s->elem; }
+static double vec_footprint(void *p) { vec_state *s = p; return (s->y ? 2.0 : 1.0) * s->n * s->elem; }
+static int vec_resize(void *p, unsigned long size) { ((vec_state *) p)->n = size; return 0; }
 
-    /* print result so compiler does not throw it away */
-    printf("Dot product result: %d\n", result);
+/*
+ * fp16 and bf16 storage (see half.h). The 16-bit kernels widen blocks
+ * of HALF_BLOCK elements to float on the stack, run the float vector
+ * kernels on them and round the blocks they write back; sums are
+ * carried from block to block in float. The fp16 and bf16 kernels
+ * share their code and differ in their setup only.
+ */
+#define HALF_BLOCK 512
 
-    elapsed_time_hr(start, end, "Integer dot product.");
+static void half_load(int bf16, const uint16_t *h, float *x, unsigned long n) {
 
-    free(v1);
-    free(v2);
+    if (bf16) simd->b2s(h, x, n);
+    else simd->h2s(h, x, n);
+}
 
-    return 0;
+static void half_store(int bf16, const float *x, uint16_t *h, unsigned long n) {
+
+    if (bf16) simd->s2b(x, h, n);
+    else simd->s2h(x, h, n);
+}
+
+static float half_value(int bf16, uint16_t h) { return bf16 ? bf16_to_float(h) : half_to_float(h); }
+
+static void half_fill(int bf16, uint16_t *v, unsigned long n, unsigned int stream) {
 
+    if (bf16) rng_bf16(v, n, 0.0f, 10.0f, stream, 0);
+    else rng_half(v, n, 0.0f, 10.0f, stream, 0);
 }
 
 /*
- * Vector dot product, floats
- *
- * result = result + v1_i * v2_i
- *
- * Input: size of the vectors (in number of elements)
- * Output: dot product
- *
+ * The int16, int32 and int64 kernels saturate where the int ones wrap:
+ * like the int ones, their dot products and matrix-vector products sum
+ * into 64 bits, and their AXPY and scaling saturate to the type (see
+ * simd.h). int16 takes its full range; int32 and int64 take [-65536,
+ * 65536), whose products sum without overflow for up to 2^31 elements.
+ * int64 sums into 128 bits where the compiler has them, and into 64
+ * bits that saturate elsewhere; its matrix-vector product saturates the
+ * row sums to y's 64 bits.
  */
-int float_dot_product(unsigned int size) {
+static void wide_fill(size_t elem, void *v, unsigned long n, unsigned int stream, unsigned long long first) {
 
-    int i;
+    if (elem == sizeof (int16_t)) rng_int16(v, n, -32768, 32768, stream, first);
+    else if (elem == sizeof (int32_t)) rng_int(v, n, -65536, 65536, stream, first);
+    else rng_int64(v, n, -65536, 65536, stream, first);
+}
 
-    /* create three vectors */
-    float *v1 = (float *) malloc(size * sizeof (float));
-    float *v2 = (float *) malloc(size * sizeof (float));
-    float result = 0.0;
+static int32_t sat32(long long v) { return (int32_t) (v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : v); }
 
-    if (v1 == NULL || v2 == NULL) {
-        printf("Out Of Memory: could not allocate space for the two arrays.\n");
-        return 0;
-    }
+#ifdef __SIZEOF_INT128__
+__extension__ typedef __int128 wide_t;
 
-    srand((int) time(NULL));
+static wide_t wide_mul(int64_t x, int64_t y) { return (wide_t) x * y; }
+static wide_t wide_add(wide_t x, wide_t y) { return x + y; }
+static int64_t sat_wide(wide_t v) { return (int64_t) (v > INT64_MAX ? INT64_MAX : v < INT64_MIN ? INT64_MIN : v); }
+#else
+/* No 128-bit integers (32-bit targets): int64 products and sums saturate */
+typedef int64_t wide_t;
 
-    struct timespec start, end;
+static wide_t wide_mul(int64_t x, int64_t y) {
 
-    /* fill vectors with random floats */
-    for (i = 0; i < size; i++) {
-        v1[i] = (float) rand() / (float) (RAND_MAX / 10.0);
-        v2[i] = (float) rand() / (float) (RAND_MAX / 10.0);
-    }
+    if (x == 0 || y == 0) return 0;
+    if (x > 0 ? (y > 0 ? x > INT64_MAX / y : y < INT64_MIN / x)
+              : (y > 0 ? x < INT64_MIN / y : y < INT64_MAX / x))
+        return ((x > 0) == (y > 0)) ? INT64_MAX : INT64_MIN;
+    return x * y;
+}
 
-    clock_gettime(CLOCK, &start);
+static wide_t wide_add(wide_t x, wide_t y) {
 
-    /* perform dot product */
-    for (i = 0; i < size; i++) {
-        result = result + v1[i] * v2[i];
-    }
+    if (y > 0 && x > INT64_MAX - y) return INT64_MAX;
+    if (y < 0 && x < INT64_MIN - y) return INT64_MIN;
+    return x + y;
+}
 
-    clock_gettime(CLOCK, &end);
+static int64_t sat_wide(wide_t v) { return v; }
+#endif
 
-    /* print result so compiler does not throw it away */
-    printf("Dot product result: %f\n", result);
+/* a * x + y, computed in wide_t */
+static int64_t sat64(int64_t a, int64_t x, int64_t y) { return sat_wide(wide_add(wide_mul(a, x), y)); }
 
-    elapsed_time_hr(start, end, "Float dot product.");
+/* The first element of an int16, int32 or int64 vector, to return from a kernel */
+static double wide_value(size_t elem, const void *v) {
 
-    free(v1);
-    free(v2);
+    if (elem == sizeof (int16_t)) return *(const int16_t *) v;
+    if (elem == sizeof (int32_t)) return *(const int32_t *) v;
+    return *(const int64_t *) v;
+}
 
-    return 0;
+static wide_t int64_dot(const int64_t *x, const int64_t *y, unsigned long n) {
 
+    wide_t result = 0;
+    unsigned long i;
+
+    for (i = 0; i < n; i++) result = wide_add(result, wide_mul(x[i], y[i]));
+
+    return result;
 }
 
+
 /*
- * Vector dot product, doubles
+ * Vector dot product
  *
  * result = result + v1_i * v2_i
  *
@@ -149,1255 +295,3143 @@ int float_dot_product(unsigned int size) {
  * Output: dot product
  *
  */
-int double_dot_product(unsigned int size) {
+static void *int_dot_setup(unsigned long size) {
 
-    int i;
+    vec_state *s = vec_alloc(size, sizeof (int), 1);
+    int *v1, *v2;
 
-    /* create three vectors */
-    double *v1 = (double *) malloc(size * sizeof (double));
-    double *v2 = (double *) malloc(size * sizeof (double));
-    double result = 0.0;
+    if (s == NULL) return NULL;
+    v1 = s->x;
+    v2 = s->y;
 
-    if (v1 == NULL || v2 == NULL) {
-        printf("Out Of Memory: could not allocate space for the two arrays.\n");
-        return 0;
-    }
+    /* fill vectors with random integer values */
+    rng_int(v1, size, 0, 10, RNG_X, 0);
+    rng_int(v2, size, 0, 10, RNG_Y, 0);
 
-    srand((int) time(NULL));
+    return s;
+}
 
-    struct timespec start, end;
+static double int_dot_range(void *p, unsigned long begin, unsigned long end) {
 
-    /* fill vectors with random floats */
-    for (i = 0; i < size; i++) {
-        v1[i] = (double) rand() / (double) (RAND_MAX / 10.0);
-        v2[i] = (double) rand() / (double) (RAND_MAX / 10.0);
-    }
+    vec_state *s = p;
+    int *v1 = s->x, *v2 = s->y;
+    unsigned long i;
+    long long result = 0;
 
-    clock_gettime(CLOCK, &start);
+    for (i = begin; i < end; i++) {
+        result = result + (long long) v1[i] * v2[i];
+    }
 
+    return result;
+}
 
-    /* perform dot product */
-    for (i = 0; i < size; i++) {
-        result = result + v1[i] * v2[i];
-    }
-    clock_gettime(CLOCK, &end);
+static double int_dot_compute(void *p) { return int_dot_range(p, 0, ((vec_state *) p)->n); }
+static double int_dot_parallel(void *p) { return par_for(((vec_state *) p)->n, int_dot_range, p); }
 
-    /* print result so compiler does not throw it away */
-    printf("Dot product result: %f\n", result);
+static void *float_dot_setup(unsigned long size) {
 
-    elapsed_time_hr(start, end, "Double dot product.");
+    vec_state *s = vec_alloc(size, sizeof (float), 1);
+    float *v1, *v2;
 
-    free(v1);
-    free(v2);
+    if (s == NULL) return NULL;
+    v1 = s->x;
+    v2 = s->y;
 
-    return 0;
+    /* fill vectors with random floats */
+    rng_float(v1, size, 0.0f, 10.0f, RNG_X, 0);
+    rng_float(v2, size, 0.0f, 10.0f, RNG_Y, 0);
 
+    return s;
 }
 
+static double float_dot_range(void *p, unsigned long begin, unsigned long end) {
 
-/* Vector scalar product, integers    */
+    vec_state *s = p;
+    float *v1 = s->x, *v2 = s->y;
 
-/* v_i = a * v1_i                     */
-int int_scalar_mult(unsigned int size) {
+    return reduce_sdot(s->algo, v1 + begin, v2 + begin, end - begin);
+}
 
-    int i;
+static double float_dot_compute(void *p) { return float_dot_range(p, 0, ((vec_state *) p)->n); }
+static double float_dot_parallel(void *p) { return par_for(((vec_state *) p)->n, float_dot_range, p); }
 
-    /* create vector and scalar */
-    int *v = (int *) malloc(size * sizeof (int));
-    unsigned int a = 0;
+static void *double_dot_setup(unsigned long size) {
 
-    if (v == NULL) {
-        printf("Out Of Memory: could not allocate space for the array.\n");
-        return 0;
-    }
+    vec_state *s = vec_alloc(size, sizeof (double), 1);
+    double *v1, *v2;
 
-    srand((int) time(NULL));
+    if (s == NULL) return NULL;
+    v1 = s->x;
+    v2 = s->y;
 
-    struct timespec start, end;
+    /* fill vectors with random doubles */
+    rng_double(v1, size, 0.0, 10.0, RNG_X, 0);
+    rng_double(v2, size, 0.0, 10.0, RNG_Y, 0);
 
-    /* fill vector with random ints */
-    for (i = 0; i < size; i++) {
-        v[i] = (int) rand() / (int) (RAND_MAX / 10);
-    }
+    return s;
+}
 
-    /* assign random int value */
-    a = (int) rand() / (int) (RAND_MAX / 10);
+static double double_dot_range(void *p, unsigned long begin, unsigned long end) {
 
-    clock_gettime(CLOCK, &start);
+    vec_state *s = p;
+    double *v1 = s->x, *v2 = s->y;
 
-    /* perform scalar product */
-    for (i = 0; i < size; i++) {
-        v[i] = a * v[i];
-    }
-    clock_gettime(CLOCK, &end);
+    return reduce_ddot(s->algo, v1 + begin, v2 + begin, end - begin);
+}
 
-    /* print result so compiler does not throw it away */
-    printf("Scalar product result: %d\n", v[0]);
+static double double_dot_compute(void *p) { return double_dot_range(p, 0, ((vec_state *) p)->n); }
+static double double_dot_parallel(void *p) { return par_for(((vec_state *) p)->n, double_dot_range, p); }
 
-    elapsed_time_hr(start, end, "Int scalar multiplication.");
+static void *half_dot_setup(unsigned long size, int bf16) {
 
-    free(v);
+    vec_state *s = vec_alloc(size, sizeof (uint16_t), 1);
 
-    return 0;
+    if (s == NULL) return NULL;
+    s->bf16 = bf16;
 
-}
+    /* the float vectors, rounded */
+    half_fill(bf16, s->x, size, RNG_X);
+    half_fill(bf16, s->y, size, RNG_Y);
 
-/* Vector scalar product, floats    */
+    return s;
+}
 
-/* v_i = a * v1_i                     */
-int float_scalar_mult(unsigned int size) {
+static void *fp16_dot_setup(unsigned long size) { return half_dot_setup(size, 0); }
+static void *bf16_dot_setup(unsigned long size) { return half_dot_setup(size, 1); }
 
-    int i;
+static double half_dot_range(void *p, unsigned long begin, unsigned long end) {
 
-    /* create vector and scalar */
-    float *v = (float *) malloc(size * sizeof (float));
-    float a = 0.0;
+    vec_state *s = p;
+    uint16_t *v1 = s->x, *v2 = s->y;
+    float x[HALF_BLOCK], y[HALF_BLOCK], sum = 0.0f;
+    unsigned long i, len;
 
-    if (v == NULL) {
-        printf("Out Of Memory: could not allocate space for the array.\n");
-        return 0;
+    for (i = begin; i < end; i += len) {
+        len = (end - i < HALF_BLOCK) ? end - i : HALF_BLOCK;
+        half_load(s->bf16, v1 + i, x, len);
+        half_load(s->bf16, v2 + i, y, len);
+        sum = sum + (float) simd->sdot(x, y, len);
     }
 
-    srand((int) time(NULL));
-
-    struct timespec start, end;
+    return sum;
+}
 
-    /* fill vector with random floats */
-    for (i = 0; i < size; i++) {
-        v[i] = (float) rand() / (float) (RAND_MAX / 10.0);
-    }
+static double half_dot_compute(void *p) { return half_dot_range(p, 0, ((vec_state *) p)->n); }
+static double half_dot_parallel(void *p) { return par_for(((vec_state *) p)->n, half_dot_range, p); }
 
-    /* assign random float value */
-    a = (float) rand() / (float) (RAND_MAX / 10.0);
+/*
+ * The int16, int32 and int64 dot products are exact: the threaded
+ * variant adds the sums of its ranges as integers, in a slot per
+ * thread in acc a cache line apart, rather than through par_for()'s
+ * double sum, and only the total is rounded to the double returned.
+ */
+#define WIDE_PAD (64 / sizeof (wide_t))
 
-    clock_gettime(CLOCK, &start);
+static void *wide_dot_setup(unsigned long size, size_t elem) {
 
-    /* perfom scalar product */
-    for (i = 0; i < size; i++) {
-        v[i] = a * v[i];
-    }
+    vec_state *s = vec_acc_alloc(vec_alloc(size, elem, 1), par_threads() * WIDE_PAD * sizeof (wide_t));
 
-    clock_gettime(CLOCK, &end);
+    if (s == NULL) return NULL;
 
-    /* print result so compiler does not throw it away */
-    printf("Scalar product result: %f\n", v[0]);
+    wide_fill(elem, s->x, size, RNG_X, 0);
+    wide_fill(elem, s->y, size, RNG_Y, 0);
 
-    elapsed_time_hr(start, end, "Float scalar multiplication.");
+    return s;
+}
 
-    free(v);
+static void *int16_dot_setup(unsigned long size) { return wide_dot_setup(size, sizeof (int16_t)); }
+static void *int32_dot_setup(unsigned long size) { return wide_dot_setup(size, sizeof (int32_t)); }
+static void *int64_dot_setup(unsigned long size) { return wide_dot_setup(size, sizeof (int64_t)); }
 
-    return 0;
+static wide_t wide_dot(const vec_state *s, unsigned long begin, unsigned long end) {
 
+    if (s->elem == sizeof (int16_t)) return simd->i16dot((int16_t *) s->x + begin, (int16_t *) s->y + begin, end - begin);
+    if (s->elem == sizeof (int32_t)) return simd->i32dot((int32_t *) s->x + begin, (int32_t *) s->y + begin, end - begin);
+    return int64_dot((int64_t *) s->x + begin, (int64_t *) s->y + begin, end - begin);
 }
 
-/* Vector scalar product, doubles    */
+static double wide_dot_range(void *p, unsigned long begin, unsigned long end) {
 
-/* v_i = a * v1_i                     */
-int double_scalar_mult(unsigned int size) {
+    vec_state *s = p;
 
-    int i;
+    wide_t *acc = (wide_t *) s->acc + par_thread() * WIDE_PAD;
 
-    /* create vector and scalar */
-    double *v = (double *) malloc(size * sizeof (double));
-    double a = 0.0;
+    *acc = wide_add(*acc, wide_dot(s, begin, end));
 
-    if (v == NULL) {
-        printf("Out Of Memory: could not allocate space for the array.\n");
-        return 0;
-    }
+    return 0.0;
+}
 
-    srand((int) time(NULL));
+static double wide_dot_compute(void *p) { vec_state *s = p; return (double) wide_dot(s, 0, s->n); }
 
-    struct timespec start, end;
+static double wide_dot_parallel(void *p) {
 
-    /* fill vector with random doubles */
-    for (i = 0; i < size; i++) {
-        v[i] = (double) rand() / (double) (RAND_MAX / 10.0);
-    }
+    vec_state *s = p;
+    wide_t *acc = s->acc, sum = 0;
+    int t;
 
-    /* assign random double value */
-    a = (double) rand() / (double) (RAND_MAX / 10.0);
+    for (t = 0; t < par_threads(); t++) acc[t * WIDE_PAD] = 0;
+    par_for(s->n, wide_dot_range, s);
+    for (t = 0; t < par_threads(); t++) sum = wide_add(sum, acc[t * WIDE_PAD]);
 
-    clock_gettime(CLOCK, &start);
+    return (double) sum;
+}
 
-    /* perfom scalar product */
-    for (i = 0; i < size; i++) {
-        v[i] = a * v[i];
-    }
 
-    clock_gettime(CLOCK, &end);
+/*
+ * Vector scalar product
+ *
+ * v_i = a * v_i
+ *
+ * The floating point versions alternate between a and 1/a on
+ * successive repetitions so the vector stays finite however many
+ * repetitions are run.
+ */
+static void *int_scal_setup(unsigned long size) {
 
-    /* print result so compiler does not throw it away */
-    printf("Scalar product result: %f\n", v[0]);
+    vec_state *s = vec_alloc(size, sizeof (int), 0);
+    int *v;
 
-    elapsed_time_hr(start, end, "Double scalar multiplication.");
+    if (s == NULL) return NULL;
+    v = s->x;
 
-    free(v);
+    /* fill vector with random ints */
+    rng_int(v, size, 0, 10, RNG_X, 0);
 
-    return 0;
+    /* assign random int value */
+    s->a = (int) (10 * rng_uniform(RNG_SCALAR, 0));
 
+    return s;
 }
 
-/* compute the Euclidean norm of an int vector      */
-/* !!!! naive implementation -- find algorithm that  */
-
-/* !!!! will avoid over/underflow for large vectors  */
-int int_norm(unsigned int size) {
-
-    int i;
+static double int_scal_range(void *p, unsigned long begin, unsigned long end) {
 
-    unsigned int *v = (unsigned int *) malloc(size * sizeof (unsigned int));
-    unsigned int sum = 0;
-    float norm = 0.0; /* Result is a float */
+    vec_state *s = p;
+    int *v = s->x;
+    unsigned int a = (unsigned int) s->a;
+    unsigned long i;
 
-    if (v == NULL) {
-        printf("Out Of Memory: could not allocate space for the array.\n");
-        return 0;
+    for (i = begin; i < end; i++) {
+        v[i] = a * v[i];
     }
 
-    struct timespec start, end;
-
-    /* fill vector with random ints */
-    for (i = 0; i < size; i++) {
-        v[i] = 1 + (int) UNI;
-    }
+    return 0.0;
+}
 
-    clock_gettime(CLOCK, &start);
+static double int_scal_compute(void *p) {
 
-    for (i = 0; i < size; i++) {
-        sum = sum + (v[i] * v[i]);
-    }
+    vec_state *s = p;
 
-    norm = sqrt(sum);
+    int_scal_range(s, 0, s->n);
 
-    clock_gettime(CLOCK, &end);
+    return ((int *) s->x)[0];
+}
 
-    elapsed_time_hr(start, end, "Int vector norm.");
+static double int_scal_parallel(void *p) {
 
-    /* print result so compiler does not throw it away */
-    printf("Norm = %f\n", norm);
+    vec_state *s = p;
 
-    free(v);
+    par_for(s->n, int_scal_range, s);
 
-    return 0;
+    return ((int *) s->x)[0];
 }
 
-/* compute the Euclidean norm of a float vector      */
-/* !!!! naive implementation -- find algorithm that  */
+static void *float_scal_setup(unsigned long size) {
 
-/* !!!! will avoid over/underflow for large vectors  */
-int float_norm(unsigned int size) {
+    vec_state *s = vec_alloc(size, sizeof (float), 0);
+    float *v;
 
-    int i;
+    if (s == NULL) return NULL;
+    v = s->x;
 
-    float *v = (float *) malloc(size * sizeof (float));
-    float sum = 0.0, norm = 0.0;
+    /* fill vector with random floats */
+    rng_float(v, size, 0.0f, 10.0f, RNG_X, 0);
 
-    if (v == NULL) {
-        printf("Out Of Memory: could not allocate space for the array.\n");
-        return 0;
-    }
+    /* assign random float value, away from zero so 1/a is finite */
+    s->a = (float) (1.0 + 9.0 * rng_uniform(RNG_SCALAR, 0));
 
-    srand((int) time(NULL));
+    return s;
+}
 
-    struct timespec start, end;
+static double float_scal_range(void *p, unsigned long begin, unsigned long end) {
 
-    /* fill vector with random floats */
-    for (i = 0; i < size; i++) {
-        v[i] = (float) rand() / (float) (RAND_MAX / 10.0);
-    }
+    vec_state *s = p;
+    float *v = s->x;
 
-    clock_gettime(CLOCK, &start);
+    simd->sscal((float) s->a, v + begin, end - begin);
 
-    for (i = 0; i < size; i++) {
-        sum = sum + (v[i] * v[i]);
-    }
+    return 0.0;
+}
 
-    norm = sqrt(sum);
+static double float_scal_compute(void *p) {
 
-    clock_gettime(CLOCK, &end);
+    vec_state *s = p;
+    float a = (float) s->a;
 
-    elapsed_time_hr(start, end, "Float vector norm.");
+    float_scal_range(s, 0, s->n);
+    s->a = 1.0 / a;
 
-    /* print result so compiler does not throw it away */
-    printf("Norm = %f\n", norm);
+    return ((float *) s->x)[0];
+}
 
-    free(v);
+static double float_scal_parallel(void *p) {
 
-    return 0;
+    vec_state *s = p;
+    float a = (float) s->a;
+
+    par_for(s->n, float_scal_range, s);
+    s->a = 1.0 / a;
+
+    return ((float *) s->x)[0];
 }
 
-/* compute the Euclidean norm of a double vector      */
-/* !!!! naive implementation -- find algorithm that  */
+static void *double_scal_setup(unsigned long size) {
 
-/* !!!! will avoid over/underflow for large vectors  */
-int double_norm(unsigned int size) {
+    vec_state *s = vec_alloc(size, sizeof (double), 0);
+    double *v;
 
-    int i;
+    if (s == NULL) return NULL;
+    v = s->x;
+
+    /* fill vector with random doubles */
+    rng_double(v, size, 0.0, 10.0, RNG_X, 0);
 
-    double *v = (double *) malloc(size * sizeof (double));
-    double sum = 0.0, norm = 0.0;
+    /* assign random double value, away from zero so 1/a is finite */
+    s->a = 1.0 + 9.0 * rng_uniform(RNG_SCALAR, 0);
 
-    if (v == NULL) {
-        printf("Out Of Memory: could not allocate space for the array.\n");
-        return 0;
-    }
+    return s;
+}
 
-    struct timespec start, end;
+static double double_scal_range(void *p, unsigned long begin, unsigned long end) {
 
-    /* fill vector with random doubles */
-    for (i = 0; i < size; i++) {
-        v[i] = UNI;
-    }
+    vec_state *s = p;
+    double *v = s->x;
 
-    clock_gettime(CLOCK, &start);
+    simd->dscal(s->a, v + begin, end - begin);
 
-    for (i = 0; i < size; i++) {
-        sum = sum + (v[i] * v[i]);
-    }
+    return 0.0;
+}
+
+static double double_scal_compute(void *p) {
 
-    norm = sqrt(sum);
+    vec_state *s = p;
+    double a = s->a;
 
-    clock_gettime(CLOCK, &end);
+    double_scal_range(s, 0, s->n);
+    s->a = 1.0 / a;
 
-    elapsed_time_hr(start, end, "Double vector norm.");
+    return ((double *) s->x)[0];
+}
 
-    /* print result so compiler does not throw it away */
-    printf("Norm = %f\n", norm);
+static double double_scal_parallel(void *p) {
 
-    free(v);
+    vec_state *s = p;
+    double a = s->a;
 
-    return 0;
+    par_for(s->n, double_scal_range, s);
+    s->a = 1.0 / a;
+
+    return ((double *) s->x)[0];
 }
 
-/*
- *
- * Compute vector-scalar product
- * AXPY, integers
- *
- * y = a * x + y
- *
- * Naive implementation
- *
- */
-int int_axpy(unsigned int size) {
+static void *half_scal_setup(unsigned long size, int bf16) {
 
-    int i, a;
-    int *x = (int *) malloc(size * sizeof (int));
-    int *y = (int *) malloc(size * sizeof (int));
+    vec_state *s = vec_alloc(size, sizeof (uint16_t), 0);
 
-    if (x == NULL || y == NULL) {
-        printf("Out Of Memory: could not allocate space for the two arrays.\n");
-        return 0;
-    }
+    if (s == NULL) return NULL;
+    s->bf16 = bf16;
 
-    srand((int) time(NULL));
+    half_fill(bf16, s->x, size, RNG_X);
+    s->a = (float) (1.0 + 9.0 * rng_uniform(RNG_SCALAR, 0));
 
-    a = (int) rand() / (int) (RAND_MAX / 10);
+    return s;
+}
 
-    /* fill x and y vectors with random ints */
-    for (i = 0; i < size; i++) {
-        x[i] = (int) rand() / (int) (RAND_MAX / 10);
-        y[i] = (int) rand() / (int) (RAND_MAX / 10);
-    }
+static void *fp16_scal_setup(unsigned long size) { return half_scal_setup(size, 0); }
+static void *bf16_scal_setup(unsigned long size) { return half_scal_setup(size, 1); }
 
-    struct timespec start, end;
+static double half_scal_range(void *p, unsigned long begin, unsigned long end) {
 
-    clock_gettime(CLOCK, &start);
+    vec_state *s = p;
+    uint16_t *v = s->x;
+    float x[HALF_BLOCK];
+    unsigned long i, len;
 
-    for (i = 0; i < size; i++) {
-        y[i] = a * x[i] + y[i];
+    for (i = begin; i < end; i += len) {
+        len = (end - i < HALF_BLOCK) ? end - i : HALF_BLOCK;
+        half_load(s->bf16, v + i, x, len);
+        simd->sscal((float) s->a, x, len);
+        half_store(s->bf16, x, v + i, len);
     }
 
-    clock_gettime(CLOCK, &end);
+    return 0.0;
+}
 
-    elapsed_time_hr(start, end, "Int AXPY.");
+static double half_scal_compute(void *p) {
 
-    /* print some of the result so compiler does not throw it away */
-    printf("APXY result = %d\n", y[0]);
+    vec_state *s = p;
+    float a = (float) s->a;
 
-    free(x);
-    free(y);
+    half_scal_range(s, 0, s->n);
+    s->a = 1.0f / a;
 
-    return 0;
+    return half_value(s->bf16, ((uint16_t *) s->x)[0]);
 }
 
-/*
- *
- * Compute vector-scalar product
- * AXPY, floats
- *
- * y = a * x + y
- *
- * Naive implementation
- *
- */
-int float_axpy(unsigned int size) {
+static double half_scal_parallel(void *p) {
 
-    int i;
-    float a;
-    float *x = (float *) malloc(size * sizeof (float));
-    float *y = (float *) malloc(size * sizeof (float));
+    vec_state *s = p;
+    float a = (float) s->a;
 
-    if (x == NULL || y == NULL) {
-        printf("Out Of Memory: could not allocate space for the two arrays.\n");
-        return 0;
-    }
+    par_for(s->n, half_scal_range, s);
+    s->a = 1.0f / a;
 
-    srand((int) time(NULL));
+    return half_value(s->bf16, ((uint16_t *) s->x)[0]);
+}
 
-    a = (float) rand() / (float) (RAND_MAX / 10.0);
+/* The widening kernels keep a: their elements saturate at the ends of the type after a few repetitions */
+static void *wide_scal_setup(unsigned long size, size_t elem) {
 
-    /* fill x and y vectors with random ints */
-    for (i = 0; i < size; i++) {
-        x[i] = (float) rand() / (float) (RAND_MAX / 10.0);
-        y[i] = (float) rand() / (float) (RAND_MAX / 10.0);
-    }
+    vec_state *s = vec_alloc(size, elem, 0);
 
-    struct timespec start, end;
+    if (s == NULL) return NULL;
 
-    clock_gettime(CLOCK, &start);
+    wide_fill(elem, s->x, size, RNG_X, 0);
+    s->a = (int) (10 * rng_uniform(RNG_SCALAR, 0));
 
-    for (i = 0; i < size; i++) {
-        y[i] = a * x[i] + y[i];
-    }
+    return s;
+}
 
-    clock_gettime(CLOCK, &end);
+static void *int16_scal_setup(unsigned long size) { return wide_scal_setup(size, sizeof (int16_t)); }
+static void *int32_scal_setup(unsigned long size) { return wide_scal_setup(size, sizeof (int32_t)); }
+static void *int64_scal_setup(unsigned long size) { return wide_scal_setup(size, sizeof (int64_t)); }
 
-    elapsed_time_hr(start, end, "Float AXPY.");
+static double int16_scal_range(void *p, unsigned long begin, unsigned long end) {
 
-    /* print some of the result so compiler does not throw it away */
-    printf("APXY result = %f\n", y[0]);
+    vec_state *s = p;
 
-    free(x);
-    free(y);
+    simd->i16scal((int) s->a, (int16_t *) s->x + begin, end - begin);
 
-    return 0;
+    return 0.0;
 }
 
-/*
- *
- * Compute vector-scalar product
- * AXPY, doubles
- *
- * y = a * x + y
- *
- * Naive implementation
- *
- */
-int double_axpy(unsigned int size) {
+static double int32_scal_range(void *p, unsigned long begin, unsigned long end) {
 
-    int i;
-    double a;
-    double *x = (double *) malloc(size * sizeof (double));
-    double *y = (double *) malloc(size * sizeof (double));
+    vec_state *s = p;
+    int32_t *v = s->x;
+    long long a = (int) s->a;
+    unsigned long i;
 
-    if (x == NULL || y == NULL) {
-        printf("Out Of Memory: could not allocate space for the two arrays.\n");
-        return 0;
+    for (i = begin; i < end; i++) {
+        v[i] = sat32(a * v[i]);
     }
 
-    srand((int) time(NULL));
-
-    a = (double) rand() / (double) (RAND_MAX / 10.0);
-
-    /* fill x and y vectors with random ints */
-    for (i = 0; i < size; i++) {
-        x[i] = (double) rand() / (double) (RAND_MAX / 10.0);
-        y[i] = (double) rand() / (double) (RAND_MAX / 10.0);
-    }
+    return 0.0;
+}
 
-    struct timespec start, end;
+static double int64_scal_range(void *p, unsigned long begin, unsigned long end) {
 
-    clock_gettime(CLOCK, &start);
+    vec_state *s = p;
+    int64_t *v = s->x;
+    int64_t a = (int) s->a;
+    unsigned long i;
 
-    for (i = 0; i < size; i++) {
-        y[i] = a * x[i] + y[i];
+    for (i = begin; i < end; i++) {
+        v[i] = sat64(a, v[i], 0);
     }
 
-    clock_gettime(CLOCK, &end);
-
-    elapsed_time_hr(start, end, "Double AXPY.");
+    return 0.0;
+}
 
-    /* print some of the result so compiler does not throw it away */
-    printf("APXY result = %f\n", y[0]);
+/* One repetition of the scaling range over all of x, threaded or not */
+static double wide_scal_run(vec_state *s, double (*range)(void *, unsigned long, unsigned long), int parallel) {
 
-    free(x);
-    free(y);
+    if (parallel) par_for(s->n, range, s);
+    else range(s, 0, s->n);
 
-    return 0;
+    return wide_value(s->elem, s->x);
 }
 
+static double int16_scal_compute(void *p) { return wide_scal_run(p, int16_scal_range, 0); }
+static double int32_scal_compute(void *p) { return wide_scal_run(p, int32_scal_range, 0); }
+static double int64_scal_compute(void *p) { return wide_scal_run(p, int64_scal_range, 0); }
+static double int16_scal_parallel(void *p) { return wide_scal_run(p, int16_scal_range, 1); }
+static double int32_scal_parallel(void *p) { return wide_scal_run(p, int32_scal_range, 1); }
+static double int64_scal_parallel(void *p) { return wide_scal_run(p, int64_scal_range, 1); }
+
+
 /*
- * Dense Matrix-Vector product, integers
- *
- * y = A * x
- * where A is a square matrix
- *
- * Input:  number of elements in vectors and of rows/cols
- *         in matrix specified as number of ints
+ * Euclidean norm of a vector
  *
+ * The plain kernels sum the squares directly, so float and double
+ * norms overflow (or underflow) once elements pass the square root of
+ * the type's range; norm_blue below is safe over the whole range. The
+ * int kernel sums the exact squares in 64 bits.
  */
-int int_dmatvec_product(unsigned int size) {
-
-    int i, j;
-    int r1, r2;
+static void *int_norm_setup(unsigned long size) {
 
-    /* create two vectors */
-    int *x = (int *) malloc(size * sizeof (int));
-    int *y = (int *) calloc(size, sizeof (int));
+    vec_state *s = vec_alloc(size, sizeof (unsigned int), 0);
+    unsigned int *v;
 
-    /* create matrix */
-    int **A;
-    A = (int **) malloc(size * sizeof (int *));
-    for (i = 0; i < size; i++) {
-        A[i] = (int *) malloc(size * sizeof (int));
-    }
+    if (s == NULL) return NULL;
+    v = s->x;
 
-    if (x == NULL || y == NULL || A == NULL) {
-        printf("Out Of Memory: could not allocate space for the vectors and matrix.\n");
-        return 0;
-    }
+    /* fill vector with random ints */
+    rng_int((int *) v, size, 0, 10, RNG_X, 0);
 
-    srand((int) time(NULL));
+    return s;
+}
 
-    struct timespec start, end;
+static double int_norm_range(void *p, unsigned long begin, unsigned long end) {
 
-    r1 = (int) rand() / (int) (RAND_MAX / 10);
-    r2 = (int) rand() / (int) (RAND_MAX / 10);
+    vec_state *s = p;
+    unsigned int *v = s->x;
+    unsigned long long sum = 0;
+    unsigned long i;
 
-    /* fill vector x and matrix A with random integer values */
-    for (i = 0; i < size; i++) {
-        x[i] = r1;
-        for (j = 0; j < size; j++) {
-            A[i][j] = r2;
-        }
+    for (i = begin; i < end; i++) {
+        sum = sum + (unsigned long long) v[i] * v[i];
     }
 
-    clock_gettime(CLOCK, &start);
+    return sum;
+}
+
+/* Result is a float */
+static double int_norm_compute(void *p) { return (float) sqrt(int_norm_range(p, 0, ((vec_state *) p)->n)); }
+static double int_norm_parallel(void *p) { return (float) sqrt(par_for(((vec_state *) p)->n, int_norm_range, p)); }
 
-    /* perform matrix-vector product */
-    for (i = 0; i < size; i++) {
-        for (j = 0; j < size; j++) {
-            y[i] = y[i] + A[i][j] * x[j];
-        }
-    }
+static void *float_norm_setup(unsigned long size) {
 
-    clock_gettime(CLOCK, &end);
+    vec_state *s = vec_alloc(size, sizeof (float), 0);
+    float *v;
 
-    elapsed_time_hr(start, end, "Dense Matrix-Vector product.");
+    if (s == NULL) return NULL;
+    v = s->x;
 
-    /* print result so compiler does not throw it away */
-    printf("Result vector y[0] = %d\n", y[0]);
+    /* fill vector with random floats */
+    rng_float(v, size, 0.0f, 10.0f, RNG_X, 0);
 
+    return s;
+}
 
-    free(x);
-    free(y);
-    for (i = 0; i < size; i++) free(A[i]);
-    free(A);
+static double float_norm_range(void *p, unsigned long begin, unsigned long end) {
 
-    return 0;
+    vec_state *s = p;
+    float *v = s->x;
 
+    return s->algo == REDUCE_SIMD ? simd->ssumsq(v + begin, end - begin)
+                                  : reduce_sdot(s->algo, v + begin, v + begin, end - begin);
 }
 
-/*
- * Dense Matrix-Vector product, floats
- *
- * y = A * x
- * where A is a square matrix
- *
- * Input:  number of elements in vectors and of rows/cols
- *         in matrix specified as number of floats
- *
- */
-int float_dmatvec_product(unsigned int size) {
+static double float_norm_compute(void *p) { return sqrtf(float_norm_range(p, 0, ((vec_state *) p)->n)); }
+static double float_norm_parallel(void *p) { return sqrtf(par_for(((vec_state *) p)->n, float_norm_range, p)); }
 
-    int i, j;
-    float r1, r2;
+static void *double_norm_setup(unsigned long size) {
 
-    /* create two vectors */
-    float *x = (float *) malloc(size * sizeof (float));
-    float *y = (float *) calloc(size, sizeof (float));
+    vec_state *s = vec_alloc(size, sizeof (double), 0);
+    double *v;
 
-    /* create matrix */
-    float **A;
-    A = (float **) malloc(size * sizeof (float *));
-    for (i = 0; i < size; i++) {
-        A[i] = (float *) malloc(size * sizeof (float));
-    }
+    if (s == NULL) return NULL;
+    v = s->x;
 
-    if (x == NULL || y == NULL || A == NULL) {
-        printf("Out Of Memory: could not allocate space for the vectors and matrix.\n");
-        return 0;
-    }
+    /* fill vector with random doubles */
+    rng_double(v, size, 0.0, 10.0, RNG_X, 0);
 
-    srand((int) time(NULL));
+    return s;
+}
 
-    struct timespec start, end;
+static double double_norm_range(void *p, unsigned long begin, unsigned long end) {
 
-    r1 = (float) rand() / (float) (RAND_MAX / 10.0);
-    r2 = (float) rand() / (float) (RAND_MAX / 10.0);
+    vec_state *s = p;
+    double *v = s->x;
 
-    /* fill vector x and matrix A with random integer values */
-    for (i = 0; i < size; i++) {
-        x[i] = r1;
-        for (j = 0; j < size; j++) {
-            A[i][j] = r2;
-        }
-    }
+    return s->algo == REDUCE_SIMD ? simd->dsumsq(v + begin, end - begin)
+                                  : reduce_ddot(s->algo, v + begin, v + begin, end - begin);
+}
 
-    clock_gettime(CLOCK, &start);
+static double double_norm_compute(void *p) { return sqrt(double_norm_range(p, 0, ((vec_state *) p)->n)); }
+static double double_norm_parallel(void *p) { return sqrt(par_for(((vec_state *) p)->n, double_norm_range, p)); }
 
-    /* perform matrix-vector product */
-    for (i = 0; i < size; i++) {
-        for (j = 0; j < size; j++) {
-            y[i] = y[i] + A[i][j] * x[j];
-        }
-    }
+static void *half_norm_setup(unsigned long size, int bf16) {
 
-    clock_gettime(CLOCK, &end);
+    vec_state *s = vec_alloc(size, sizeof (uint16_t), 0);
 
-    elapsed_time_hr(start, end, "Dense Matrix-Vector product.");
+    if (s == NULL) return NULL;
+    s->bf16 = bf16;
 
-    /* print result so compiler does not throw it away */
-    printf("Result vector y[0] = %f\n", y[0]);
+    half_fill(bf16, s->x, size, RNG_X);
 
+    return s;
+}
 
-    free(x);
-    free(y);
-    for (i = 0; i < size; i++) free(A[i]);
-    free(A);
+static void *fp16_norm_setup(unsigned long size) { return half_norm_setup(size, 0); }
+static void *bf16_norm_setup(unsigned long size) { return half_norm_setup(size, 1); }
 
-    return 0;
+static double half_norm_range(void *p, unsigned long begin, unsigned long end) {
 
+    vec_state *s = p;
+    uint16_t *v = s->x;
+    float x[HALF_BLOCK], sum = 0.0f;
+    unsigned long i, len;
+
+    for (i = begin; i < end; i += len) {
+        len = (end - i < HALF_BLOCK) ? end - i : HALF_BLOCK;
+        half_load(s->bf16, v + i, x, len);
+        sum = sum + (float) simd->ssumsq(x, len);
+    }
+
+    return sum;
 }
 
+static double half_norm_compute(void *p) { return sqrtf(half_norm_range(p, 0, ((vec_state *) p)->n)); }
+static double half_norm_parallel(void *p) { return sqrtf(par_for(((vec_state *) p)->n, half_norm_range, p)); }
+
+
 /*
- * Dense Matrix-Vector product, doubles
- *
- * y = A * x
- * where A is a square matrix
- *
- * Input:  number of elements in vectors and of rows/cols
- *         in matrix specified as number of floats
- *
+ * Overflow safe norm, Blue's algorithm (see reduce.h), on the data of
+ * the norm kernels. The threaded variant keeps the sums of each block
+ * of NRM2_BLOCK elements and adds them up in order before combining.
  */
-int double_dmatvec_product(unsigned int size) {
+#define NRM2_BLOCK 4096
+#define NRM2_BLOCKS(size) (((size) + NRM2_BLOCK - 1) / NRM2_BLOCK)
 
-    int i, j;
-    double r1, r2;
+static void *float_nrm2_setup(unsigned long size) { return vec_acc_alloc(float_norm_setup(size), NRM2_BLOCKS(size) * sizeof (snrm2_acc)); }
+static void *double_nrm2_setup(unsigned long size) { return vec_acc_alloc(double_norm_setup(size), NRM2_BLOCKS(size) * sizeof (dnrm2_acc)); }
 
-    /* create two vectors */
-    double *x = (double *) malloc(size * sizeof (double));
-    double *y = (double *) calloc(size, sizeof (double));
+static double float_nrm2_compute(void *p) {
 
-    if (x == NULL || y == NULL) {
-        printf("Out Of Memory: could not allocate space for the vectors.\n");
-        return 0;
+    vec_state *s = p;
+    snrm2_acc acc = {0.0f, 0.0f, 0.0f};
+
+    reduce_snrm2_acc(s->x, s->n, &acc);
+
+    return reduce_snrm2_finish(&acc);
+}
+
+static double float_nrm2_blocks(void *p, unsigned long begin, unsigned long end) {
+
+    vec_state *s = p;
+    snrm2_acc *acc = s->acc;
+    float *x = s->x;
+    unsigned long b, first, last;
+
+    for (b = begin; b < end; b++) {
+        first = b * NRM2_BLOCK;
+        last = (first + NRM2_BLOCK < s->n) ? first + NRM2_BLOCK : s->n;
+        acc[b].big = acc[b].med = acc[b].sml = 0.0f;
+        reduce_snrm2_acc(x + first, last - first, &acc[b]);
+    }
+
+    return 0.0;
+}
+
+static double float_nrm2_parallel(void *p) {
+
+    vec_state *s = p;
+    unsigned long nb = NRM2_BLOCKS(s->n), b;
+    snrm2_acc total = {0.0f, 0.0f, 0.0f}, *acc = s->acc;
+
+    par_for(nb, float_nrm2_blocks, s);
+    for (b = 0; b < nb; b++) {
+        total.big += acc[b].big;
+        total.med += acc[b].med;
+        total.sml += acc[b].sml;
+    }
+
+    return reduce_snrm2_finish(&total);
+}
+
+static double double_nrm2_compute(void *p) {
+
+    vec_state *s = p;
+    dnrm2_acc acc = {0.0, 0.0, 0.0};
+
+    reduce_dnrm2_acc(s->x, s->n, &acc);
+
+    return reduce_dnrm2_finish(&acc);
+}
+
+static double double_nrm2_blocks(void *p, unsigned long begin, unsigned long end) {
+
+    vec_state *s = p;
+    dnrm2_acc *acc = s->acc;
+    double *x = s->x;
+    unsigned long b, first, last;
+
+    for (b = begin; b < end; b++) {
+        first = b * NRM2_BLOCK;
+        last = (first + NRM2_BLOCK < s->n) ? first + NRM2_BLOCK : s->n;
+        acc[b].big = acc[b].med = acc[b].sml = 0.0;
+        reduce_dnrm2_acc(x + first, last - first, &acc[b]);
+    }
+
+    return 0.0;
+}
+
+static double double_nrm2_parallel(void *p) {
+
+    vec_state *s = p;
+    unsigned long nb = NRM2_BLOCKS(s->n), b;
+    dnrm2_acc total = {0.0, 0.0, 0.0}, *acc = s->acc;
+
+    par_for(nb, double_nrm2_blocks, s);
+    for (b = 0; b < nb; b++) {
+        total.big += acc[b].big;
+        total.med += acc[b].med;
+        total.sml += acc[b].sml;
+    }
+
+    return reduce_dnrm2_finish(&total);
+}
+
+
+/*
+ *
+ * Compute vector-scalar product
+ * AXPY
+ *
+ * y = a * x + y
+ *
+ * Naive implementation
+ *
+ */
+static void *int_axpy_setup(unsigned long size) {
+
+    vec_state *s = vec_alloc(size, sizeof (int), 1);
+    int *x, *y;
+
+    if (s == NULL) return NULL;
+    x = s->x;
+    y = s->y;
+
+    s->a = (int) (10 * rng_uniform(RNG_SCALAR, 0));
+
+    /* fill x and y vectors with random ints */
+    rng_int(x, size, 0, 10, RNG_X, 0);
+    rng_int(y, size, 0, 10, RNG_Y, 0);
+
+    return s;
+}
+
+static double int_axpy_range(void *p, unsigned long begin, unsigned long end) {
+
+    vec_state *s = p;
+    int *x = s->x, *y = s->y;
+    int a = (int) s->a;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) {
+        y[i] = a * x[i] + y[i];
+    }
+
+    return 0.0;
+}
+
+static double int_axpy_compute(void *p) {
+
+    vec_state *s = p;
+
+    int_axpy_range(s, 0, s->n);
+
+    return ((int *) s->y)[0];
+}
+
+static double int_axpy_parallel(void *p) {
+
+    vec_state *s = p;
+
+    par_for(s->n, int_axpy_range, s);
+
+    return ((int *) s->y)[0];
+}
+
+static void *float_axpy_setup(unsigned long size) {
+
+    vec_state *s = vec_alloc(size, sizeof (float), 1);
+    float *x, *y;
+
+    if (s == NULL) return NULL;
+    x = s->x;
+    y = s->y;
+
+    s->a = (float) (10 * rng_uniform(RNG_SCALAR, 0));
+
+    /* fill x and y vectors with random floats */
+    rng_float(x, size, 0.0f, 10.0f, RNG_X, 0);
+    rng_float(y, size, 0.0f, 10.0f, RNG_Y, 0);
+
+    return s;
+}
+
+static double float_axpy_range(void *p, unsigned long begin, unsigned long end) {
+
+    vec_state *s = p;
+    float *x = s->x, *y = s->y;
+
+    simd->saxpy((float) s->a, x + begin, y + begin, end - begin);
+
+    return 0.0;
+}
+
+static double float_axpy_compute(void *p) {
+
+    vec_state *s = p;
+
+    float_axpy_range(s, 0, s->n);
+
+    return ((float *) s->y)[0];
+}
+
+static double float_axpy_parallel(void *p) {
+
+    vec_state *s = p;
+
+    par_for(s->n, float_axpy_range, s);
+
+    return ((float *) s->y)[0];
+}
+
+static void *double_axpy_setup(unsigned long size) {
+
+    vec_state *s = vec_alloc(size, sizeof (double), 1);
+    double *x, *y;
+
+    if (s == NULL) return NULL;
+    x = s->x;
+    y = s->y;
+
+    s->a = 10 * rng_uniform(RNG_SCALAR, 0);
+
+    /* fill x and y vectors with random doubles */
+    rng_double(x, size, 0.0, 10.0, RNG_X, 0);
+    rng_double(y, size, 0.0, 10.0, RNG_Y, 0);
+
+    return s;
+}
+
+static double double_axpy_range(void *p, unsigned long begin, unsigned long end) {
+
+    vec_state *s = p;
+    double *x = s->x, *y = s->y;
+
+    simd->daxpy(s->a, x + begin, y + begin, end - begin);
+
+    return 0.0;
+}
+
+static double double_axpy_compute(void *p) {
+
+    vec_state *s = p;
+
+    double_axpy_range(s, 0, s->n);
+
+    return ((double *) s->y)[0];
+}
+
+static double double_axpy_parallel(void *p) {
+
+    vec_state *s = p;
+
+    par_for(s->n, double_axpy_range, s);
+
+    return ((double *) s->y)[0];
+}
+
+/*
+ * fp16 overflows past 65504, so the 16-bit kernels flip the sign of a
+ * after every repetition and y stays in range however many are run.
+ */
+static void *half_axpy_setup(unsigned long size, int bf16) {
+
+    vec_state *s = vec_alloc(size, sizeof (uint16_t), 1);
+
+    if (s == NULL) return NULL;
+    s->bf16 = bf16;
+
+    s->a = (float) (10 * rng_uniform(RNG_SCALAR, 0));
+    half_fill(bf16, s->x, size, RNG_X);
+    half_fill(bf16, s->y, size, RNG_Y);
+
+    return s;
+}
+
+static void *fp16_axpy_setup(unsigned long size) { return half_axpy_setup(size, 0); }
+static void *bf16_axpy_setup(unsigned long size) { return half_axpy_setup(size, 1); }
+
+static double half_axpy_range(void *p, unsigned long begin, unsigned long end) {
+
+    vec_state *s = p;
+    uint16_t *v1 = s->x, *v2 = s->y;
+    float x[HALF_BLOCK], y[HALF_BLOCK];
+    unsigned long i, len;
+
+    for (i = begin; i < end; i += len) {
+        len = (end - i < HALF_BLOCK) ? end - i : HALF_BLOCK;
+        half_load(s->bf16, v1 + i, x, len);
+        half_load(s->bf16, v2 + i, y, len);
+        simd->saxpy((float) s->a, x, y, len);
+        half_store(s->bf16, y, v2 + i, len);
+    }
+
+    return 0.0;
+}
+
+static double half_axpy_compute(void *p) {
+
+    vec_state *s = p;
+
+    half_axpy_range(s, 0, s->n);
+    s->a = -s->a;
+
+    return half_value(s->bf16, ((uint16_t *) s->y)[0]);
+}
+
+static double half_axpy_parallel(void *p) {
+
+    vec_state *s = p;
+
+    par_for(s->n, half_axpy_range, s);
+    s->a = -s->a;
+
+    return half_value(s->bf16, ((uint16_t *) s->y)[0]);
+}
+
+/* The widening kernels flip the sign of a after each repetition, so y returns to its values unless it saturated */
+static void *wide_axpy_setup(unsigned long size, size_t elem) {
+
+    vec_state *s = vec_alloc(size, elem, 1);
+
+    if (s == NULL) return NULL;
+
+    s->a = (int) (10 * rng_uniform(RNG_SCALAR, 0));
+    wide_fill(elem, s->x, size, RNG_X, 0);
+    wide_fill(elem, s->y, size, RNG_Y, 0);
+
+    return s;
+}
+
+static void *int16_axpy_setup(unsigned long size) { return wide_axpy_setup(size, sizeof (int16_t)); }
+static void *int32_axpy_setup(unsigned long size) { return wide_axpy_setup(size, sizeof (int32_t)); }
+static void *int64_axpy_setup(unsigned long size) { return wide_axpy_setup(size, sizeof (int64_t)); }
+
+static double int16_axpy_range(void *p, unsigned long begin, unsigned long end) {
+
+    vec_state *s = p;
+
+    simd->i16axpy((int) s->a, (int16_t *) s->x + begin, (int16_t *) s->y + begin, end - begin);
+
+    return 0.0;
+}
+
+static double int32_axpy_range(void *p, unsigned long begin, unsigned long end) {
+
+    vec_state *s = p;
+    int32_t *x = s->x, *y = s->y;
+    long long a = (int) s->a;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) {
+        y[i] = sat32(a * x[i] + y[i]);
+    }
+
+    return 0.0;
+}
+
+static double int64_axpy_range(void *p, unsigned long begin, unsigned long end) {
+
+    vec_state *s = p;
+    int64_t *x = s->x, *y = s->y;
+    int64_t a = (int) s->a;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) {
+        y[i] = sat64(a, x[i], y[i]);
+    }
+
+    return 0.0;
+}
+
+/* One repetition of the AXPY range over all of y, threaded or not */
+static double wide_axpy_run(vec_state *s, double (*range)(void *, unsigned long, unsigned long), int parallel) {
+
+    if (parallel) par_for(s->n, range, s);
+    else range(s, 0, s->n);
+    s->a = -s->a;
+
+    return wide_value(s->elem, s->y);
+}
+
+static double int16_axpy_compute(void *p) { return wide_axpy_run(p, int16_axpy_range, 0); }
+static double int32_axpy_compute(void *p) { return wide_axpy_run(p, int32_axpy_range, 0); }
+static double int64_axpy_compute(void *p) { return wide_axpy_run(p, int64_axpy_range, 0); }
+static double int16_axpy_parallel(void *p) { return wide_axpy_run(p, int16_axpy_range, 1); }
+static double int32_axpy_parallel(void *p) { return wide_axpy_run(p, int32_axpy_range, 1); }
+static double int64_axpy_parallel(void *p) { return wide_axpy_run(p, int64_axpy_range, 1); }
+
+
+/*
+ * AXPY followed by the squared norm of the result, y = y + a * x and
+ * y . y, as in the residual update of CG. The plain kernels make two
+ * passes, the second reading y again; the fused ones record both
+ * operations and run them in one blocked pass (see fuse.h), which
+ * reads x and y once and writes y once. Same data as the AXPY kernels.
+ */
+static double float_axpy_dot_compute(void *p) {
+
+    vec_state *s = p;
+
+    float_axpy_range(s, 0, s->n);
+
+    return simd->ssumsq(s->y, s->n);
+}
+
+static double float_sumsq_range(void *p, unsigned long begin, unsigned long end) {
+
+    vec_state *s = p;
+
+    return simd->ssumsq((float *) s->y + begin, end - begin);
+}
+
+static double float_axpy_dot_parallel(void *p) {
+
+    vec_state *s = p;
+
+    par_for(s->n, float_axpy_range, s);
+
+    return par_for(s->n, float_sumsq_range, s);
+}
+
+
+static double double_axpy_dot_compute(void *p) {
+
+    vec_state *s = p;
+
+    double_axpy_range(s, 0, s->n);
+
+    return simd->dsumsq(s->y, s->n);
+}
+
+static double double_sumsq_range(void *p, unsigned long begin, unsigned long end) {
+
+    vec_state *s = p;
+
+    return simd->dsumsq((double *) s->y + begin, end - begin);
+}
+
+static double double_axpy_dot_parallel(void *p) {
+
+    vec_state *s = p;
+
+    par_for(s->n, double_axpy_range, s);
+
+    return par_for(s->n, double_sumsq_range, s);
+}
+
+/* The fused kernels serve float and double alike */
+static void *float_axpy_fused_setup(unsigned long size) { return vec_acc_alloc(float_axpy_setup(size), fuse_sums(size) * sizeof (double)); }
+static void *double_axpy_fused_setup(unsigned long size) { return vec_acc_alloc(double_axpy_setup(size), fuse_sums(size) * sizeof (double)); }
+
+static void axpy_dot_record(fuse_t *f, vec_state *s, double *yy) {
+
+    fuse_init(f, s->elem == sizeof (float) ? FUSE_FLOAT : FUSE_DOUBLE, s->n, s->acc);
+    fuse_axpy(f, s->a, s->x, s->y);
+    fuse_dot(f, s->y, s->y, yy);
+}
+
+static double axpy_dot_fused(vec_state *s, int par) {
+
+    fuse_t f;
+    double yy;
+
+    axpy_dot_record(&f, s, &yy);
+    fuse_run(&f, par);
+
+    return yy;
+}
+
+static double axpy_dot_fused_compute(void *p) { return axpy_dot_fused(p, 0); }
+static double axpy_dot_fused_parallel(void *p) { return axpy_dot_fused(p, 1); }
+
+static double axpy_dot_fused_bytes(void *p) {
+
+    fuse_t f;
+    double yy;
+
+    axpy_dot_record(&f, p, &yy);
+
+    return fuse_bytes(&f);
+}
+
+static double axpy_dot_saved(void *p) {
+
+    fuse_t f;
+    double yy;
+
+    axpy_dot_record(&f, p, &yy);
+
+    return fuse_unfused_bytes(&f) - fuse_bytes(&f);
+}
+
+
+/*
+ * Dense Matrix-Vector product
+ *
+ * y = A * x (dmv) or y = A^T * x (dmv_t)
+ * where A is a square matrix
+ *
+ * Input:  number of elements in vectors and of rows/cols
+ *         in matrix
+ *
+ * A is one row-major block with its rows ld elements apart, ld being
+ * n padded to a whole number of cache lines, and not a multiple of
+ * 4 KiB so that the rows of a block do not alias in the cache. The
+ * product takes DMV_ROWS rows at a time, each with a row of lane
+ * accumulators, so every load of x serves DMV_ROWS rows and the
+ * compiler can keep the accumulators in vector registers. The
+ * transposed product adds DMV_ROWS rows, scaled by their elements of
+ * x, into y at a time; its threaded variant splits the columns, so
+ * each y element is summed in the same order on any number of threads.
+ */
+#define DMV_ROWS 4
+#define DMV_LINE 64
+#define DMV_ILANES 8
+#define DMV_SLANES 8
+#define DMV_DLANES 4
+
+/* Row length of a matrix with size columns, padded as described above */
+static unsigned long padded_ld(unsigned long size, size_t elem) {
+
+    unsigned long ld = (size * elem + DMV_LINE - 1) / DMV_LINE * DMV_LINE / elem;
+
+    if ((ld * elem) % 4096 == 0) ld += DMV_LINE / elem;
+    return ld;
+}
+
+static dmv_state *dmv_alloc(unsigned long size, size_t elem, size_t yelem) {
+
+    dmv_state *s = calloc(1, sizeof (dmv_state));
+
+    if (s == NULL) return NULL;
+
+    s->n = size;
+    s->elem = elem;
+    s->yelem = yelem;
+    s->ld = padded_ld(size, elem);
+
+    /* create two vectors */
+    s->x = mem_alloc(size * elem);
+    s->y = mem_calloc(size, yelem);
+
+    /* create matrix */
+    s->A = mem_alloc(size * s->ld * elem);
+
+    if (s->x == NULL || s->y == NULL || s->A == NULL) {
+        printf("Out Of Memory: could not allocate space for the vectors and matrix.\n");
+        mem_free(s->x);
+        mem_free(s->y);
+        mem_free(s->A);
+        free(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+static void dmv_teardown(void *p) {
+
+    dmv_state *s = p;
+
+    mem_free(s->A);
+    mem_free(s->x);
+    mem_free(s->y);
+    free(s);
+}
+
+static double dmv_flops(void *p) { dmv_state *s = p; return 2.0 * s->n * s->n; }
+static double dmv_bytes(void *p) { dmv_state *s = p; return ((double) s->n * s->n + s->n) * s->elem + 2.0 * s->n * s->yelem; }
+static double dmv_footprint(void *p) { dmv_state *s = p; return ((double) s->n * s->n + s->n) * s->elem + (double) s->n * s->yelem; }
+static int dmv_resize(void *p, unsigned long size) { ((dmv_state *) p)->n = size; return 0; }
+
+static void int_dmv_rows(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) {
+        rng_int((int *) s->A + i * s->ld, s->n, 0, 10, RNG_A, (unsigned long long) i * s->n);
+    }
+}
+
+static void *int_dmv_setup(unsigned long size) {
+
+    dmv_state *s = dmv_alloc(size, sizeof (int), sizeof (long long));
+    int *x;
+
+    if (s == NULL) return NULL;
+    x = s->x;
+
+    /* fill vector x and matrix A with random values, rows split over the setup threads */
+    rng_int(x, size, 0, 10, RNG_X, 0);
+    pool_for(size, int_dmv_rows, s);
+
+    return s;
+}
+
+static double int_dmv_range(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    const int *A = s->A, *x = s->x, *a;
+    long long *y = s->y;
+    long long acc[DMV_ROWS][DMV_ILANES], sum;
+    unsigned long i, j, jt, n = s->n, ld = s->ld;
+    int r, k;
+
+    for (i = begin; i + DMV_ROWS <= end; i += DMV_ROWS) {
+        a = A + i * ld;
+        for (r = 0; r < DMV_ROWS; r++)
+            for (k = 0; k < DMV_ILANES; k++) acc[r][k] = 0;
+        for (j = 0; j + DMV_ILANES <= n; j += DMV_ILANES)
+            for (r = 0; r < DMV_ROWS; r++)
+                for (k = 0; k < DMV_ILANES; k++) acc[r][k] = acc[r][k] + (long long) a[r * ld + j + k] * x[j + k];
+        for (r = 0; r < DMV_ROWS; r++) {
+            sum = 0;
+            for (k = 0; k < DMV_ILANES; k++) sum = sum + acc[r][k];
+            for (jt = j; jt < n; jt++) sum = sum + (long long) a[r * ld + jt] * x[jt];
+            y[i + r] = sum;
+        }
+    }
+    for (; i < end; i++) {
+        a = A + i * ld;
+        sum = 0;
+        for (j = 0; j < n; j++) sum = sum + (long long) a[j] * x[j];
+        y[i] = sum;
+    }
+
+    return 0.0;
+}
+
+static double int_dmv_compute(void *p) {
+
+    dmv_state *s = p;
+
+    int_dmv_range(s, 0, s->n);
+
+    return ((long long *) s->y)[0];
+}
+
+static double int_dmv_parallel(void *p) {
+
+    dmv_state *s = p;
+
+    par_for(s->n, int_dmv_range, s);
+
+    return ((long long *) s->y)[0];
+}
+
+/* Columns [begin, end) of y = A^T * x */
+static double int_dmv_t_range(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    const int *A = s->A, *x = s->x, *a;
+    long long *y = s->y;
+    long long x0, x1, x2, x3;
+    unsigned long i, j, n = s->n, ld = s->ld;
+
+    for (j = begin; j < end; j++) y[j] = 0;
+    for (i = 0; i + DMV_ROWS <= n; i += DMV_ROWS) {
+        a = A + i * ld;
+        x0 = x[i];
+        x1 = x[i + 1];
+        x2 = x[i + 2];
+        x3 = x[i + 3];
+        for (j = begin; j < end; j++)
+            y[j] = y[j] + (a[j] * x0 + a[ld + j] * x1 + a[2 * ld + j] * x2 + a[3 * ld + j] * x3);
+    }
+    for (; i < n; i++) {
+        a = A + i * ld;
+        for (j = begin; j < end; j++) y[j] = y[j] + (long long) a[j] * x[i];
+    }
+
+    return 0.0;
+}
+
+static double int_dmv_t_compute(void *p) {
+
+    dmv_state *s = p;
+
+    int_dmv_t_range(s, 0, s->n);
+
+    return ((long long *) s->y)[0];
+}
+
+static double int_dmv_t_parallel(void *p) {
+
+    dmv_state *s = p;
+
+    par_for(s->n, int_dmv_t_range, s);
+
+    return ((long long *) s->y)[0];
+}
+
+static void float_dmv_rows(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) {
+        rng_float((float *) s->A + i * s->ld, s->n, 0.0f, 10.0f, RNG_A, (unsigned long long) i * s->n);
+    }
+}
+
+static void *float_dmv_setup(unsigned long size) {
+
+    dmv_state *s = dmv_alloc(size, sizeof (float), sizeof (float));
+    float *x;
+
+    if (s == NULL) return NULL;
+    x = s->x;
+
+    /* fill vector x and matrix A with random values, rows split over the setup threads */
+    rng_float(x, size, 0.0f, 10.0f, RNG_X, 0);
+    pool_for(size, float_dmv_rows, s);
+
+    return s;
+}
+
+static double float_dmv_range(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    const float *A = s->A, *x = s->x, *a;
+    float *y = s->y;
+    float acc[DMV_ROWS][DMV_SLANES], sum;
+    unsigned long i, j, jt, n = s->n, ld = s->ld;
+    int r, k;
+
+    for (i = begin; i + DMV_ROWS <= end; i += DMV_ROWS) {
+        a = A + i * ld;
+        for (r = 0; r < DMV_ROWS; r++)
+            for (k = 0; k < DMV_SLANES; k++) acc[r][k] = 0.0f;
+        for (j = 0; j + DMV_SLANES <= n; j += DMV_SLANES)
+            for (r = 0; r < DMV_ROWS; r++)
+                for (k = 0; k < DMV_SLANES; k++) acc[r][k] = acc[r][k] + a[r * ld + j + k] * x[j + k];
+        for (r = 0; r < DMV_ROWS; r++) {
+            sum = 0.0f;
+            for (k = 0; k < DMV_SLANES; k++) sum = sum + acc[r][k];
+            for (jt = j; jt < n; jt++) sum = sum + a[r * ld + jt] * x[jt];
+            y[i + r] = sum;
+        }
+    }
+    for (; i < end; i++) {
+        a = A + i * ld;
+        sum = 0.0f;
+        for (j = 0; j < n; j++) sum = sum + a[j] * x[j];
+        y[i] = sum;
+    }
+
+    return 0.0;
+}
+
+static double float_dmv_compute(void *p) {
+
+    dmv_state *s = p;
+
+    float_dmv_range(s, 0, s->n);
+
+    return ((float *) s->y)[0];
+}
+
+static double float_dmv_parallel(void *p) {
+
+    dmv_state *s = p;
+
+    par_for(s->n, float_dmv_range, s);
+
+    return ((float *) s->y)[0];
+}
+
+/* Columns [begin, end) of y = A^T * x */
+static double float_dmv_t_range(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    const float *A = s->A, *x = s->x, *a;
+    float *y = s->y;
+    float x0, x1, x2, x3;
+    unsigned long i, j, n = s->n, ld = s->ld;
+
+    for (j = begin; j < end; j++) y[j] = 0.0f;
+    for (i = 0; i + DMV_ROWS <= n; i += DMV_ROWS) {
+        a = A + i * ld;
+        x0 = x[i];
+        x1 = x[i + 1];
+        x2 = x[i + 2];
+        x3 = x[i + 3];
+        for (j = begin; j < end; j++)
+            y[j] = y[j] + (a[j] * x0 + a[ld + j] * x1 + a[2 * ld + j] * x2 + a[3 * ld + j] * x3);
+    }
+    for (; i < n; i++) {
+        a = A + i * ld;
+        for (j = begin; j < end; j++) y[j] = y[j] + a[j] * x[i];
+    }
+
+    return 0.0;
+}
+
+static double float_dmv_t_compute(void *p) {
+
+    dmv_state *s = p;
+
+    float_dmv_t_range(s, 0, s->n);
+
+    return ((float *) s->y)[0];
+}
+
+static double float_dmv_t_parallel(void *p) {
+
+    dmv_state *s = p;
+
+    par_for(s->n, float_dmv_t_range, s);
+
+    return ((float *) s->y)[0];
+}
+
+static void double_dmv_rows(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) {
+        rng_double((double *) s->A + i * s->ld, s->n, 0.0, 10.0, RNG_A, (unsigned long long) i * s->n);
+    }
+}
+
+static void *double_dmv_setup(unsigned long size) {
+
+    dmv_state *s = dmv_alloc(size, sizeof (double), sizeof (double));
+    double *x;
+
+    if (s == NULL) return NULL;
+    x = s->x;
+
+    /* fill vector x and matrix A with random values, rows split over the setup threads */
+    rng_double(x, size, 0.0, 10.0, RNG_X, 0);
+    pool_for(size, double_dmv_rows, s);
+
+    return s;
+}
+
+static double double_dmv_range(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    const double *A = s->A, *x = s->x, *a;
+    double *y = s->y;
+    double acc[DMV_ROWS][DMV_DLANES], sum;
+    unsigned long i, j, jt, n = s->n, ld = s->ld;
+    int r, k;
+
+    for (i = begin; i + DMV_ROWS <= end; i += DMV_ROWS) {
+        a = A + i * ld;
+        for (r = 0; r < DMV_ROWS; r++)
+            for (k = 0; k < DMV_DLANES; k++) acc[r][k] = 0.0;
+        for (j = 0; j + DMV_DLANES <= n; j += DMV_DLANES)
+            for (r = 0; r < DMV_ROWS; r++)
+                for (k = 0; k < DMV_DLANES; k++) acc[r][k] = acc[r][k] + a[r * ld + j + k] * x[j + k];
+        for (r = 0; r < DMV_ROWS; r++) {
+            sum = 0.0;
+            for (k = 0; k < DMV_DLANES; k++) sum = sum + acc[r][k];
+            for (jt = j; jt < n; jt++) sum = sum + a[r * ld + jt] * x[jt];
+            y[i + r] = sum;
+        }
+    }
+    for (; i < end; i++) {
+        a = A + i * ld;
+        sum = 0.0;
+        for (j = 0; j < n; j++) sum = sum + a[j] * x[j];
+        y[i] = sum;
+    }
+
+    return 0.0;
+}
+
+static double double_dmv_compute(void *p) {
+
+    dmv_state *s = p;
+
+    double_dmv_range(s, 0, s->n);
+
+    return ((double *) s->y)[0];
+}
+
+static double double_dmv_parallel(void *p) {
+
+    dmv_state *s = p;
+
+    par_for(s->n, double_dmv_range, s);
+
+    return ((double *) s->y)[0];
+}
+
+/* Columns [begin, end) of y = A^T * x */
+static double double_dmv_t_range(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    const double *A = s->A, *x = s->x, *a;
+    double *y = s->y;
+    double x0, x1, x2, x3;
+    unsigned long i, j, n = s->n, ld = s->ld;
+
+    for (j = begin; j < end; j++) y[j] = 0.0;
+    for (i = 0; i + DMV_ROWS <= n; i += DMV_ROWS) {
+        a = A + i * ld;
+        x0 = x[i];
+        x1 = x[i + 1];
+        x2 = x[i + 2];
+        x3 = x[i + 3];
+        for (j = begin; j < end; j++)
+            y[j] = y[j] + (a[j] * x0 + a[ld + j] * x1 + a[2 * ld + j] * x2 + a[3 * ld + j] * x3);
+    }
+    for (; i < n; i++) {
+        a = A + i * ld;
+        for (j = begin; j < end; j++) y[j] = y[j] + a[j] * x[i];
+    }
+
+    return 0.0;
+}
+
+static double double_dmv_t_compute(void *p) {
+
+    dmv_state *s = p;
+
+    double_dmv_t_range(s, 0, s->n);
+
+    return ((double *) s->y)[0];
+}
+
+static double double_dmv_t_parallel(void *p) {
+
+    dmv_state *s = p;
+
+    par_for(s->n, double_dmv_t_range, s);
+
+    return ((double *) s->y)[0];
+}
+
+/*
+ * The int16, int32 and int64 products sum each row into an int64
+ * element of y with the dot product kernels, which a row of A is long
+ * enough to keep busy. Same data as their dot products.
+ */
+static void wide_dmv_rows(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) {
+        wide_fill(s->elem, (char *) s->A + i * s->ld * s->elem, s->n, RNG_A, (unsigned long long) i * s->n);
+    }
+}
+
+static void *wide_dmv_setup(unsigned long size, size_t elem) {
+
+    dmv_state *s = dmv_alloc(size, elem, sizeof (int64_t));
+
+    if (s == NULL) return NULL;
+
+    /* fill vector x and matrix A with random values, rows split over the setup threads */
+    wide_fill(elem, s->x, size, RNG_X, 0);
+    pool_for(size, wide_dmv_rows, s);
+
+    return s;
+}
+
+static void *int16_dmv_setup(unsigned long size) { return wide_dmv_setup(size, sizeof (int16_t)); }
+static void *int32_dmv_setup(unsigned long size) { return wide_dmv_setup(size, sizeof (int32_t)); }
+static void *int64_dmv_setup(unsigned long size) { return wide_dmv_setup(size, sizeof (int64_t)); }
+
+static double int16_dmv_range(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    const int16_t *A = s->A, *x = s->x;
+    int64_t *y = s->y;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) y[i] = simd->i16dot(A + i * s->ld, x, s->n);
+
+    return 0.0;
+}
+
+static double int32_dmv_range(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    const int32_t *A = s->A, *x = s->x;
+    int64_t *y = s->y;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) y[i] = simd->i32dot(A + i * s->ld, x, s->n);
+
+    return 0.0;
+}
+
+static double int64_dmv_range(void *p, unsigned long begin, unsigned long end) {
+
+    dmv_state *s = p;
+    const int64_t *A = s->A, *x = s->x;
+    int64_t *y = s->y;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) y[i] = sat_wide(int64_dot(A + i * s->ld, x, s->n));
+
+    return 0.0;
+}
+
+/* One product over all rows, threaded or not */
+static double wide_dmv_run(dmv_state *s, double (*range)(void *, unsigned long, unsigned long), int parallel) {
+
+    if (parallel) par_for(s->n, range, s);
+    else range(s, 0, s->n);
+
+    return ((int64_t *) s->y)[0];
+}
+
+static double int16_dmv_compute(void *p) { return wide_dmv_run(p, int16_dmv_range, 0); }
+static double int32_dmv_compute(void *p) { return wide_dmv_run(p, int32_dmv_range, 0); }
+static double int64_dmv_compute(void *p) { return wide_dmv_run(p, int64_dmv_range, 0); }
+static double int16_dmv_parallel(void *p) { return wide_dmv_run(p, int16_dmv_range, 1); }
+static double int32_dmv_parallel(void *p) { return wide_dmv_run(p, int32_dmv_range, 1); }
+static double int64_dmv_parallel(void *p) { return wide_dmv_run(p, int64_dmv_range, 1); }
+
+
+/*
+ * Dense Matrix-Matrix product
+ *
+ * C = A * B
+ * where A and B are square matrices
+ *
+ * Input:  number of rows/cols in the matrices
+ *
+ * The matrices are laid out as for DMV. gemm is the cache-blocked,
+ * packed product of gemm.h, bound by the floating point units rather
+ * than by memory; gemm_naive is the textbook triple loop, for
+ * comparison. Their threaded variants split the rows of C.
+ */
+static gemm_state *gemm_alloc(unsigned long size, size_t elem) {
+
+    gemm_state *s = calloc(1, sizeof (gemm_state));
+
+    if (s == NULL) return NULL;
+
+    s->n = size;
+    s->elem = elem;
+    s->ld = padded_ld(size, elem);
+    s->A = mem_alloc(size * s->ld * elem);
+    s->B = mem_alloc(size * s->ld * elem);
+    s->C = mem_calloc(size * s->ld, elem);
+
+    if (s->A == NULL || s->B == NULL || s->C == NULL) {
+        printf("Out Of Memory: could not allocate space for the matrices.\n");
+        mem_free(s->A);
+        mem_free(s->B);
+        mem_free(s->C);
+        free(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+static void gemm_teardown(void *p) {
+
+    gemm_state *s = p;
+
+    mem_free(s->A);
+    mem_free(s->B);
+    mem_free(s->C);
+    free(s->pa);
+    free(s->pb);
+    free(s);
+}
+
+/* Packing buffers for products of up to n rows, so that gemm allocates nothing while it is timed */
+static gemm_state *gemm_pack_alloc(gemm_state *s, int dp) {
+
+    unsigned long pa, pb;
+
+    if (s == NULL) return NULL;
+
+    gemm_pack_size(dp, s->n, &pa, &pb);
+    s->pa = malloc(pa * s->elem);
+    s->pb = malloc(pb * s->elem);
+    if (s->pa == NULL || s->pb == NULL) {
+        printf("Out Of Memory: could not allocate the GEMM packing buffers.\n");
+        gemm_teardown(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+static double gemm_flops(void *p) { gemm_state *s = p; return 2.0 * s->n * s->n * s->n; }
+static double gemm_bytes(void *p) { gemm_state *s = p; return 3.0 * s->n * s->n * s->elem; }
+static double gemm_footprint(void *p) { gemm_state *s = p; return 3.0 * s->n * s->n * s->elem; }
+static int gemm_resize(void *p, unsigned long size) { ((gemm_state *) p)->n = size; return 0; }
+
+static void float_gemm_rows(void *p, unsigned long begin, unsigned long end) {
+
+    gemm_state *s = p;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) {
+        rng_float((float *) s->A + i * s->ld, s->n, 0.0f, 10.0f, RNG_A, (unsigned long long) i * s->n);
+        rng_float((float *) s->B + i * s->ld, s->n, 0.0f, 10.0f, RNG_B, (unsigned long long) i * s->n);
+    }
+}
+
+static void *float_gemm_naive_setup(unsigned long size) {
+
+    gemm_state *s = gemm_alloc(size, sizeof (float));
+
+    if (s == NULL) return NULL;
+
+    /* fill matrices A and B with random values, rows split over the setup threads */
+    pool_for(size, float_gemm_rows, s);
+
+    return s;
+}
+
+static void *float_gemm_setup(unsigned long size) { return gemm_pack_alloc(float_gemm_naive_setup(size), 0); }
+
+static double float_gemm(gemm_state *s, int par) {
+
+    gemm_sgemm(s->n, s->n, s->n, s->A, s->ld, s->B, s->ld, s->C, s->ld, par, s->pa, s->pb);
+
+    return ((float *) s->C)[0];
+}
+
+static double float_gemm_compute(void *p) { return float_gemm(p, 0); }
+static double float_gemm_parallel(void *p) { return float_gemm(p, 1); }
+
+static double float_gemm_naive_range(void *p, unsigned long begin, unsigned long end) {
+
+    gemm_state *s = p;
+    const float *A = s->A, *B = s->B;
+    float *C = s->C, sum;
+    unsigned long i, j, k, n = s->n, ld = s->ld;
+
+    for (i = begin; i < end; i++) {
+        for (j = 0; j < n; j++) {
+            sum = 0.0f;
+            for (k = 0; k < n; k++) sum = sum + A[i * ld + k] * B[k * ld + j];
+            C[i * ld + j] = sum;
+        }
+    }
+
+    return 0.0;
+}
+
+static double float_gemm_naive_compute(void *p) {
+
+    gemm_state *s = p;
+
+    float_gemm_naive_range(s, 0, s->n);
+
+    return ((float *) s->C)[0];
+}
+
+static double float_gemm_naive_parallel(void *p) {
+
+    gemm_state *s = p;
+
+    par_for(s->n, float_gemm_naive_range, s);
+
+    return ((float *) s->C)[0];
+}
+
+static void double_gemm_rows(void *p, unsigned long begin, unsigned long end) {
+
+    gemm_state *s = p;
+    unsigned long i;
+
+    for (i = begin; i < end; i++) {
+        rng_double((double *) s->A + i * s->ld, s->n, 0.0, 10.0, RNG_A, (unsigned long long) i * s->n);
+        rng_double((double *) s->B + i * s->ld, s->n, 0.0, 10.0, RNG_B, (unsigned long long) i * s->n);
+    }
+}
+
+static void *double_gemm_naive_setup(unsigned long size) {
+
+    gemm_state *s = gemm_alloc(size, sizeof (double));
+
+    if (s == NULL) return NULL;
+
+    /* fill matrices A and B with random values, rows split over the setup threads */
+    pool_for(size, double_gemm_rows, s);
+
+    return s;
+}
+
+static void *double_gemm_setup(unsigned long size) { return gemm_pack_alloc(double_gemm_naive_setup(size), 1); }
+
+static double double_gemm(gemm_state *s, int par) {
+
+    gemm_dgemm(s->n, s->n, s->n, s->A, s->ld, s->B, s->ld, s->C, s->ld, par, s->pa, s->pb);
+
+    return ((double *) s->C)[0];
+}
+
+static double double_gemm_compute(void *p) { return double_gemm(p, 0); }
+static double double_gemm_parallel(void *p) { return double_gemm(p, 1); }
+
+static double double_gemm_naive_range(void *p, unsigned long begin, unsigned long end) {
+
+    gemm_state *s = p;
+    const double *A = s->A, *B = s->B;
+    double *C = s->C, sum;
+    unsigned long i, j, k, n = s->n, ld = s->ld;
+
+    for (i = begin; i < end; i++) {
+        for (j = 0; j < n; j++) {
+            sum = 0.0;
+            for (k = 0; k < n; k++) sum = sum + A[i * ld + k] * B[k * ld + j];
+            C[i * ld + j] = sum;
+        }
+    }
+
+    return 0.0;
+}
+
+static double double_gemm_naive_compute(void *p) {
+
+    gemm_state *s = p;
+
+    double_gemm_naive_range(s, 0, s->n);
+
+    return ((double *) s->C)[0];
+}
+
+static double double_gemm_naive_parallel(void *p) {
+
+    gemm_state *s = p;
+
+    par_for(s->n, double_gemm_naive_range, s);
+
+    return ((double *) s->C)[0];
+}
+
+
+/*
+ * Read a CSR matrix file as written by mm_to_csr. The first line
+ * holds nz, the number of column indices and the number of row
+ * pointers; values, column indices and row pointers follow one per
+ * line. Values are stored as doubles and narrowed by the caller.
+ *
+ * Returns 0 on success.
+ */
+static int csr_read(char *filename, int *m, int *n, int *nz,
+                    int **row_idx, int **col_idx, double **values) {
+
+    FILE *f;
+    char line[64];
+    int i;
+
+    if ((f = fopen(filename, "r")) == NULL) {
+        printf("can't open file <%s> \n", filename);
+        return 1;
+    }
+
+    if (fgets(line, sizeof (line), f) == NULL ||
+        sscanf(line, "%d %d %d", nz, n, m) != 3) {
+        printf("Failed to read file\n");
+        fclose(f);
+        return 1;
+    }
+
+    printf("Number of elements of values and col_idx: %d; number of values in row_idx: %d\n", *nz, *m);
+
+    *row_idx = mem_alloc(*m * sizeof (int));
+    *col_idx = mem_alloc(*nz * sizeof (int));
+    *values = mem_alloc(*nz * sizeof (double));
+
+    if (!*row_idx || !*col_idx || !*values) {
+        printf("cannot allocate memory for sparse matrix\n");
+        mem_free(*row_idx);
+        mem_free(*col_idx);
+        mem_free(*values);
+        fclose(f);
+        return 1;
+    }
+
+    /* fill values, then col_idx, then row_idx */
+    for (i = 0; i < *nz; i++) {
+        if (fgets(line, sizeof (line), f) == NULL) break;
+        sscanf(line, "%lf", &(*values)[i]);
+    }
+    for (i = 0; i < *nz && !feof(f); i++) {
+        if (fgets(line, sizeof (line), f) == NULL) break;
+        sscanf(line, "%d", &(*col_idx)[i]);
+    }
+    for (i = 0; i < *m && !feof(f); i++) {
+        if (fgets(line, sizeof (line), f) == NULL) break;
+        sscanf(line, "%d", &(*row_idx)[i]);
+    }
+
+    fclose(f);
+
+    if (i != *m) {
+        printf("Failed to read file\n");
+        mem_free(*row_idx);
+        mem_free(*col_idx);
+        mem_free(*values);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Sparse Matrix-Vector product
+ *
+ * b = A * x
+ * where A is read in CSR format from file
+ *
+ */
+static void *spmv_setup(size_t elem) {
+
+    spmv_state *s = calloc(1, sizeof (spmv_state));
+    double *values;
+    int i;
+
+    if (s == NULL) return NULL;
+
+    if (csr_read(csr_filename, &s->m, &s->n, &s->nz, &s->row_idx, &s->col_idx, &values) != 0) {
+        free(s);
+        return NULL;
+    }
+
+    s->elem = elem;
+    s->velem = elem;
+    s->x = mem_alloc((s->m - 1) * elem);
+    s->b = mem_alloc((s->m - 1) * elem);
+
+    if (!s->x || !s->b) {
+        printf("cannot allocate memory for sparse matrix and vectors\n");
+        mem_free(s->x);
+        mem_free(s->b);
+        mem_free(s->row_idx);
+        mem_free(s->col_idx);
+        mem_free(values);
+        free(s);
+        return NULL;
+    }
+
+    if (elem == sizeof (float)) {
+        float *fv = mem_alloc(s->nz * sizeof (float));
+        float *x = s->x;
+        if (fv == NULL) {
+            printf("cannot allocate memory for sparse matrix and vectors\n");
+            mem_free(s->x);
+            mem_free(s->b);
+            mem_free(s->row_idx);
+            mem_free(s->col_idx);
+            mem_free(values);
+            free(s);
+            return NULL;
+        }
+        for (i = 0; i < s->nz; i++) fv[i] = (float) values[i];
+        for (i = 0; i < s->m - 1; i++) x[i] = i + 1.5; // give basic values to vector x
+        mem_free(values);
+        s->values = fv;
+    } else {
+        double *x = s->x;
+        for (i = 0; i < s->m - 1; i++) x[i] = i + 1.5; // give basic values to vector x
+        s->values = values;
+    }
+
+    printf("memory allocated\n");
+
+    return s;
+}
+
+static void *float_spmv_setup(unsigned long size) { return spmv_setup(sizeof (float)); }
+static void *double_spmv_setup(unsigned long size) { return spmv_setup(sizeof (double)); }
+
+static void spmv_teardown(void *p) {
+
+    spmv_state *s = p;
+
+    mem_free(s->x);
+    mem_free(s->b);
+    mem_free(s->row_idx);
+    mem_free(s->col_idx);
+    mem_free(s->values);
+    free(s);
+}
+
+/* The float matrix with its values rounded to 16 bits; x and b stay float */
+static void *half_spmv_setup(int bf16) {
+
+    spmv_state *s = spmv_setup(sizeof (float));
+    uint16_t *hv;
+
+    if (s == NULL) return NULL;
+    hv = mem_alloc(s->nz * sizeof (uint16_t));
+    if (hv == NULL) {
+        printf("cannot allocate memory for sparse matrix and vectors\n");
+        spmv_teardown(s);
+        return NULL;
+    }
+    half_store(bf16, s->values, hv, s->nz);
+    mem_free(s->values);
+    s->values = hv;
+    s->velem = sizeof (uint16_t);
+    s->bf16 = bf16;
+
+    return s;
+}
+
+static void *fp16_spmv_setup(unsigned long size) { return half_spmv_setup(0); }
+static void *bf16_spmv_setup(unsigned long size) { return half_spmv_setup(1); }
+
+static double spmv_flops(void *p) { return 2.0 * ((spmv_state *) p)->nz; }
+
+static double spmv_bytes(void *p) {
+
+    spmv_state *s = p;
+
+    /* values and column indices, row pointers, x once and b read/write */
+    return (double) s->nz * (s->velem + sizeof (int)) + (double) s->m * sizeof (int)
+           + 3.0 * (s->m - 1) * s->elem;
+}
+
+static double spmv_footprint(void *p) {
+
+    spmv_state *s = p;
+
+    return (double) s->nz * (s->velem + sizeof (int)) + (double) s->m * sizeof (int)
+           + 2.0 * (s->m - 1) * s->elem;
+}
+
+static double float_spmv_range(void *p, unsigned long begin, unsigned long end) {
+
+    spmv_state *s = p;
+    int *row_idx = s->row_idx, *col_idx = s->col_idx;
+    float *values = s->values, *x = s->x, *b = s->b;
+    int i, j;
+
+    /* Ax=b */
+    for (i = begin; i < (int) end; i++) {
+        b[i] = 0;
+        for (j = row_idx[i]; j < row_idx[i + 1]; j++) {
+            b[i] = b[i] + values[j] * x[col_idx[j]];
+        }
+    }
+
+    return 0.0;
+}
+
+static double float_spmv_compute(void *p) {
+
+    spmv_state *s = p;
+
+    float_spmv_range(s, 0, s->m - 1);
+
+    return ((float *) s->b)[0];
+}
+
+static double float_spmv_parallel(void *p) {
+
+    spmv_state *s = p;
+
+    par_for_grain(s->m - 1, SPMV_GRAIN, float_spmv_range, s);
+
+    return ((float *) s->b)[0];
+}
+
+static double double_spmv_range(void *p, unsigned long begin, unsigned long end) {
+
+    spmv_state *s = p;
+    int *row_idx = s->row_idx, *col_idx = s->col_idx;
+    double *values = s->values, *x = s->x, *b = s->b;
+    int i, j;
+
+    /* Ax=b */
+    for (i = begin; i < (int) end; i++) {
+        b[i] = 0;
+        for (j = row_idx[i]; j < row_idx[i + 1]; j++) {
+            b[i] = b[i] + values[j] * x[col_idx[j]];
+        }
     }
 
+    return 0.0;
+}
+
+static double double_spmv_compute(void *p) {
+
+    spmv_state *s = p;
+
+    double_spmv_range(s, 0, s->m - 1);
 
-    /* create matrix */
-    double **A;
-    A = (double **) malloc(size * sizeof (double *));
-    if (A == NULL) {
-        printf("Out Of Memory: could not allocate space for the matrix.\n");
-        return 0;
-    }
-
-    for (i = 0; i < size; i++) {
-        A[i] = (double *) malloc(size * sizeof (double));
-        if (A[i] == NULL) {
-            printf("Out Of Memory: could not allocate space for the matrix.\n");
-            return 0;
-        }
-    }
+    return ((double *) s->b)[0];
+}
 
-    srand((int) time(NULL));
+static double double_spmv_parallel(void *p) {
 
-    struct timespec start, end;
+    spmv_state *s = p;
 
-    r1 = (double) rand() / (double) (RAND_MAX / 10.0);
-    r2 = (double) rand() / (double) (RAND_MAX / 10.0);
+    par_for_grain(s->m - 1, SPMV_GRAIN, double_spmv_range, s);
 
-    /* fill vector x and matrix A with random integer values */
-    for (i = 0; i < size; i++) {
-        x[i] = r1;
-        for (j = 0; j < size; j++) {
-            A[i][j] = r2;
+    return ((double *) s->b)[0];
+}
+
+/*
+ * The values of rows [begin, end) are contiguous, so they are widened
+ * a block at a time across row boundaries, then gathered against x.
+ */
+static double half_spmv_range(void *p, unsigned long begin, unsigned long end) {
+
+    spmv_state *s = p;
+    int *row_idx = s->row_idx, *col_idx = s->col_idx;
+    uint16_t *values = s->values;
+    float *x = s->x, *b = s->b, v[HALF_BLOCK], sum;
+    int i, j, base = 0, lim = row_idx[begin], last = row_idx[end];
+
+    for (i = begin; i < (int) end; i++) {
+        sum = 0.0f;
+        for (j = row_idx[i]; j < row_idx[i + 1]; j++) {
+            if (j == lim) {
+                base = j;
+                lim = (last - j < HALF_BLOCK) ? last : j + HALF_BLOCK;
+                half_load(s->bf16, values + base, v, lim - base);
+            }
+            sum = sum + v[j - base] * x[col_idx[j]];
         }
+        b[i] = sum;
     }
 
-    clock_gettime(CLOCK, &start);
+    return 0.0;
+}
 
-    /* perform matrix-vector product */
-    for (i = 0; i < size; i++) {
-        for (j = 0; j < size; j++) {
-            y[i] = y[i] + A[i][j] * x[j];
-        }
-    }
+static double half_spmv_compute(void *p) {
 
-    clock_gettime(CLOCK, &end);
+    spmv_state *s = p;
 
-    elapsed_time_hr(start, end, "Dense Matrix-Vector product.");
+    half_spmv_range(s, 0, s->m - 1);
 
-    /* print result so compiler does not throw it away */
-    printf("Result vector y[0] = %f\n", y[0]);
+    return ((float *) s->b)[0];
+}
 
+static double half_spmv_parallel(void *p) {
 
-    free(x);
-    free(y);
-    for (i = 0; i < size; i++) free(A[i]);
-    free(A);
+    spmv_state *s = p;
 
-    return 0;
+    par_for_grain(s->m - 1, SPMV_GRAIN, half_spmv_range, s);
 
+    return ((float *) s->b)[0];
 }
 
-int float_spmatvec_product(unsigned long r) {
 
-    int m, n, nz;
+/*
+ * Sparse Matrix-Matrix product
+ *
+ * C = C + A * B
+ * where A is read in CSR format from file and B is the same
+ * matrix converted to CSC.
+ *
+ */
+static void *spgemm_setup(size_t elem) {
+
+    spgemm_state *s = calloc(1, sizeof (spgemm_state));
     int *row_idx, *col_idx;
-    float *values;
-    float *x, *b;
+    double *values;
+    int i, j, k, m;
+    int count = 0, nz_count = 0;
 
-    struct timespec start, end;
+    if (s == NULL) return NULL;
 
-    char *filename = "matrix_sml.csr";
+    if (csr_read(csr_filename, &s->m, &s->n, &s->nz, &row_idx, &col_idx, &values) != 0) {
+        free(s);
+        return NULL;
+    }
 
-    int i, j, rep;
+    s->elem = elem;
+    s->row_csr_idx = row_idx;
+    s->col_csr_idx = col_idx;
+    s->row_csc_idx = mem_alloc(s->nz * sizeof (int));
+    s->col_csc_idx = mem_alloc(s->m * sizeof (int));
+    s->A_csr = mem_alloc(s->nz * elem);
+    s->B_csc = mem_alloc(s->nz * elem);
 
-    FILE *f;
-    char line[64];
-    char *rv = NULL;
+    s->m -= 1;
+    s->n = s->m;
+    m = s->m;
 
-    if (r == ULONG_MAX) r = 1000;
+    s->C = mem_calloc((size_t) m * m, elem);
+    s->threads = par_threads();
+    s->temp_vec = mem_calloc((size_t) s->threads * m, elem);
 
-    if ((f = fopen(filename, "r")) == NULL) {
-        printf("can't open file <%s> \n", filename);
-        exit(1);
+    if (!s->row_csc_idx || !s->col_csc_idx || !s->A_csr || !s->B_csc || !s->C || !s->temp_vec) {
+        printf("cannot allocate memory for %d, %d, %d sparse matrices and %d scratch vectors\n", s->m, s->n, s->nz, s->threads);
+        mem_free(values);
+        mem_free(s->row_csr_idx);
+        mem_free(s->col_csr_idx);
+        mem_free(s->row_csc_idx);
+        mem_free(s->col_csc_idx);
+        mem_free(s->A_csr);
+        mem_free(s->B_csc);
+        mem_free(s->C);
+        mem_free(s->temp_vec);
+        free(s);
+        return NULL;
     }
 
-    rv = fgets(line, sizeof (line), f);
-    if (*rv != EOF) {
-        sscanf(line, "%d %d %d", &nz, &n, &m);
-    } else {
-        printf("Failed to read file\n");
-        exit(1);
+    for (i = 0; i < s->nz; i++) {
+        if (elem == sizeof (float)) ((float *) s->A_csr)[i] = (float) values[i];
+        else ((double *) s->A_csr)[i] = values[i];
     }
+    mem_free(values);
 
-    printf("Number of elements of values and col_idx: %d; number of values in row_idx: %d\n", nz, m);
+    s->col_csc_idx[0] = 0;
 
-    row_idx = malloc(m * sizeof (int));
-    col_idx = malloc(n * sizeof (int));
-    values = malloc(nz * sizeof (float));
-    x = malloc((m - 1) * sizeof (float));
-    b = malloc((m - 1) * sizeof (float));
+    /* create B_csc from A_csr */
+    for (i = 0; i < m; i++) {
 
-    if (!row_idx || !col_idx || !values || !x || !b) {
-        printf("cannot allocate memory for sparse matrix and vectors\n");
-        exit(1);
-    } else {
-        printf("memory allocated\n");
-    }
+        nz_count = 0;
+
+        for (j = 0; j < m; j++) {
 
+            for (k = row_idx[j]; k < row_idx[j + 1]; k++) {
 
-    // fill values
-    rv = NULL;
-    for (i = 0; i < nz; i++) {
-        rv = fgets(line, sizeof (line), f);
-        if (*rv != EOF) {
-            sscanf(line, "%f", &values[i]);
-        } else {
-            printf("Failed to read file\n");
-            exit(1);
+                if (col_idx[k] == i) {
+                    memcpy((char *) s->B_csc + count * elem, (char *) s->A_csr + nz_count * elem, elem);
+                    s->row_csc_idx[count] = j;
+                    count++;
+                }
+                nz_count++;
+            }
+            s->col_csc_idx[i + 1] = count;
         }
     }
 
-    rv = NULL;
-    // fill col_idx
-    for (i = 0; i < nz; i++) {
-        rv = fgets(line, sizeof (line), f);
-        if (*rv != EOF) {
-            sscanf(line, "%d", &col_idx[i]);
-        } else {
-            printf("Failed to read file\n");
-            exit(1);
-        }
+    printf("memory allocated\n");
 
-    }
+    return s;
+}
 
+static void *float_spgemm_setup(unsigned long size) { return spgemm_setup(sizeof (float)); }
+static void *double_spgemm_setup(unsigned long size) { return spgemm_setup(sizeof (double)); }
 
-    rv = NULL;
-    // fill row_idx
-    for (i = 0; i < m; i++) {
-        rv = fgets(line, sizeof (line), f);
-        if (*rv != EOF) {
-            sscanf(line, "%d", &row_idx[i]);
-        } else {
-            printf("Failed to read file\n");
-            exit(1);
+static void spgemm_teardown(void *p) {
+
+    spgemm_state *s = p;
+
+    mem_free(s->row_csr_idx);
+    mem_free(s->col_csr_idx);
+    mem_free(s->row_csc_idx);
+    mem_free(s->col_csc_idx);
+    mem_free(s->A_csr);
+    mem_free(s->B_csc);
+    mem_free(s->C);
+    mem_free(s->temp_vec);
+    free(s);
+}
+
+static double spgemm_flops(void *p) { spgemm_state *s = p; return 2.0 * s->nz * s->n; }
+
+static double spgemm_bytes(void *p) {
+
+    spgemm_state *s = p;
+
+    /* A streamed once per column of B, plus C read/write */
+    return (double) s->n * ((double) s->nz * (s->elem + sizeof (int)) + (s->m + 1.0) * sizeof (int))
+           + 2.0 * s->m * s->n * s->elem;
+}
+
+static double spgemm_footprint(void *p) {
+
+    spgemm_state *s = p;
+
+    /* A in CSR, B in CSC, dense C and a column accumulator per thread */
+    return 2.0 * ((double) s->nz * (s->elem + sizeof (int)) + (s->m + 1.0) * sizeof (int))
+           + ((double) s->m * s->n + (double) s->threads * s->m) * s->elem;
+}
+
+/* Columns [begin, end) of C, scattering each column of B into temp_vec */
+static void float_spgemm_cols(spgemm_state *s, float *temp_vec, int begin, int end) {
+
+    float *A_csr = s->A_csr, *B_csc = s->B_csc, *C = s->C;
+    int m = s->m;
+    int i, j, k;
+
+    /* A*B=C */
+    for (j = begin; j < end; j++) { // cols
+
+        /* scatter column j of B into the padded temporary vector */
+        for (k = s->col_csc_idx[j]; k < s->col_csc_idx[j + 1]; k++) {
+            temp_vec[s->row_csc_idx[k]] = B_csc[k];
+        }
+
+        /* spgemm */
+        for (i = 0; i < m; i++) { // rows
+            for (k = s->row_csr_idx[i]; k < s->row_csr_idx[i + 1]; k++) {
+                C[j + i * m] = C[j + i * m] + A_csr[k] * temp_vec[s->col_csr_idx[k]];
+            }
         }
-    }
 
-    for (i = 0; i < m - 1; i++) {
-        x[i] = i + 1.5; // give basic values to vector x
+        /* clear the temporary vector for the next column */
+        for (k = s->col_csc_idx[j]; k < s->col_csc_idx[j + 1]; k++) {
+            temp_vec[s->row_csc_idx[k]] = 0.0;
+        }
     }
+}
+
+static double float_spgemm_compute(void *p) {
+
+    spgemm_state *s = p;
+
+    float_spgemm_cols(s, s->temp_vec, 0, s->n);
+
+    return ((float *) s->C)[0];
+}
+
+/* Each thread scatters into the temporary vector setup gave it */
+static double float_spgemm_range(void *p, unsigned long begin, unsigned long end) {
+
+    spgemm_state *s = p;
+
+    float_spgemm_cols(s, (float *) s->temp_vec + (size_t) par_thread() * s->m, begin, end);
+
+    return 0.0;
+}
+
+static double float_spgemm_parallel(void *p) {
+
+    spgemm_state *s = p;
+
+    par_for_grain(s->n, SPGEMM_GRAIN, float_spgemm_range, s);
+
+    return ((float *) s->C)[0];
+}
+
+/* Columns [begin, end) of C, scattering each column of B into temp_vec */
+static void double_spgemm_cols(spgemm_state *s, double *temp_vec, int begin, int end) {
+
+    double *A_csr = s->A_csr, *B_csc = s->B_csc, *C = s->C;
+    int m = s->m;
+    int i, j, k;
+
+    /* AB=C */
+    for (j = begin; j < end; j++) { // cols
 
-    clock_gettime(CLOCK, &start);
+        /* scatter column j of B into the padded temporary vector */
+        for (k = s->col_csc_idx[j]; k < s->col_csc_idx[j + 1]; k++) {
+            temp_vec[s->row_csc_idx[k]] = B_csc[k];
+        }
 
-    for (rep = 0; rep < r; rep++) {
-        /* Ax=b */
-        for (i = 0; i < m - 1; i++) {
-            for (j = row_idx[i]; j < row_idx[i + 1]; j++) {
-                b[i] = b[i] + values[j] * x[col_idx[j]];
+        /* spgemm */
+        for (i = 0; i < m; i++) { // rows
+            for (k = s->row_csr_idx[i]; k < s->row_csr_idx[i + 1]; k++) {
+                C[j + i * m] = C[j + i * m] + A_csr[k] * temp_vec[s->col_csr_idx[k]];
             }
         }
+
+        /* clear the temporary vector for the next column */
+        for (k = s->col_csc_idx[j]; k < s->col_csc_idx[j + 1]; k++) {
+            temp_vec[s->row_csc_idx[k]] = 0.0;
+        }
     }
+}
 
-    clock_gettime(CLOCK, &end);
+static double double_spgemm_compute(void *p) {
 
-    elapsed_time_hr(start, end, "Sparse DMVs.");
+    spgemm_state *s = p;
 
-    free(x);
-    free(b);
-    free(row_idx);
-    free(col_idx);
-    free(values);
+    double_spgemm_cols(s, s->temp_vec, 0, s->n);
 
-    fclose(f);
+    return ((double *) s->C)[0];
+}
 
-    return 0;
+/* Each thread scatters into the temporary vector setup gave it */
+static double double_spgemm_range(void *p, unsigned long begin, unsigned long end) {
+
+    spgemm_state *s = p;
+
+    double_spgemm_cols(s, (double *) s->temp_vec + (size_t) par_thread() * s->m, begin, end);
+
+    return 0.0;
 }
 
-int double_spmatvec_product(unsigned long r) {
+static double double_spgemm_parallel(void *p) {
 
-    //int *m, *n, *nz;
-    int m, n, nz;
-    int *row_idx, *col_idx;
-    double *values;
-    double *x, *b;
+    spgemm_state *s = p;
 
-    struct timespec start, end;
+    par_for_grain(s->n, SPGEMM_GRAIN, double_spgemm_range, s);
 
-    char *filename = "matrix_sml.csr";
+    return ((double *) s->C)[0];
+}
 
-    int i, j, rep;
 
-    FILE *f;
-    char line[64];
-    char *rv = NULL;
+/*
+ * Verification against reference results
+ *
+ * Each check runs the kernel once more and compares what it produced
+ * with a long double reference built from the same inputs, normalised
+ * by the sum of the magnitudes of the terms. Integer sums are exact
+ * and must match exactly; the int AXPY and scaling wrap modulo 2^32,
+ * so their references use unsigned arithmetic. Kernels that update
+ * their data in place keep a copy of the inputs first.
+ */
 
-    if (r == ULONG_MAX) r = 1000;
+/* Element i of a kernel buffer of the given dtype, widened */
+static long double elem_at(const char *dtype, const void *v, unsigned long i) {
+
+    if (strcmp(dtype, "fp16") == 0) return half_to_float(((const uint16_t *) v)[i]);
+    if (strcmp(dtype, "bf16") == 0) return bf16_to_float(((const uint16_t *) v)[i]);
+    if (dtype[0] == 'f') return ((const float *) v)[i];
+    if (dtype[0] == 'd') return ((const double *) v)[i];
+    if (strcmp(dtype, "int16") == 0) return ((const int16_t *) v)[i];
+    if (strcmp(dtype, "int32") == 0) return ((const int32_t *) v)[i];
+    if (strcmp(dtype, "int64") == 0) return ((const int64_t *) v)[i];
+    return ((const int *) v)[i];
+}
 
-    if ((f = fopen(filename, "r")) == NULL) {
-        printf("can't open file <%s> \n", filename);
-        exit(1);
-    }
-    rv = fgets(line, sizeof (line), f);
-    if (*rv != EOF) {
-        sscanf(line, "%d %d %d", &nz, &n, &m);
-    } else {
-        printf("Failed to read file\n");
-        exit(1);
-    }
+/* v as the widening integer kernels store it, saturated to their type; other types are left alone */
+static long double saturate_as(const char *dtype, long double v) {
 
-    /* fgets(line, sizeof(line), f); */
-    /* sscanf(line, "%d %d %d", &nz, &n, &m); */
+    long double lo, hi;
 
-    printf("Number of elements of values and col_idx: %d; number of values in row_idx: %d\n", nz, m);
+    if (strcmp(dtype, "int16") == 0) lo = INT16_MIN, hi = INT16_MAX;
+    else if (strcmp(dtype, "int32") == 0) lo = INT32_MIN, hi = INT32_MAX;
+    else if (strcmp(dtype, "int64") == 0) lo = INT64_MIN, hi = INT64_MAX;
+    else return v;
 
-    row_idx = malloc(m * sizeof (int));
-    col_idx = malloc(n * sizeof (int));
-    values = malloc(nz * sizeof (double));
-    x = malloc((m - 1) * sizeof (double));
-    b = malloc((m - 1) * sizeof (double));
+    return v < lo ? lo : v > hi ? hi : v;
+}
 
-    if (!row_idx || !col_idx || !values || !x || !b) {
-        printf("cannot allocate memory for sparse matrix and vectors\n");
-        exit(1);
-    } else {
-        printf("memory allocated\n");
-    }
+/* The scalar a as the kernel of the given dtype rounds it; the 16-bit kernels take it in float */
+static long double scalar_as(const char *dtype, double a) {
 
-    // fill values
-    rv = NULL;
-    for (i = 0; i < nz; i++) {
-        rv = fgets(line, sizeof (line), f);
-        if (*rv != EOF) {
-            sscanf(line, "%lf", &values[i]);
-        } else {
-            printf("Failed to read file\n");
-            exit(1);
-        }
-    }
+    if (dtype[0] == 'f' || dtype[0] == 'b') return (float) a;
+    if (dtype[0] == 'd') return a;
+    return (int) a;
+}
 
-    rv = NULL;
-    // fill col_idx
-    for (i = 0; i < nz; i++) {
-        rv = fgets(line, sizeof (line), f);
-        if (*rv != EOF) {
-            sscanf(line, "%d", &col_idx[i]);
-        } else {
-            printf("Failed to read file\n");
-            exit(1);
-        }
+static void *copy_of(const void *v, size_t len) {
+
+    void *c = malloc(len);
+
+    if (c) memcpy(c, v, len);
+    return c;
+}
+
+static double dot_verify(const kernel_t *k, void *p, double *tol) {
 
+    vec_state *s = p;
+    double got = k->compute(s);
+    long double ref = 0, scale = 0;
+    unsigned long i;
+
+    *tol = verify_tolerance(k->dtype, s->n);
+    for (i = 0; i < s->n; i++) {
+        long double t = elem_at(k->dtype, s->x, i) * elem_at(k->dtype, s->y, i);
+        ref += t;
+        scale += fabsl(t);
     }
+    /* the integer sums are exact, then rounded once to the double returned */
+    if (strncmp(k->dtype, "int", 3) == 0) return verify_error(got, (double) ref, scale);
+    return verify_error(got, ref, scale);
+}
 
+static double scal_verify(const kernel_t *k, void *p, double *tol) {
 
-    rv = NULL;
-    // fill row_idx
-    for (i = 0; i < m; i++) {
-        rv = fgets(line, sizeof (line), f);
-        if (*rv != EOF) {
-            sscanf(line, "%d", &row_idx[i]);
+    vec_state *s = p;
+    void *x0 = copy_of(s->x, s->n * s->elem);
+    long double a = scalar_as(k->dtype, s->a);
+    double err = 0, e;
+    unsigned long i;
+
+    if (x0 == NULL) return -1;
+    k->compute(s);
+
+    *tol = verify_store_tolerance(k->dtype, 1);
+    for (i = 0; i < s->n; i++) {
+        if (strcmp(k->dtype, "int") == 0) {
+            int ref = (int) ((unsigned int) s->a * (unsigned int) ((int *) x0)[i]);
+            e = verify_error(((int *) s->x)[i], ref, 1);
         } else {
-            printf("Failed to read file\n");
-            exit(1);
+            long double ref = saturate_as(k->dtype, a * elem_at(k->dtype, x0, i));
+            e = verify_error(elem_at(k->dtype, s->x, i), ref, fabsl(ref));
         }
+        if (e > err) err = e;
     }
 
+    free(x0);
+    return err;
+}
 
-    /* // fill col_idx */
-    /* for(i=0;i<nz;i++){ */
-    /*   fgets(line, sizeof(line), f); */
-    /*   sscanf(line, "%d", &col_idx[i]); */
-    /* } */
+static double norm_verify(const kernel_t *k, void *p, double *tol) {
 
-    /* // fill row_idx */
-    /* for(i=0;i<m;i++){ */
-    /*   fgets(line, sizeof(line), f); */
-    /*   sscanf(line, "%d", &row_idx[i]); */
-    /* } */
+    vec_state *s = p;
+    double got = k->compute(s);
+    long double sum = 0;
+    unsigned long long isum = 0;
+    unsigned long i;
 
-    for (i = 0; i < m - 1; i++) {
-        x[i] = i + 1.5; // give basic values to vector x
+    *tol = verify_tolerance(k->dtype, s->n + 1.0);
+    if (strcmp(k->dtype, "int") == 0) {
+        for (i = 0; i < s->n; i++) isum += (unsigned long long) ((unsigned int *) s->x)[i] * ((unsigned int *) s->x)[i];
+        return verify_error(got, (float) sqrt(isum), 1);
     }
+    for (i = 0; i < s->n; i++) sum += elem_at(k->dtype, s->x, i) * elem_at(k->dtype, s->x, i);
+    return verify_error(got, sqrtl(sum), sqrtl(sum));
+}
 
-    clock_gettime(CLOCK, &start);
-
-    for (rep = 0; rep < r; rep++) {
-        /* Ax=b */
-        for (i = 0; i < m - 1; i++) {
-            for (j = row_idx[i]; j < row_idx[i + 1]; j++) {
-                b[i] = b[i] + values[j] * x[col_idx[j]];
-            }
+/*
+ * norm_blue is checked on its own data, then on that data scaled near
+ * the ends of the type's range and to mixed magnitudes, where a plain
+ * sum of squares overflows or underflows: the naive norm of each scaled
+ * vector is printed next to it. The references divide by the largest
+ * element, so they hold where long double is no wider than double.
+ */
+static double nrm2_verify(const kernel_t *k, void *p, double *tol) {
+
+    vec_state *s = p;
+    int dp = strcmp(k->dtype, "double") == 0, algo = s->algo, pass;
+    double big = dp ? 1e300 : 1e30, small = dp ? 1e-300 : 1e-30;
+    double err = norm_verify(k, s, tol), e, f, got, naive;
+    void *x0 = copy_of(s->x, s->n * s->elem);
+    long double m, sum, t;
+    char name[64];
+    unsigned long i;
+
+    if (x0 == NULL) return -1;
+    for (pass = 0; pass < 3; pass++) {
+        /* all big, all small, then big, unscaled and small in turn */
+        m = 0;
+        for (i = 0; i < s->n; i++) {
+            f = pass == 0 ? big : pass == 1 ? small : i % 3 == 0 ? big : i % 3 == 1 ? 1.0 : small;
+            if (dp) ((double *) s->x)[i] = ((double *) x0)[i] * f;
+            else ((float *) s->x)[i] = (float) (((float *) x0)[i] * f);
+            if (fabsl(elem_at(k->dtype, s->x, i)) > m) m = fabsl(elem_at(k->dtype, s->x, i));
+        }
+        sum = 0;
+        for (i = 0; m > 0 && i < s->n; i++) {
+            t = elem_at(k->dtype, s->x, i) / m;
+            sum += t * t;
         }
+
+        got = k->compute(s);
+        s->algo = REDUCE_NAIVE;
+        naive = dp ? double_norm_compute(s) : float_norm_compute(s);
+        s->algo = algo;
+
+        e = verify_error(got, m * sqrtl(sum), m * sqrtl(sum));
+        if (pass < 2) fprintf(stderr, "NOTE: %s on x scaled by %g: %g (error %.2g), naive sum %g\n",
+                              kernel_name(k, name, sizeof (name)), pass == 0 ? big : small, got, e, naive);
+        else fprintf(stderr, "NOTE: %s on x scaled by %g, 1 and %g in turn: %g (error %.2g), naive sum %g\n",
+                     kernel_name(k, name, sizeof (name)), big, small, got, e, naive);
+        if (e > err) err = e;
     }
 
-    clock_gettime(CLOCK, &end);
+    memcpy(s->x, x0, s->n * s->elem);
+    free(x0);
+    return err;
+}
 
-    elapsed_time_hr(start, end, "Sparse DMVs.");
+static double axpy_verify(const kernel_t *k, void *p, double *tol) {
 
-    free(x);
-    free(b);
-    free(row_idx);
-    free(col_idx);
-    free(values);
+    vec_state *s = p;
+    void *y0 = copy_of(s->y, s->n * s->elem);
+    long double a = scalar_as(k->dtype, s->a);
+    double err = 0, e;
+    unsigned long i;
 
-    fclose(f);
+    if (y0 == NULL) return -1;
+    k->compute(s);
 
-    return 0;
+    *tol = verify_store_tolerance(k->dtype, 2);
+    for (i = 0; i < s->n; i++) {
+        if (strcmp(k->dtype, "int") == 0) {
+            int ref = (int) ((unsigned int) (int) s->a * (unsigned int) ((int *) s->x)[i]
+                             + (unsigned int) ((int *) y0)[i]);
+            e = verify_error(((int *) s->y)[i], ref, 1);
+        } else {
+            long double ax = a * elem_at(k->dtype, s->x, i), y = elem_at(k->dtype, y0, i);
+            e = verify_error(elem_at(k->dtype, s->y, i), saturate_as(k->dtype, ax + y), fabsl(ax) + fabsl(y));
+        }
+        if (e > err) err = e;
+    }
+
+    free(y0);
+    return err;
 }
 
-int float_spgemm(unsigned long r) {
+/* Checks y as axpy_verify() does, then the returned y . y against the y computed */
+static double axpy_dot_verify(const kernel_t *k, void *p, double *tol) {
 
-    int m, n, nz;
-    int *row_csr_idx, *col_csr_idx;
-    int *row_csc_idx, *col_csc_idx;
-    float *A_csr, *B_csc, *C; // matrices
-    double *tmp;
-    
-    /* Change this to matrix_lrg.csr and recompile to use the large matrix */
-    char *filename = "matrix_sml.csr";
-    char line[64];
-    char *rv = NULL;
+    vec_state *s = p;
+    void *y0 = copy_of(s->y, s->n * s->elem);
+    long double a = scalar_as(k->dtype, s->a), ref = 0;
+    double got, err = 0, e;
+    unsigned long i;
 
-    int i, j, k;
-    unsigned long rep = 0;
-    int count = 0, nz_count = 0;
+    if (y0 == NULL) return -1;
+    got = k->compute(s);
 
-    struct timespec start, end;
+    *tol = verify_tolerance(k->dtype, s->n + 2.0);
+    for (i = 0; i < s->n; i++) {
+        long double ax = a * elem_at(k->dtype, s->x, i), y = elem_at(k->dtype, y0, i);
+        e = verify_error(elem_at(k->dtype, s->y, i), ax + y, fabsl(ax) + fabsl(y));
+        if (e > err) err = e;
+        ref += elem_at(k->dtype, s->y, i) * elem_at(k->dtype, s->y, i);
+    }
+    e = verify_error(got, ref, ref);
 
-    if (r == ULONG_MAX) r = 100;
+    free(y0);
+    return e > err ? e : err;
+}
 
-    FILE *f;
-    if ((f = fopen(filename, "r")) == NULL) {
-        printf("can't open file <%s> \n", filename);
-        exit(1);
-    }
-    rv = fgets(line, sizeof (line), f);
-    if (*rv != EOF) {
-        sscanf(line, "%d %d %d", &nz, &n, &m);
-    } else {
-        printf("Failed to read file\n");
-        exit(1);
+/* Checks y = A * x, or y = A^T * x if trans is set */
+static double dmv_check(const kernel_t *k, dmv_state *s, int trans, double *tol) {
+
+    double err = 0, e;
+    unsigned long i, j, aij;
+
+    k->compute(s);
+
+    *tol = verify_tolerance(k->dtype, s->n);
+    for (i = 0; i < s->n; i++) {
+        const char *ytype = s->yelem == s->elem ? k->dtype : "int64";
+        long double ref = 0, scale = 0, t;
+        for (j = 0; j < s->n; j++) {
+            aij = trans ? j * s->ld + i : i * s->ld + j;
+            t = elem_at(k->dtype, s->A, aij) * elem_at(k->dtype, s->x, j);
+            ref += t;
+            scale += fabsl(t);
+        }
+        e = verify_error(elem_at(ytype, s->y, i), saturate_as(ytype, ref), scale);
+        if (e > err) err = e;
     }
 
+    return err;
+}
 
+static double dmv_verify(const kernel_t *k, void *p, double *tol) { return dmv_check(k, p, 0, tol); }
+static double dmv_t_verify(const kernel_t *k, void *p, double *tol) { return dmv_check(k, p, 1, tol); }
 
-    row_csr_idx = malloc(nz * sizeof (int));
-    col_csr_idx = malloc(nz * sizeof (int));
-    A_csr = malloc(nz * sizeof (float));
-    tmp = malloc(nz * sizeof (double));
-    row_csc_idx = malloc(nz * sizeof (int));
-    col_csc_idx = malloc(nz * sizeof (int));
-    B_csc = malloc(nz * sizeof (float));
-    C = calloc((m * n), sizeof (float));
+/* Checks every element of GEMM_VERIFY_ROWS rows of C spread over the matrix, O(n^2) each */
+#define GEMM_VERIFY_ROWS 32
 
-    if (!row_csr_idx || !col_csr_idx || !A_csr || !row_csc_idx || !col_csc_idx || !B_csc || !C) {
-        printf("cannot allocate memory for %d, %d, %d sparse matrices and vector\n", m, n, nz);
-        exit(1);
-    } else {
-        printf("memory allocated\n");
-    }
+static double gemm_verify(const kernel_t *k, void *p, double *tol) {
 
-    clock_gettime(CLOCK, &start);
+    gemm_state *s = p;
+    double err = 0, e;
+    unsigned long r, i, j, l, step = s->n > GEMM_VERIFY_ROWS ? s->n / GEMM_VERIFY_ROWS : 1;
+    long double ref, scale, t;
 
-    // fill A_csr
-    for (i = 0; i < nz; i++) {
-        rv = fgets(line, sizeof (line), f);
-        k = sscanf(line, "%f", &A_csr[i]);
+    k->compute(s);
 
+    *tol = verify_tolerance(k->dtype, s->n);
+    for (r = 0; r < s->n; r += step) {
+        /* the last row too, where the edge tiles are */
+        i = (r + step >= s->n) ? s->n - 1 : r;
+        for (j = 0; j < s->n; j++) {
+            ref = scale = 0;
+            for (l = 0; l < s->n; l++) {
+                t = elem_at(k->dtype, s->A, i * s->ld + l) * elem_at(k->dtype, s->B, l * s->ld + j);
+                ref += t;
+                scale += fabsl(t);
+            }
+            e = verify_error(elem_at(k->dtype, s->C, i * s->ld + j), ref, scale);
+            if (e > err) err = e;
+        }
     }
 
-    // fill col_csr_idx
-    for (i = 0; i < nz; i++) {
-        rv = fgets(line, sizeof (line), f);
-        sscanf(line, "%d", &col_csr_idx[i]);
-    }
+    return err;
+}
 
-    // fill row_csr_idx
-    for (i = 0; i < m; i++) {
-        rv = fgets(line, sizeof (line), f);
-        sscanf(line, "%d", &row_csr_idx[i]);
-    }
+static double spmv_verify(const kernel_t *k, void *p, double *tol) {
 
-    fclose(f);
-    clock_gettime(CLOCK, &end);
-    elapsed_time_hr(start, end, "Read in CSR file");
+    spmv_state *s = p;
+    const char *vec = (s->velem == s->elem) ? k->dtype : "float";
+    double err = 0, e;
+    int i, j, longest = 0;
 
+    k->compute(s);
 
+    for (i = 0; i < s->m - 1; i++) {
+        long double ref = 0, scale = 0;
+        for (j = s->row_idx[i]; j < s->row_idx[i + 1]; j++) {
+            long double t = elem_at(k->dtype, s->values, j) * elem_at(vec, s->x, s->col_idx[j]);
+            ref += t;
+            scale += fabsl(t);
+        }
+        if (s->row_idx[i + 1] - s->row_idx[i] > longest) longest = s->row_idx[i + 1] - s->row_idx[i];
+        e = verify_error(elem_at(vec, s->b, i), ref, scale);
+        if (e > err) err = e;
+    }
 
+    *tol = verify_tolerance(k->dtype, longest);
+    return err;
+}
 
-    m -= 1;
-    n = m;
 
-    col_csc_idx[0] = 0;
+/*
+ * Reduction variants of the float and double dot product and norm:
+ * the same kernels, with the sum formed by one of the algorithms of
+ * reduce.h instead of the vector kernels. Run them with --verify to
+ * see the error of each next to its throughput.
+ */
+static void *with_algo(void *p, int algo) {
 
-    /* create B_csc from A_csr */
-    for (i = 0; i < m; i++) {
+    if (p != NULL) ((vec_state *) p)->algo = algo;
+    return p;
+}
 
-        nz_count = 0;
+static void *float_dot_naive_setup(unsigned long size) { return with_algo(float_dot_setup(size), REDUCE_NAIVE); }
+static void *float_dot_kway_setup(unsigned long size) { return with_algo(float_dot_setup(size), REDUCE_KWAY); }
+static void *float_dot_pairwise_setup(unsigned long size) { return with_algo(float_dot_setup(size), REDUCE_PAIRWISE); }
+static void *float_dot_kahan_setup(unsigned long size) { return with_algo(float_dot_setup(size), REDUCE_KAHAN); }
+static void *float_dot_double_setup(unsigned long size) { return with_algo(float_dot_setup(size), REDUCE_DOUBLE); }
+static void *double_dot_naive_setup(unsigned long size) { return with_algo(double_dot_setup(size), REDUCE_NAIVE); }
+static void *double_dot_kway_setup(unsigned long size) { return with_algo(double_dot_setup(size), REDUCE_KWAY); }
+static void *double_dot_pairwise_setup(unsigned long size) { return with_algo(double_dot_setup(size), REDUCE_PAIRWISE); }
+static void *double_dot_kahan_setup(unsigned long size) { return with_algo(double_dot_setup(size), REDUCE_KAHAN); }
+
+static void *float_norm_naive_setup(unsigned long size) { return with_algo(float_norm_setup(size), REDUCE_NAIVE); }
+static void *float_norm_kway_setup(unsigned long size) { return with_algo(float_norm_setup(size), REDUCE_KWAY); }
+static void *float_norm_pairwise_setup(unsigned long size) { return with_algo(float_norm_setup(size), REDUCE_PAIRWISE); }
+static void *float_norm_kahan_setup(unsigned long size) { return with_algo(float_norm_setup(size), REDUCE_KAHAN); }
+static void *float_norm_double_setup(unsigned long size) { return with_algo(float_norm_setup(size), REDUCE_DOUBLE); }
+static void *double_norm_naive_setup(unsigned long size) { return with_algo(double_norm_setup(size), REDUCE_NAIVE); }
+static void *double_norm_kway_setup(unsigned long size) { return with_algo(double_norm_setup(size), REDUCE_KWAY); }
+static void *double_norm_pairwise_setup(unsigned long size) { return with_algo(double_norm_setup(size), REDUCE_PAIRWISE); }
+static void *double_norm_kahan_setup(unsigned long size) { return with_algo(double_norm_setup(size), REDUCE_KAHAN); }
 
-        for (j = 0; j < m; j++) {
+/*
+ * C accumulates A * B, so the check compares the change in C with the
+ * reference product, computed a row of A at a time against the columns
+ * of B.
+ */
+static double spgemm_verify(const kernel_t *k, void *p, double *tol) {
 
-            for (k = row_csr_idx[j]; k < row_csr_idx[j + 1]; k++) {
+    spgemm_state *s = p;
+    int m = s->m;
+    void *C0 = copy_of(s->C, (size_t) m * m * s->elem);
+    long double *arow = calloc(m, sizeof (long double));
+    double err = 0, e;
+    int i, j, kk, longest = 0;
 
-                if (col_csr_idx[k] == i) {
-                    B_csc[count] = A_csr[nz_count];
-                    row_csc_idx[count] = j;
-                    //      printf("j = %d and k = %d\n", j, k);
-                    count++;
-                }
-                nz_count++;
-                //      printf("nz = %d\n", nz_count);
+    if (C0 == NULL || arow == NULL) {
+        free(C0);
+        free(arow);
+        return -1;
+    }
+    k->compute(s);
+
+    for (i = 0; i < m; i++) {
+        for (kk = s->row_csr_idx[i]; kk < s->row_csr_idx[i + 1]; kk++)
+            arow[s->col_csr_idx[kk]] = elem_at(k->dtype, s->A_csr, kk);
+        for (j = 0; j < s->n; j++) {
+            long double c0 = elem_at(k->dtype, C0, (size_t) i * m + j);
+            long double ref = c0, scale = fabsl(c0);
+            for (kk = s->col_csc_idx[j]; kk < s->col_csc_idx[j + 1]; kk++) {
+                long double t = arow[s->row_csc_idx[kk]] * elem_at(k->dtype, s->B_csc, kk);
+                ref += t;
+                scale += fabsl(t);
             }
-            col_csc_idx[i + 1] = count;
+            e = verify_error(elem_at(k->dtype, s->C, (size_t) i * m + j), ref, scale);
+            if (e > err) err = e;
         }
+        for (kk = s->row_csr_idx[i]; kk < s->row_csr_idx[i + 1]; kk++) arow[s->col_csr_idx[kk]] = 0;
+        if (s->row_csr_idx[i + 1] - s->row_csr_idx[i] > longest) longest = s->row_csr_idx[i + 1] - s->row_csr_idx[i];
     }
 
-    clock_gettime(CLOCK, &start);
+    /* one rounding per product term and one for the addition into C */
+    *tol = verify_tolerance(k->dtype, 2.0 * longest + 1);
+
+    free(C0);
+    free(arow);
+    return err;
+}
 
-    for (rep = 0; rep < r; rep++) {
 
-        /* A*B=C */
+#ifdef HAVE_CBLAS
+/*
+ * The float and double kernels through the system CBLAS (see
+ * backend.h). They work on the state of the in-tree kernels, so the
+ * data, the traffic counted and the verification are the same.
+ */
+static double float_dot_cblas(void *p) {
 
-        for (j = 0; j < n; j++) { // cols
+    vec_state *s = p;
 
-            /* temporary padded column vector */
-            float *temp_vec = malloc(nz * sizeof (float));
+    return cblas_sdot(s->n, s->x, 1, s->y, 1);
+}
 
-            for (k = col_csc_idx[j]; k < col_csc_idx[j + 1]; k++) {
-                temp_vec[row_csc_idx[k]] = B_csc[k];
-            }
+static double double_dot_cblas(void *p) {
 
-            /* spgemm */
-            for (i = 0; i < m; i++) { // rows
+    vec_state *s = p;
 
-                for (k = row_csr_idx[i]; k < row_csr_idx[i + 1]; k++) {
-                    C[j + i * m] = C[j + i * m] + A_csr[k] * temp_vec[col_csr_idx[k]];
-                }
+    return cblas_ddot(s->n, s->x, 1, s->y, 1);
+}
 
-            }
+static double float_scal_cblas(void *p) {
 
-            /* free temporary vector */
-            free(temp_vec);
+    vec_state *s = p;
+    float a = (float) s->a;
 
-        }
+    cblas_sscal(s->n, a, s->x, 1);
+    s->a = 1.0 / a;
 
-    }
+    return ((float *) s->x)[0];
+}
 
-    clock_gettime(CLOCK, &end);
+static double double_scal_cblas(void *p) {
 
-    elapsed_time_hr(start, end, "Sparse float GEMM.");
+    vec_state *s = p;
+    double a = s->a;
 
-    /* free memory*/
-    free(tmp);
-    free(row_csr_idx);
-    free(col_csr_idx);
-    free(row_csc_idx);
-    free(col_csc_idx);
-    free(A_csr);
-    free(B_csc);
-    free(C);
+    cblas_dscal(s->n, a, s->x, 1);
+    s->a = 1.0 / a;
 
-    return 0;
+    return ((double *) s->x)[0];
 }
 
-int double_spgemm(unsigned long r) {
-
-    int m, n, nz;
-    int *row_csr_idx, *col_csr_idx;
-    int *row_csc_idx, *col_csc_idx;
-    double *A_csr, *B_csc, *C; // matrices
+static double float_norm_cblas(void *p) {
 
-    /* Change this to matrix_lrg.csr and recompile to use the large matrix */
-    char *filename = "matrix_sml.csr";
-    char line[64];
-    char *rv = NULL;
+    vec_state *s = p;
 
-    int i, j, k;
-    unsigned long rep = 0;
-    int count = 0, nz_count = 0;
+    return cblas_snrm2(s->n, s->x, 1);
+}
 
-    struct timespec start, end;
+static double double_norm_cblas(void *p) {
 
-    if (r == ULONG_MAX) r = 100;
+    vec_state *s = p;
 
-    FILE *f;
-    if ((f = fopen(filename, "r")) == NULL) {
-        printf("can't open file <%s> \n", filename);
-        exit(1);
-    }
-    rv = fgets(line, sizeof (line), f);
-    if (*rv != EOF) {
-        sscanf(line, "%d %d %d", &nz, &n, &m);
-    } else {
-        printf("Failed to read file\n");
-        exit(1);
-    }
+    return cblas_dnrm2(s->n, s->x, 1);
+}
 
+static double float_axpy_cblas(void *p) {
 
-    row_csr_idx = malloc(nz * sizeof (int));
-    col_csr_idx = malloc(nz * sizeof (int));
-    A_csr = malloc(nz * sizeof (double));
-    row_csc_idx = malloc(nz * sizeof (int));
-    col_csc_idx = malloc(nz * sizeof (int));
-    B_csc = malloc(nz * sizeof (double));
-    C = calloc((m * n), sizeof (double));
+    vec_state *s = p;
 
-    if (!row_csr_idx || !col_csr_idx || !A_csr || !row_csc_idx || !col_csc_idx || !B_csc || !C) {
-        printf("cannot allocate memory for %d, %d, %d sparse matrices and vector\n", m, n, nz);
-        exit(1);
-    }
+    cblas_saxpy(s->n, (float) s->a, s->x, 1, s->y, 1);
 
-    clock_gettime(CLOCK, &start);
+    return ((float *) s->y)[0];
+}
 
-    // fill A_csr
-    for (i = 0; i < nz; i++) {
-        rv = fgets(line, sizeof (line), f);
-        k = sscanf(line, "%lf", &A_csr[i]);
+static double double_axpy_cblas(void *p) {
 
-    }
+    vec_state *s = p;
 
-    // fill col_csr_idx
-    for (i = 0; i < nz; i++) {
-        rv = fgets(line, sizeof (line), f);
-        sscanf(line, "%d", &col_csr_idx[i]);
-    }
+    cblas_daxpy(s->n, s->a, s->x, 1, s->y, 1);
 
-    // fill row_csr_idx
-    for (i = 0; i < m; i++) {
-        rv = fgets(line, sizeof (line), f);
-        sscanf(line, "%d", &row_csr_idx[i]);
-    }
+    return ((double *) s->y)[0];
+}
 
-    fclose(f);
-    clock_gettime(CLOCK, &end);
-    elapsed_time_hr(start, end, "Read in CSR file");
+static double float_dmv_cblas(void *p) {
 
-    m -= 1;
-    n = m;
+    dmv_state *s = p;
 
-    col_csc_idx[0] = 0;
+    cblas_sgemv(CblasRowMajor, CblasNoTrans, s->n, s->n, 1.0f, s->A, s->ld, s->x, 1, 0.0f, s->y, 1);
 
-    /* create B_csc from A_csr */
-    for (i = 0; i < m; i++) {
+    return ((float *) s->y)[0];
+}
 
-        nz_count = 0;
+static double double_dmv_cblas(void *p) {
 
-        for (j = 0; j < m; j++) {
+    dmv_state *s = p;
 
-            for (k = row_csr_idx[j]; k < row_csr_idx[j + 1]; k++) {
+    cblas_dgemv(CblasRowMajor, CblasNoTrans, s->n, s->n, 1.0, s->A, s->ld, s->x, 1, 0.0, s->y, 1);
 
-                if (col_csr_idx[k] == i) {
-                    B_csc[count] = A_csr[nz_count];
-                    row_csc_idx[count] = j;
-                    //      printf("j = %d and k = %d\n", j, k);
-                    count++;
-                }
-                nz_count++;
-                //      printf("nz = %d\n", nz_count);
-            }
-            col_csc_idx[i + 1] = count;
-        }
-    }
+    return ((double *) s->y)[0];
+}
 
-    clock_gettime(CLOCK, &start);
+static double float_dmv_t_cblas(void *p) {
 
-    for (rep = 0; rep < r; rep++) {
+    dmv_state *s = p;
 
-        /* AB=C */
+    cblas_sgemv(CblasRowMajor, CblasTrans, s->n, s->n, 1.0f, s->A, s->ld, s->x, 1, 0.0f, s->y, 1);
 
-        for (j = 0; j < n; j++) { // cols
+    return ((float *) s->y)[0];
+}
 
-            /* temporary padded column vector */
-            double *temp_vec = malloc(nz * sizeof (double));
+static double double_dmv_t_cblas(void *p) {
 
-            for (k = col_csc_idx[j]; k < col_csc_idx[j + 1]; k++) {
-                temp_vec[row_csc_idx[k]] = B_csc[k];
-            }
+    dmv_state *s = p;
 
-            /* spgemm */
-            for (i = 0; i < m; i++) { // rows
+    cblas_dgemv(CblasRowMajor, CblasTrans, s->n, s->n, 1.0, s->A, s->ld, s->x, 1, 0.0, s->y, 1);
 
-                for (k = row_csr_idx[i]; k < row_csr_idx[i + 1]; k++) {
-                    C[j + i * m] = C[j + i * m] + A_csr[k] * temp_vec[col_csr_idx[k]];
-                }
+    return ((double *) s->y)[0];
+}
 
-            }
+static double float_gemm_cblas(void *p) {
 
-            /* free temporary vector */
-            free(temp_vec);
+    gemm_state *s = p;
 
-        }
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, s->n, s->n, s->n,
+                1.0f, s->A, s->ld, s->B, s->ld, 0.0f, s->C, s->ld);
 
-    }
+    return ((float *) s->C)[0];
+}
 
-    clock_gettime(CLOCK, &end);
+static double double_gemm_cblas(void *p) {
 
-    elapsed_time_hr(start, end, "Sparse DGEMMs");
+    gemm_state *s = p;
 
-    /* free memory*/
-    free(row_csr_idx);
-    free(col_csr_idx);
-    free(row_csc_idx);
-    free(col_csc_idx);
-    free(A_csr);
-    free(B_csc);
-    free(C);
+    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, s->n, s->n, s->n,
+                1.0, s->A, s->ld, s->B, s->ld, 0.0, s->C, s->ld);
 
-    return 0;
+    return ((double *) s->C)[0];
 }
+
+/* nrm2 stands in for both the plain and the overflow safe norm */
+const backend_op blas_op_cblas[] = {
+    {"blas_op", "dot_product", "float", float_dot_cblas},
+    {"blas_op", "dot_product", "double", double_dot_cblas},
+    {"blas_op", "scalar_mult", "float", float_scal_cblas},
+    {"blas_op", "scalar_mult", "double", double_scal_cblas},
+    {"blas_op", "norm", "float", float_norm_cblas},
+    {"blas_op", "norm", "double", double_norm_cblas},
+    {"blas_op", "norm_blue", "float", float_norm_cblas},
+    {"blas_op", "norm_blue", "double", double_norm_cblas},
+    {"blas_op", "axpy", "float", float_axpy_cblas},
+    {"blas_op", "axpy", "double", double_axpy_cblas},
+    {"blas_op", "dmv", "float", float_dmv_cblas},
+    {"blas_op", "dmv", "double", double_dmv_cblas},
+    {"blas_op", "dmv_t", "float", float_dmv_t_cblas},
+    {"blas_op", "dmv_t", "double", double_dmv_t_cblas},
+    {"blas_op", "gemm", "float", float_gemm_cblas},
+    {"blas_op", "gemm", "double", double_gemm_cblas},
+    {NULL}
+};
+#endif
+
+const kernel_t blas_op_kernels[] = {
+    {"blas_op", "dot_product", "int", "Integer dot product, summed in 64 bits.", REPS,
+     int_dot_setup, int_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, int_dot_parallel, NULL},
+    {"blas_op", "dot_product", "float", "Float dot product.", REPS,
+     float_dot_setup, float_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, float_dot_parallel, NULL},
+    {"blas_op", "dot_product", "double", "Double dot product.", REPS,
+     double_dot_setup, double_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, double_dot_parallel, NULL},
+    {"blas_op", "dot_product", "fp16", "Fp16 dot product, float accumulation.", REPS,
+     fp16_dot_setup, half_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, half_dot_parallel, NULL},
+    {"blas_op", "dot_product", "bf16", "Bf16 dot product, float accumulation.", REPS,
+     bf16_dot_setup, half_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, half_dot_parallel, NULL},
+    {"blas_op", "dot_product", "int16", "Int16 dot product, pmaddwd pairs summed in 64 bits.", REPS,
+     int16_dot_setup, wide_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, wide_dot_parallel, NULL},
+    {"blas_op", "dot_product", "int32", "Int32 dot product, summed in 64 bits.", REPS,
+     int32_dot_setup, wide_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, wide_dot_parallel, NULL},
+    {"blas_op", "dot_product", "int64", "Int64 dot product, summed in 128 bits.", REPS,
+     int64_dot_setup, wide_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, wide_dot_parallel, NULL},
+
+    {"blas_op", "dot_naive", "float", "Float dot product, naive sum.", REPS,
+     float_dot_naive_setup, float_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, float_dot_parallel, NULL},
+    {"blas_op", "dot_naive", "double", "Double dot product, naive sum.", REPS,
+     double_dot_naive_setup, double_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, double_dot_parallel, NULL},
+    {"blas_op", "dot_kway", "float", "Float dot product, 8-way accumulators.", REPS,
+     float_dot_kway_setup, float_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, float_dot_parallel, NULL},
+    {"blas_op", "dot_kway", "double", "Double dot product, 8-way accumulators.", REPS,
+     double_dot_kway_setup, double_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, double_dot_parallel, NULL},
+    {"blas_op", "dot_pairwise", "float", "Float dot product, blocked pairwise sum.", REPS,
+     float_dot_pairwise_setup, float_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, float_dot_parallel, NULL},
+    {"blas_op", "dot_pairwise", "double", "Double dot product, blocked pairwise sum.", REPS,
+     double_dot_pairwise_setup, double_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, double_dot_parallel, NULL},
+    {"blas_op", "dot_kahan", "float", "Float dot product, Kahan-Neumaier sum.", REPS,
+     float_dot_kahan_setup, float_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, float_dot_parallel, NULL},
+    {"blas_op", "dot_kahan", "double", "Double dot product, Kahan-Neumaier sum.", REPS,
+     double_dot_kahan_setup, double_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, double_dot_parallel, NULL},
+    {"blas_op", "dot_double", "float", "Float dot product, double accumulator.", REPS,
+     float_dot_double_setup, float_dot_compute, vec_teardown, dot_flops, dot_bytes,
+     NULL, vec_footprint, vec_resize, dot_verify, float_dot_parallel, NULL},
+
+    {"blas_op", "scalar_mult", "int", "Int scalar multiplication.", REPS,
+     int_scal_setup, int_scal_compute, vec_teardown, scal_flops, scal_bytes,
+     NULL, vec_footprint, vec_resize, scal_verify, int_scal_parallel, NULL},
+    {"blas_op", "scalar_mult", "float", "Float scalar multiplication.", REPS,
+     float_scal_setup, float_scal_compute, vec_teardown, scal_flops, scal_bytes,
+     NULL, vec_footprint, vec_resize, scal_verify, float_scal_parallel, NULL},
+    {"blas_op", "scalar_mult", "double", "Double scalar multiplication.", REPS,
+     double_scal_setup, double_scal_compute, vec_teardown, scal_flops, scal_bytes,
+     NULL, vec_footprint, vec_resize, scal_verify, double_scal_parallel, NULL},
+    {"blas_op", "scalar_mult", "fp16", "Fp16 scalar multiplication, computed in float.", REPS,
+     fp16_scal_setup, half_scal_compute, vec_teardown, scal_flops, scal_bytes,
+     NULL, vec_footprint, vec_resize, scal_verify, half_scal_parallel, NULL},
+    {"blas_op", "scalar_mult", "bf16", "Bf16 scalar multiplication, computed in float.", REPS,
+     bf16_scal_setup, half_scal_compute, vec_teardown, scal_flops, scal_bytes,
+     NULL, vec_footprint, vec_resize, scal_verify, half_scal_parallel, NULL},
+    {"blas_op", "scalar_mult", "int16", "Int16 scalar multiplication, saturating.", REPS,
+     int16_scal_setup, int16_scal_compute, vec_teardown, scal_flops, scal_bytes,
+     NULL, vec_footprint, vec_resize, scal_verify, int16_scal_parallel, NULL},
+    {"blas_op", "scalar_mult", "int32", "Int32 scalar multiplication, saturating.", REPS,
+     int32_scal_setup, int32_scal_compute, vec_teardown, scal_flops, scal_bytes,
+     NULL, vec_footprint, vec_resize, scal_verify, int32_scal_parallel, NULL},
+    {"blas_op", "scalar_mult", "int64", "Int64 scalar multiplication, saturating.", REPS,
+     int64_scal_setup, int64_scal_compute, vec_teardown, scal_flops, scal_bytes,
+     NULL, vec_footprint, vec_resize, scal_verify, int64_scal_parallel, NULL},
+
+    {"blas_op", "norm", "int", "Int vector norm.", REPS,
+     int_norm_setup, int_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, int_norm_parallel, NULL},
+    {"blas_op", "norm", "float", "Float vector norm.", REPS,
+     float_norm_setup, float_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, float_norm_parallel, NULL},
+    {"blas_op", "norm", "double", "Double vector norm.", REPS,
+     double_norm_setup, double_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, double_norm_parallel, NULL},
+    {"blas_op", "norm", "fp16", "Fp16 vector norm, float accumulation.", REPS,
+     fp16_norm_setup, half_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, half_norm_parallel, NULL},
+    {"blas_op", "norm", "bf16", "Bf16 vector norm, float accumulation.", REPS,
+     bf16_norm_setup, half_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, half_norm_parallel, NULL},
+
+    {"blas_op", "norm_naive", "float", "Float vector norm, naive sum.", REPS,
+     float_norm_naive_setup, float_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, float_norm_parallel, NULL},
+    {"blas_op", "norm_naive", "double", "Double vector norm, naive sum.", REPS,
+     double_norm_naive_setup, double_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, double_norm_parallel, NULL},
+    {"blas_op", "norm_kway", "float", "Float vector norm, 8-way accumulators.", REPS,
+     float_norm_kway_setup, float_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, float_norm_parallel, NULL},
+    {"blas_op", "norm_kway", "double", "Double vector norm, 8-way accumulators.", REPS,
+     double_norm_kway_setup, double_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, double_norm_parallel, NULL},
+    {"blas_op", "norm_pairwise", "float", "Float vector norm, blocked pairwise sum.", REPS,
+     float_norm_pairwise_setup, float_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, float_norm_parallel, NULL},
+    {"blas_op", "norm_pairwise", "double", "Double vector norm, blocked pairwise sum.", REPS,
+     double_norm_pairwise_setup, double_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, double_norm_parallel, NULL},
+    {"blas_op", "norm_kahan", "float", "Float vector norm, Kahan-Neumaier sum.", REPS,
+     float_norm_kahan_setup, float_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, float_norm_parallel, NULL},
+    {"blas_op", "norm_kahan", "double", "Double vector norm, Kahan-Neumaier sum.", REPS,
+     double_norm_kahan_setup, double_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, double_norm_parallel, NULL},
+    {"blas_op", "norm_double", "float", "Float vector norm, double accumulator.", REPS,
+     float_norm_double_setup, float_norm_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, norm_verify, float_norm_parallel, NULL},
+
+    {"blas_op", "norm_blue", "float", "Float vector norm, Blue's overflow safe algorithm.", REPS,
+     float_nrm2_setup, float_nrm2_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, nrm2_verify, float_nrm2_parallel, NULL},
+    {"blas_op", "norm_blue", "double", "Double vector norm, Blue's overflow safe algorithm.", REPS,
+     double_nrm2_setup, double_nrm2_compute, vec_teardown, norm_flops, norm_bytes,
+     NULL, vec_footprint, vec_resize, nrm2_verify, double_nrm2_parallel, NULL},
+
+    {"blas_op", "axpy", "int", "Int AXPY.", REPS,
+     int_axpy_setup, int_axpy_compute, vec_teardown, axpy_flops, axpy_bytes,
+     NULL, vec_footprint, vec_resize, axpy_verify, int_axpy_parallel, NULL},
+    {"blas_op", "axpy", "float", "Float AXPY.", REPS,
+     float_axpy_setup, float_axpy_compute, vec_teardown, axpy_flops, axpy_bytes,
+     NULL, vec_footprint, vec_resize, axpy_verify, float_axpy_parallel, NULL},
+    {"blas_op", "axpy", "double", "Double AXPY.", REPS,
+     double_axpy_setup, double_axpy_compute, vec_teardown, axpy_flops, axpy_bytes,
+     NULL, vec_footprint, vec_resize, axpy_verify, double_axpy_parallel, NULL},
+    {"blas_op", "axpy", "fp16", "Fp16 AXPY, computed in float.", REPS,
+     fp16_axpy_setup, half_axpy_compute, vec_teardown, axpy_flops, axpy_bytes,
+     NULL, vec_footprint, vec_resize, axpy_verify, half_axpy_parallel, NULL},
+    {"blas_op", "axpy", "bf16", "Bf16 AXPY, computed in float.", REPS,
+     bf16_axpy_setup, half_axpy_compute, vec_teardown, axpy_flops, axpy_bytes,
+     NULL, vec_footprint, vec_resize, axpy_verify, half_axpy_parallel, NULL},
+    {"blas_op", "axpy", "int16", "Int16 AXPY, saturating.", REPS,
+     int16_axpy_setup, int16_axpy_compute, vec_teardown, axpy_flops, axpy_bytes,
+     NULL, vec_footprint, vec_resize, axpy_verify, int16_axpy_parallel, NULL},
+    {"blas_op", "axpy", "int32", "Int32 AXPY, saturating.", REPS,
+     int32_axpy_setup, int32_axpy_compute, vec_teardown, axpy_flops, axpy_bytes,
+     NULL, vec_footprint, vec_resize, axpy_verify, int32_axpy_parallel, NULL},
+    {"blas_op", "axpy", "int64", "Int64 AXPY, saturating.", REPS,
+     int64_axpy_setup, int64_axpy_compute, vec_teardown, axpy_flops, axpy_bytes,
+     NULL, vec_footprint, vec_resize, axpy_verify, int64_axpy_parallel, NULL},
+    {"blas_op", "axpy_dot", "float", "Float AXPY and squared norm of the result, two passes.", REPS,
+     float_axpy_setup, float_axpy_dot_compute, vec_teardown, axpy_dot_flops, axpy_dot_bytes,
+     NULL, vec_footprint, vec_resize, axpy_dot_verify, float_axpy_dot_parallel, NULL},
+    {"blas_op", "axpy_dot", "double", "Double AXPY and squared norm of the result, two passes.", REPS,
+     double_axpy_setup, double_axpy_dot_compute, vec_teardown, axpy_dot_flops, axpy_dot_bytes,
+     NULL, vec_footprint, vec_resize, axpy_dot_verify, double_axpy_dot_parallel, NULL},
+    {"blas_op", "axpy_dot_fused", "float", "Float AXPY and squared norm of the result, fused.", REPS,
+     float_axpy_fused_setup, axpy_dot_fused_compute, vec_teardown, axpy_dot_flops, axpy_dot_fused_bytes,
+     NULL, vec_footprint, vec_resize, axpy_dot_verify, axpy_dot_fused_parallel, axpy_dot_saved},
+    {"blas_op", "axpy_dot_fused", "double", "Double AXPY and squared norm of the result, fused.", REPS,
+     double_axpy_fused_setup, axpy_dot_fused_compute, vec_teardown, axpy_dot_flops, axpy_dot_fused_bytes,
+     NULL, vec_footprint, vec_resize, axpy_dot_verify, axpy_dot_fused_parallel, axpy_dot_saved},
+
+    {"blas_op", "dmv", "int", "Int dense Matrix-Vector product, summed in 64 bits.", REPS,
+     int_dmv_setup, int_dmv_compute, dmv_teardown, dmv_flops, dmv_bytes,
+     NULL, dmv_footprint, dmv_resize, dmv_verify, int_dmv_parallel, NULL},
+    {"blas_op", "dmv", "float", "Float dense Matrix-Vector product.", REPS,
+     float_dmv_setup, float_dmv_compute, dmv_teardown, dmv_flops, dmv_bytes,
+     NULL, dmv_footprint, dmv_resize, dmv_verify, float_dmv_parallel, NULL},
+    {"blas_op", "dmv", "double", "Double dense Matrix-Vector product.", REPS,
+     double_dmv_setup, double_dmv_compute, dmv_teardown, dmv_flops, dmv_bytes,
+     NULL, dmv_footprint, dmv_resize, dmv_verify, double_dmv_parallel, NULL},
+    {"blas_op", "dmv", "int16", "Int16 dense Matrix-Vector product, summed in 64 bits.", REPS,
+     int16_dmv_setup, int16_dmv_compute, dmv_teardown, dmv_flops, dmv_bytes,
+     NULL, dmv_footprint, dmv_resize, dmv_verify, int16_dmv_parallel, NULL},
+    {"blas_op", "dmv", "int32", "Int32 dense Matrix-Vector product, summed in 64 bits.", REPS,
+     int32_dmv_setup, int32_dmv_compute, dmv_teardown, dmv_flops, dmv_bytes,
+     NULL, dmv_footprint, dmv_resize, dmv_verify, int32_dmv_parallel, NULL},
+    {"blas_op", "dmv", "int64", "Int64 dense Matrix-Vector product, summed in 128 bits, saturating.", REPS,
+     int64_dmv_setup, int64_dmv_compute, dmv_teardown, dmv_flops, dmv_bytes,
+     NULL, dmv_footprint, dmv_resize, dmv_verify, int64_dmv_parallel, NULL},
+    {"blas_op", "dmv_t", "int", "Int dense transposed Matrix-Vector product, summed in 64 bits.", REPS,
+     int_dmv_setup, int_dmv_t_compute, dmv_teardown, dmv_flops, dmv_bytes,
+     NULL, dmv_footprint, dmv_resize, dmv_t_verify, int_dmv_t_parallel, NULL},
+    {"blas_op", "dmv_t", "float", "Float dense transposed Matrix-Vector product.", REPS,
+     float_dmv_setup, float_dmv_t_compute, dmv_teardown, dmv_flops, dmv_bytes,
+     NULL, dmv_footprint, dmv_resize, dmv_t_verify, float_dmv_t_parallel, NULL},
+    {"blas_op", "dmv_t", "double", "Double dense transposed Matrix-Vector product.", REPS,
+     double_dmv_setup, double_dmv_t_compute, dmv_teardown, dmv_flops, dmv_bytes,
+     NULL, dmv_footprint, dmv_resize, dmv_t_verify, double_dmv_t_parallel, NULL},
+
+    {"blas_op", "gemm", "float", "Float dense Matrix-Matrix product, blocked and packed.", REPS,
+     float_gemm_setup, float_gemm_compute, gemm_teardown, gemm_flops, gemm_bytes,
+     NULL, gemm_footprint, gemm_resize, gemm_verify, float_gemm_parallel, NULL},
+    {"blas_op", "gemm", "double", "Double dense Matrix-Matrix product, blocked and packed.", REPS,
+     double_gemm_setup, double_gemm_compute, gemm_teardown, gemm_flops, gemm_bytes,
+     NULL, gemm_footprint, gemm_resize, gemm_verify, double_gemm_parallel, NULL},
+    {"blas_op", "gemm_naive", "float", "Float dense Matrix-Matrix product, triple loop.", REPS,
+     float_gemm_naive_setup, float_gemm_naive_compute, gemm_teardown, gemm_flops, gemm_bytes,
+     NULL, gemm_footprint, gemm_resize, gemm_verify, float_gemm_naive_parallel, NULL},
+    {"blas_op", "gemm_naive", "double", "Double dense Matrix-Matrix product, triple loop.", REPS,
+     double_gemm_naive_setup, double_gemm_naive_compute, gemm_teardown, gemm_flops, gemm_bytes,
+     NULL, gemm_footprint, gemm_resize, gemm_verify, double_gemm_naive_parallel, NULL},
+
+    {"blas_op", "spmv", "float", "Sparse float DMVs.", REPS,
+     float_spmv_setup, float_spmv_compute, spmv_teardown, spmv_flops, spmv_bytes,
+     NULL, spmv_footprint, NULL, spmv_verify, float_spmv_parallel, NULL},
+    {"blas_op", "spmv", "double", "Sparse double DMVs.", REPS,
+     double_spmv_setup, double_spmv_compute, spmv_teardown, spmv_flops, spmv_bytes,
+     NULL, spmv_footprint, NULL, spmv_verify, double_spmv_parallel, NULL},
+    {"blas_op", "spmv", "fp16", "Sparse fp16 DMVs, float vectors and accumulation.", REPS,
+     fp16_spmv_setup, half_spmv_compute, spmv_teardown, spmv_flops, spmv_bytes,
+     NULL, spmv_footprint, NULL, spmv_verify, half_spmv_parallel, NULL},
+    {"blas_op", "spmv", "bf16", "Sparse bf16 DMVs, float vectors and accumulation.", REPS,
+     bf16_spmv_setup, half_spmv_compute, spmv_teardown, spmv_flops, spmv_bytes,
+     NULL, spmv_footprint, NULL, spmv_verify, half_spmv_parallel, NULL},
+
+    {"blas_op", "spgemm", "float", "Sparse float GEMM.", SPGEMM_REPS,
+     float_spgemm_setup, float_spgemm_compute, spgemm_teardown, spgemm_flops, spgemm_bytes,
+     NULL, spgemm_footprint, NULL, spgemm_verify, float_spgemm_parallel, NULL},
+    {"blas_op", "spgemm", "double", "Sparse DGEMMs", SPGEMM_REPS,
+     double_spgemm_setup, double_spgemm_compute, spgemm_teardown, spgemm_flops, spgemm_bytes,
+     NULL, spgemm_footprint, NULL, spgemm_verify, double_spgemm_parallel, NULL},
+
+    {NULL}
+};
@@ -24,12 +24,21 @@
 #include <time.h>
 #include <math.h>
 
+#include "fuse.h"
+#include "level1.h"
+#include "memory.h"
+#include "par.h"
+#include "pool.h"
+#include "rng.h"
 #include "utils.h"
 
 #define PCG_TOLERANCE 1e-3
 #define PCG_MAX_ITER 1000
 #define PCG_FLOAT_TOLERANCE 1e-2
 
+/* Default timed repetitions, each one a complete solve */
+#define REPS 5
+
 /* Conjugate gradient benchmark */
 
 
@@ -56,325 +65,456 @@ typedef struct
 
 /*
  * Sparse matrix and vector utility functions
+ *
+ * Each loop is written over a range of rows or elements, so the
+ * threaded solvers (par set) can split it with par_for().
  */
-static void CSR_matrix_vector_mult(CSRmatrix *A, double *x, double *b)
+typedef struct
+{
+  void *A;
+  void *x, *y;
+  double alpha;
+} cg_args;
+
+static double spmv_range(void *p, unsigned long begin, unsigned long end)
 {
+  cg_args *a = p;
+  CSRmatrix *A = a->A;
+  double *x = a->x, *b = a->y;
   int i, j;
-  for (i = 0; i < A->nrow; i++) {
+  for (i = begin; i < (int)end; i++) {
     double sum = 0.0;
     for (j = A->rowStart[i]; j < A->rowStart[i+1]; j++) {
       sum += A->values[j] * x[A->colIndex[j]];
     }
     b[i] = sum;
   }
+  return 0.0;
 }
 
-static void CSR_matrix_vector_multF(CSRmatrixF *A, float *x, float *b)
+static double spmv_rangeF(void *p, unsigned long begin, unsigned long end)
 {
+  cg_args *a = p;
+  CSRmatrixF *A = a->A;
+  float *x = a->x, *b = a->y;
   int i, j;
-  for (i = 0; i < A->nrow; i++) {
+  for (i = begin; i < (int)end; i++) {
     float sum = 0.0;
     for (j = A->rowStart[i]; j < A->rowStart[i+1]; j++) {
       sum += A->values[j] * x[A->colIndex[j]];
     }
     b[i] = sum;
   }
+  return 0.0;
 }
 
-static double dotProduct(double *v1, double *v2, int size)
+static double dot_range(void *p, unsigned long begin, unsigned long end)
 {
-  int i;
+  cg_args *a = p;
+  double *v1 = a->x, *v2 = a->y;
+  unsigned long i;
   double result = 0.0;
-  for (i = 0; i < size; i++) {
+  for (i = begin; i < end; i++) {
     result += v1[i] * v2[i];
   }
   return result;
 }
 
-static float dotProductF(float *v1, float *v2, int size)
+static double dot_rangeF(void *p, unsigned long begin, unsigned long end)
 {
-  int i;
+  cg_args *a = p;
+  float *v1 = a->x, *v2 = a->y;
+  unsigned long i;
   float result = 0.0;
-  for (i = 0; i < size; i++) {
+  for (i = begin; i < end; i++) {
     result += v1[i] * v2[i];
   }
   return result;
 }
 
-static void vecAxpy(double *x, double *y, int size, double alpha)
+static double aypx_range(void *p, unsigned long begin, unsigned long end)
 {
-  int i;
-  for (i = 0; i < size; i++) {
-    y[i] = y[i] + alpha * x[i];
+  cg_args *a = p;
+  double *x = a->x, *y = a->y;
+  double alpha = a->alpha;
+  unsigned long i;
+  for (i = begin; i < end; i++) {
+    y[i] = alpha * y[i] + x[i];
   }
+  return 0.0;
 }
 
-static void vecAxpyF(float *x, float *y, int size, float alpha)
+static double aypx_rangeF(void *p, unsigned long begin, unsigned long end)
 {
-  int i;
-  for (i = 0; i < size; i++) {
-    y[i] = y[i] + alpha * x[i];
+  cg_args *a = p;
+  float *x = a->x, *y = a->y;
+  float alpha = a->alpha;
+  unsigned long i;
+  for (i = begin; i < end; i++) {
+    y[i] = alpha * y[i] + x[i];
   }
+  return 0.0;
 }
 
-static void vecAypx(double *x, double *y, int size, double alpha)
+/* Run fn over [0, n), split over the threads if par is set */
+static double cg_loop(int par, unsigned long n, par_fn fn, cg_args *a)
 {
-  int i;
-  for (i = 0; i < size; i++) {
-    y[i] = alpha * y[i] + x[i];
+  return par ? par_for(n, fn, a) : fn(a, 0, n);
+}
+
+static void CSR_matrix_vector_mult(CSRmatrix *A, double *x, double *b, int par)
+{
+  cg_args a = { A, x, b, 0.0 };
+  cg_loop(par, A->nrow, spmv_range, &a);
+}
+
+static void CSR_matrix_vector_multF(CSRmatrixF *A, float *x, float *b, int par)
+{
+  cg_args a = { A, x, b, 0.0 };
+  cg_loop(par, A->nrow, spmv_rangeF, &a);
+}
+
+static double dotProduct(double *v1, double *v2, int size, int par)
+{
+  cg_args a = { NULL, v1, v2, 0.0 };
+  return cg_loop(par, size, dot_range, &a);
+}
+
+static float dotProductF(float *v1, float *v2, int size, int par)
+{
+  cg_args a = { NULL, v1, v2, 0.0 };
+  return cg_loop(par, size, dot_rangeF, &a);
+}
+
+static void vecAypx(double *x, double *y, int size, double alpha, int par)
+{
+  cg_args a = { NULL, x, y, alpha };
+  cg_loop(par, size, aypx_range, &a);
+}
+
+static void vecAypxF(float *x, float *y, int size, float alpha, int par)
+{
+  cg_args a = { NULL, x, y, alpha };
+  cg_loop(par, size, aypx_rangeF, &a);
+}
+
+
+/* State for the double precision and mixed precision CG kernels */
+typedef struct
+{
+  unsigned int s;
+  int iters;
+  CSRmatrix *A;
+  CSRmatrixF *AF;
+  double *x, *b, *r, *p, *omega;
+  float *xf, *bf, *rf, *pf, *omegaf;
+  double *sums;                 /* block sums of the fused update */
+} cg_state;
+
+
+static void cg_teardown(void *arg);
+static void cg_reset(void *arg);
+
+/*
+ * Setup work split over the setup threads by rows, so each part of the
+ * matrix and vectors is first touched by the thread owning those rows.
+ * The matrix is diagonal: row i holds the single entry (i, i).
+ */
+static void cg_structure(void *arg, unsigned long begin, unsigned long end)
+{
+  CSRmatrix *A = arg;
+  unsigned long i;
+
+  for (i = begin; i < end; i++) {
+    A->rowStart[i] = i;
+    A->colIndex[i] = i;
   }
 }
 
-static void vecAypxF(float *x, float *y, int size, float alpha)
+static void cg_structureF(void *arg, unsigned long begin, unsigned long end)
 {
-  int i;
-  for (i = 0; i < size; i++) {
-    y[i] = alpha * y[i] + x[i];
+  CSRmatrixF *A = arg;
+  unsigned long i;
+
+  for (i = begin; i < end; i++) {
+    A->rowStart[i] = i;
+    A->colIndex[i] = i;
   }
 }
 
+/* b = A x for rows [begin, end) */
+static void cg_rhs(void *arg, unsigned long begin, unsigned long end)
+{
+  cg_state *st = arg;
+  CSRmatrix *A = st->A;
+  unsigned long i;
+  int j;
 
-int conjugate_gradient(unsigned int s)
+  for (i = begin; i < end; i++) {
+    double sum = 0.0;
+    for (j = A->rowStart[i]; j < A->rowStart[i + 1]; j++)
+      sum += A->values[j] * st->x[A->colIndex[j]];
+    st->b[i] = sum;
+  }
+}
+
+/*======================================================================
+ *
+ * generate a random diagonal matrix of size s x s, and the vectors
+ * (unknowns, RHS and temporaries) for the solver
+ *
+ *======================================================================*/
+static cg_state *cg_alloc(unsigned int s, int mixed)
 {
+  cg_state *st;
   CSRmatrix *A;
   int i;
-  double *x, *b, *r, *p, *omega;
-  int k;
-  double r0, r1, beta, dot, alpha;
-  double tol = PCG_TOLERANCE * PCG_TOLERANCE;
 
-  struct timespec start, end;
+  st = calloc(1, sizeof(cg_state));
+  if (st == NULL) return NULL;
+  st->s = s;
 
-  /*======================================================================
-   *
-   * generate a random matrix of size s x s
-   *
-   *======================================================================*/
   A = malloc(sizeof(CSRmatrix));
+  st->A = A;
+  if (A == NULL) {
+    cg_teardown(st);
+    return NULL;
+  }
   A->nrow = s;
   A->ncol = s;
   A->nzmax = s;
-  A->colIndex = malloc(A->nzmax * sizeof(int));
-  A->rowStart = malloc((A->nrow+1) * sizeof(int));
-  A->values = malloc(A->nzmax * sizeof(double));
+  A->colIndex = mem_alloc(A->nzmax * sizeof(int));
+  A->rowStart = mem_alloc((A->nrow+1) * sizeof(int));
+  A->values = mem_alloc(A->nzmax * sizeof(double));
 
-  /* generate structure for matrix */
-  for (i = 0; i < A->nrow; i++) {
-    A->rowStart[i] = i;
-    A->colIndex[i] = i;
+  /* allocate vectors (unknowns, RHS and temporaries) */
+  st->x = mem_alloc(s * sizeof(double));
+  st->b = mem_alloc(s * sizeof(double));
+  st->r = mem_alloc(s * sizeof(double));
+  st->p = mem_alloc(s * sizeof(double));
+  st->omega = mem_alloc(s * sizeof(double));
+  st->sums = malloc(fuse_sums(s) * sizeof(double));
+
+  if (!A->colIndex || !A->rowStart || !A->values ||
+      !st->x || !st->b || !st->r || !st->p || !st->omega || !st->sums) {
+    printf("Conjugate gradient Error: Unable to allocate memory\n");
+    cg_teardown(st);
+    return NULL;
   }
-  A->rowStart[i] = i;
-
-  /* now generate values for matrix */
-  srand((unsigned int)time(NULL));
 
-  for (i = 0; i < A->nzmax; i++) {
-    A->values[i] = rand() / 32768.0;
-  }
+  /* generate structure for matrix */
+  pool_for(A->nrow, cg_structure, A);
+  A->rowStart[A->nrow] = A->nrow;
 
-  /*======================================================================
-   *
-   * Initialise vectors
-   *
-   *======================================================================*/
-  /* allocate vectors (unknowns, RHS and temporaries) */
-  x = malloc(s * sizeof(double));
-  b = malloc(s * sizeof(double));
-  r = malloc(s * sizeof(double));
-  p = malloc(s * sizeof(double));
-  omega = malloc(s * sizeof(double));
+  /* now generate values for matrix */
+  rng_double(A->values, A->nzmax, 0.0, 65536.0, RNG_A, 0);
 
   /* generate a random vector of size s for the unknowns */
-  for (i = 0; i < s; i++) {
-    x[i] = rand() / 32768.0;
-  }
+  rng_double(st->x, s, 0.0, 65536.0, RNG_X, 0);
 
   /* multiply matrix by vector to get RHS */
-  CSR_matrix_vector_mult(A, x, b);
+  pool_for(A->nrow, cg_rhs, st);
+
+  if (mixed) {
+    CSRmatrixF *AF = malloc(sizeof(CSRmatrixF));
+    st->AF = AF;
+    if (AF == NULL) {
+      cg_teardown(st);
+      return NULL;
+    }
+    AF->nrow = s;
+    AF->ncol = s;
+    AF->nzmax = s;
+    AF->colIndex = mem_alloc(AF->nzmax * sizeof(int));
+    AF->rowStart = mem_alloc((AF->nrow+1) * sizeof(int));
+    AF->values = mem_alloc(AF->nzmax * sizeof(float));
+
+    st->xf = mem_alloc(s * sizeof(float));
+    st->bf = mem_alloc(s * sizeof(float));
+    st->rf = mem_alloc(s * sizeof(float));
+    st->pf = mem_alloc(s * sizeof(float));
+    st->omegaf = mem_alloc(s * sizeof(float));
+
+    if (!AF->colIndex || !AF->rowStart || !AF->values ||
+        !st->xf || !st->bf || !st->rf || !st->pf || !st->omegaf) {
+      printf("Conjugate gradient Error: Unable to allocate memory\n");
+      cg_teardown(st);
+      return NULL;
+    }
 
-  /* clear initial guess and initialise temporaries */
-  for (i = 0; i < s; i++) {
-    x[i] = 0.0;
+    pool_for(AF->nrow, cg_structureF, AF);
+    AF->rowStart[AF->nrow] = AF->nrow;
 
-    /* r = b - Ax; since x is 0, r = b */
-    r[i] = b[i];
+    for (i = 0; i < AF->nzmax; i++) {
+      AF->values[i] = (float)A->values[i];
+    }
 
-    /* p = r ( = b)*/
-    p[i] = b[i];
+    for (i = 0; i < s; i++) {
+      st->xf[i] = (float)st->x[i];
+    }
 
-    omega[i] = 0.0;
+    CSR_matrix_vector_multF(AF, st->xf, st->bf, 0);
   }
 
+  cg_reset(st);
 
-  clock_gettime(CLOCK, &start);
+  return st;
+}
 
-  /* compute initial residual */
-  r1 = dotProduct(r, r, s);
-  r0 = r1;
+static void *cg_setup(unsigned long s)
+{
+  return cg_alloc(s, 0);
+}
 
-  /*======================================================================
-   *
-   * Actual solver loop
-   *
-   *======================================================================*/
-  k = 0;
-  while ((r1 > tol) && (k <= PCG_MAX_ITER)) {
-    /* omega = Ap */
-    CSR_matrix_vector_mult(A, p, omega);
+static void *cg_mixed_setup(unsigned long s)
+{
+  return cg_alloc(s, 1);
+}
 
-    /* dot = p . omega */
-    dot = dotProduct(p, omega, s);
+/* clear initial guess and initialise temporaries before each solve */
+static void cg_reset_range(void *arg, unsigned long begin, unsigned long end)
+{
+  cg_state *st = arg;
+  unsigned long i;
 
-    alpha = r1 / dot;
+  for (i = begin; i < end; i++) {
+    st->x[i] = 0.0;
 
-    /* x = x + alpha.p */
-    vecAxpy(p, x, s, alpha);
+    /* r = b - Ax; since x is 0, r = b */
+    st->r[i] = st->b[i];
 
-    /* r = r - alpha.omega */
-    vecAxpy(omega, r, s, -alpha);
+    /* p = r ( = b)*/
+    st->p[i] = st->b[i];
 
-    r0 = r1;
+    st->omega[i] = 0.0;
 
-    /* r1 = r . r */
-    r1 = dotProduct(r, r, s);
+    if (st->AF) {
+      st->xf[i] = 0.0;
+      st->rf[i] = st->bf[i];
+      st->pf[i] = st->bf[i];
+      st->omegaf[i] = 0.0;
+    }
+  }
+}
 
-    beta = r1 / r0;
+static void cg_reset(void *arg)
+{
+  cg_state *st = arg;
 
-    /* p = r + beta.p */
-    vecAypx(r, p, s, beta);
-    k++;
-  }
+  pool_for(st->s, cg_reset_range, st);
+}
 
-  clock_gettime(CLOCK, &end);
-  elapsed_time_hr(start, end, "Conjugate gradient solve.");
+/*======================================================================
+ *
+ * Free memory
+ *
+ *======================================================================*/
+static void cg_teardown(void *arg)
+{
+  cg_state *st = arg;
 
-  /*======================================================================
-   *
-   * Free memory
-   *
-   *======================================================================*/
   /* free the vectors */
-  free(omega);
-  free(p);
-  free(r);
-  free(b);
-  free(x);
+  mem_free(st->omega);
+  mem_free(st->p);
+  mem_free(st->r);
+  mem_free(st->b);
+  mem_free(st->x);
+
+  mem_free(st->omegaf);
+  mem_free(st->pf);
+  mem_free(st->rf);
+  mem_free(st->bf);
+  mem_free(st->xf);
+
+  free(st->sums);
 
   /* free the matrix */
-  free(A->colIndex);
-  free(A->rowStart);
-  free(A->values);
-  free(A);
+  if (st->A) {
+    mem_free(st->A->colIndex);
+    mem_free(st->A->rowStart);
+    mem_free(st->A->values);
+    free(st->A);
+  }
+
+  if (st->AF) {
+    mem_free(st->AF->colIndex);
+    mem_free(st->AF->rowStart);
+    mem_free(st->AF->values);
+    free(st->AF);
+  }
 
-  return 0;
+  free(st);
 }
 
 
-/* mixed precision version */
-int conjugate_gradient_mixed(unsigned int s)
+/* Conjugate gradient solve in double precision, threaded if par is set */
+static double cg_solve(cg_state *st, int par)
 {
-  CSRmatrix *A;
-  CSRmatrixF *AF;
-  int i;
-  double *x, *b, *r, *p, *omega;
-  float *xf, *bf, *rf, *pf, *omegaf;
+  CSRmatrix *A = st->A;
+  int s = st->s;
+  double *x = st->x, *r = st->r, *p = st->p, *omega = st->omega;
   int k;
   double r0, r1, beta, dot, alpha;
-  float r0f, r1f, betaf, dotf, alphaf;
-  double tol = PCG_FLOAT_TOLERANCE * PCG_FLOAT_TOLERANCE;
+  double tol = PCG_TOLERANCE * PCG_TOLERANCE;
+  fuse_t f;
 
-  struct timespec start, end;
+  /* compute initial residual */
+  r1 = dotProduct(r, r, s, par);
+  r0 = r1;
 
   /*======================================================================
    *
-   * generate a random matrix of size s x s
+   * Actual solver loop
    *
    *======================================================================*/
-  A = malloc(sizeof(CSRmatrix));
-  A->nrow = s;
-  A->ncol = s;
-  A->nzmax = s;
-  A->colIndex = malloc(A->nzmax * sizeof(int));
-  A->rowStart = malloc((A->nrow+1) * sizeof(int));
-  A->values = malloc(A->nzmax * sizeof(double));
-
-  AF = malloc(sizeof(CSRmatrixF));
-  AF->nrow = s;
-  AF->ncol = s;
-  AF->nzmax = s;
-  AF->colIndex = malloc(AF->nzmax * sizeof(int));
-  AF->rowStart = malloc((AF->nrow+1) * sizeof(int));
-  AF->values = malloc(AF->nzmax * sizeof(float));
-
-  /* generate structure for matrix */
-  for (i = 0; i < A->nrow; i++) {
-    A->rowStart[i] = i;
-    A->colIndex[i] = i;
+  k = 0;
+  while ((r1 > tol) && (k <= PCG_MAX_ITER)) {
+    /* omega = Ap */
+    CSR_matrix_vector_mult(A, p, omega, par);
 
-    AF->rowStart[i] = i;
-    AF->colIndex[i] = i;
-  }
-  A->rowStart[i] = i;
-  AF->rowStart[i] = i;
+    /* dot = p . omega */
+    dot = dotProduct(p, omega, s, par);
 
-  /* now generate values for matrix */
-  srand((unsigned int)time(NULL));
+    alpha = r1 / dot;
 
-  for (i = 0; i < A->nzmax; i++) {
-    A->values[i] = rand() / 32768.0;
-    AF->values[i] = (float)A->values[i];
-  }
+    /* x = x + alpha.p, r = r - alpha.omega and r1 = r . r in one pass */
+    r0 = r1;
+    fuse_init(&f, FUSE_DOUBLE, s, st->sums);
+    fuse_axpy(&f, alpha, p, x);
+    fuse_axpy(&f, -alpha, omega, r);
+    fuse_dot(&f, r, r, &r1);
+    fuse_run(&f, par);
 
-  /*======================================================================
-   *
-   * Initialise vectors
-   *
-   *======================================================================*/
-  /* allocate vectors (unknowns, RHS and temporaries) */
-  x = malloc(s * sizeof(double));
-  b = malloc(s * sizeof(double));
-  r = malloc(s * sizeof(double));
-  p = malloc(s * sizeof(double));
-  omega = malloc(s * sizeof(double));
-
-  xf = malloc(s * sizeof(float));
-  bf = malloc(s * sizeof(float));
-  rf = malloc(s * sizeof(float));
-  pf = malloc(s * sizeof(float));
-  omegaf = malloc(s * sizeof(float));
+    beta = r1 / r0;
 
-  /* generate a random vector of size s for the unknowns */
-  for (i = 0; i < s; i++) {
-    x[i] = rand() / 32768.0;
-    xf[i] = (float)x[i];
+    /* p = r + beta.p */
+    vecAypx(r, p, s, beta, par);
+    k++;
   }
 
-  /* multiply matrix by vector to get RHS */
-  CSR_matrix_vector_mult(A, x, b);
-  CSR_matrix_vector_multF(AF, xf, bf);
-
-  /* clear initial guess and initialise temporaries */
-  for (i = 0; i < s; i++) {
-    x[i] = 0.0;
-    xf[i] = 0.0;
-
-    /* r = b - Ax; since x is 0, r = b */
-    r[i] = b[i];
-    rf[i] = bf[i];
-
-    /* p = r ( = b)*/
-    p[i] = b[i];
-    pf[i] = bf[i];
+  st->iters = k;
 
-    omega[i] = 0.0;
-    omegaf[i] = 0.0;
-  }
+  return r1;
+}
 
 
-  clock_gettime(CLOCK, &start);
+/* mixed precision version */
+static double cg_mixed_solve(cg_state *st, int par)
+{
+  CSRmatrix *A = st->A;
+  CSRmatrixF *AF = st->AF;
+  int s = st->s;
+  int i;
+  double *x = st->x, *r = st->r, *p = st->p, *omega = st->omega;
+  float *xf = st->xf, *rf = st->rf, *pf = st->pf, *omegaf = st->omegaf;
+  int k;
+  double r0, r1, beta, dot, alpha;
+  float r0f, r1f, betaf, dotf, alphaf;
+  double dotr, tol = PCG_FLOAT_TOLERANCE * PCG_FLOAT_TOLERANCE;
+  fuse_t f;
 
   /* compute initial residual */
-  r1f = dotProductF(rf, rf, s);
+  r1f = dotProductF(rf, rf, s, par);
   r0f = r1f;
 
   /*======================================================================
@@ -385,39 +525,44 @@ int conjugate_gradient_mixed(unsigned int s)
   k = 0;
   while ((r1f > tol) && (k <= PCG_MAX_ITER)) {
     /* omega = Ap */
-    CSR_matrix_vector_multF(AF, pf, omegaf);
+    CSR_matrix_vector_multF(AF, pf, omegaf, par);
 
     /* dot = p . omega */
-    dotf = dotProductF(pf, omegaf, s);
+    dotf = dotProductF(pf, omegaf, s, par);
 
     alphaf = r1f / dotf;
 
-    /* x = x + alpha.p */
-    vecAxpyF(pf, xf, s, alphaf);
-
-    /* r = r - alpha.omega */
-    vecAxpyF(omegaf, rf, s, -alphaf);
-
+    /* x = x + alpha.p, r = r - alpha.omega and r1 = r . r in one pass */
     r0f = r1f;
-
-    /* r1 = r . r */
-    r1f = dotProductF(rf, rf, s);
+    fuse_init(&f, FUSE_FLOAT, s, st->sums);
+    fuse_axpy(&f, alphaf, pf, xf);
+    fuse_axpy(&f, -alphaf, omegaf, rf);
+    fuse_dot(&f, rf, rf, &dotr);
+    fuse_run(&f, par);
+    r1f = dotr;
 
     betaf = r1f / r0f;
 
     /* p = r + beta.p */
-    vecAypxF(rf, pf, s, betaf);
+    vecAypxF(rf, pf, s, betaf, par);
     k++;
   }
 
-  /* convert for double precision iterations */
-  r1 = (double)r1f;
-  r0 = (double)r0f;
+  /*
+   * convert for double precision iterations; the single precision
+   * residual is for the rounded right hand side, so restart from the
+   * true residual r = b - Ax
+   */
   for (i = 0; i < s; i++) {
-      r[i] = (double)rf[i];
-      p[i] = (double)pf[i];
       x[i] = (double)xf[i];
   }
+  CSR_matrix_vector_mult(A, x, omega, par);
+  for (i = 0; i < s; i++) {
+      r[i] = st->b[i] - omega[i];
+      p[i] = r[i];
+  }
+  r1 = dotProduct(r, r, s, par);
+  r0 = r1;
 
   tol = PCG_TOLERANCE * PCG_TOLERANCE;
 
@@ -428,63 +573,114 @@ int conjugate_gradient_mixed(unsigned int s)
    *======================================================================*/
   while ((r1 > tol) && (k <= PCG_MAX_ITER)) {
     /* omega = Ap */
-    CSR_matrix_vector_mult(A, p, omega);
+    CSR_matrix_vector_mult(A, p, omega, par);
 
     /* dot = p . omega */
-    dot = dotProduct(p, omega, s);
+    dot = dotProduct(p, omega, s, par);
 
     alpha = r1 / dot;
 
-    /* x = x + alpha.p */
-    vecAxpy(p, x, s, alpha);
-
-    /* r = r - alpha.omega */
-    vecAxpy(omega, r, s, -alpha);
-
+    /* x = x + alpha.p, r = r - alpha.omega and r1 = r . r in one pass */
     r0 = r1;
-
-    /* r1 = r . r */
-    r1 = dotProduct(r, r, s);
+    fuse_init(&f, FUSE_DOUBLE, s, st->sums);
+    fuse_axpy(&f, alpha, p, x);
+    fuse_axpy(&f, -alpha, omega, r);
+    fuse_dot(&f, r, r, &r1);
+    fuse_run(&f, par);
 
     beta = r1 / r0;
 
     /* p = r + beta.p */
-    vecAypx(r, p, s, beta);
+    vecAypx(r, p, s, beta, par);
     k++;
   }
 
-  clock_gettime(CLOCK, &end);
-  elapsed_time_hr(start, end, "Conjugate gradient solve.");
+  st->iters = k;
 
-  /*======================================================================
-   *
-   * Free memory
-   *
-   *======================================================================*/
-  /* free the vectors */
-  free(omega);
-  free(p);
-  free(r);
-  free(b);
-  free(x);
+  return r1;
+}
 
-  free(omegaf);
-  free(pf);
-  free(rf);
-  free(bf);
-  free(xf);
+static double cg_compute(void *arg) { return cg_solve(arg, 0); }
+static double cg_parallel(void *arg) { return cg_solve(arg, 1); }
+static double cg_mixed_compute(void *arg) { return cg_mixed_solve(arg, 0); }
+static double cg_mixed_parallel(void *arg) { return cg_mixed_solve(arg, 1); }
 
+/*
+ * Work per solve: each iteration is one SpMV, two dot products, two
+ * AXPYs and one AYPX. The AXPYs and the second dot product share one
+ * fused pass, which saves reading r again. The mixed precision solver
+ * runs some of its iterations in single precision; they are counted as
+ * double here.
+ */
+static double cg_flops(void *arg)
+{
+  cg_state *st = arg;
 
-  /* free the matrix */
-  free(A->colIndex);
-  free(A->rowStart);
-  free(A->values);
-  free(A);
+  return (double)st->iters * (2.0 * st->A->nzmax + 10.0 * st->s) + 2.0 * st->s;
+}
+
+static double cg_bytes(void *arg)
+{
+  cg_state *st = arg;
+  double spmv = st->A->nzmax * (sizeof(double) + sizeof(int)) + (st->s + 1.0) * sizeof(int);
+
+  return (double)st->iters * (spmv + 13.0 * st->s * sizeof(double)) + st->s * sizeof(double);
+}
+
+static double cg_saved(void *arg)
+{
+  cg_state *st = arg;
+
+  return (double)st->iters * st->s * sizeof(double);
+}
 
-  free(AF->colIndex);
-  free(AF->rowStart);
-  free(AF->values);
-  free(AF);
+/* Matrix and the five solver vectors, plus their copies in single precision */
+static double cg_footprint(void *arg)
+{
+  cg_state *st = arg;
+  double fp = st->A->nzmax * (sizeof(double) + sizeof(int)) + (st->s + 1.0) * sizeof(int)
+              + 5.0 * st->s * sizeof(double);
+
+  if (st->AF)
+    fp += st->A->nzmax * (sizeof(float) + sizeof(int)) + (st->s + 1.0) * sizeof(int)
+          + 5.0 * st->s * sizeof(float);
+  return fp;
+}
+
+
+/*
+ * Check the solution against the true residual b - Ax, which the
+ * recurrence for r only tracks up to rounding. The solver stops once
+ * |r| falls below PCG_TOLERANCE, so twice that is allowed here.
+ */
+static double cg_verify(const kernel_t *k, void *arg, double *tol)
+{
+  cg_state *st = arg;
+  CSRmatrix *A = st->A;
+  long double sum = 0, ax;
+  int i, j;
+
+  k->compute(st);
+  *tol = 2.0 * PCG_TOLERANCE;
+  if (st->iters > PCG_MAX_ITER) return INFINITY;
 
-  return 0;
+  for (i = 0; i < A->nrow; i++) {
+    ax = 0;
+    for (j = A->rowStart[i]; j < A->rowStart[i + 1]; j++)
+      ax += (long double)A->values[j] * st->x[A->colIndex[j]];
+    sum += (st->b[i] - ax) * (st->b[i] - ax);
+  }
+
+  return sqrtl(sum);
 }
+
+
+const kernel_t cg_kernels[] = {
+  {"cg", "normal", "double", "Conjugate gradient solve.", REPS,
+   cg_setup, cg_compute, cg_teardown, cg_flops, cg_bytes, cg_reset,
+   cg_footprint, NULL, cg_verify, cg_parallel, cg_saved},
+  {"cg", "mixed", "double", "Conjugate gradient solve (mixed precision).", REPS,
+   cg_mixed_setup, cg_mixed_compute, cg_teardown, cg_flops, cg_bytes, cg_reset,
+   cg_footprint, NULL, cg_verify, cg_mixed_parallel, cg_saved},
+  {NULL}
+};
@@ -24,97 +24,199 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
-#include <ctype.h>
 
 #include "utils.h"
 #include "level1.h"
+#include "memory.h"
+#include "par.h"
+#include "rng.h"
 
-int create_line(char*, size_t, char*, unsigned int);
+int create_line(char*, size_t, char*, unsigned int, unsigned long);
 int seek_match(char*, size_t, char*, unsigned int);
 
+static char search_phrase[] = "AdeptProject";
 
-void fileparse(unsigned int num_rows){
+/* Length of each generated line, excluding the terminating NUL */
+#define LINE_LEN 81
 
-  char search_phrase[] = "AdeptProject";
-  size_t sp_len = strlen(search_phrase);
+/* Default timed repetitions */
+#define REPS 5
+
+/* Size of the stdio buffer the file is read through */
+#define READ_BUF (64*1024)
+
+/*
+ * The file contents live in the page cache, placed by the memory
+ * policy of the thread that wrote them; the read buffer comes from
+ * the memory layer so it follows the same placement.
+ */
+typedef struct {
+  unsigned int num_rows;
+  unsigned int matches;      /* lines holding the phrase, counted with strstr() */
+  char filename[32];
+  char *buf;
+} fileparse_state;
+
+
+/*
+ * Generate a file of num_rows random lines, about half of which
+ * contain the search phrase. This is untimed.
+ */
+static void *fileparse_setup(unsigned long num_rows){
 
-  unsigned int desired_line_len = 81;
-  char line[desired_line_len];
+  size_t sp_len = strlen(search_phrase);
+  char line[LINE_LEN+1];
 
-  srand(time(NULL)); // Set seed
+  fileparse_state *s = calloc(1, sizeof(fileparse_state));
 
   int i = 0;
   int r = 0;
   int m = 0;
   int mismatch = 0;
   int r_count = 0;
-  int m_count = 0;
-  struct timespec start, end;
 
   FILE* fp;
-  fp = fopen("testfile", "w+");
+
+  if (s == NULL) return NULL;
+
+  s->buf = mem_alloc(READ_BUF);
+  if (s->buf == NULL){
+    free(s);
+    return NULL;
+  }
+
+  s->num_rows = num_rows;
+  strcpy(s->filename, "testfile");
+
+  fp = fopen(s->filename, "w+");
+  if (fp == NULL){
+    printf("Fileparse Error: unable to create %s\n", s->filename);
+    mem_free(s->buf);
+    free(s);
+    return NULL;
+  }
 
   for (i=0;i<num_rows;i++){
-    r = create_line(search_phrase, sp_len, line, desired_line_len);
-    m = seek_match(search_phrase, sp_len, line, desired_line_len);
+    r = create_line(search_phrase, sp_len, line, LINE_LEN, i);
+    m = seek_match(search_phrase, sp_len, line, LINE_LEN);
     if (r!=m){
       mismatch++;
     }
     if (r==0){
       r_count++;
     }
+    if (strstr(line, search_phrase) != NULL){
+      s->matches++;
+    }
     fprintf(fp, "%s\n", line);
   }
   fsync(fileno(fp));
   fclose(fp);
 
-  m=0;
+  return s;
+}
+
+/* Scan the file line by line and count the lines that match */
+static double fileparse_compute(void *p){
+
+  fileparse_state *s = p;
+  size_t sp_len = strlen(search_phrase);
+  char line[LINE_LEN+1];
+  int m = 0;
+  int m_count = 0;
+  FILE* fp;
 
-  clock_gettime(CLOCK, &start);
-  fp = fopen("testfile", "r");
-  while (fscanf(fp, "%s\n", line)!=EOF){
-    m = seek_match(search_phrase, sp_len, line, desired_line_len);
+  fp = fopen(s->filename, "r");
+  setvbuf(fp, s->buf, _IOFBF, READ_BUF);
+  while (fscanf(fp, "%81s\n", line)!=EOF){
+    m = seek_match(search_phrase, sp_len, line, LINE_LEN);
     if (m==0){
       m_count++;
     }
   }
   fclose(fp);
-  clock_gettime(CLOCK, &end);
-  elapsed_time_hr(start, end, "Fileparse");
 
-  unlink("testfile"); // Use this to ensure the generated file is removed from the system upon finish
+  return m_count;
+}
 
+/*
+ * Threaded variant: every line is LINE_LEN+1 bytes, so each thread
+ * seeks straight to its first row and scans its own rows through its
+ * own stream.
+ */
+static double fileparse_range(void *p, unsigned long begin, unsigned long end){
+
+  fileparse_state *s = p;
+  size_t sp_len = strlen(search_phrase);
+  char line[LINE_LEN+1];
+  unsigned long row;
+  int m_count = 0;
+  FILE* fp;
+
+  fp = fopen(s->filename, "r");
+  if (fp == NULL) return 0.0;
+  fseek(fp, (long)begin*(LINE_LEN+1), SEEK_SET);
+  for (row = begin; row < end && fscanf(fp, "%81s\n", line) != EOF; row++){
+    if (seek_match(search_phrase, sp_len, line, LINE_LEN)==0){
+      m_count++;
+    }
+  }
+  fclose(fp);
+
+  return m_count;
 }
 
+static double fileparse_parallel(void *p){ return par_for(((fileparse_state *)p)->num_rows, fileparse_range, p); }
+
+static void fileparse_teardown(void *p){
+
+  fileparse_state *s = p;
+
+  unlink(s->filename); // Use this to ensure the generated file is removed from the system upon finish
+  mem_free(s->buf);
+  free(s);
+}
+
+/* The count must agree exactly with the one made while writing the file */
+static double fileparse_verify(const kernel_t *k, void *p, double *tol){
+
+  fileparse_state *s = p;
+
+  *tol = 0.0;
+  return verify_error(k->compute(s), s->matches, 1.0);
+}
+
+static double fileparse_flops(void *p){ return 0.0; }
+static double fileparse_bytes(void *p){ return (LINE_LEN+1.0)*((fileparse_state *)p)->num_rows; }
+
+
+const kernel_t fileparse_kernels[] = {
+  {"fileparse", "search", "char", "Fileparse", REPS,
+   fileparse_setup, fileparse_compute, fileparse_teardown, fileparse_flops, fileparse_bytes,
+   NULL, NULL, NULL, fileparse_verify, fileparse_parallel, NULL},
+  {NULL}
+};
+
 /*
- * Create a line of random characters
+ * Create line number row of random characters
  * Line will be ll long and appears in l
  * Randomly, phrase contained in sp and of sp_len length will be added to l at a random position
+ * The line depends only on the seed and row, so lines can be made in any order
  */
-int create_line(char* sp, size_t sp_len, char* l, unsigned int ll){
+int create_line(char* sp, size_t sp_len, char* l, unsigned int ll, unsigned long row){
 
 
-  int i = 0;
-  int r = 0;
+  unsigned int r = 0;
   int flag = 0;
 
-  for (i=0;i<ll;i++){
-    r = (rand() % 128);
-    while(!isalnum(r)){
-      r = (rand() % 128);
-    }
-    l[i] = (char)r;
-  }
-  l[i+1] = '\0';
+  rng_alnum(l, ll, RNG_TEXT, (unsigned long long)row*ll);
+  l[ll] = '\0';
 
-  r = rand() % 2;
-  /* printf("R = %d\n", r); */
-  if (r==0){
+  r = rng_u32(RNG_PHRASE, 2*(unsigned long long)row);
+  if ((r & 1)==0){
     flag = 0;
-    r = rand() % (ll - sp_len);
-    for (i=0;i<sp_len;i++){
-      l[r+i] = sp[i];
-    }
+    r = rng_u32(RNG_PHRASE, 2*(unsigned long long)row+1) % (ll - sp_len);
+    memcpy(&l[r], sp, sp_len);
   }
   else{
     flag = 1;
@@ -0,0 +1,230 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+#include <stdio.h>
+
+#include "par.h"
+#include "simd.h"
+#include "fuse.h"
+
+
+/* Number of doubles of block sums the threaded pass over n elements needs */
+unsigned long fuse_sums(unsigned long n){
+
+  return (n + FUSE_BLOCK - 1) / FUSE_BLOCK * FUSE_MAX_OPS;
+}
+
+void fuse_init(fuse_t *f, int dtype, unsigned long n, double *sums){
+
+  f->dtype = dtype;
+  f->n = n;
+  f->nops = 0;
+  f->sums = sums;
+}
+
+static int fuse_add(fuse_t *f, int op, double alpha, void *x, void *y, double *result){
+
+  fuse_op *o;
+
+  if (f->nops == FUSE_MAX_OPS) {
+    fprintf(stderr, "ERROR: more than %d fused operations\n", FUSE_MAX_OPS);
+    return -1;
+  }
+  o = &f->op[f->nops++];
+  o->op = op;
+  o->alpha = alpha;
+  o->x = x;
+  o->y = y;
+  o->result = result;
+
+  return 0;
+}
+
+int fuse_axpy(fuse_t *f, double alpha, void *x, void *y){ return fuse_add(f, FUSE_AXPY, alpha, x, y, NULL); }
+int fuse_aypx(fuse_t *f, double alpha, void *x, void *y){ return fuse_add(f, FUSE_AYPX, alpha, x, y, NULL); }
+int fuse_scal(fuse_t *f, double alpha, void *x){ return fuse_add(f, FUSE_SCAL, alpha, x, NULL, NULL); }
+int fuse_dot(fuse_t *f, void *x, void *y, double *result){ return fuse_add(f, FUSE_DOT, 0.0, x, y, result); }
+
+
+static double float_block(const fuse_op *o, unsigned long begin, unsigned long end){
+
+  float *x = (float *) o->x + begin, *y = o->y ? (float *) o->y + begin : NULL;
+  float a = (float) o->alpha;
+  unsigned long i, n = end - begin;
+
+  switch (o->op) {
+  case FUSE_AXPY:
+    simd->saxpy(a, x, y, n);
+    break;
+  case FUSE_AYPX:
+    for (i = 0; i < n; i++) y[i] = a * y[i] + x[i];
+    break;
+  case FUSE_SCAL:
+    simd->sscal(a, x, n);
+    break;
+  case FUSE_DOT:
+    return x == y ? simd->ssumsq(x, n) : simd->sdot(x, y, n);
+  }
+
+  return 0.0;
+}
+
+static double double_block(const fuse_op *o, unsigned long begin, unsigned long end){
+
+  double *x = (double *) o->x + begin, *y = o->y ? (double *) o->y + begin : NULL;
+  double a = o->alpha;
+  unsigned long i, n = end - begin;
+
+  switch (o->op) {
+  case FUSE_AXPY:
+    simd->daxpy(a, x, y, n);
+    break;
+  case FUSE_AYPX:
+    for (i = 0; i < n; i++) y[i] = a * y[i] + x[i];
+    break;
+  case FUSE_SCAL:
+    simd->dscal(a, x, n);
+    break;
+  case FUSE_DOT:
+    return x == y ? simd->dsumsq(x, n) : simd->ddot(x, y, n);
+  }
+
+  return 0.0;
+}
+
+/* The fused pass over a range of blocks, keeping the dot products of each block in sums */
+typedef struct {
+  const fuse_t *f;
+  double *sums;              /* FUSE_MAX_OPS per block */
+  unsigned long base;        /* block of sums[0] */
+} fuse_args;
+
+static double fuse_blocks(void *p, unsigned long begin, unsigned long end){
+
+  fuse_args *a = p;
+  const fuse_t *f = a->f;
+  unsigned long b, first, last;
+  int k;
+
+  for (b = begin; b < end; b++) {
+    first = b * FUSE_BLOCK;
+    last = (first + FUSE_BLOCK < f->n) ? first + FUSE_BLOCK : f->n;
+    for (k = 0; k < f->nops; k++)
+      a->sums[(b - a->base) * FUSE_MAX_OPS + k] = f->dtype == FUSE_FLOAT ? float_block(&f->op[k], first, last)
+                                                             : double_block(&f->op[k], first, last);
+  }
+
+  return 0.0;
+}
+
+/*
+ * Run the recorded operations in one pass, threaded if par is set,
+ * and store the dot products. The record is kept, to run again.
+ */
+void fuse_run(fuse_t *f, int par){
+
+  unsigned long nb = (f->n + FUSE_BLOCK - 1) / FUSE_BLOCK, b;
+  double one[FUSE_MAX_OPS], sum;
+  fuse_args a;
+  int k;
+
+  a.f = f;
+  a.base = 0;
+  a.sums = (par && nb > 1) ? f->sums : NULL;
+
+  if (a.sums) {
+    par_for(nb, fuse_blocks, &a);
+    for (k = 0; k < f->nops; k++) {
+      if (f->op[k].op != FUSE_DOT) continue;
+      for (sum = 0.0, b = 0; b < nb; b++) sum += a.sums[b * FUSE_MAX_OPS + k];
+      *f->op[k].result = sum;
+    }
+  } else {
+    /* one block at a time, adding up the dot products in the same order */
+    for (k = 0; k < f->nops; k++)
+      if (f->op[k].op == FUSE_DOT) *f->op[k].result = 0.0;
+    for (b = 0; b < nb; b++) {
+      a.sums = one;
+      a.base = b;
+      fuse_blocks(&a, b, b + 1);
+      for (k = 0; k < f->nops; k++)
+        if (f->op[k].op == FUSE_DOT) *f->op[k].result += one[k];
+    }
+  }
+}
+
+
+/* Whether v is an operand of the recorded operations, and whether one of them writes it */
+static void fuse_use(const fuse_t *f, const void *v, int *read, int *written){
+
+  int k;
+
+  *read = *written = 0;
+  for (k = 0; k < f->nops; k++) {
+    if (f->op[k].x == v || f->op[k].y == v) *read = 1;
+    if ((f->op[k].op == FUSE_SCAL && f->op[k].x == v)
+        || ((f->op[k].op == FUSE_AXPY || f->op[k].op == FUSE_AYPX) && f->op[k].y == v)) *written = 1;
+  }
+}
+
+/* Every vector read once, and those written written once */
+double fuse_bytes(const fuse_t *f){
+
+  double passes = 0.0;
+  const void *v;
+  int k, j, seen, read, written;
+
+  for (k = 0; k < 2 * f->nops; k++) {
+    v = (k % 2) ? f->op[k / 2].y : f->op[k / 2].x;
+    if (v == NULL) continue;
+    for (seen = 0, j = 0; j < k && !seen; j++)
+      seen = v == ((j % 2) ? f->op[j / 2].y : f->op[j / 2].x);
+    if (seen) continue;
+    fuse_use(f, v, &read, &written);
+    passes += read + written;
+  }
+
+  return passes * f->n * (f->dtype == FUSE_FLOAT ? sizeof (float) : sizeof (double));
+}
+
+/* Each operation reading its operands and writing its result in a pass of its own */
+double fuse_unfused_bytes(const fuse_t *f){
+
+  double passes = 0.0;
+  int k;
+
+  for (k = 0; k < f->nops; k++) {
+    switch (f->op[k].op) {
+    case FUSE_AXPY:
+    case FUSE_AYPX:
+      passes += 3.0;
+      break;
+    case FUSE_SCAL:
+      passes += 2.0;
+      break;
+    case FUSE_DOT:
+      passes += f->op[k].x == f->op[k].y ? 1.0 : 2.0;
+      break;
+    }
+  }
+
+  return passes * f->n * (f->dtype == FUSE_FLOAT ? sizeof (float) : sizeof (double));
+}
@@ -0,0 +1,79 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Fused level-1 expressions.
+ *
+ * A fuse_t records a sequence of level-1 operations on vectors of the
+ * same length and type without running them; fuse_run() then applies
+ * all of them in one pass. The vectors are cut into blocks of
+ * FUSE_BLOCK elements, small enough that the blocks of every vector
+ * involved stay in L1, and each block goes through the operations in
+ * the order they were recorded. Each vector is read from memory once
+ * and written back once however many operations use it, and every
+ * operation sees the results of those before it, so
+ *
+ *   fuse_init(&f, FUSE_DOUBLE, n, sums);
+ *   fuse_axpy(&f, -alpha, w, r);
+ *   fuse_dot(&f, r, r, &rr);
+ *   fuse_run(&f, par);
+ *
+ * reads w and r once and writes r once, where the two calls on their
+ * own would read r twice. Dot products are summed per block and the
+ * block sums added in order, so the results do not depend on the
+ * number of threads. The threaded pass keeps the block sums in sums,
+ * fuse_sums(n) doubles the caller allocates once, outside the timed
+ * loop; with sums NULL fuse_run() runs the blocks one at a time.
+ * fuse_bytes() and fuse_unfused_bytes() give the
+ * memory traffic of the fused pass and of the operations run one by
+ * one.
+ */
+
+enum { FUSE_FLOAT, FUSE_DOUBLE };
+enum { FUSE_AXPY, FUSE_AYPX, FUSE_SCAL, FUSE_DOT };
+
+#define FUSE_MAX_OPS 8
+#define FUSE_BLOCK 2048
+
+typedef struct {
+  int op;                    /* FUSE_AXPY, ... */
+  void *x, *y;               /* y is NULL for FUSE_SCAL */
+  double alpha;
+  double *result;            /* where FUSE_DOT stores its result */
+} fuse_op;
+
+typedef struct {
+  int dtype;                 /* FUSE_FLOAT or FUSE_DOUBLE */
+  unsigned long n;
+  int nops;
+  fuse_op op[FUSE_MAX_OPS];
+  double *sums;              /* fuse_sums(n) block sums, or NULL */
+} fuse_t;
+
+unsigned long fuse_sums(unsigned long n);
+void fuse_init(fuse_t *f, int dtype, unsigned long n, double *sums);  /* start an empty record */
+int fuse_axpy(fuse_t *f, double alpha, void *x, void *y);      /* y = y + alpha * x */
+int fuse_aypx(fuse_t *f, double alpha, void *x, void *y);      /* y = alpha * y + x */
+int fuse_scal(fuse_t *f, double alpha, void *x);               /* x = alpha * x */
+int fuse_dot(fuse_t *f, void *x, void *y, double *result);     /* *result = x . y */
+void fuse_run(fuse_t *f, int par);
+double fuse_bytes(const fuse_t *f);
+double fuse_unfused_bytes(const fuse_t *f);
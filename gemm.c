@@ -0,0 +1,274 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+#include <string.h>
+
+#include "par.h"
+#include "simd.h"
+#include "gemm.h"
+
+
+void gemm_pack_size(int dp, unsigned long m, unsigned long *pa, unsigned long *pb){
+
+  int mr = dp ? simd->dgemm_mr : simd->sgemm_mr, nr = dp ? simd->dgemm_nr : simd->sgemm_nr;
+  unsigned long mc = GEMM_MC / mr * mr;
+
+  *pa = ((m + mr - 1) / mr * mr + mc) * GEMM_KC;
+  *pb = (GEMM_NC / nr * nr + nr) * GEMM_KC;
+}
+
+/* Run fn over [0, n), split over the threads if par is set */
+static double gemm_loop(int par, unsigned long n, par_fn fn, void *arg){
+
+  return par ? par_for(n, fn, arg) : fn(arg, 0, n);
+}
+
+/* Largest micro-kernel tile, for partial tiles at the edges */
+#define GEMM_EDGE (16 * 64)
+
+
+/* One GEMM_KC x GEMM_NC step of the float product */
+typedef struct {
+  unsigned long m, nb, kb, jc, pc, mc;
+  const float *A, *B;
+  unsigned long lda, ldb, ldc;
+  float *C, *pa, *pb;
+  int mr, nr;
+} sgemm_step;
+
+/* Pack panels [begin, end) of nr columns of the kb x nb block of B */
+static double spack_b(void *arg, unsigned long begin, unsigned long end){
+
+  sgemm_step *g = arg;
+  const float *b;
+  float *pb;
+  unsigned long jr, p;
+  int j, nr = g->nr, w;
+
+  for (jr = begin * nr; jr < end * nr && jr < g->nb; jr += nr) {
+    pb = g->pb + jr * g->kb;
+    w = (g->nb - jr < (unsigned long) nr) ? (int) (g->nb - jr) : nr;
+    for (p = 0; p < g->kb; p++) {
+      b = g->B + (g->pc + p) * g->ldb + g->jc + jr;
+      for (j = 0; j < w; j++) pb[p * nr + j] = b[j];
+      for (; j < nr; j++) pb[p * nr + j] = 0.0f;
+    }
+  }
+
+  return 0.0;
+}
+
+/* Pack row block ic of A into pa, in panels of mr rows */
+static void spack_a(sgemm_step *g, unsigned long ic, unsigned long mb, float *pa){
+
+  const float *a;
+  unsigned long ir, p;
+  int i, mr = g->mr, h;
+
+  for (ir = 0; ir < mb; ir += mr) {
+    h = (mb - ir < (unsigned long) mr) ? (int) (mb - ir) : mr;
+    for (i = 0; i < mr; i++) {
+      a = g->A + (ic + ir + i) * g->lda + g->pc;
+      if (i < h) for (p = 0; p < g->kb; p++) pa[ir * g->kb + p * mr + i] = a[p];
+      else for (p = 0; p < g->kb; p++) pa[ir * g->kb + p * mr + i] = 0.0f;
+    }
+  }
+}
+
+/* Row blocks [begin, end) of GEMM_MC rows: pack A, then every tile against the packed B */
+static double sgemm_blocks(void *arg, unsigned long begin, unsigned long end){
+
+  sgemm_step *g = arg;
+  float edge[GEMM_EDGE], *pa, *c;
+  unsigned long bi, ic, mb, ir, jr;
+  int mr = g->mr, nr = g->nr, h, w, i, j;
+
+  for (bi = begin; bi < end; bi++) {
+    ic = bi * g->mc;
+    mb = (g->m - ic < g->mc) ? g->m - ic : g->mc;
+    pa = g->pa + ic * g->kb;
+    spack_a(g, ic, mb, pa);
+    for (jr = 0; jr < g->nb; jr += nr) {
+      w = (g->nb - jr < (unsigned long) nr) ? (int) (g->nb - jr) : nr;
+      for (ir = 0; ir < mb; ir += mr) {
+        h = (mb - ir < (unsigned long) mr) ? (int) (mb - ir) : mr;
+        c = g->C + (ic + ir) * g->ldc + g->jc + jr;
+        if (h == mr && w == nr) {
+          simd->sgemm(g->kb, pa + ir * g->kb, g->pb + jr * g->kb, c, g->ldc);
+          continue;
+        }
+        /* a partial tile goes through a whole one on the stack */
+        memset(edge, 0, mr * nr * sizeof (float));
+        simd->sgemm(g->kb, pa + ir * g->kb, g->pb + jr * g->kb, edge, nr);
+        for (i = 0; i < h; i++)
+          for (j = 0; j < w; j++) c[i * g->ldc + j] += edge[i * nr + j];
+      }
+    }
+  }
+
+  return 0.0;
+}
+
+void gemm_sgemm(unsigned long m, unsigned long n, unsigned long k, const float *A, unsigned long lda,
+                const float *B, unsigned long ldb, float *C, unsigned long ldc, int par, float *pa, float *pb){
+
+  sgemm_step g;
+  unsigned long nc, i;
+
+  g.mr = simd->sgemm_mr;
+  g.nr = simd->sgemm_nr;
+  g.mc = GEMM_MC / g.mr * g.mr;
+  nc = GEMM_NC / g.nr * g.nr;
+  g.pa = pa;
+  g.pb = pb;
+  g.m = m;
+  g.A = A;
+  g.B = B;
+  g.C = C;
+  g.lda = lda;
+  g.ldb = ldb;
+  g.ldc = ldc;
+
+  for (i = 0; i < m; i++) memset(C + i * ldc, 0, n * sizeof (float));
+
+  for (g.jc = 0; g.jc < n; g.jc += nc) {
+    g.nb = (n - g.jc < nc) ? n - g.jc : nc;
+    for (g.pc = 0; g.pc < k; g.pc += GEMM_KC) {
+      g.kb = (k - g.pc < GEMM_KC) ? k - g.pc : GEMM_KC;
+      gemm_loop(par, (g.nb + g.nr - 1) / g.nr, spack_b, &g);
+      gemm_loop(par, (m + g.mc - 1) / g.mc, sgemm_blocks, &g);
+    }
+  }
+}
+
+
+/* One GEMM_KC x GEMM_NC step of the double product */
+typedef struct {
+  unsigned long m, nb, kb, jc, pc, mc;
+  const double *A, *B;
+  unsigned long lda, ldb, ldc;
+  double *C, *pa, *pb;
+  int mr, nr;
+} dgemm_step;
+
+/* Pack panels [begin, end) of nr columns of the kb x nb block of B */
+static double dpack_b(void *arg, unsigned long begin, unsigned long end){
+
+  dgemm_step *g = arg;
+  const double *b;
+  double *pb;
+  unsigned long jr, p;
+  int j, nr = g->nr, w;
+
+  for (jr = begin * nr; jr < end * nr && jr < g->nb; jr += nr) {
+    pb = g->pb + jr * g->kb;
+    w = (g->nb - jr < (unsigned long) nr) ? (int) (g->nb - jr) : nr;
+    for (p = 0; p < g->kb; p++) {
+      b = g->B + (g->pc + p) * g->ldb + g->jc + jr;
+      for (j = 0; j < w; j++) pb[p * nr + j] = b[j];
+      for (; j < nr; j++) pb[p * nr + j] = 0.0;
+    }
+  }
+
+  return 0.0;
+}
+
+/* Pack row block ic of A into pa, in panels of mr rows */
+static void dpack_a(dgemm_step *g, unsigned long ic, unsigned long mb, double *pa){
+
+  const double *a;
+  unsigned long ir, p;
+  int i, mr = g->mr, h;
+
+  for (ir = 0; ir < mb; ir += mr) {
+    h = (mb - ir < (unsigned long) mr) ? (int) (mb - ir) : mr;
+    for (i = 0; i < mr; i++) {
+      a = g->A + (ic + ir + i) * g->lda + g->pc;
+      if (i < h) for (p = 0; p < g->kb; p++) pa[ir * g->kb + p * mr + i] = a[p];
+      else for (p = 0; p < g->kb; p++) pa[ir * g->kb + p * mr + i] = 0.0;
+    }
+  }
+}
+
+/* Row blocks [begin, end) of GEMM_MC rows: pack A, then every tile against the packed B */
+static double dgemm_blocks(void *arg, unsigned long begin, unsigned long end){
+
+  dgemm_step *g = arg;
+  double edge[GEMM_EDGE], *pa, *c;
+  unsigned long bi, ic, mb, ir, jr;
+  int mr = g->mr, nr = g->nr, h, w, i, j;
+
+  for (bi = begin; bi < end; bi++) {
+    ic = bi * g->mc;
+    mb = (g->m - ic < g->mc) ? g->m - ic : g->mc;
+    pa = g->pa + ic * g->kb;
+    dpack_a(g, ic, mb, pa);
+    for (jr = 0; jr < g->nb; jr += nr) {
+      w = (g->nb - jr < (unsigned long) nr) ? (int) (g->nb - jr) : nr;
+      for (ir = 0; ir < mb; ir += mr) {
+        h = (mb - ir < (unsigned long) mr) ? (int) (mb - ir) : mr;
+        c = g->C + (ic + ir) * g->ldc + g->jc + jr;
+        if (h == mr && w == nr) {
+          simd->dgemm(g->kb, pa + ir * g->kb, g->pb + jr * g->kb, c, g->ldc);
+          continue;
+        }
+        /* a partial tile goes through a whole one on the stack */
+        memset(edge, 0, mr * nr * sizeof (double));
+        simd->dgemm(g->kb, pa + ir * g->kb, g->pb + jr * g->kb, edge, nr);
+        for (i = 0; i < h; i++)
+          for (j = 0; j < w; j++) c[i * g->ldc + j] += edge[i * nr + j];
+      }
+    }
+  }
+
+  return 0.0;
+}
+
+void gemm_dgemm(unsigned long m, unsigned long n, unsigned long k, const double *A, unsigned long lda,
+                const double *B, unsigned long ldb, double *C, unsigned long ldc, int par, double *pa, double *pb){
+
+  dgemm_step g;
+  unsigned long nc, i;
+
+  g.mr = simd->dgemm_mr;
+  g.nr = simd->dgemm_nr;
+  g.mc = GEMM_MC / g.mr * g.mr;
+  nc = GEMM_NC / g.nr * g.nr;
+  g.pa = pa;
+  g.pb = pb;
+  g.m = m;
+  g.A = A;
+  g.B = B;
+  g.C = C;
+  g.lda = lda;
+  g.ldb = ldb;
+  g.ldc = ldc;
+
+  for (i = 0; i < m; i++) memset(C + i * ldc, 0, n * sizeof (double));
+
+  for (g.jc = 0; g.jc < n; g.jc += nc) {
+    g.nb = (n - g.jc < nc) ? n - g.jc : nc;
+    for (g.pc = 0; g.pc < k; g.pc += GEMM_KC) {
+      g.kb = (k - g.pc < GEMM_KC) ? k - g.pc : GEMM_KC;
+      gemm_loop(par, (g.nb + g.nr - 1) / g.nr, dpack_b, &g);
+      gemm_loop(par, (m + g.mc - 1) / g.mc, dgemm_blocks, &g);
+    }
+  }
+}
@@ -0,0 +1,52 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Cache-blocked matrix multiplication, C = A * B, in the structure of
+ * BLIS: C is computed in blocks of GEMM_NC columns; for each, B is
+ * taken GEMM_KC rows at a time and packed into panels of nr columns,
+ * sized to stay in L3, and A GEMM_MC rows at a time into panels of mr
+ * rows, sized to stay in L2. The micro-kernel of the instruction set
+ * in use (see simd.h) then runs over every mr x nr tile of the block,
+ * streaming a panel of B, which stays in L1, against a panel of A.
+ * Packing makes both streams contiguous and pads the edges with
+ * zeros, so the micro-kernel only ever sees whole tiles.
+ *
+ * The matrices are row-major, with rows lda, ldb and ldc elements
+ * apart. With par set the row blocks of A are split over the threads
+ * (see par.h); each thread writes its own rows of C, so the result
+ * does not depend on the number of threads.
+ *
+ * The caller allocates the packing buffers pa and pb, outside any
+ * timed loop: gemm_pack_size() gives the elements each needs for
+ * products with up to m rows, with double elements if dp is set, for
+ * the micro-kernel of the instruction set in use.
+ */
+
+#define GEMM_MC 144
+#define GEMM_KC 256
+#define GEMM_NC 4096
+
+void gemm_pack_size(int dp, unsigned long m, unsigned long *pa, unsigned long *pb);
+void gemm_sgemm(unsigned long m, unsigned long n, unsigned long k, const float *A, unsigned long lda,
+                const float *B, unsigned long ldb, float *C, unsigned long ldc, int par, float *pa, float *pb);
+void gemm_dgemm(unsigned long m, unsigned long n, unsigned long k, const double *A, unsigned long lda,
+                const double *B, unsigned long ldb, double *C, unsigned long ldc, int par, double *pa, double *pb);
@@ -0,0 +1,97 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Conversions by integer arithmetic on the bit patterns, after
+ * F. Giesen's "half to float done quic" and "float to half" routines:
+ * the exponent is rebiased with one add and subnormals are handled by
+ * letting the FPU normalise (or round) against a magic constant.
+ */
+
+#include <stdint.h>
+
+#include "half.h"
+
+typedef union {
+  uint32_t u;
+  float f;
+} bits32;
+
+
+float half_to_float(uint16_t h){
+
+  bits32 o, magic = { 113u << 23 };
+  uint32_t exp;
+
+  o.u = (uint32_t)(h & 0x7fff) << 13;
+  exp = o.u & (0x7c00u << 13);
+  o.u += (127 - 15) << 23;
+  if (exp == (0x7c00u << 13)) o.u += (128 - 16) << 23;     /* Inf or NaN */
+  else if (exp == 0) {                                       /* zero or subnormal */
+    o.u += 1u << 23;
+    o.f -= magic.f;
+  }
+  o.u |= (uint32_t)(h & 0x8000) << 16;
+
+  return o.f;
+}
+
+uint16_t half_from_float(float f){
+
+  bits32 in, infty = { 255u << 23 }, big = { (127u + 16) << 23 }, denorm = { ((127u - 15) + (23 - 10) + 1) << 23 };
+  uint32_t sign;
+  uint16_t o;
+
+  in.f = f;
+  sign = in.u & 0x80000000u;
+  in.u ^= sign;
+
+  if (in.u >= big.u) o = (in.u > infty.u) ? 0x7e00 : 0x7c00;   /* NaN stays NaN, the rest is Inf */
+  else if (in.u < (113u << 23)) {                                /* rounds to a subnormal or zero */
+    in.f += denorm.f;
+    o = (uint16_t)(in.u - denorm.u);
+  } else {
+    uint32_t odd = (in.u >> 13) & 1;
+    in.u += ((uint32_t)(15 - 127) << 23) + 0xfff + odd;
+    o = (uint16_t)(in.u >> 13);
+  }
+
+  return o | (uint16_t)(sign >> 16);
+}
+
+float bf16_to_float(uint16_t h){
+
+  bits32 o;
+
+  o.u = (uint32_t)h << 16;
+  return o.f;
+}
+
+uint16_t bf16_from_float(float f){
+
+  bits32 in;
+
+  in.f = f;
+  if ((in.u & 0x7fffffffu) > 0x7f800000u) return (uint16_t)((in.u >> 16) | 0x40);   /* quiet NaN */
+  in.u += 0x7fff + ((in.u >> 16) & 1);
+
+  return (uint16_t)(in.u >> 16);
+}
@@ -0,0 +1,44 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * 16-bit floating point storage.
+ *
+ * fp16 is IEEE binary16 (5 exponent bits, 11 significant bits) and
+ * bf16 is bfloat16, the top half of a float (8 exponent bits, 8
+ * significant bits). Both are only stored; the kernels widen them to
+ * float, compute and accumulate in float, and round results back. The
+ * conversions here are the portable ones: exact to float, and
+ * round-to-nearest-even from float, with overflow to infinity and NaN
+ * kept a NaN. The vector kernels of simd.h convert whole arrays with
+ * F16C or AVX-512 where the instruction set has them.
+ */
+
+#include <stdint.h>
+
+/* Unit roundoff of the two formats */
+#define HALF_U ldexp(1.0, -11)
+#define BF16_U ldexp(1.0, -8)
+
+float half_to_float(uint16_t h);
+uint16_t half_from_float(float f);
+float bf16_to_float(uint16_t h);
+uint16_t bf16_from_float(float f);
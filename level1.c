@@ -21,136 +21,652 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <fnmatch.h>
+#include <math.h>
+#include <float.h>
 
 #include "level1.h"
 #include "utils.h"
+#include "memory.h"
+#include "report.h"
+#include "roofline.h"
+#include "par.h"
+#include "pool.h"
+#include "backend.h"
+#include "half.h"
 
-/* Level 1 benchmark driver - calls appropriate function */
-/* based on command line arguments.                      */
-void bench_level1(char *b, unsigned int s, unsigned long r, char *o, char *dt, char *algo ){
+bench_config_t bench_config = { 1, 0, 0, 0, 0, SCALING_NONE, 0, NULL, 0, 0 };
 
-	/* BLAS operations */
-	if(strcmp(b, "blas_op") == 0){
+/* State of the last kernel run, kept for the next run when bench_config.keep is set */
+static const kernel_t *kept_kernel = NULL;
+static void *kept_state = NULL;
+static unsigned long kept_size = 0;
 
-		if(strcmp(o, "dot_product") == 0){
+static const kernel_t *kernel_tables[] = {
+	blas_op_kernels, stencil_kernels, fileparse_kernels, cg_kernels, NULL
+};
 
-			if(strcmp(dt, "int") == 0) int_dot_product(s);
-			else if(strcmp(dt, "float") == 0) float_dot_product(s);
-			else if(strcmp(dt, "double") == 0) double_dot_product(s);
-			else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
 
-		}
+/* Registry name of a kernel, "bench/op/dtype" */
+char *kernel_name(const kernel_t *k, char *buf, size_t len){
+
+	snprintf(buf, len, "%s/%s/%s", k->bench, k->op, k->dtype);
+	return buf;
+}
 
-		else if(strcmp(o, "scalar_mult") == 0){
+/* Print every registered kernel with its default repetitions */
+void kernel_list(FILE *f){
 
-			if(strcmp(dt, "int") == 0) int_scalar_mult(s);
-			else if(strcmp(dt, "float") == 0) float_scalar_mult(s);
-			else if(strcmp(dt, "double") == 0) double_scalar_mult(s);
-			else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
+	const kernel_t **t;
+	const kernel_t *k;
+	char name[128];
 
+	for(t = kernel_tables; *t != NULL; t++){
+		for(k = *t; k->bench != NULL; k++){
+			fprintf(f, "%-28s reps %-5lu %s\n", kernel_name(k, name, sizeof(name)), k->reps, k->title);
 		}
+	}
+}
 
-		else if(strcmp(o, "norm") == 0){
+/* Does name match any of the comma separated glob patterns? */
+static int kernel_matches(const char *name, const char *patterns){
 
-			if(strcmp(dt, "int") == 0) int_norm(s);
-			else if(strcmp(dt, "float") == 0) float_norm(s);
-			else if(strcmp(dt, "double") == 0) double_norm(s);
-			else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
+	char buf[1024];
+	char *pat, *save = NULL;
 
-		}
+	snprintf(buf, sizeof(buf), "%s", patterns);
+	for(pat = strtok_r(buf, ",", &save); pat != NULL; pat = strtok_r(NULL, ",", &save)){
+		if(fnmatch(pat, name, 0) == 0) return 1;
+	}
 
-		else if(strcmp(o, "axpy") == 0){
+	return 0;
+}
 
-			if(strcmp(dt, "int") == 0) int_axpy(s);
-			else if(strcmp(dt, "float") == 0) float_axpy(s);
-			else if(strcmp(dt, "double") == 0) double_axpy(s);
-			else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
+/* Size in bytes of one element of a kernel's data type */
+static size_t dtype_size(const char *dtype){
 
-		}
+	if(strcmp(dtype, "double") == 0) return sizeof(double);
+	if(strcmp(dtype, "float") == 0) return sizeof(float);
+	if(strcmp(dtype, "int") == 0) return sizeof(int);
+	if(strcmp(dtype, "fp16") == 0 || strcmp(dtype, "bf16") == 0 || strcmp(dtype, "int16") == 0) return 2;
+	if(strcmp(dtype, "int32") == 0) return 4;
+	if(strcmp(dtype, "int64") == 0) return 8;
+	return sizeof(char);
+}
 
-		else if(strcmp(o, "dmv") == 0){
+/* Timer overhead samples, taken once per process */
+static struct timespec overhead[2*OVERHEAD_SAMPLES];
+static int have_overhead = 0;
 
-			if(strcmp(dt, "int") == 0) int_dmatvec_product(s);
-			else if(strcmp(dt, "float") == 0) float_dmatvec_product(s);
-			else if(strcmp(dt, "double") == 0) double_dmatvec_product(s);
-			else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
+/*
+ * Check a kernel's output against its reference and record the
+ * outcome. Returns 2 if the check fails, 0 otherwise.
+ */
+static int verify_kernel(const kernel_t *k, void *state, bench_record *rec){
 
-		}
-		else if(strcmp(o, "spmv") == 0){
+	char name[128];
+	double err, tol = 0.0;
+
+	if(k->verify == NULL){
+		strcpy(rec->verify, "n/a");
+		return 0;
+	}
+
+	if(k->reset) k->reset(state);
+	err = k->verify(k, state, &tol);
+	rec->verify_err = err;
+	rec->verify_tol = tol;
+	if(err < 0){
+		strcpy(rec->verify, "skipped");
+		return 0;
+	}
+	if(err <= tol){
+		strcpy(rec->verify, "pass");
+		return 0;
+	}
+
+	strcpy(rec->verify, "FAIL");
+	fprintf(stderr, "ERROR: verification failed for %s at size %lu: error %g > tolerance %g\n",
+	        kernel_name(k, name, sizeof(name)), rec->size, err, tol);
+	return 2;
+}
+
+/* Note the id of the calling kernel thread, for the counters */
+static void kernel_tid(void *arg){
+
+	((int *)arg)[par_thread()] = perf_tid();
+}
+
+/*
+ * Open the counters on every thread of the kernels when k runs its
+ * threaded variant, so threaded runs are counted in full. An external
+ * library runs threads of its own that cannot be followed, so its
+ * threaded runs are not counted; returns 0 then.
+ */
+static int counters_open(const kernel_t *k, perf_counters *pc){
+
+	static int tid[PERF_MAX_THREADS];
+	static int warned = 0;
+
+	if(par_threads() > 1 && backend_external()){
+		if(!warned) fprintf(stderr, "WARNING: the counters cannot follow the threads of %s, "
+		                            "threaded runs are not counted\n", backend_name());
+		warned = 1;
+		return 0;
+	}
+	if(par_threads() == 1 || k->compute != k->parallel) perf_open(pc, NULL, 1);
+	else {
+		par_each(kernel_tid, tid);
+		perf_open(pc, tid, par_threads());
+	}
+
+	return 1;
+}
+
+/* Flush this kernel thread's part of the cache flush buffer */
+static void flush_part(void *arg){
+
+	cache_flush_part(par_thread(), *(int *)arg);
+}
+
+/*
+ * Evict the caches before a cold repetition. The threads of a threaded
+ * kernel each flush a part of the buffer, so the private caches of
+ * every core are evicted, not only those of the calling thread.
+ */
+static void cold_flush(const kernel_t *k){
+
+	int parts = par_threads();
+
+	if(parts == 1 || k->compute != k->parallel) cache_flush();
+	else if(cache_flush_init(parts) == 0) par_each(flush_part, &parts);
+}
+
+/*
+ * Run the warmup repetitions of a set up kernel, then time every
+ * repetition individually and fill rec with the statistics (timer
+ * overhead removed) and the derived rates.
+ */
+static int measure_kernel(const kernel_t *k, void *state, unsigned long size, unsigned long reps, bench_record *rec){
+
+	struct timespec *times;
+	perf_counters pc;
+	mem_placement where;
+	char name[128];
+	double result = 0.0;
+	unsigned long i;
+	int counting = 0;
+
+	if(!have_overhead){
+		timer_overhead_hr(overhead);
+		have_overhead = 1;
+	}
+
+	times = malloc(2 * reps * sizeof(struct timespec));
+	if(times == NULL){
+		fprintf(stderr, "ERROR: unable to allocate timing array for %lu repetitions\n", reps);
+		return 1;
+	}
+
+	for(i = 0; i < bench_config.warmup; i++){
+		if(k->reset) k->reset(state);
+		result = k->compute(state);
+	}
+
+	if(bench_config.counters) counting = counters_open(k, &pc);
+
+	for(i = 0; i < reps; i++){
+		if(k->reset) k->reset(state);
+		if(bench_config.cold) cold_flush(k);
+		if(counting) perf_start(&pc);
+		clock_gettime(CLOCK, &times[2*i]);
+		result = k->compute(state);
+		clock_gettime(CLOCK, &times[2*i+1]);
+		if(counting) perf_stop(&pc);
+	}
+
+	/* print result so compiler does not throw it away */
+	printf("%s result: %f\n", kernel_name(k, name, sizeof(name)), result);
+
+	memset(rec, 0, sizeof(*rec));
+	strcpy(rec->verify, "off");
+	kernel_name(k, rec->kernel, sizeof(rec->kernel));
+	rec->bench = k->bench;
+	rec->op = k->op;
+	rec->dtype = k->dtype;
+	rec->title = k->title;
+	rec->size = size;
+	rec->reps = reps;
+	rec->warmup = bench_config.warmup;
+	rec->cache = bench_config.cold ? "cold" : "warm";
+	rec->threads = par_threads();
+	rec->runtime = backend_external() ? backend_name() : par_runtime();
+	rec->scaling = "none";
+	rec->speedup = -1.0;
+	rec->efficiency = -1.0;
+	rec->flops = k->flops(state);
+	rec->bytes = k->bytes(state);
+	rec->bytes_saved = k->saved ? k->saved(state) : 0.0;
+	rec->result = result;
+	rec->footprint = k->footprint ? k->footprint(state) : 0.0;
+	mem_where(&where);
+	rec->cpu = where.cpu;
+	rec->cpu_node = where.cpu_node;
+	snprintf(rec->mem_policy, sizeof(rec->mem_policy), "%s", where.policy);
+	snprintf(rec->mem_pages, sizeof(rec->mem_pages), "%s", where.pages);
+	snprintf(rec->page_mode, sizeof(rec->page_mode), "%s", where.page_mode);
+	rec->huge_bytes = where.huge_bytes;
+	rec->elements = rec->bytes / dtype_size(k->dtype);
+	for(i = 0; i < PERF_NEVENTS; i++) rec->counter[i] = -1.0;
+	if(counting){
+		for(i = 0; i < PERF_NEVENTS; i++)
+			if(pc.count[i] >= 0 && pc.regions > 0) rec->counter[i] = pc.count[i] / pc.regions;
+		perf_close(&pc);
+	}
+	discrete_stats_hr(overhead, times, reps, &rec->t);
+	if(rec->t.median > 0){
+		rec->gflops = rec->flops / rec->t.median / 1e9;
+		rec->gbytes = rec->bytes / rec->t.median / 1e9;
+	}
+	if(bench_config.roofline) roofline_apply(rec);
+
+	free(times);
+
+	if(bench_config.verify) return verify_kernel(k, state, rec);
+
+	return 0;
+}
+
+/*
+ * The kernel to time on the current number of threads: k itself on
+ * one thread, otherwise a copy of k in kt with parallel() in place of
+ * compute(), so verify() checks the variant that was timed. Under an
+ * external backend the copy computes through the library instead,
+ * which runs its own threads.
+ */
+static const kernel_t *threaded_kernel(const kernel_t *k, kernel_t *kt){
+
+	char name[128];
+
+	if(backend_external()){
+		backend_threads(par_threads());
+		*kt = *k;
+		kt->compute = backend_compute(k);
+		return kt;
+	}
+	if(par_threads() == 1) return k;
+	if(k->parallel == NULL){
+		fprintf(stderr, "WARNING: %s has no threaded variant, running it on one thread\n",
+		        kernel_name(k, name, sizeof(name)));
+		return k;
+	}
+	*kt = *k;
+	kt->compute = k->parallel;
+	return kt;
+}
+
+/*
+ * Run one kernel at the single size, or at every size of the sweep
+ * in bench_config. Kernels with a resize() hook are set up once for
+ * the largest size and shrunk in place; the others are set up afresh
+ * for each size. Each size is reported as it completes, and a sweep
+ * ends with a summary table. With bench_config.keep the state is kept
+ * afterwards, and the next run of the same kernel reuses it if it is
+ * no larger (or the same size, for kernels without resize()).
+ */
+static int run_kernel(const kernel_t *k, unsigned long size, unsigned long reps){
+
+	const kernel_t *entry = k;
+	unsigned long *sizes = &size;
+	unsigned long largest;
+	int nsizes = 1;
+	bench_record *recs;
+	char name[128];
+	void *state = NULL;
+	int i, reuse, done = 0, rv = 0;
+	kernel_t kt;
+
+	if(reps == 0) reps = k->reps;
+	k = threaded_kernel(k, &kt);
+
+	if(bench_config.nsizes > 0){
+		sizes = bench_config.sizes;
+		nsizes = bench_config.nsizes;
+	}
+	largest = sizes[nsizes-1];
 
-			if(strcmp(dt, "float") == 0) float_spmatvec_product(r);
-			else if(strcmp(dt, "double") == 0) double_spmatvec_product(r);
-			else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
+	recs = malloc(nsizes * sizeof(bench_record));
+	if(recs == NULL){
+		fprintf(stderr, "ERROR: unable to allocate results for %d sizes\n", nsizes);
+		return 1;
+	}
+
+	/* the kept state serves this run if it can be resized to every size, or is the one size */
+	if(kept_kernel == entry && (k->resize != NULL ? largest <= kept_size : (nsizes == 1 && size == kept_size))){
+		state = kept_state;
+		largest = kept_size;
+		kept_kernel = NULL;
+	} else bench_release();
+
+	/* fall back to a setup per size if the largest does not fit */
+	reuse = (state != NULL || (nsizes > 1 && k->resize != NULL) || (bench_config.keep && nsizes == 1));
+	if(reuse && state == NULL){
+		state = k->setup(largest);
+		if(state == NULL){
+			fprintf(stderr, "WARNING: setup failed for %s at size %lu, setting up each size separately\n",
+			        kernel_name(k, name, sizeof(name)), largest);
+			reuse = 0;
+		}
+	}
 
+	for(i = 0; i < nsizes; i++){
+		if(reuse){
+			if(k->resize != NULL && k->resize(state, sizes[i]) != 0){
+				fprintf(stderr, "ERROR: %s cannot be resized to %lu\n", kernel_name(k, name, sizeof(name)), sizes[i]);
+				rv = 1;
+				continue;
+			}
+		} else {
+			state = k->setup(sizes[i]);
+			if(state == NULL){
+				fprintf(stderr, "ERROR: setup failed for %s at size %lu\n", kernel_name(k, name, sizeof(name)), sizes[i]);
+				rv = 1;
+				continue;
+			}
 		}
-		else if(strcmp(o, "spgemm") == 0){
 
-			if(strcmp(dt, "float") == 0) float_spgemm(r);
-			else if(strcmp(dt, "double") == 0) double_spgemm(r);
-			else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
+		switch(measure_kernel(k, state, sizes[i], reps, &recs[done])){
+		case 0:
+			report_record(&recs[done++]);
+			break;
+		case 2:
+			/* verification failed: report the timing anyway */
+			report_record(&recs[done++]);
+			rv |= 2;
+			break;
+		default:
+			rv |= 1;
 		}
 
+		if(!reuse) k->teardown(state);
 	}
 
-	/* Stencil codes */
-	else if (strcmp(b, "stencil") == 0){
+	if(reuse){
+		if(bench_config.keep){
+			kept_kernel = entry;
+			kept_state = state;
+			kept_size = largest;
+		} else k->teardown(state);
+	}
+	if(nsizes > 1) report_sweep(recs, done);
 
-		/* o is set to "dot_product" by default. Use this to check for a default */
-		if( strcmp(o, "27") == 0 || strcmp(o, "dot_product") == 0){
+	free(recs);
 
-			if(strcmp(dt,"float")==0) float_stencil27(s);
-			else if(strcmp(dt,"double")==0)	double_stencil27(s);
-			else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
-		}
+	return rv;
+}
+
+/* Tear down the state kept by the last run, if any */
+void bench_release(void){
+
+	if(kept_kernel != NULL) kept_kernel->teardown(kept_state);
+	kept_kernel = NULL;
+	kept_state = NULL;
+	kept_size = 0;
+}
 
-		else if(strcmp(o, "19") == 0){
+/* Use t threads for the kernels, and for setup unless --setup-threads fixed it */
+static void use_threads(int t){
 
-			if(strcmp(dt,"float")==0) float_stencil19(s);
-			else if(strcmp(dt,"double")==0)	double_stencil19(s);
-			else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
+	par_set_threads(t);
+	if(bench_config.setup_threads == 0){
+		pool_stop();
+		pool_start(t);
+	}
+}
+
+/*
+ * Size with t times the work of size for weak scaling. Stencils grow
+ * their interior in 2 or 3 dimensions, DMV its matrix in 2 and GEMM
+ * its matrices in 3 (the work being n^3); the sparse kernels read a
+ * fixed matrix, so their size cannot grow.
+ */
+static unsigned long weak_size(const kernel_t *k, unsigned long size, int t){
+
+	if(strcmp(k->bench, "stencil") == 0){
+		int dims = (atoi(k->op) >= 19) ? 3 : 2;
+		return 2 + (unsigned long)((size - 2.0) * pow(t, 1.0/dims) + 0.5);
+	}
+	if(strncmp(k->op, "dmv", 3) == 0) return (unsigned long)(size * sqrt(t) + 0.5);
+	if(strncmp(k->op, "gemm", 4) == 0) return (unsigned long)(size * cbrt(t) + 0.5);
+	if(strcmp(k->op, "spmv") == 0 || strcmp(k->op, "spgemm") == 0) return size;
+	return size * t;
+}
+
+/*
+ * Run one kernel on 1, 2, 4, ... threads up to max (and at max), at a
+ * fixed size (strong scaling) or a size growing with the threads (weak
+ * scaling). Speedup and parallel efficiency are relative to the one
+ * thread run: for strong scaling the speedup is t1/tN, for weak scaling
+ * the efficiency is t1/tN and the speedup N times that.
+ */
+static int run_scaling(const kernel_t *k, unsigned long size, unsigned long reps, int max){
+
+	bench_record *recs;
+	char name[128];
+	kernel_t kt;
+	void *state;
+	int counts[64], n = 0, t, i, done = 0, rv = 0;
+	int weak = (bench_config.scaling == SCALING_WEAK);
+	double t1 = 0.0;
+
+	if(reps == 0) reps = k->reps;
+	if(weak && weak_size(k, size, 2) == size){
+		fprintf(stderr, "WARNING: %s has a fixed size, reporting strong scaling\n", kernel_name(k, name, sizeof(name)));
+		weak = 0;
+	}
 
+	for(t = 1; t < max && n < 63; t *= 2) counts[n++] = t;
+	counts[n++] = max;
+
+	recs = malloc(n * sizeof(bench_record));
+	if(recs == NULL){
+		fprintf(stderr, "ERROR: unable to allocate results for %d thread counts\n", n);
+		return 1;
+	}
+
+	for(i = 0; i < n; i++){
+		unsigned long sz = weak ? weak_size(k, size, counts[i]) : size;
+		const kernel_t *kk;
+		bench_record *r = &recs[done];
+
+		use_threads(counts[i]);
+		kk = threaded_kernel(k, &kt);
+		state = kk->setup(sz);
+		if(state == NULL){
+			fprintf(stderr, "ERROR: setup failed for %s at size %lu\n", kernel_name(k, name, sizeof(name)), sz);
+			rv |= 1;
+			continue;
 		}
-		else if(strcmp(o, "9") == 0){
 
-			if(strcmp(dt,"float")==0) float_stencil9(s);
-			else if(strcmp(dt,"double")==0)	double_stencil9(s);
-			else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
+		switch(measure_kernel(kk, state, sz, reps, r)){
+		case 2:
+			/* verification failed: report the timing anyway */
+			rv |= 2;
+			break;
+		case 0:
+			break;
+		default:
+			rv |= 1;
+			kk->teardown(state);
+			continue;
+		}
 
+		if(counts[i] == 1) t1 = r->t.median;
+		r->scaling = weak ? "weak" : "strong";
+		if(t1 > 0 && r->t.median > 0){
+			if(weak){
+				r->efficiency = t1 / r->t.median;
+				r->speedup = counts[i] * r->efficiency;
+			} else {
+				r->speedup = t1 / r->t.median;
+				r->efficiency = r->speedup / counts[i];
+			}
 		}
-		else if(strcmp(o, "5") == 0){
+		report_record(r);
+		done++;
+
+		kk->teardown(state);
+	}
 
-			if(strcmp(dt,"float")==0) float_stencil5(s);
-			else if(strcmp(dt,"double")==0)	double_stencil5(s);
-			else fprintf(stderr, "ERROR: check you are using a valid data type...\n");
+	report_scaling(recs, done);
+	free(recs);
 
+	return rv;
+}
+
+/*
+ * Run every kernel whose name matches one of the comma separated
+ * glob patterns, e.g. "blas_op/axpy/[fd]*,stencil/27/float".
+ * A reps of 0 uses each kernel's default.
+ */
+int bench_run(const char *patterns, unsigned long size, unsigned long reps){
+
+	const kernel_t **t;
+	const kernel_t *k;
+	char name[128];
+	int found = 0;
+	int rv = 0;
+	int threads = par_threads(), max = threads;
+
+	/* scale up to --threads, or to every CPU the process may use */
+	if(bench_config.scaling != SCALING_NONE && max == 1){
+		int cpus[1024], local;
+		max = mem_cpus(cpus, 1024, &local);
+	}
+
+	for(t = kernel_tables; *t != NULL; t++){
+		for(k = *t; k->bench != NULL; k++){
+			if(kernel_matches(kernel_name(k, name, sizeof(name)), patterns)){
+				found++;
+				if(backend_external() && backend_compute(k) == NULL){
+					fprintf(stderr, "WARNING: %s has no %s equivalent, skipped\n", name, backend_name());
+					continue;
+				}
+				if(bench_config.scaling != SCALING_NONE) rv |= run_scaling(k, size, reps, max);
+				else rv |= run_kernel(k, size, reps);
+			}
 		}
+	}
 
-		else fprintf(stderr, "ERROR: check you are using a valid operation type...\n");
+	if(bench_config.scaling != SCALING_NONE) use_threads(threads);
 
+	if(!found){
+		fprintf(stderr, "ERROR: no kernel matches \"%s\", use --list to see the available kernels...\n", patterns);
+		return 1;
 	}
 
-	else if (strcmp(b, "fileparse") == 0){
+	return rv;
+}
 
-		if(strcmp(o, "dot_product") == 0){
-			fileparse(s);
-		}
+/* Level 1 benchmark driver - maps the bench, op, dtype and algo */
+/* command line arguments onto a kernel registry name.           */
+int bench_level1(char *b, unsigned int s, unsigned long r, char *o, char *dt, char *algo ){
+
+	char name[256];
+
+	/* o is set to "dot_product" by default. Use this to check for a default */
+	if(strcmp(b, "stencil") == 0 && strcmp(o, "dot_product") == 0) o = "27";
+
+	if(strcmp(b, "fileparse") == 0){
+		if(strcmp(o, "dot_product") == 0) o = "search";
+		dt = "char";
+	}
+
+	/* the CG variants are selected by algorithm */
+	if(strcmp(b, "cg") == 0) o = algo;
+
+	snprintf(name, sizeof(name), "%s/%s/%s", b, o, dt);
 
-		else fprintf(stderr, "ERROR: check you are using a valid operation type...\n");
+	return bench_run(name, s, r);
 
+}
+
+/*
+ * Parse a size sweep "start:end[:step]" into an ascending list of
+ * sizes. A step of "xF" (or a bare number F) multiplies by F each
+ * time, "+S" adds S; the default is x2. Returns the number of sizes,
+ * or -1 if the specification is not valid.
+ */
+int size_range(const char *spec, unsigned long **sizes){
+
+	double start, end, step = 2.0, v;
+	int linear = 0, n = 0, max;
+	char *p;
+
+	start = strtod(spec, &p);
+	if(p == spec || *p != ':') return -1;
+	spec = p + 1;
+	end = strtod(spec, &p);
+	if(p == spec) return -1;
+	if(*p == ':'){
+		spec = p + 1;
+		if(*spec == 'x' || *spec == '*') spec++;
+		else if(*spec == '+'){ linear = 1; spec++; }
+		step = strtod(spec, &p);
+		if(p == spec) return -1;
 	}
-	else if (strcmp(b, "cg") == 0) {
-	    if (strcmp(algo, "mixed") == 0) {
-		conjugate_gradient_mixed(s);
-	    }
-	    else if (strcmp(algo, "normal") == 0) {
-		conjugate_gradient(s);
-	    }
-	    else fprintf(stderr, "ERROR: check you are using a valid algorithm...\n");
+	if(*p != '\0') return -1;
+
+	if(start < 1 || end < start) return -1;
+	if(linear ? step < 1 : step <= 1.0) return -1;
+
+	max = linear ? (int)((end - start) / step) + 1 : (int)(log(end / start) / log(step)) + 2;
+	*sizes = malloc(max * sizeof(unsigned long));
+	if(*sizes == NULL) return -1;
+
+	for(v = start; v <= end * (1 + 1e-12) && n < max; v = linear ? v + step : v * step){
+		unsigned long s = (unsigned long)(v + 0.5);
+		if(n == 0 || s != (*sizes)[n-1]) (*sizes)[n++] = s;
 	}
 
+	return n;
+}
+
+/*
+ * Largest normalised error allowed for a kernel whose result goes
+ * through the given number of roundings, twice the first order bound
+ * terms * u. The fp16 and bf16 kernels compute in float, so their
+ * results have the float bound; integer kernels must match exactly.
+ */
+double verify_tolerance(const char *dtype, double terms){
 
-	else fprintf(stderr, "ERROR: check you are using a valid benchmark...\n");
+	double u;
 
+	if(strcmp(dtype, "double") == 0) u = DBL_EPSILON / 2;
+	else if(strcmp(dtype, "float") == 0 || strcmp(dtype, "fp16") == 0 || strcmp(dtype, "bf16") == 0) u = FLT_EPSILON / 2;
+	else return 0.0;
 
+	return 2.0 * terms * u;
 }
 
+/*
+ * As verify_tolerance(), for a kernel that stores its result in its
+ * data type: the fp16 and bf16 results are rounded once more, from
+ * float to their storage type.
+ */
+double verify_store_tolerance(const char *dtype, double terms){
+
+	if(strcmp(dtype, "fp16") == 0) return 2.0 * (terms * FLT_EPSILON / 2 + HALF_U);
+	if(strcmp(dtype, "bf16") == 0) return 2.0 * (terms * FLT_EPSILON / 2 + BF16_U);
+	return verify_tolerance(dtype, terms);
+}
+
+/* |got - ref| relative to scale, the sum of the magnitudes that made up ref */
+double verify_error(long double got, long double ref, long double scale){
+
+	long double d = fabsl(got - ref);
+
+	if(got != got) return INFINITY;
+	return (double)((scale > 0) ? d / scale : d);
+}
@@ -19,70 +19,85 @@
 /* limitations under the License. */
 
 
-void bench_level1(char *, unsigned int, unsigned long, char *, char *, char *);
+#include <stdio.h>
 
-int int_dot_product(unsigned int);
-int float_dot_product(unsigned int);
-int double_dot_product(unsigned int);
-
-int int_scalar_mult(unsigned int);
-int float_scalar_mult(unsigned int);
-int double_scalar_mult(unsigned int);
-
-int int_norm(unsigned int);
-int float_norm(unsigned int);
-int double_norm(unsigned int);
-
-int int_axpy(unsigned int);
-int float_axpy(unsigned int);
-int double_axpy(unsigned int);
-
-int int_dmatvec_product(unsigned int);
-int float_dmatvec_product(unsigned int);
-int double_dmatvec_product(unsigned int);
-
-int float_spmatvec_product(unsigned long);
-int double_spmatvec_product(unsigned long);
-int float_spgemm(unsigned long);
-int double_spgemm(unsigned long);
-
-void float_stencil27(unsigned int);
-void double_stencil27(unsigned int);
-void float_stencil19(unsigned int);
-void double_stencil19(unsigned int);
-void float_stencil9(unsigned int);
-void double_stencil9(unsigned int);
-void float_stencil5(unsigned int);
-void double_stencil5(unsigned int);
-
-void fileparse(unsigned int);
-
-int conjugate_gradient(unsigned int);
-int conjugate_gradient_mixed(unsigned int);
-
-/* Marsaglia's RNGs (fast on Odroid) */
 /*
- * See
- * http://www.cse.yorku.ca/~oz/marsaglia-rng.html
+ * Kernel registry.
+ *
+ * Every benchmark kernel is described by one kernel_t entry. The
+ * driver calls setup() once (untimed), compute() once per repetition
+ * (timed) and teardown() once (untimed). compute() returns a value
+ * derived from the result so the compiler cannot throw the work away.
+ * flops() and bytes() give the work done by a single repetition.
+ * reset(), if not NULL, is called untimed before every repetition to
+ * restore state that compute() consumes (e.g. an iterative solve).
+ * footprint(), if not NULL, gives the working set in bytes; together
+ * with flops() and bytes() it places the kernel on the roofline.
+ * resize(), if not NULL, shrinks the problem in place to a size no
+ * larger than the one given to setup(), reusing its buffers; size
+ * sweeps then call setup() once for the largest size. It returns 0 on
+ * success.
+ * verify(), if not NULL, runs compute() once more (untimed) and checks
+ * its output against a reference computed in higher precision, or
+ * with exact integer arithmetic. It returns the normalised error and
+ * sets *tol to the largest error allowed for the data type, or
+ * returns a negative value if the check could not be made.
+ * parallel(), if not NULL, is the threaded variant of compute(), used
+ * in its place when more than one thread is asked for (see par.h).
+ * saved(), if not NULL, gives the memory traffic in bytes a kernel that
+ * fuses several passes over its vectors into one (see fuse.h) avoids
+ * per repetition; bytes() counts the traffic of the fused passes.
  */
-
-#define znew (z=36969*(z&65535)+(z>>16))
-#define wnew (w=18000*(w&65535)+(w>>16))
-#define MWC ((znew<<16)+wnew )
-#define SHR3 (jsr^=(jsr<<17), jsr^=(jsr>>13), jsr^=(jsr<<5))
-#define CONG (jcong=69069*jcong+1234567)
-#define FIB ((b=a+b),(a=b-a))
-#define KISS ((MWC^CONG)+SHR3)
-#define LFIB4 (c++,t[c]=t[c]+t[UC(c+58)]+t[UC(c+119)]+t[UC(c+178)])
-#define SWB (c++,bro=(x<y),t[c]=(x=t[UC(c+34)])-(y=t[UC(c+19)]+bro))
-#define UNI (KISS*2.328306e-10)
-#define VNI ((long) KISS)*4.656613e-10
-#define UC (unsigned char) /*a cast operation*/
-typedef unsigned long UL;
-/* Global static variables: */
-static UL z=362436069, w=521288629, jsr=123456789, jcong=380116160;
-static UL a=224466889, b=7584631, t[256];
-/* Use random seeds to reset z,w,jsr,jcong,a,b, and the table
-t[256]*/
-static UL x=0,y=0,bro; static unsigned char c=0;
+typedef struct kernel {
+  const char *bench;                    /* benchmark family, e.g. "blas_op" */
+  const char *op;                       /* operation, e.g. "dot_product"    */
+  const char *dtype;                    /* data type, e.g. "double"         */
+  const char *title;                    /* human readable title             */
+  unsigned long reps;                   /* default number of repetitions    */
+  void *(*setup)(unsigned long size);
+  double (*compute)(void *state);
+  void (*teardown)(void *state);
+  double (*flops)(void *state);
+  double (*bytes)(void *state);
+  void (*reset)(void *state);
+  double (*footprint)(void *state);
+  int (*resize)(void *state, unsigned long size);
+  double (*verify)(const struct kernel *k, void *state, double *tol);
+  double (*parallel)(void *state);
+  double (*saved)(void *state);
+} kernel_t;
+
+enum { SCALING_NONE, SCALING_STRONG, SCALING_WEAK };
+
+/* Run configuration shared by the driver and the kernels */
+typedef struct {
+  unsigned long warmup;                 /* untimed repetitions before timing */
+  int roofline;                         /* place each result on the roofline */
+  int counters;                         /* collect hardware counters per repetition */
+  int cold;                             /* flush the caches before every timed repetition */
+  int verify;                           /* check every kernel against its reference */
+  int scaling;                          /* SCALING_* thread sweep, or SCALING_NONE */
+  int setup_threads;                    /* setup pool size, 0 to follow the kernel threads */
+  unsigned long *sizes;                 /* size sweep, ascending; NULL for a single size */
+  int nsizes;
+  int keep;                             /* keep the last kernel's state for its next run */
+} bench_config_t;
+
+extern bench_config_t bench_config;
+
+/* Kernel tables, terminated by an entry with a NULL bench */
+extern const kernel_t blas_op_kernels[];
+extern const kernel_t stencil_kernels[];
+extern const kernel_t fileparse_kernels[];
+extern const kernel_t cg_kernels[];
+
+int bench_level1(char *, unsigned int, unsigned long, char *, char *, char *);
+int bench_run(const char *, unsigned long, unsigned long);
+void bench_release(void);
+void kernel_list(FILE *);
+char *kernel_name(const kernel_t *, char *, size_t);
+int size_range(const char *, unsigned long **);
+double verify_tolerance(const char *, double);
+double verify_store_tolerance(const char *, double);
+double verify_error(long double, long double, long double);
 
@@ -23,70 +23,216 @@
 #include <stdlib.h>
 #include <getopt.h>
 #include <limits.h>
+#include <string.h>
 
 #include "level1.h"
 #include "utils.h"
+#include "report.h"
+#include "memory.h"
+#include "rng.h"
+#include "pool.h"
+#include "par.h"
+#include "suite.h"
+#include "baseline.h"
+#include "simd.h"
+#include "backend.h"
 
 void usage();
 void info();
 
-void settable(UL i1,UL i2,UL i3,UL i4,UL i5, UL i6){
-  int i; z=i1;w=i2,jsr=i3; jcong=i4; a=i5; b=i6;
-  for(i=0;i<256;i=i+1) t[i]=KISS;
-}
-
 int main(int argc, char **argv){
 
   int c;
 
-  /* Init RNG here */
-  settable(12345,65435,34221,12345,9983651,95746118);
-
   char *bench = "blas_op";
   unsigned int size = 200;
-  unsigned long rep = 1;
+  unsigned long rep = 0;
   char *op  = "dot_product";
   char *dt = "double";
   char *algo = "normal";
+  char *kernels = NULL;
+  char *format = "text";
+  char *outfile = NULL;
+  char *cpu = NULL;
+  char *numa = NULL;
+  int setup_threads = 0;
+  int threads = 1;
+  char *suite = NULL;
+  char *save = NULL;
+  char *compare = NULL;
+  double threshold = 0.05;
+  char *isa = "auto";
+  char *backend = "ref";
+  int rv;
 
   static struct option option_list[] =
     { {"bench", required_argument, NULL, 'b'},
       {"size", required_argument, NULL, 's'},
+      {"size-range", required_argument, NULL, 'S'},
       {"reps", required_argument, NULL, 'r'},
       {"op", required_argument, NULL, 'o'},
       {"dtype", required_argument, NULL, 'd'},
       {"algo", required_argument, NULL, 'a'},
+      {"warmup", required_argument, NULL, 'w'},
+      {"kernels", required_argument, NULL, 'k'},
+      {"format", required_argument, NULL, 'f'},
+      {"out", required_argument, NULL, 'O'},
+      {"roofline", no_argument, NULL, 'R'},
+      {"counters", no_argument, NULL, 'C'},
+      {"cache", required_argument, NULL, 'c'},
+      {"cpu", required_argument, NULL, 'P'},
+      {"numa", required_argument, NULL, 'N'},
+      {"pages", required_argument, NULL, 'G'},
+      {"verify", no_argument, NULL, 'V'},
+      {"seed", required_argument, NULL, 'e'},
+      {"setup-threads", required_argument, NULL, 't'},
+      {"threads", required_argument, NULL, 'T'},
+      {"scaling", required_argument, NULL, 'L'},
+      {"runtime", required_argument, NULL, 'u'},
+      {"suite", required_argument, NULL, 'x'},
+      {"save-baseline", required_argument, NULL, 'B'},
+      {"compare", required_argument, NULL, 'D'},
+      {"threshold", required_argument, NULL, 'H'},
+      {"isa", required_argument, NULL, 'I'},
+      {"backend", required_argument, NULL, 'E'},
+      {"list", no_argument, NULL, 'l'},
       {"info", no_argument, NULL, 'i'},
       {"help", no_argument, NULL, 'h'},
       {0, 0, 0, 0}
     };
 
-  while((c = getopt_long(argc, argv, "b:s:r:o:d:a:ih", option_list, NULL)) != -1){
+  while((c = getopt_long(argc, argv, "b:s:S:r:w:o:d:a:k:f:O:RCc:P:N:G:Ve:t:T:L:u:x:B:D:H:I:E:lih", option_list, NULL)) != -1){
     switch(c){
     case 'b':
       bench = optarg;
-      printf("Benchmark is %s.\n", bench);
+      fprintf(stderr, "Benchmark is %s.\n", bench);
       break;
     case 's':
       size = atoi(optarg);
-      printf("Size is %d.\n", size);
+      fprintf(stderr, "Size is %d.\n", size);
+      break;
+    case 'S':
+      bench_config.nsizes = size_range(optarg, &bench_config.sizes);
+      if (bench_config.nsizes <= 0) {
+        fprintf(stderr, "ERROR: invalid size range \"%s\", expected start:end[:xF|:+S]\n", optarg);
+        return 1;
+      }
+      fprintf(stderr, "Size sweep of %d sizes from %lu to %lu.\n", bench_config.nsizes,
+              bench_config.sizes[0], bench_config.sizes[bench_config.nsizes-1]);
       break;
     case 'r':
       rep = atol(optarg);
-      printf("Number of repetitions %lu.\n", rep);
+      fprintf(stderr, "Number of repetitions %lu.\n", rep);
+      break;
+    case 'w':
+      bench_config.warmup = atol(optarg);
+      fprintf(stderr, "Number of warmup repetitions %lu.\n", bench_config.warmup);
       break;
     case 'o':
       op = optarg;
-      printf("Operation %s\n", op);
+      fprintf(stderr, "Operation %s\n", op);
       break;
     case 'd':
       dt = optarg;
-      printf("Data type is %s\n", dt);
+      fprintf(stderr, "Data type is %s\n", dt);
       break;
     case 'a':
       algo = optarg;
-      printf("Algorithm is %s\n", algo);
+      fprintf(stderr, "Algorithm is %s\n", algo);
+      break;
+    case 'k':
+      kernels = optarg;
+      fprintf(stderr, "Kernels are %s\n", kernels);
+      break;
+    case 'f':
+      format = optarg;
+      break;
+    case 'O':
+      outfile = optarg;
+      break;
+    case 'R':
+      bench_config.roofline = 1;
+      break;
+    case 'C':
+      bench_config.counters = 1;
+      break;
+    case 'c':
+      if (strcmp(optarg, "cold") == 0) bench_config.cold = 1;
+      else if (strcmp(optarg, "warm") == 0) bench_config.cold = 0;
+      else {
+        fprintf(stderr, "ERROR: unknown cache mode \"%s\", expected warm or cold\n", optarg);
+        return 1;
+      }
+      fprintf(stderr, "Cache mode is %s\n", optarg);
+      break;
+    case 'P':
+      cpu = optarg;
+      break;
+    case 'N':
+      numa = optarg;
+      break;
+    case 'G':
+      if (mem_page_mode(optarg) != 0) return 1;
+      fprintf(stderr, "Page mode is %s\n", optarg);
+      break;
+    case 'V':
+      bench_config.verify = 1;
+      break;
+    case 'e':
+      rng_seed(strtoull(optarg, NULL, 0));
+      fprintf(stderr, "Seed is %llu.\n", rng_get_seed());
+      break;
+    case 't':
+      setup_threads = atoi(optarg);
+      if (setup_threads < 1) {
+        fprintf(stderr, "ERROR: invalid number of setup threads \"%s\"\n", optarg);
+        return 1;
+      }
+      break;
+    case 'T':
+      threads = atoi(optarg);
+      if (threads < 1) {
+        fprintf(stderr, "ERROR: invalid number of threads \"%s\"\n", optarg);
+        return 1;
+      }
       break;
+    case 'L':
+      if (strcmp(optarg, "strong") == 0) bench_config.scaling = SCALING_STRONG;
+      else if (strcmp(optarg, "weak") == 0) bench_config.scaling = SCALING_WEAK;
+      else {
+        fprintf(stderr, "ERROR: unknown scaling mode \"%s\", expected strong or weak\n", optarg);
+        return 1;
+      }
+      fprintf(stderr, "Scaling mode is %s\n", optarg);
+      break;
+    case 'u':
+      if (par_set_runtime(optarg) != 0) return 1;
+      break;
+    case 'x':
+      suite = optarg;
+      break;
+    case 'B':
+      save = optarg;
+      break;
+    case 'D':
+      compare = optarg;
+      break;
+    case 'H':
+      threshold = atof(optarg) / 100.0;
+      if (threshold < 0) {
+        fprintf(stderr, "ERROR: invalid threshold \"%s\"\n", optarg);
+        return 1;
+      }
+      break;
+    case 'I':
+      isa = optarg;
+      break;
+    case 'E':
+      backend = optarg;
+      break;
+    case 'l':
+      kernel_list(stdout);
+      return 0;
     case 'i':
       info();
       return 0;
@@ -99,9 +245,41 @@ int main(int argc, char **argv){
     }
   }
 
-  bench_level1(bench, size, rep, op, dt, algo);
+  if (bench_config.scaling != SCALING_NONE && bench_config.sizes != NULL) {
+    fprintf(stderr, "ERROR: --scaling and --size-range cannot be combined\n");
+    return 1;
+  }
+  if (suite != NULL && (bench_config.sizes != NULL || kernels != NULL || bench_config.scaling != SCALING_NONE)) {
+    fprintf(stderr, "ERROR: --suite cannot be combined with --size-range, --kernels or --scaling\n");
+    return 1;
+  }
+  bench_config.setup_threads = setup_threads;
+
+  if (simd_select(isa) != 0) return 1;
+  fprintf(stderr, "Vector instruction set is %s.\n", simd_isa());
+  if (backend_select(backend) != 0) return 1;
+  fprintf(stderr, "BLAS backend is %s.\n", backend_name());
+
+  if (mem_setup(cpu, numa) != 0) return 1;
+  if (report_open(format, outfile) != 0) return 1;
+  if (threads > 1) fprintf(stderr, "Kernels on %d threads (%s).\n", par_set_threads(threads), par_runtime());
+  fprintf(stderr, "Setup on %d threads.\n", pool_start(setup_threads ? setup_threads : (threads > 1 ? threads : 0)));
+
+  if (suite != NULL || save != NULL || compare != NULL) report_collect(1);
+
+  if (suite != NULL) rv = suite_run(suite, size, rep);
+  else if (kernels != NULL) rv = bench_run(kernels, size, rep);
+  else rv = bench_level1(bench, size, rep, op, dt, algo);
+
+  if (compare != NULL) rv |= baseline_compare(compare, threshold);
+  if (save != NULL && baseline_save(save) != 0) rv |= 1;
+
+  report_close();
+  pool_stop();
+  par_stop();
+  free(bench_config.sizes);
 
-  return 0;
+  return rv;
 
 }
 
@@ -116,19 +294,93 @@ void usage(){
 		 "\t\t\t\t     It is size^2 for 5 and 9 point stencils, and size^3 for 19 and 27 point stencils.\n"
 		 "\t\t\t\t --> for the BLAS operations it is the vector length or size of the matrix. \n"
 		 "\t\t\t\t     Note: this is not applicable for BLAS operations spmv and spgemm, where the size is dictated by the input matrix.\n");
-  printf("\t -r, --reps N \t\t N number of repetitions. Default value is 1.\n"
-		 "\t\t\t\t --> for the BLAS operations spmv and spgemm, this can be used to run the operation multiple times.\n");
+  printf("\t -S, --size-range R \t Sweep sizes in one process instead of -s. R is start:end[:step] where step is\n"
+		 "\t\t\t\t xF (geometric, the default is x2) or +S (linear), e.g. 1000:1e7:x1.5 or 64:512:+64.\n"
+		 "\t\t\t\t One result is written per size; vector, dmv and stencil kernels reuse the buffers\n"
+		 "\t\t\t\t of the largest size.\n");
+  printf("\t -r, --reps N \t\t N number of repetitions of the timed kernel. Default is the kernel's own default.\n"
+		 "\t\t\t\t --> for stencil this is the number of sweeps, default 100. See --list for the other defaults.\n"
+		 "\t\t\t\t Every repetition is timed on its own; min, median, mean, p95, max, stddev and a 95%% confidence\n"
+		 "\t\t\t\t interval of the mean are reported with the timer overhead removed.\n");
+  printf("\t -w, --warmup N \t N untimed warmup repetitions before timing starts. Default is 1.\n");
+  printf("\t -c, --cache MODE \t warm (default) or cold. Cold writes and reads a buffer of twice the last level\n"
+		 "\t\t\t\t cache before every timed repetition, outside the timed region, so each repetition\n"
+		 "\t\t\t\t starts with the kernel's data evicted. Threaded kernels split the buffer over their\n"
+		 "\t\t\t\t threads, each part at least twice the private caches of a core.\n");
   printf("\t -o, --op TYPE \t\t TYPE of operation.\n");
-  printf("\t\t\t\t --> for BLAS benchmark: \"dot_product\", \"scalar_mult\", \"norm\", \"axpy\", \"dmv\", \"spmv\" and \"spgemm\". \n"
+  printf("\t\t\t\t --> for BLAS benchmark: \"dot_product\", \"scalar_mult\", \"norm\", \"axpy\", \"dmv\", \"dmv_t\", \"gemm\",\n"
+		 "\t\t\t\t     \"gemm_naive\", \"spmv\" and \"spgemm\". \n"
 		 "\t\t\t\t     Default is \"dot_product\".\n");
   printf("\t\t\t\t --> for stencil benchmark: \"27\", \"19\", \"9\" and \"5\". \n"
 		 "\t\t\t\t     Default is \"27\".\n");
   printf("\t -d, --dtype DATATYPE \t DATATYPE to be used for the BLAS benchmarks. Default is double.\n"
-		 "\t\t\t\t --> for norm, dot_product, scalar_product, axpy and dmv possible values are int, float, double.\n"
+		 "\t\t\t\t --> for norm, dot_product, scalar_product and axpy possible values are int, float, double,\n"
+		 "\t\t\t\t     fp16 and bf16 (16-bit storage, float accumulation); dot_product, scalar_product\n"
+		 "\t\t\t\t     and axpy also take int16, int32 and int64 (64-bit sums, saturated results).\n"
+		 "\t\t\t\t --> for dmv possible values are int, float, double, int16, int32 and int64;\n"
+		 "\t\t\t\t     for dmv_t int, float and double.\n"
 		 "\t\t\t\t --> for stencil possible values are float and double.\n"
-		 "\t\t\t\t --> for spmv and spgemm possible values are float, double.\n");
+		 "\t\t\t\t --> for spmv possible values are float, double, fp16 and bf16 (16-bit matrix values).\n"
+		 "\t\t\t\t --> for gemm, gemm_naive and spgemm possible values are float, double.\n");
   printf("\t -a, --algo ALGORITHM \t ALGORITHM to be used. Default is normal.\n"
 	         "\t\t\t\t --> for cg possible values are normal, mixed.\n");
+  printf("\t -k, --kernels LIST \t Comma separated list of kernel names or shell globs to run in one process,\n"
+		 "\t\t\t\t e.g. \"blas_op/axpy/[fd]*,stencil/27/float\". Overrides -b, -o, -d and -a.\n");
+  printf("\t -x, --suite FILE \t Run the plan in FILE in one process: one run per line, given as key=value\n"
+		 "\t\t\t\t settings for bench, op, dtype, algo, kernels, size (a size or a range as for -S),\n"
+		 "\t\t\t\t reps and warmup, e.g. \"bench=stencil op=19 dtype=float size=64:512\". Unset keys\n"
+		 "\t\t\t\t take the command line values; # starts a comment. Runs of the same kernel\n"
+		 "\t\t\t\t reuse its buffers where the sizes allow. A summary of all results ends the report.\n");
+  printf("\t -B, --save-baseline FILE Save the results of this run as a baseline in FILE.\n");
+  printf("\t -D, --compare FILE \t Compare the results with the baseline in FILE (or a --format json report),\n"
+		 "\t\t\t\t matching kernel, size and threads. A median that moved by more than the combined\n"
+		 "\t\t\t\t 95%% confidence intervals of both runs, and by at least the threshold, is flagged;\n"
+		 "\t\t\t\t the exit status is 4 if any kernel got slower.\n");
+  printf("\t -H, --threshold PCT \t Smallest change in percent that --compare flags, default 5.\n");
+  printf("\t -I, --isa ISA \t\t Instruction set for the float and double dot product, AXPY, scaling and norm:\n"
+		 "\t\t\t\t auto (default, the widest the CPU supports), avx512, avx2, sse2 or scalar,\n"
+		 "\t\t\t\t the plain C loops as the compiler vectorises them. --info lists them.\n");
+  printf("\t -E, --backend NAME \t BLAS for the float and double dot product, AXPY, scaling, norm, dmv, dmv_t\n"
+		 "\t\t\t\t and gemm: ref (default, the in-tree kernels) or cblas, the CBLAS found at build\n"
+		 "\t\t\t\t time; other kernels are skipped under cblas. Save a baseline with ref and\n"
+		 "\t\t\t\t --compare a cblas run against it for a head-to-head table.\n");
+  printf("\t -l, --list \t\t List the registered kernels and exit.\n");
+  printf("\t -f, --format FMT \t Result format: text (default), json or csv.\n");
+  printf("\t -O, --out FILE \t Write results to FILE instead of stdout.\n");
+  printf("\t -R, --roofline \t Calibrate the machine once (AXPY and dot product bandwidth of each cache level and main\n"
+		 "\t\t\t\t memory, peak multiply-add rate of the GEMM micro-kernel of the --isa instruction\n"
+		 "\t\t\t\t set) and report each kernel's arithmetic intensity, the attainable rate for its\n"
+		 "\t\t\t\t working set and the achieved percentage of it. The roofs are single-thread, so\n"
+		 "\t\t\t\t runs on more than one thread are reported without them.\n");
+  printf("\t -C, --counters \t Count cycles, instructions, LLC, branch and dTLB misses around every timed\n"
+		 "\t\t\t\t repetition with perf_event_open, summed over the kernel threads, and report IPC\n"
+		 "\t\t\t\t and misses per element.\n"
+		 "\t\t\t\t Counters that are not permitted or not supported are reported as n/a.\n");
+  printf("\t -V, --verify \t\t After timing, run each kernel once more and check its output against a reference\n"
+		 "\t\t\t\t (long double or exact integer arithmetic) within a tolerance for the data type.\n"
+		 "\t\t\t\t The exit status is 2 if any kernel fails.\n");
+  printf("\t -e, --seed N \t\t Seed for the kernels' input data, default %llu. Inputs depend only on the seed,\n"
+		 "\t\t\t\t so runs with the same seed and sizes see the same data.\n", RNG_DEFAULT_SEED);
+  printf("\t -t, --setup-threads N \t Initialise kernel data on N threads, default one per CPU on the node of the\n"
+		 "\t\t\t\t benchmark thread. Each thread first touches the part of the data a threaded\n"
+		 "\t\t\t\t kernel would compute on; the timed kernels are not affected.\n");
+  printf("\t -T, --threads N \t Run the threaded variant of each kernel on N threads (OpenMP), pinned to the\n"
+		 "\t\t\t\t CPUs the setup threads used, so each thread computes on the data it initialised.\n"
+		 "\t\t\t\t Setup also runs on N threads unless -t is given. Default is 1.\n");
+  printf("\t -u, --runtime NAME \t Threading runtime for -T: \"openmp\" (default where the compiler supports it)\n"
+		 "\t\t\t\t or \"steal\", a pthreads runtime with per-thread work-stealing deques that\n"
+		 "\t\t\t\t balances irregular loops such as sparse rows and columns dynamically.\n");
+  printf("\t -L, --scaling MODE \t Run each kernel on 1, 2, 4, ... threads up to -T (default all CPUs) and report\n"
+		 "\t\t\t\t speedup and parallel efficiency: \"strong\" at a fixed size, \"weak\" with the\n"
+		 "\t\t\t\t work grown in proportion to the threads.\n");
+  printf("\t -P, --cpu N \t\t Pin the benchmark thread to CPU N. Default is the CPU it starts on; \"none\"\n"
+		 "\t\t\t\t leaves it to the scheduler.\n");
+  printf("\t -N, --numa POLICY \t Page placement for all kernel data: \"local\" (default) to the node of the\n"
+		 "\t\t\t\t pinned CPU, a node number to bind to, \"interleave\" over all nodes or \"default\".\n"
+		 "\t\t\t\t The CPU, its node and the share of resident pages on each node are reported.\n");
+  printf("\t -G, --pages MODE \t Pages backing kernel data: 4k (default), thp (transparent huge pages via\n"
+		 "\t\t\t\t madvise) or huge (explicit MAP_HUGETLB pages, falling back to thp if none are\n"
+		 "\t\t\t\t reserved). Buffers of a page or more are page aligned, smaller ones 64-byte aligned.\n");
   printf("\t -i, --info \t\t Print out system information such as current CPU frequency, core counts, cache size, plus datatype sizes.\n");
   printf("\t -h, --help \t\t Displays this help.\n");
   printf("\n\n");
@@ -149,5 +401,9 @@ void info(){
   printf("Size of float: \t\t%lu bytes\n", sizeof(float));
   printf("Size of double: \t%lu bytes\n", sizeof(double));
   printf("***************************************\n");
+  printf("\nVector instruction sets: ");
+  simd_list(stdout);
+  printf("\nBLAS backends: ");
+  backend_list(stdout);
   printf("\n\n");
 }
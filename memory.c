@@ -0,0 +1,548 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+#include "memory.h"
+
+/* Alignment of small buffers, one cache line */
+#define MEM_ALIGN 64
+
+/* Size of the shared chunks small buffers are carved from */
+#define ARENA_CHUNK (32UL*1024*1024)
+
+/* Buffers of at least this size get a chunk of their own */
+#define ARENA_OWN (ARENA_CHUNK/4)
+
+/* Largest node number handled in policy masks */
+#define MEM_MAX_NODES 1024
+
+/* Pages sampled per chunk when reporting placement */
+#define MEM_SAMPLES 256
+
+/*
+ * A region mapped from the OS. Buffers are carved from it in order
+ * and it is reused once all of them are freed, after its pages are
+ * given back so that the next first touch places them again; a large
+ * buffer has a chunk of its own, which is unmapped when the buffer is
+ * freed.
+ */
+typedef struct mem_chunk {
+  struct mem_chunk *next;
+  char *base;
+  size_t size;               /* mapped bytes */
+  size_t used;               /* bytes handed out */
+  long live;                 /* buffers not yet freed */
+  int own;                   /* holds a single large buffer */
+} mem_chunk;
+
+static mem_chunk *chunks = NULL;
+static mem_chunk *current = NULL;        /* shared chunk being carved */
+
+static int pages = MEM_PAGES_4K;
+static const char *page_names[] = { "4k", "thp", "huge" };
+
+static int mode = -1;                    /* MPOL_* mode, -1 leaves the default */
+static unsigned long nodemask[MEM_MAX_NODES / (8 * sizeof(unsigned long))];
+static char policy_name[24] = "default";
+static int pinned = -1;                  /* CPU the benchmark thread is pinned to */
+
+
+/* Select the page size of all later chunks: "4k", "thp" or "huge" */
+int mem_page_mode(const char *name){
+
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    if (strcmp(name, page_names[i]) == 0) {
+      pages = i;
+      return 0;
+    }
+  }
+  fprintf(stderr, "ERROR: unknown page mode \"%s\", expected 4k, thp or huge\n", name);
+  return 1;
+}
+
+static size_t round_up(size_t n, size_t to){ return (n + to - 1) / to * to; }
+
+/* Default huge page size, from /proc/meminfo; 2 MiB if unknown */
+static size_t huge_page_size(void){
+
+  static size_t huge = 0;
+  char line[128];
+  FILE *f;
+
+  if (huge) return huge;
+  huge = 2*1024*1024;
+  if ((f = fopen("/proc/meminfo", "r")) == NULL) return huge;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    unsigned long kb;
+    if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+      huge = kb * 1024;
+      break;
+    }
+  }
+  fclose(f);
+
+  return huge;
+}
+
+#ifdef __linux__
+
+/* Highest online node number, from sysfs; 0 if unknown */
+static int max_node(void){
+
+  FILE *f = fopen("/sys/devices/system/node/online", "r");
+  char buf[256], *p;
+  int n = 0, v;
+
+  if (f == NULL) return 0;
+  if (fgets(buf, sizeof(buf), f) != NULL) {
+    /* a list of ranges such as "0-1,4" */
+    for (p = buf; *p; ) {
+      v = (int)strtol(p, &p, 10);
+      if (v > n) n = v;
+      if (*p == '-' || *p == ',') p++;
+      else break;
+    }
+  }
+  fclose(f);
+
+  return (n < MEM_MAX_NODES) ? n : MEM_MAX_NODES - 1;
+}
+
+/*
+ * Pin the calling thread and set its memory policy. cpu is a CPU
+ * number, "none" to leave the scheduler free, or NULL for the CPU the
+ * thread is running on now. policy is "local", "default", "interleave"
+ * or a node number to bind to. Returns 0 on success.
+ */
+static cpu_set_t avail;                  /* CPUs usable before the thread was pinned */
+static int avail_known = 0;
+
+int mem_setup(const char *cpu, const char *policy){
+
+  cpu_set_t set;
+  int c, n;
+
+  avail_known = (sched_getaffinity(0, sizeof(avail), &avail) == 0);
+  if (cpu == NULL || strcmp(cpu, "none") != 0) {
+    if (cpu == NULL) c = sched_getcpu();
+    else {
+      char *end;
+      long v = strtol(cpu, &end, 10);
+      if (end == cpu || *end != '\0' || v < 0 || v >= CPU_SETSIZE) {
+        fprintf(stderr, "ERROR: unknown cpu \"%s\", expected a CPU number or none\n", cpu);
+        return 1;
+      }
+      if (avail_known && !CPU_ISSET(v, &avail)) {
+        fprintf(stderr, "ERROR: cpu %ld is not online or not available to this process\n", v);
+        return 1;
+      }
+      c = (int)v;
+    }
+    if (c < 0) c = 0;
+    CPU_ZERO(&set);
+    CPU_SET(c, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+      fprintf(stderr, "ERROR: unable to pin to cpu %d: %s\n", c, strerror(errno));
+      return 1;
+    }
+    pinned = c;
+  }
+
+  memset(nodemask, 0, sizeof(nodemask));
+  if (policy == NULL || strcmp(policy, "local") == 0) {
+    mode = MPOL_LOCAL;
+    strcpy(policy_name, "local");
+  } else if (strcmp(policy, "default") == 0) {
+    mode = -1;
+    strcpy(policy_name, "default");
+    return 0;
+  } else if (strcmp(policy, "interleave") == 0) {
+    mode = MPOL_INTERLEAVE;
+    for (n = 0; n <= max_node(); n++)
+      nodemask[n / (8 * sizeof(unsigned long))] |= 1UL << (n % (8 * sizeof(unsigned long)));
+    strcpy(policy_name, "interleave");
+  } else {
+    char *end;
+    n = (int)strtol(policy, &end, 10);
+    if (end == policy || *end != '\0' || n < 0 || n > max_node()) {
+      fprintf(stderr, "ERROR: unknown memory policy or node \"%s\"\n", policy);
+      return 1;
+    }
+    mode = MPOL_BIND;
+    nodemask[n / (8 * sizeof(unsigned long))] |= 1UL << (n % (8 * sizeof(unsigned long)));
+    snprintf(policy_name, sizeof(policy_name), "bind:%d", n);
+  }
+
+  if (syscall(SYS_set_mempolicy, mode, mode == MPOL_LOCAL ? NULL : nodemask,
+              mode == MPOL_LOCAL ? 0 : MEM_MAX_NODES) != 0) {
+    fprintf(stderr, "WARNING: set_mempolicy(%s) failed: %s, using the default policy\n",
+            policy_name, strerror(errno));
+    mode = -1;
+    strcpy(policy_name, "default");
+  }
+
+  return 0;
+}
+
+/* Node of a CPU, from sysfs; 0 if unknown */
+static int node_of_cpu(int cpu){
+
+  char path[64];
+  int n;
+
+  for (n = 0; n <= max_node(); n++) {
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d", cpu, n);
+    if (access(path, F_OK) == 0) return n;
+  }
+  return 0;
+}
+
+/*
+ * CPUs the process could use before mem_setup() pinned it, for worker
+ * threads: the benchmark thread's CPU first, then the others on its
+ * node, then the rest. Returns the number written to cpus and sets
+ * *local to how many of them lead on the benchmark thread's node.
+ */
+int mem_cpus(int *cpus, int max, int *local){
+
+  int self = (pinned >= 0) ? pinned : sched_getcpu();
+  int node, c, n = 0, pass;
+
+  if (self < 0) self = 0;
+  if (!avail_known) {
+    avail_known = (sched_getaffinity(0, sizeof(avail), &avail) == 0);
+    if (!avail_known) {
+      cpus[0] = self;
+      *local = 1;
+      return 1;
+    }
+  }
+
+  node = node_of_cpu(self);
+  if (n < max) cpus[n++] = self;
+  for (pass = 0; pass < 2; pass++) {
+    for (c = 0; c < CPU_SETSIZE && n < max; c++) {
+      if (c == self || !CPU_ISSET(c, &avail)) continue;
+      if ((node_of_cpu(c) == node) == (pass == 0)) cpus[n++] = c;
+    }
+    if (pass == 0) *local = n;
+  }
+
+  return n;
+}
+
+/* The CPU the benchmark thread is pinned to, -1 if it is not pinned */
+int mem_pinned(void){ return pinned; }
+
+/* Apply the policy to a whole chunk */
+static void mem_bind(void *p, size_t len){
+
+  if (mode < 0) return;
+  syscall(SYS_mbind, p, len, mode, mode == MPOL_LOCAL ? NULL : nodemask,
+          mode == MPOL_LOCAL ? 0 : MEM_MAX_NODES, 0);
+}
+
+#else
+
+int mem_setup(const char *cpu, const char *policy){ (void)cpu; (void)policy; return 0; }
+int mem_pinned(void){ return -1; }
+
+int mem_cpus(int *cpus, int max, int *local){
+
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  int c;
+
+  if (n < 1) n = 1;
+  if (n > max) n = max;
+  for (c = 0; c < n; c++) cpus[c] = c;
+  *local = (int)n;
+  return (int)n;
+}
+static void mem_bind(void *p, size_t len){ (void)p; (void)len; }
+
+#endif
+
+/*
+ * Map len bytes in the current page mode. Explicit huge pages come
+ * from the hugetlbfs pool; if it is empty the request falls back to
+ * transparent huge pages, with a warning. THP mappings are aligned to
+ * the huge page size so whole huge pages can back them; 4k mappings
+ * opt out of THP so the mode means the same whatever the system
+ * default is.
+ */
+static char *map_chunk(size_t *len){
+
+  size_t huge = huge_page_size();
+  char *p;
+
+#ifdef MAP_HUGETLB
+  if (pages == MEM_PAGES_HUGE) {
+    size_t n = round_up(*len, huge);
+    p = mmap(NULL, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      *len = n;
+      return p;
+    }
+    fprintf(stderr, "WARNING: no explicit huge pages available (see /proc/sys/vm/nr_hugepages), "
+                    "using transparent huge pages\n");
+    pages = MEM_PAGES_THP;
+  }
+#else
+  if (pages == MEM_PAGES_HUGE) pages = MEM_PAGES_THP;
+#endif
+
+  if (pages == MEM_PAGES_THP) {
+    size_t n = round_up(*len, huge), lead;
+    p = mmap(NULL, n + huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+    /* trim to a huge page aligned start */
+    lead = round_up((size_t)p, huge) - (size_t)p;
+    if (lead) munmap(p, lead);
+    munmap(p + lead + n, huge - lead);
+    p += lead;
+#ifdef MADV_HUGEPAGE
+    madvise(p, n, MADV_HUGEPAGE);
+#endif
+    *len = n;
+    return p;
+  }
+
+  *len = round_up(*len, sysconf(_SC_PAGESIZE));
+  p = mmap(NULL, *len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) return NULL;
+#ifdef MADV_NOHUGEPAGE
+  madvise(p, *len, MADV_NOHUGEPAGE);
+#endif
+  return p;
+}
+
+static mem_chunk *new_chunk(size_t len, int own){
+
+  mem_chunk *c = calloc(1, sizeof(mem_chunk));
+
+  if (c == NULL) return NULL;
+  c->size = len;
+  c->base = map_chunk(&c->size);
+  if (c->base == NULL) {
+    free(c);
+    return NULL;
+  }
+  mem_bind(c->base, c->size);
+  c->own = own;
+  c->next = chunks;
+  chunks = c;
+
+  return c;
+}
+
+static void drop_chunk(mem_chunk *c){
+
+  mem_chunk **pc;
+
+  for (pc = &chunks; *pc != c; pc = &(*pc)->next);
+  *pc = c->next;
+  if (current == c) current = NULL;
+  munmap(c->base, c->size);
+  free(c);
+}
+
+/*
+ * Arena allocation. Buffers of a page or more are page aligned (huge
+ * page aligned in the thp and huge modes), smaller ones are cache
+ * line aligned. Large buffers get their own chunk; the others are
+ * carved from a shared one. Every chunk is bound to the memory policy.
+ */
+void *mem_alloc(size_t len){
+
+  size_t page = sysconf(_SC_PAGESIZE), huge = huge_page_size();
+  size_t align = (pages != MEM_PAGES_4K && len >= huge) ? huge : (len >= page) ? page : MEM_ALIGN;
+  size_t off;
+  mem_chunk *c;
+
+  if (len == 0) len = 1;
+
+  if (len >= ARENA_OWN) {
+    c = new_chunk(len, 1);
+    if (c == NULL) return NULL;
+    c->used = len;
+    c->live = 1;
+    return c->base;
+  }
+
+  off = current ? round_up(current->used, align) : 0;
+  if (current == NULL || off + len > current->size) {
+    current = new_chunk(ARENA_CHUNK, 0);
+    if (current == NULL) return NULL;
+    off = 0;
+  }
+  current->used = off + len;
+  current->live++;
+
+  return current->base + off;
+}
+
+void *mem_calloc(size_t n, size_t size){
+
+  /* the arena hands out fresh anonymous pages, which read as zero: not
+     touching them here leaves their placement to the kernel's threads */
+  return mem_alloc(n * size);
+}
+
+void mem_free(void *p){
+
+  mem_chunk *c;
+
+  if (p == NULL) return;
+  for (c = chunks; c != NULL; c = c->next) {
+    if ((char *)p >= c->base && (char *)p < c->base + c->size) break;
+  }
+  if (c == NULL) {
+    fprintf(stderr, "WARNING: mem_free of a buffer not from the arena\n");
+    return;
+  }
+  if (--c->live > 0) return;
+
+  /* keep the shared chunk being carved for the next kernel, without its
+     pages: they would keep the placement of the last kernel's first touch */
+#if defined(__linux__) && defined(MADV_DONTNEED)
+  if (c == current && madvise(c->base, c->size, MADV_DONTNEED) == 0) {
+    c->used = 0;
+    return;
+  }
+#endif
+  drop_chunk(c);
+}
+
+/* Bytes of this process backed by huge pages, THP and hugetlbfs */
+static double huge_bytes(void){
+
+  char line[128];
+  double total = 0;
+  unsigned long kb;
+  FILE *f;
+
+  if ((f = fopen("/proc/self/smaps_rollup", "r")) == NULL) return 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1 ||
+        sscanf(line, "Private_Hugetlb: %lu kB", &kb) == 1 ||
+        sscanf(line, "Shared_Hugetlb: %lu kB", &kb) == 1) total += kb * 1024.0;
+  }
+  fclose(f);
+
+  return total;
+}
+
+#ifdef __linux__
+
+/*
+ * Sample the resident pages of every chunk in use with move_pages()
+ * (which only queries when no target nodes are given) and summarise
+ * the share on each node.
+ */
+static void mem_pages(char *buf, size_t len){
+
+  long page = sysconf(_SC_PAGESIZE);
+  double count[MEM_MAX_NODES], total = 0;
+  void *addr[MEM_SAMPLES];
+  int status[MEM_SAMPLES];
+  int nnodes = max_node() + 1, i, n;
+  mem_chunk *c;
+  size_t off;
+
+  memset(count, 0, sizeof(count));
+
+  for (c = chunks; c != NULL; c = c->next) {
+    size_t npages = (c->used + page - 1) / page;
+    size_t step = (npages + MEM_SAMPLES - 1) / MEM_SAMPLES;
+
+    if (c->live == 0) continue;
+    if (step == 0) step = 1;
+    for (n = 0, off = 0; off < npages && n < MEM_SAMPLES; off += step, n++)
+      addr[n] = c->base + off * page;
+    if (syscall(SYS_move_pages, 0, n, addr, NULL, status, 0) != 0) continue;
+    for (i = 0; i < n; i++) {
+      if (status[i] >= 0 && status[i] < nnodes) {
+        count[status[i]] += step;
+        total += step;
+      }
+    }
+  }
+
+  buf[0] = '\0';
+  if (total == 0) {
+    snprintf(buf, len, "unknown");
+    return;
+  }
+  for (i = 0; i < nnodes; i++) {
+    size_t used = strlen(buf);
+    if (count[i] > 0)
+      snprintf(buf + used, len - used, "%snode%d:%.0f%%", used ? " " : "", i, 100.0 * count[i] / total);
+  }
+}
+
+void mem_where(mem_placement *w){
+
+  unsigned int cpu = 0, node = 0;
+
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) {
+    w->cpu = cpu;
+    w->cpu_node = node;
+  } else {
+    w->cpu = -1;
+    w->cpu_node = -1;
+  }
+  snprintf(w->policy, sizeof(w->policy), "%s", policy_name);
+  mem_pages(w->pages, sizeof(w->pages));
+  snprintf(w->page_mode, sizeof(w->page_mode), "%s", page_names[pages]);
+  w->huge_bytes = huge_bytes();
+}
+
+#else
+
+void mem_where(mem_placement *w){
+
+  w->cpu = -1;
+  w->cpu_node = -1;
+  snprintf(w->policy, sizeof(w->policy), "%s", policy_name);
+  snprintf(w->pages, sizeof(w->pages), "unknown");
+  snprintf(w->page_mode, sizeof(w->page_mode), "%s", page_names[pages]);
+  w->huge_bytes = huge_bytes();
+}
+
+#endif
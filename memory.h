@@ -0,0 +1,55 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Memory and affinity layer.
+ *
+ * mem_setup() pins the benchmark thread to one CPU and sets the page
+ * placement policy for everything the thread touches afterwards. The
+ * kernels allocate their data through mem_alloc()/mem_calloc() from
+ * an arena of mapped chunks: aligned, backed by 4k, transparent huge
+ * or explicit huge pages (mem_page_mode()), and bound to the policy so
+ * pages stay where they were asked for whichever thread touches them
+ * first. The arena knows its chunks, so their placement can be
+ * reported.
+ */
+
+/* Page size backing the arena */
+enum { MEM_PAGES_4K, MEM_PAGES_THP, MEM_PAGES_HUGE };
+
+/* Placement of the benchmark thread and of its live buffers */
+typedef struct {
+  int cpu;                   /* CPU the thread runs on, -1 if unknown */
+  int cpu_node;              /* node of that CPU, -1 if unknown */
+  char policy[24];           /* e.g. "local", "bind:1", "interleave" */
+  char pages[64];            /* share of resident pages per node, e.g. "node0:100%" */
+  char page_mode[8];         /* "4k", "thp" or "huge" */
+  double huge_bytes;         /* bytes of the process backed by huge pages */
+} mem_placement;
+
+int mem_setup(const char *cpu, const char *policy);
+int mem_page_mode(const char *);
+void *mem_alloc(size_t);
+void *mem_calloc(size_t, size_t);
+void mem_free(void *);
+void mem_where(mem_placement *);
+int mem_cpus(int *cpus, int max, int *local);
+int mem_pinned(void);
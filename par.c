@@ -0,0 +1,248 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * OpenMP backend. Threads inherit the benchmark thread's single-CPU
+ * affinity, so par_set_threads() pins thread t of the team to the
+ * t-th CPU of mem_cpus(), the CPU setup worker t ran on. libgomp
+ * keeps the team's threads between parallel regions, so the pinning
+ * holds for the kernels that follow. The steal runtime pins its own
+ * workers the same way.
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "memory.h"
+#include "par.h"
+#include "steal.h"
+
+#define PAR_MAX_THREADS 1024
+
+enum { PAR_OPENMP, PAR_STEAL };
+
+static int nthreads = 1;
+#ifdef _OPENMP
+static int runtime = PAR_OPENMP;
+#else
+static int runtime = PAR_STEAL;
+#endif
+
+#ifdef _OPENMP
+
+/* One partial result per cache line, so threads do not share lines */
+#define PAR_PAD 8
+
+static double partial[PAR_MAX_THREADS * PAR_PAD];
+
+/* Result of every chunk of a par_for_grain() */
+static double *results = NULL;
+static unsigned long nresults = 0;
+
+
+/* Range t of nt near-equal ranges of [0, n), as in pool_for() */
+static void par_range(unsigned long t, unsigned long nt, unsigned long n, unsigned long *begin, unsigned long *end){
+
+  unsigned long chunk = n / nt, rem = n % nt;
+
+  *begin = t * chunk + (t < rem ? t : rem);
+  *end = *begin + chunk + (t < rem);
+}
+
+static int omp_set_threads(int n){
+
+  static int cpus[PAR_MAX_THREADS];
+  int ncpus, local;
+
+  if (n == 1) return 1;
+
+  ncpus = mem_cpus(cpus, PAR_MAX_THREADS, &local);
+#pragma omp parallel num_threads(n)
+  {
+#ifdef __linux__
+    int t = omp_get_thread_num();
+    if (t > 0 && mem_pinned() >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus[t % ncpus], &set);
+      sched_setaffinity(0, sizeof(set), &set);
+    }
+#endif
+  }
+
+  return n;
+}
+
+static double omp_for(unsigned long n, par_fn fn, void *arg){
+
+  double sum = 0.0;
+  int t, nt = nthreads;
+
+  for (t = 0; t < nt; t++) partial[t * PAR_PAD] = 0.0;
+
+#pragma omp parallel num_threads(nt)
+  {
+    unsigned long begin, end;
+    int me = omp_get_thread_num();
+
+    /* the split is by team size, which can be smaller than asked for */
+    par_range(me, omp_get_num_threads(), n, &begin, &end);
+    if (begin < end) partial[me * PAR_PAD] = fn(arg, begin, end);
+  }
+
+  for (t = 0; t < nt; t++) sum += partial[t * PAR_PAD];
+
+  return sum;
+}
+
+static double omp_for_grain(unsigned long n, unsigned long grain, par_fn fn, void *arg){
+
+  unsigned long chunks = (n + grain - 1) / grain, c;
+  long i;
+  double sum = 0.0;
+
+  if (chunks > nresults) {
+    double *r = realloc(results, chunks * sizeof(double));
+    if (r == NULL) return fn(arg, 0, n);
+    results = r;
+    nresults = chunks;
+  }
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+  for (i = 0; i < (long)chunks; i++) {
+    unsigned long begin, end;
+    par_range(i, chunks, n, &begin, &end);
+    results[i] = fn(arg, begin, end);
+  }
+
+  for (c = 0; c < chunks; c++) sum += results[c];
+
+  return sum;
+}
+
+#endif
+
+/* Choose the runtime, "openmp" or "steal"; returns 0 on success */
+int par_set_runtime(const char *name){
+
+  if (strcmp(name, "steal") == 0) runtime = PAR_STEAL;
+  else if (strcmp(name, "openmp") == 0) {
+#ifdef _OPENMP
+    runtime = PAR_OPENMP;
+#else
+    fprintf(stderr, "ERROR: built without OpenMP, use --runtime=steal\n");
+    return -1;
+#endif
+  } else {
+    fprintf(stderr, "ERROR: unknown runtime \"%s\", expected openmp or steal\n", name);
+    return -1;
+  }
+
+  return 0;
+}
+
+const char *par_runtime(void){ return runtime == PAR_STEAL ? "steal" : "openmp"; }
+
+/* Use n threads for the threaded kernels; returns the number in use */
+int par_set_threads(int n){
+
+  if (n < 1) n = 1;
+  if (n > PAR_MAX_THREADS) n = PAR_MAX_THREADS;
+
+  if (runtime == PAR_STEAL) {
+    steal_stop();
+    nthreads = steal_start(n);
+  }
+#ifdef _OPENMP
+  else nthreads = omp_set_threads(n);
+#endif
+
+  return nthreads;
+}
+
+int par_threads(void){ return nthreads; }
+
+/* The calling thread's number in the running par_for(), 0 outside one */
+int par_thread(void){
+
+  if (nthreads == 1) return 0;
+  if (runtime == PAR_STEAL) return steal_thread();
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+double par_for(unsigned long n, par_fn fn, void *arg){
+
+  if (nthreads == 1 || n < 2) return n ? fn(arg, 0, n) : 0.0;
+  if (runtime == PAR_STEAL) return steal_for(n, 0, fn, arg);
+#ifdef _OPENMP
+  return omp_for(n, fn, arg);
+#else
+  return fn(arg, 0, n);
+#endif
+}
+
+double par_for_grain(unsigned long n, unsigned long grain, par_fn fn, void *arg){
+
+  if (nthreads == 1 || n < 2) return n ? fn(arg, 0, n) : 0.0;
+  if (grain == 0) return par_for(n, fn, arg);
+  if (runtime == PAR_STEAL) return steal_for(n, grain, fn, arg);
+#ifdef _OPENMP
+  return omp_for_grain(n, grain, fn, arg);
+#else
+  return fn(arg, 0, n);
+#endif
+}
+
+/* Run fn once on every thread of the kernels, the calling thread included */
+void par_each(void (*fn)(void *arg), void *arg){
+
+  if (nthreads == 1) fn(arg);
+  else if (runtime == PAR_STEAL) steal_each(fn, arg);
+#ifdef _OPENMP
+  else {
+#pragma omp parallel num_threads(nthreads)
+    fn(arg);
+  }
+#endif
+}
+
+void par_stop(void){
+
+  steal_stop();
+  nthreads = 1;
+}
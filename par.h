@@ -0,0 +1,57 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Threaded kernels.
+ *
+ * The threaded variant of a kernel hands its outer loop to par_for(),
+ * which runs fn on par_threads() threads. [0, n) is cut into one
+ * contiguous range per thread in the same way pool_for() splits setup
+ * work, so each thread computes on the part of the data it first
+ * touched. fn returns a partial result for its range (0 if there is
+ * nothing to reduce) and par_for() returns the sum of the partials,
+ * added in range order so the result does not depend on scheduling.
+ *
+ * par_for_grain() is for irregular loops, such as the rows of a sparse
+ * matrix: [0, n) is cut into chunks of about grain iterations that are
+ * balanced dynamically between the threads, and the chunk results are
+ * again added in order.
+ *
+ * Two runtimes run the loops: OpenMP, the default where the compiler
+ * supports it, and a work-stealing pthreads runtime (see steal.h).
+ * par_set_runtime() chooses one before par_set_threads().
+ *
+ * par_thread() numbers the thread running fn from 0 to par_threads() - 1,
+ * so fn can use scratch space that setup allocated per thread, and
+ * par_each() runs a function once on each of the threads.
+ */
+
+typedef double (*par_fn)(void *arg, unsigned long begin, unsigned long end);
+
+int par_set_runtime(const char *name);
+const char *par_runtime(void);
+int par_set_threads(int n);
+int par_threads(void);
+int par_thread(void);
+double par_for(unsigned long n, par_fn fn, void *arg);
+double par_for_grain(unsigned long n, unsigned long grain, par_fn fn, void *arg);
+void par_each(void (*fn)(void *arg), void *arg);
+void par_stop(void);
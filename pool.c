@@ -0,0 +1,168 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "memory.h"
+#include "pool.h"
+
+#define POOL_MAX_THREADS 1024
+
+static int nthreads = 1;
+static pthread_t threads[POOL_MAX_THREADS];
+static int cpus[POOL_MAX_THREADS];
+static int ncpus = 0;
+
+/* The current job, guarded by lock */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+static unsigned long generation = 0;
+static int running = 0;                  /* workers yet to finish the job */
+static int stopping = 0;
+static pool_fn job_fn;
+static void *job_arg;
+static unsigned long job_n;
+
+static __thread int in_pool = 0;
+
+
+/* Worker t's share of [0, n): the first n % T workers get one more */
+static void run_share(int t){
+
+  unsigned long chunk = job_n / nthreads, rem = job_n % nthreads;
+  unsigned long begin = t * chunk + ((unsigned long)t < rem ? (unsigned long)t : rem);
+  unsigned long end = begin + chunk + ((unsigned long)t < rem);
+
+  if (begin < end) job_fn(job_arg, begin, end);
+}
+
+static void *worker(void *p){
+
+  int t = (int)(long)p;
+  unsigned long seen = 0;
+
+  in_pool = 1;
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    while (generation == seen && !stopping) pthread_cond_wait(&start, &lock);
+    if (stopping) break;
+    seen = generation;
+    pthread_mutex_unlock(&lock);
+
+    run_share(t);
+
+    pthread_mutex_lock(&lock);
+    if (--running == 0) pthread_cond_signal(&done);
+  }
+  pthread_mutex_unlock(&lock);
+
+  return NULL;
+}
+
+/*
+ * Start n threads in all, including the calling one; n <= 0 takes one
+ * per CPU on the benchmark thread's node. Returns the number started.
+ */
+int pool_start(int n){
+
+  pthread_attr_t attr;
+  int local, t;
+
+  ncpus = mem_cpus(cpus, POOL_MAX_THREADS, &local);
+  if (n <= 0) n = local;
+  if (n > POOL_MAX_THREADS) n = POOL_MAX_THREADS;
+
+  generation = 0;
+  stopping = 0;
+  nthreads = 1;
+  for (t = 1; t < n; t++) {
+    pthread_attr_init(&attr);
+#ifdef __linux__
+    if (mem_pinned() >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus[t % ncpus], &set);
+      pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    }
+#endif
+    if (pthread_create(&threads[t], &attr, worker, (void *)(long)t) != 0) {
+      fprintf(stderr, "WARNING: could only start %d setup threads\n", t);
+      pthread_attr_destroy(&attr);
+      break;
+    }
+    pthread_attr_destroy(&attr);
+    nthreads = t + 1;
+  }
+
+  return nthreads;
+}
+
+int pool_threads(void){ return nthreads; }
+
+void pool_for(unsigned long n, pool_fn fn, void *arg){
+
+  if (nthreads == 1 || in_pool || n < 2) {
+    if (n > 0) fn(arg, 0, n);
+    return;
+  }
+
+  pthread_mutex_lock(&lock);
+  job_fn = fn;
+  job_arg = arg;
+  job_n = n;
+  running = nthreads - 1;
+  generation++;
+  pthread_cond_broadcast(&start);
+  pthread_mutex_unlock(&lock);
+
+  in_pool = 1;
+  run_share(0);
+  in_pool = 0;
+
+  pthread_mutex_lock(&lock);
+  while (running > 0) pthread_cond_wait(&done, &lock);
+  pthread_mutex_unlock(&lock);
+}
+
+void pool_stop(void){
+
+  int t;
+
+  pthread_mutex_lock(&lock);
+  stopping = 1;
+  pthread_cond_broadcast(&start);
+  pthread_mutex_unlock(&lock);
+
+  for (t = 1; t < nthreads; t++) pthread_join(threads[t], NULL);
+  nthreads = 1;
+}
@@ -0,0 +1,39 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Thread pool for untimed setup work.
+ *
+ * pool_start() starts the workers, each pinned to its own CPU when
+ * the benchmark thread is pinned (see mem_cpus()), the benchmark thread
+ * itself being worker 0. pool_for() splits [0, n) into one contiguous
+ * range per worker, in order, and returns when all of them are done.
+ * Buffers initialised this way are first touched by the worker, and so
+ * the CPU, that a threaded kernel using the same split computes on.
+ * pool_for() called from inside a range runs the whole range inline.
+ */
+
+typedef void (*pool_fn)(void *arg, unsigned long begin, unsigned long end);
+
+int pool_start(int nthreads);
+int pool_threads(void);
+void pool_for(unsigned long n, pool_fn fn, void *arg);
+void pool_stop(void);
@@ -0,0 +1,254 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+#include "simd.h"
+#include "reduce.h"
+
+
+static float sdot_naive(const float *x, const float *y, unsigned long n){
+
+  float sum = 0.0f;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) sum = sum + x[i] * y[i];
+
+  return sum;
+}
+
+static float sdot_kway(const float *x, const float *y, unsigned long n){
+
+  float s[REDUCE_WAYS] = { 0.0f };
+  unsigned long i = 0;
+  int k;
+
+  for (; i + REDUCE_WAYS <= n; i += REDUCE_WAYS)
+    for (k = 0; k < REDUCE_WAYS; k++) s[k] = s[k] + x[i + k] * y[i + k];
+  for (k = 0; i < n; i++, k++) s[k] = s[k] + x[i] * y[i];
+
+  for (k = REDUCE_WAYS / 2; k > 0; k /= 2)
+    for (i = 0; i < (unsigned long)k; i++) s[i] = s[i] + s[i + k];
+
+  return s[0];
+}
+
+/* Halves split on a block boundary, so every leaf is a full block but the last */
+static float sdot_pairwise(const float *x, const float *y, unsigned long n){
+
+  unsigned long half;
+
+  if (n <= REDUCE_BLOCK) return sdot_kway(x, y, n);
+  half = (n / REDUCE_BLOCK + 1) / 2 * REDUCE_BLOCK;
+
+  return sdot_pairwise(x, y, half) + sdot_pairwise(x + half, y + half, n - half);
+}
+
+static float sdot_kahan(const float *x, const float *y, unsigned long n){
+
+  float sum = 0.0f, c = 0.0f, p, t;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) {
+    p = x[i] * y[i];
+    t = sum + p;
+    if (fabsf(sum) >= fabsf(p)) c = c + ((sum - t) + p);
+    else c = c + ((p - t) + sum);
+    sum = t;
+  }
+
+  return sum + c;
+}
+
+static float sdot_double(const float *x, const float *y, unsigned long n){
+
+  double sum = 0.0;
+  unsigned long i;
+
+  /* the product of two floats is exact in double */
+  for (i = 0; i < n; i++) sum = sum + (double) x[i] * y[i];
+
+  return (float) sum;
+}
+
+static double ddot_naive(const double *x, const double *y, unsigned long n){
+
+  double sum = 0.0;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) sum = sum + x[i] * y[i];
+
+  return sum;
+}
+
+static double ddot_kway(const double *x, const double *y, unsigned long n){
+
+  double s[REDUCE_WAYS] = { 0.0 };
+  unsigned long i = 0;
+  int k;
+
+  for (; i + REDUCE_WAYS <= n; i += REDUCE_WAYS)
+    for (k = 0; k < REDUCE_WAYS; k++) s[k] = s[k] + x[i + k] * y[i + k];
+  for (k = 0; i < n; i++, k++) s[k] = s[k] + x[i] * y[i];
+
+  for (k = REDUCE_WAYS / 2; k > 0; k /= 2)
+    for (i = 0; i < (unsigned long)k; i++) s[i] = s[i] + s[i + k];
+
+  return s[0];
+}
+
+static double ddot_pairwise(const double *x, const double *y, unsigned long n){
+
+  unsigned long half;
+
+  if (n <= REDUCE_BLOCK) return ddot_kway(x, y, n);
+  half = (n / REDUCE_BLOCK + 1) / 2 * REDUCE_BLOCK;
+
+  return ddot_pairwise(x, y, half) + ddot_pairwise(x + half, y + half, n - half);
+}
+
+static double ddot_kahan(const double *x, const double *y, unsigned long n){
+
+  double sum = 0.0, c = 0.0, p, t;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) {
+    p = x[i] * y[i];
+    t = sum + p;
+    if (fabs(sum) >= fabs(p)) c = c + ((sum - t) + p);
+    else c = c + ((p - t) + sum);
+    sum = t;
+  }
+
+  return sum + c;
+}
+
+/* Float dot product of x and y with the given algorithm */
+double reduce_sdot(int algo, const float *x, const float *y, unsigned long n){
+
+  switch (algo) {
+  case REDUCE_NAIVE: return sdot_naive(x, y, n);
+  case REDUCE_KWAY: return sdot_kway(x, y, n);
+  case REDUCE_PAIRWISE: return sdot_pairwise(x, y, n);
+  case REDUCE_KAHAN: return sdot_kahan(x, y, n);
+  case REDUCE_DOUBLE: return sdot_double(x, y, n);
+  default: return simd->sdot(x, y, n);
+  }
+}
+
+/* Double dot product; there is no wider accumulation for double */
+double reduce_ddot(int algo, const double *x, const double *y, unsigned long n){
+
+  switch (algo) {
+  case REDUCE_NAIVE: return ddot_naive(x, y, n);
+  case REDUCE_KWAY: return ddot_kway(x, y, n);
+  case REDUCE_PAIRWISE: return ddot_pairwise(x, y, n);
+  case REDUCE_KAHAN: return ddot_kahan(x, y, n);
+  default: return simd->ddot(x, y, n);
+  }
+}
+
+
+/* Add the three sums of x to acc, with the instruction set in use */
+void reduce_snrm2_acc(const float *x, unsigned long n, snrm2_acc *acc){
+
+  float sum[3] = { 0.0f, 0.0f, 0.0f };
+
+  simd->snrm2(x, n, sum);
+  acc->big += sum[0];
+  acc->med += sum[1];
+  acc->sml += sum[2];
+}
+
+void reduce_dnrm2_acc(const double *x, unsigned long n, dnrm2_acc *acc){
+
+  double sum[3] = { 0.0, 0.0, 0.0 };
+
+  simd->dnrm2(x, n, sum);
+  acc->big += sum[0];
+  acc->med += sum[1];
+  acc->sml += sum[2];
+}
+
+/*
+ * Combine the three sums: big elements dominate any medium ones, and
+ * small ones only matter if there are no medium ones, or as a
+ * correction to them computed without forming the small sum unscaled.
+ */
+float reduce_snrm2_finish(const snrm2_acc *acc){
+
+  const float ssml = BLUE_SSML(FLT_MIN_EXP, FLT_MANT_DIG), sbig = BLUE_SBIG(FLT_MAX_EXP, FLT_MANT_DIG);
+  float big = acc->big, med = acc->med, sml = acc->sml, scl, sumsq, ymin, ymax;
+
+  if (big > 0.0f) {
+    if (med > 0.0f || isnan(med)) big += (med * sbig) * sbig;
+    scl = 1.0f / sbig;
+    sumsq = big;
+  } else if (sml > 0.0f) {
+    if (med > 0.0f || isnan(med)) {
+      med = sqrtf(med);
+      sml = sqrtf(sml) / ssml;
+      ymin = (sml > med) ? med : sml;
+      ymax = (sml > med) ? sml : med;
+      scl = 1.0f;
+      sumsq = ymax * ymax * (1.0f + (ymin / ymax) * (ymin / ymax));
+    } else {
+      scl = 1.0f / ssml;
+      sumsq = sml;
+    }
+  } else {
+    scl = 1.0f;
+    sumsq = med;
+  }
+
+  return scl * sqrtf(sumsq);
+}
+
+double reduce_dnrm2_finish(const dnrm2_acc *acc){
+
+  const double ssml = BLUE_SSML(DBL_MIN_EXP, DBL_MANT_DIG), sbig = BLUE_SBIG(DBL_MAX_EXP, DBL_MANT_DIG);
+  double big = acc->big, med = acc->med, sml = acc->sml, scl, sumsq, ymin, ymax;
+
+  if (big > 0.0) {
+    if (med > 0.0 || isnan(med)) big += (med * sbig) * sbig;
+    scl = 1.0 / sbig;
+    sumsq = big;
+  } else if (sml > 0.0) {
+    if (med > 0.0 || isnan(med)) {
+      med = sqrt(med);
+      sml = sqrt(sml) / ssml;
+      ymin = (sml > med) ? med : sml;
+      ymax = (sml > med) ? sml : med;
+      scl = 1.0;
+      sumsq = ymax * ymax * (1.0 + (ymin / ymax) * (ymin / ymax));
+    } else {
+      scl = 1.0 / ssml;
+      sumsq = sml;
+    }
+  } else {
+    scl = 1.0;
+    sumsq = med;
+  }
+
+  return scl * sqrt(sumsq);
+}
@@ -0,0 +1,64 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Reduction algorithms for the dot product (and, with x == y, the sum
+ * of squares of the norm), trading speed against accuracy:
+ *
+ *   naive     one accumulator in the data type, one add chain
+ *   kway      REDUCE_WAYS interleaved accumulators, combined pairwise
+ *   pairwise  REDUCE_BLOCK elements summed k-way, blocks summed pairwise
+ *   kahan     one accumulator with Neumaier's compensation term
+ *   double    float data accumulated in double, rounded at the end
+ *
+ * The error of the naive sum grows with n, of the pairwise sum with
+ * log n, and the compensated and double accumulated sums are close to
+ * one rounding of the exact result. The float versions return the
+ * float result, so their errors compare like for like.
+ */
+
+enum { REDUCE_SIMD, REDUCE_NAIVE, REDUCE_KWAY, REDUCE_PAIRWISE, REDUCE_KAHAN, REDUCE_DOUBLE };
+
+#define REDUCE_WAYS 8
+#define REDUCE_BLOCK 128
+
+double reduce_sdot(int algo, const float *x, const float *y, unsigned long n);
+double reduce_ddot(int algo, const double *x, const double *y, unsigned long n);
+
+
+/*
+ * Overflow and underflow safe Euclidean norm, Blue's algorithm as in
+ * LAPACK's nrm2 since 3.10, in one pass: each element's square goes
+ * into one of three sums by magnitude, big elements scaled down and
+ * small ones scaled up so that no square overflows or underflows, and
+ * nrm2_finish() combines the sums. The sums are taken with the
+ * instruction set in use (see simd.h), classifying whole vectors with
+ * compare masks. The sums of several parts of a vector can be added up
+ * before nrm2_finish().
+ */
+
+typedef struct { float big, med, sml; } snrm2_acc;
+typedef struct { double big, med, sml; } dnrm2_acc;
+
+void reduce_snrm2_acc(const float *x, unsigned long n, snrm2_acc *acc);
+void reduce_dnrm2_acc(const double *x, unsigned long n, dnrm2_acc *acc);
+float reduce_snrm2_finish(const snrm2_acc *acc);
+double reduce_dnrm2_finish(const dnrm2_acc *acc);
@@ -0,0 +1,499 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+/*
+ * Result reporting.
+ *
+ * Records are printed as the familiar ASCII box (text), as one JSON
+ * document with one record per line (json), or as CSV with a header
+ * row (csv). For the machine readable formats without --out, stdout
+ * is reserved for the records and all other output goes to stderr.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#include "utils.h"
+#include "report.h"
+#include "rng.h"
+#include "simd.h"
+#include "backend.h"
+
+#if defined(__clang__)
+#define COMPILER "clang " __clang_version__
+#elif defined(__GNUC__)
+#define COMPILER "gcc " __VERSION__
+#else
+#define COMPILER "unknown"
+#endif
+
+enum { FORMAT_TEXT, FORMAT_JSON, FORMAT_CSV };
+
+static int format = FORMAT_TEXT;
+static FILE *out = NULL;
+static int records = 0;
+
+/* Copies of the records since report_collect(), for report_summary() */
+static int collecting = 0;
+static bench_record *collected = NULL;
+static int ncollected = 0, maxcollected = 0;
+
+/* Host metadata, gathered once when the report is opened */
+static struct {
+  char hostname[256];
+  char os[256];
+  char cpu[256];
+  long cpus;
+  char timestamp[32];
+} host;
+
+
+static void host_info(void){
+
+  struct utsname u;
+  char line[512];
+  FILE *f;
+  time_t now = time(NULL);
+
+  if (gethostname(host.hostname, sizeof(host.hostname)) != 0) strcpy(host.hostname, "unknown");
+  host.hostname[sizeof(host.hostname)-1] = '\0';
+
+  if (uname(&u) == 0) snprintf(host.os, sizeof(host.os), "%s %s %s", u.sysname, u.release, u.machine);
+  else strcpy(host.os, "unknown");
+
+  strcpy(host.cpu, "unknown");
+  if ((f = fopen("/proc/cpuinfo", "r")) != NULL) {
+    while (fgets(line, sizeof(line), f)) {
+      char *colon = strchr(line, ':');
+      if (strncmp(line, "model name", 10) == 0 && colon != NULL) {
+        snprintf(host.cpu, sizeof(host.cpu), "%s", colon + 2);
+        host.cpu[strcspn(host.cpu, "\n")] = '\0';
+        break;
+      }
+    }
+    fclose(f);
+  }
+
+  host.cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  strftime(host.timestamp, sizeof(host.timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+}
+
+/* Write s as a JSON string, escaping quotes, backslashes and control characters */
+static void json_string(const char *s){
+
+  fputc('"', out);
+  for (; s && *s; s++) {
+    if (*s == '"' || *s == '\\') fprintf(out, "\\%c", *s);
+    else if ((unsigned char)*s < 0x20) fprintf(out, "\\u%04x", *s);
+    else fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+/* Write ", "key": v" with v in fmt, or null if v is not finite, as JSON has no inf or nan */
+static void json_field(const char *key, const char *fmt, double v){
+
+  fprintf(out, ", \"%s\": ", key);
+  if (isfinite(v)) fprintf(out, fmt, v);
+  else fputs("null", out);
+}
+
+/* Write s as a CSV field, quoted if it contains a separator or quote */
+static void csv_string(const char *s){
+
+  if (strpbrk(s, ",\"\n") == NULL) {
+    fputs(s, out);
+    return;
+  }
+  fputc('"', out);
+  for (; *s; s++) {
+    if (*s == '"') fputc('"', out);
+    fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+/*
+ * Select the output format ("text", "json" or "csv") and destination
+ * (NULL for stdout). Returns 0 on success.
+ */
+int report_open(const char *fmt, const char *path){
+
+  if (fmt == NULL || strcmp(fmt, "text") == 0) format = FORMAT_TEXT;
+  else if (strcmp(fmt, "json") == 0) format = FORMAT_JSON;
+  else if (strcmp(fmt, "csv") == 0) format = FORMAT_CSV;
+  else {
+    fprintf(stderr, "ERROR: unknown output format \"%s\", use text, json or csv...\n", fmt);
+    return 1;
+  }
+
+  if (path != NULL) {
+    if ((out = fopen(path, "w")) == NULL) {
+      fprintf(stderr, "ERROR: unable to open output file %s\n", path);
+      return 1;
+    }
+  } else if (format != FORMAT_TEXT) {
+    /* keep the real stdout for records, send everything else to stderr */
+    fflush(stdout);
+    out = fdopen(dup(fileno(stdout)), "w");
+    dup2(fileno(stderr), fileno(stdout));
+  } else {
+    out = stdout;
+  }
+
+  host_info();
+  records = 0;
+
+  if (format == FORMAT_JSON) {
+    fprintf(out, "{\"host\": {\"hostname\": ");
+    json_string(host.hostname);
+    fprintf(out, ", \"os\": ");
+    json_string(host.os);
+    fprintf(out, ", \"cpu\": ");
+    json_string(host.cpu);
+    fprintf(out, ", \"cpus\": %ld, \"compiler\": ", host.cpus);
+    json_string(COMPILER);
+    fprintf(out, ", \"timestamp\": ");
+    json_string(host.timestamp);
+    fprintf(out, ", \"seed\": %llu, \"isa\": \"%s\", \"backend\": \"%s\"},\n \"results\": [\n",
+            rng_get_seed(), simd_isa(), backend_name());
+  } else if (format == FORMAT_CSV) {
+    fprintf(out, "kernel,bench,op,dtype,size,reps,warmup,cache,threads,runtime,scaling,speedup,efficiency,min_s,median_s,mean_s,p95_s,max_s,"
+                 "stddev_s,ci95_s,overhead_s,flops,bytes,bytes_saved,gflops,gbytes_per_s,result,"
+                 "footprint,ai,roof_gflops,roof_frac,roof_bound,verify,verify_err,verify_tol,cpu_id,cpu_node,mem_policy,mem_pages,page_mode,huge_bytes,cycles,instructions,llc_misses,branch_misses,"
+                 "dtlb_misses,ipc,llc_misses_per_elem,branch_misses_per_elem,dtlb_misses_per_elem,"
+                 "seed,isa,backend,hostname,cpu,timestamp\n");
+  }
+
+  return 0;
+}
+
+/* Instructions per cycle, or -1 when either count is missing */
+static double ipc(bench_record *r){
+
+  if (r->counter[PERF_CYCLES] <= 0 || r->counter[PERF_INSTRUCTIONS] < 0) return -1.0;
+  return r->counter[PERF_INSTRUCTIONS] / r->counter[PERF_CYCLES];
+}
+
+/* Count of event e per element moved, or -1 when not counted */
+static double per_elem(bench_record *r, int e){
+
+  if (r->counter[e] < 0 || r->elements <= 0) return -1.0;
+  return r->counter[e] / r->elements;
+}
+
+static int counted(bench_record *r){
+
+  int e;
+
+  for (e = 0; e < PERF_NEVENTS; e++)
+    if (r->counter[e] >= 0) return 1;
+  return 0;
+}
+
+void report_record(bench_record *r){
+
+  time_stats *t = &r->t;
+
+  if (format == FORMAT_TEXT) {
+    fprintf(out, "\n--- %s\n", r->title);
+    fprintf(out, "--- Timings ------------------------------------------------------------------------\n");
+    fprintf(out, "|\n");
+    fprintf(out, "| Kernel %s   Size %lu   ", r->kernel, r->size);
+    fprintf(out, "Iterations %d   Warmup %lu   Cache %s   Threads %d (%s)\n", t->n, r->warmup, r->cache,
+            r->threads, r->runtime);
+    if (r->speedup >= 0)
+      fprintf(out, "| Scaling: %s   Speedup %.3f   Efficiency %.3f\n", r->scaling, r->speedup, r->efficiency);
+    fprintf(out, "| Min %.9lf s   ", t->min);
+    fprintf(out, "Median %.9lf s   ", t->median);
+    fprintf(out, "Mean %.9lf s\n", t->mean);
+    fprintf(out, "| P95 %.9lf s   ", t->p95);
+    fprintf(out, "Max %.9lf s   ", t->max);
+    fprintf(out, "Stddev %.9lf s\n", t->stddev);
+    fprintf(out, "| 95%% CI of mean %.9lf - %.9lf s   ", t->mean - t->ci95, t->mean + t->ci95);
+    fprintf(out, "Mean overhead %.9lf s (removed)\n", t->overhead);
+    if (strcmp(r->verify, "off") != 0) {
+      fprintf(out, "| Verify: %s", r->verify);
+      if (strcmp(r->verify, "pass") == 0 || strcmp(r->verify, "FAIL") == 0)
+        fprintf(out, "   error %.3e   tolerance %.3e", r->verify_err, r->verify_tol);
+      fprintf(out, "\n");
+    }
+    fprintf(out, "| Placement: cpu %d (node %d)   policy %s   pages %s   %s pages, %.0f KiB huge\n",
+            r->cpu, r->cpu_node, r->mem_policy, r->mem_pages, r->page_mode, r->huge_bytes / 1024);
+    fprintf(out, "| %.3f GFLOP/s   ", r->gflops);
+    fprintf(out, "%.3f GB/s (at median time)\n", r->gbytes);
+    if (r->bytes_saved > 0)
+      fprintf(out, "| Fused: %.0f KiB per repetition saved, %.1f%% of the traffic of separate passes\n",
+              r->bytes_saved / 1024, 100.0 * r->bytes_saved / (r->bytes + r->bytes_saved));
+    if (r->roof_bound[0]) {
+      fprintf(out, "| Roofline: AI %.3f flop/byte   working set %.0f KiB   bound %s   ",
+              r->ai, r->footprint/1024, r->roof_bound);
+      if (r->roof_gflops > 0) fprintf(out, "roof %.3f GFLOP/s   ", r->roof_gflops);
+      fprintf(out, "achieved %.1f%%\n", 100.0 * r->roof_frac);
+    }
+    if (counted(r)) {
+      int e;
+      fprintf(out, "| Counters per repetition:");
+      for (e = 0; e < PERF_NEVENTS; e++) {
+        if (r->counter[e] >= 0) fprintf(out, "   %s %.4g", perf_event_names[e], r->counter[e]);
+        else fprintf(out, "   %s n/a", perf_event_names[e]);
+      }
+      fprintf(out, "\n| IPC ");
+      if (ipc(r) >= 0) fprintf(out, "%.2f", ipc(r));
+      else fprintf(out, "n/a");
+      fprintf(out, "   per element:");
+      for (e = PERF_LLC_MISSES; e < PERF_NEVENTS; e++) {
+        if (per_elem(r, e) >= 0) fprintf(out, "   %s %.4f", perf_event_names[e], per_elem(r, e));
+        else fprintf(out, "   %s n/a", perf_event_names[e]);
+      }
+      fprintf(out, "\n");
+    }
+    fprintf(out, "|\n");
+    fprintf(out, "------------------------------------------------------------------------------------\n");
+  } else if (format == FORMAT_JSON) {
+    fprintf(out, "%s  {\"kernel\": ", records ? ",\n" : "");
+    json_string(r->kernel);
+    fprintf(out, ", \"bench\": ");
+    json_string(r->bench);
+    fprintf(out, ", \"op\": ");
+    json_string(r->op);
+    fprintf(out, ", \"dtype\": ");
+    json_string(r->dtype);
+    fprintf(out, ", \"size\": %lu, \"reps\": %lu, \"warmup\": %lu, \"cache\": \"%s\"",
+            r->size, r->reps, r->warmup, r->cache);
+    fprintf(out, ", \"threads\": %d, \"runtime\": \"%s\", \"scaling\": \"%s\"", r->threads, r->runtime, r->scaling);
+    if (r->speedup >= 0) {
+      json_field("speedup", "%.6f", r->speedup);
+      json_field("efficiency", "%.6f", r->efficiency);
+    } else {
+      fprintf(out, ", \"speedup\": null, \"efficiency\": null");
+    }
+    json_field("min", "%.9e", t->min);
+    json_field("median", "%.9e", t->median);
+    json_field("mean", "%.9e", t->mean);
+    json_field("p95", "%.9e", t->p95);
+    json_field("max", "%.9e", t->max);
+    json_field("stddev", "%.9e", t->stddev);
+    json_field("ci95", "%.9e", t->ci95);
+    json_field("overhead", "%.9e", t->overhead);
+    json_field("flops", "%.6e", r->flops);
+    json_field("bytes", "%.6e", r->bytes);
+    json_field("bytes_saved", "%.6e", r->bytes_saved);
+    json_field("gflops", "%.6f", r->gflops);
+    json_field("gbytes_per_s", "%.6f", r->gbytes);
+    json_field("result", "%.9e", r->result);
+    json_field("footprint", "%.6e", r->footprint);
+    json_field("ai", "%.6f", r->ai);
+    json_field("roof_gflops", "%.6f", r->roof_gflops);
+    json_field("roof_frac", "%.6f", r->roof_frac);
+    fprintf(out, ", \"roof_bound\": ");
+    json_string(r->roof_bound);
+    fprintf(out, ", \"verify\": \"%s\"", r->verify);
+    json_field("verify_err", "%.6e", r->verify_err);
+    json_field("verify_tol", "%.6e", r->verify_tol);
+    fprintf(out, ", \"cpu_id\": %d, \"cpu_node\": %d, \"mem_policy\": ", r->cpu, r->cpu_node);
+    json_string(r->mem_policy);
+    fprintf(out, ", \"mem_pages\": ");
+    json_string(r->mem_pages);
+    fprintf(out, ", \"page_mode\": \"%s\", \"huge_bytes\": %.0f", r->page_mode, r->huge_bytes);
+    fprintf(out, ", \"counters\": ");
+    if (counted(r)) {
+      int e;
+      fprintf(out, "{");
+      for (e = 0; e < PERF_NEVENTS; e++) {
+        fprintf(out, "%s\"%s\": ", e ? ", " : "", perf_event_names[e]);
+        if (r->counter[e] >= 0) fprintf(out, "%.6e", r->counter[e]);
+        else fprintf(out, "null");
+      }
+      if (ipc(r) >= 0) json_field("ipc", "%.6f", ipc(r));
+      else fprintf(out, ", \"ipc\": null");
+      for (e = PERF_LLC_MISSES; e < PERF_NEVENTS; e++) {
+        fprintf(out, ", \"%s_per_elem\": ", perf_event_names[e]);
+        if (per_elem(r, e) >= 0) fprintf(out, "%.6e", per_elem(r, e));
+        else fprintf(out, "null");
+      }
+      fprintf(out, "}");
+    } else {
+      fprintf(out, "null");
+    }
+    fprintf(out, "}");
+  } else {
+    csv_string(r->kernel);
+    fprintf(out, ",%s,%s,%s,%lu,%lu,%lu,%s", r->bench, r->op, r->dtype, r->size, r->reps, r->warmup, r->cache);
+    fprintf(out, ",%d,%s,%s,", r->threads, r->runtime, r->scaling);
+    if (r->speedup >= 0) fprintf(out, "%.6f,%.6f", r->speedup, r->efficiency);
+    else fprintf(out, ",");
+    fprintf(out, ",%.9e,%.9e,%.9e,%.9e,%.9e,%.9e,%.9e,%.9e", t->min, t->median, t->mean, t->p95, t->max,
+            t->stddev, t->ci95, t->overhead);
+    fprintf(out, ",%.6e,%.6e,%.6e,%.6f,%.6f,%.9e", r->flops, r->bytes, r->bytes_saved, r->gflops, r->gbytes, r->result);
+    fprintf(out, ",%.6e,%.6f,%.6f,%.6f,%s", r->footprint, r->ai, r->roof_gflops, r->roof_frac, r->roof_bound);
+    fprintf(out, ",%s,%.6e,%.6e", r->verify, r->verify_err, r->verify_tol);
+    fprintf(out, ",%d,%d,%s,", r->cpu, r->cpu_node, r->mem_policy);
+    csv_string(r->mem_pages);
+    fprintf(out, ",%s,%.0f", r->page_mode, r->huge_bytes);
+    {
+      int e;
+      for (e = 0; e < PERF_NEVENTS; e++) {
+        if (r->counter[e] >= 0) fprintf(out, ",%.6e", r->counter[e]);
+        else fputc(',', out);
+      }
+      if (ipc(r) >= 0) fprintf(out, ",%.6f", ipc(r));
+      else fputc(',', out);
+      for (e = PERF_LLC_MISSES; e < PERF_NEVENTS; e++) {
+        if (per_elem(r, e) >= 0) fprintf(out, ",%.6e", per_elem(r, e));
+        else fputc(',', out);
+      }
+    }
+    fprintf(out, ",%llu,%s,%s,", rng_get_seed(), simd_isa(), backend_name());
+    csv_string(host.hostname);
+    fputc(',', out);
+    csv_string(host.cpu);
+    fprintf(out, ",%s\n", host.timestamp);
+  }
+
+  records++;
+  fflush(out);
+
+  if (collecting) {
+    if (ncollected == maxcollected) {
+      int max = maxcollected ? 2 * maxcollected : 64;
+      bench_record *c = realloc(collected, max * sizeof(bench_record));
+      if (c == NULL) return;
+      collected = c;
+      maxcollected = max;
+    }
+    collected[ncollected++] = *r;
+  }
+}
+
+/* Keep a copy of every record from now on, for report_summary() */
+void report_collect(int on){
+
+  collecting = on;
+}
+
+/* The records collected so far; returns their number */
+int report_records(bench_record **r){
+
+  *r = collected;
+  return ncollected;
+}
+
+/*
+ * Stream for human readable tables: the report itself for text output,
+ * otherwise stdout, which then goes to stderr unless --out was given.
+ */
+FILE *report_stream(void){
+
+  return (format == FORMAT_TEXT && out != NULL) ? out : stdout;
+}
+
+/*
+ * One line per record collected since report_collect(), in run order.
+ * Text output gets it at the end of the report; for the machine
+ * readable formats it goes with the rest of the human readable output.
+ */
+void report_summary(void){
+
+  FILE *f = report_stream();
+  int i;
+
+  if (ncollected == 0) return;
+
+  fprintf(f, "\n--- Summary: %d results\n", ncollected);
+  fprintf(f, "------------------------------------------------------------------------------------\n");
+  fprintf(f, "| %-28s %10s %4s %14s %7s %10s %10s %8s %10s\n",
+          "Kernel", "Size", "Thr", "Median s", "CI95 %", "GFLOP/s", "GB/s", "Verify", "Error");
+  for (i = 0; i < ncollected; i++) {
+    bench_record *r = &collected[i];
+    fprintf(f, "| %-28s %10lu %4d %14.9f ", r->kernel, r->size, r->threads, r->t.median);
+    if (r->t.mean > 0) fprintf(f, "%7.2f ", 100.0 * r->t.ci95 / r->t.mean);
+    else fprintf(f, "%7s ", "-");
+    fprintf(f, "%10.3f %10.3f %8s ", r->gflops, r->gbytes, r->verify);
+    if (strcmp(r->verify, "pass") == 0 || strcmp(r->verify, "FAIL") == 0) fprintf(f, "%10.2e\n", r->verify_err);
+    else fprintf(f, "%10s\n", "-");
+  }
+  fprintf(f, "------------------------------------------------------------------------------------\n");
+  fflush(f);
+}
+
+/*
+ * Summary of a size sweep of one kernel, one line per size. Machine
+ * readable formats already carry one record per size, so this is only
+ * written for text output.
+ */
+void report_sweep(bench_record *r, int n){
+
+  int i;
+
+  if (format != FORMAT_TEXT || n == 0) return;
+
+  fprintf(out, "\n--- Size sweep: %s\n", r[0].kernel);
+  fprintf(out, "------------------------------------------------------------------------------------\n");
+  fprintf(out, "| %12s %16s %16s %12s %12s\n", "Size", "Working set KiB", "Median s", "GFLOP/s", "GB/s");
+  for (i = 0; i < n; i++) {
+    fprintf(out, "| %12lu ", r[i].size);
+    if (r[i].footprint > 0) fprintf(out, "%16.1f ", r[i].footprint / 1024);
+    else fprintf(out, "%16s ", "-");
+    fprintf(out, "%16.9f %12.3f %12.3f\n", r[i].t.median, r[i].gflops, r[i].gbytes);
+  }
+  fprintf(out, "------------------------------------------------------------------------------------\n");
+  fflush(out);
+}
+
+/* Summary of a thread scaling run of one kernel, text output only */
+void report_scaling(bench_record *r, int n){
+
+  int i;
+
+  if (format != FORMAT_TEXT || n == 0) return;
+
+  fprintf(out, "\n--- %s scaling: %s\n", strcmp(r[0].scaling, "weak") == 0 ? "Weak" : "Strong", r[0].kernel);
+  fprintf(out, "------------------------------------------------------------------------------------\n");
+  fprintf(out, "| %8s %12s %16s %10s %12s %12s\n", "Threads", "Size", "Median s", "Speedup", "Efficiency", "GFLOP/s");
+  for (i = 0; i < n; i++) {
+    fprintf(out, "| %8d %12lu %16.9f ", r[i].threads, r[i].size, r[i].t.median);
+    if (r[i].speedup >= 0) fprintf(out, "%10.3f %12.3f ", r[i].speedup, r[i].efficiency);
+    else fprintf(out, "%10s %12s ", "-", "-");
+    fprintf(out, "%12.3f\n", r[i].gflops);
+  }
+  fprintf(out, "------------------------------------------------------------------------------------\n");
+  fflush(out);
+}
+
+void report_close(void){
+
+  if (out == NULL) return;
+
+  if (format == FORMAT_JSON) fprintf(out, "%s ]}\n", records ? "\n" : "");
+
+  if (out != stdout) fclose(out);
+  else fflush(out);
+  out = NULL;
+
+  free(collected);
+  collected = NULL;
+  ncollected = maxcollected = 0;
+}
@@ -0,0 +1,70 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/* One result record per kernel run */
+typedef struct {
+  char kernel[128];          /* registry name, bench/op/dtype */
+  const char *bench;
+  const char *op;
+  const char *dtype;
+  const char *title;
+  unsigned long size;
+  unsigned long reps;
+  unsigned long warmup;
+  const char *cache;         /* "warm" or "cold" */
+  int threads;               /* threads the kernel ran on */
+  const char *runtime;       /* threading runtime, "openmp" or "steal", or the backend ("cblas") */
+  const char *scaling;       /* "strong", "weak" or "none" */
+  double speedup;            /* over one thread, -1 outside a scaling run */
+  double efficiency;         /* speedup per thread, -1 outside a scaling run */
+  time_stats t;
+  double flops;              /* per repetition */
+  double bytes;              /* per repetition */
+  double bytes_saved;        /* per repetition, by fusing passes; 0 if not fused */
+  double gflops;             /* flops / median time */
+  double gbytes;             /* bytes / median time, effective bandwidth */
+  double result;
+  double footprint;          /* working set in bytes, 0 if unknown */
+  double ai;                 /* arithmetic intensity, flops per byte */
+  double roof_gflops;        /* attainable GFLOP/s under the roofline */
+  double roof_frac;          /* achieved fraction of the roof */
+  char roof_bound[16];       /* limiting roof, e.g. "L2", "DRAM", "compute"; empty if not computed */
+  double counter[PERF_NEVENTS]; /* mean hardware count per repetition, -1 if not counted */
+  double elements;           /* elements moved per repetition, bytes / size of dtype */
+  int cpu, cpu_node;         /* where the benchmark thread ran, -1 if unknown */
+  char mem_policy[24];       /* page placement policy */
+  char mem_pages[64];        /* share of the kernel's resident pages per node */
+  char verify[8];            /* "pass", "FAIL", "skipped", "n/a" or "off" */
+  double verify_err;         /* normalised error against the reference */
+  double verify_tol;         /* tolerance it was checked against */
+  char page_mode[8];         /* "4k", "thp" or "huge" */
+  double huge_bytes;         /* bytes backed by huge pages */
+} bench_record;
+
+int report_open(const char *, const char *);
+void report_record(bench_record *);
+void report_sweep(bench_record *, int);
+void report_scaling(bench_record *, int);
+void report_collect(int);
+void report_summary(void);
+int report_records(bench_record **);
+FILE *report_stream(void);
+void report_close(void);
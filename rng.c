@@ -0,0 +1,244 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+ * 1, 2, 3", SC11). The counter is (block index, stream, 0) and the key
+ * is the seed; each block gives four 32-bit values. Doubles take 53
+ * bits of two values and floats are those doubles rounded; bounded
+ * integers and characters scale one value by a 32x32 multiply rather
+ * than rejecting any.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "pool.h"
+#include "rng.h"
+#include "half.h"
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+/* Fills at least this long are split over the setup thread pool */
+#define RNG_PAR_MIN (64*1024)
+
+static unsigned long long seed = RNG_DEFAULT_SEED;
+
+void rng_seed(unsigned long long s){ seed = s; }
+unsigned long long rng_get_seed(void){ return seed; }
+
+static void rng_block(unsigned int stream, unsigned long long block, uint32_t out[4]){
+
+  uint32_t c0 = (uint32_t)block, c1 = (uint32_t)(block >> 32), c2 = stream, c3 = 0;
+  uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+  uint64_t p0, p1;
+  int r;
+
+  for (r = 0; r < 10; r++) {
+    p0 = (uint64_t)PHILOX_M0 * c0;
+    p1 = (uint64_t)PHILOX_M1 * c2;
+    c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+    c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+    c1 = (uint32_t)p1;
+    c3 = (uint32_t)p0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+/* Value i of a stream */
+unsigned int rng_u32(unsigned int stream, unsigned long long i){
+
+  uint32_t r[4];
+
+  rng_block(stream, i >> 2, r);
+  return r[i & 3];
+}
+
+static void fill_double(double *v, size_t n, double lo, double hi, unsigned int stream, unsigned long long first);
+
+/* Value i of a stream as a double in [0, 1) */
+double rng_uniform(unsigned int stream, unsigned long long i){
+
+  double v;
+
+  fill_double(&v, 1, 0.0, 1.0, stream, i);
+  return v;
+}
+
+/* The double values of the stream, rounded, so both precisions see the same data */
+static void fill_float(float *v, size_t n, float lo, float hi, unsigned int stream, unsigned long long first){
+
+  uint32_t r[4];
+  double scale = ((double)hi - lo) * (1.0 / 9007199254740992.0);
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    unsigned long long e = first + i;
+    const uint32_t *h = &r[2 * (e & 1)];
+    if (i == 0 || (e & 1) == 0) rng_block(stream, e >> 1, r);
+    v[i] = (float)(lo + (double)(((uint64_t)(h[0] >> 5) << 26) | (h[1] >> 6)) * scale);
+  }
+}
+
+static void fill_double(double *v, size_t n, double lo, double hi, unsigned int stream, unsigned long long first){
+
+  uint32_t r[4];
+  double scale = (hi - lo) * (1.0 / 9007199254740992.0);
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    unsigned long long e = first + i;
+    const uint32_t *h = &r[2 * (e & 1)];
+    if (i == 0 || (e & 1) == 0) rng_block(stream, e >> 1, r);
+    v[i] = lo + (double)(((uint64_t)(h[0] >> 5) << 26) | (h[1] >> 6)) * scale;
+  }
+}
+
+/* Integers in [lo, hi), stored in width bytes */
+static void fill_int(void *v, int width, size_t n, int lo, int hi, unsigned int stream, unsigned long long first){
+
+  uint32_t r[4];
+  uint64_t range = (uint64_t)((int64_t)hi - lo);
+  size_t i;
+  int x;
+
+  for (i = 0; i < n; i++) {
+    unsigned long long e = first + i;
+    if (i == 0 || (e & 3) == 0) rng_block(stream, e >> 2, r);
+    x = lo + (int)((r[e & 3] * range) >> 32);
+    if (width == 2) ((int16_t *)v)[i] = (int16_t)x;
+    else if (width == 8) ((int64_t *)v)[i] = x;
+    else ((int *)v)[i] = x;
+  }
+}
+
+/* The float values of the stream, rounded again to fp16 or bf16 */
+static void fill_16(uint16_t *v, size_t n, float lo, float hi, unsigned int stream, unsigned long long first, int bf16){
+
+  float buf[256];
+  size_t i, j, len;
+
+  for (i = 0; i < n; i += len) {
+    len = (n - i < 256) ? n - i : 256;
+    fill_float(buf, len, lo, hi, stream, first + i);
+    for (j = 0; j < len; j++) v[i + j] = bf16 ? bf16_from_float(buf[j]) : half_from_float(buf[j]);
+  }
+}
+
+/*
+ * The public fills split long buffers over the thread pool; since
+ * every element depends only on its index, the values do not depend
+ * on the number of threads.
+ */
+enum { FILL_FLOAT, FILL_DOUBLE, FILL_INT, FILL_HALF, FILL_BF16, FILL_INT16, FILL_INT64 };
+
+typedef struct {
+  void *v;
+  int type;
+  double lo, hi;
+  unsigned int stream;
+  unsigned long long first;
+} fill_job;
+
+static void fill_range(void *p, unsigned long begin, unsigned long end){
+
+  fill_job *j = p;
+
+  switch (j->type) {
+  case FILL_FLOAT:
+    fill_float((float *)j->v + begin, end - begin, j->lo, j->hi, j->stream, j->first + begin);
+    break;
+  case FILL_DOUBLE:
+    fill_double((double *)j->v + begin, end - begin, j->lo, j->hi, j->stream, j->first + begin);
+    break;
+  case FILL_HALF:
+  case FILL_BF16:
+    fill_16((uint16_t *)j->v + begin, end - begin, j->lo, j->hi, j->stream, j->first + begin, j->type == FILL_BF16);
+    break;
+  case FILL_INT16:
+    fill_int((int16_t *)j->v + begin, 2, end - begin, (int)j->lo, (int)j->hi, j->stream, j->first + begin);
+    break;
+  case FILL_INT64:
+    fill_int((int64_t *)j->v + begin, 8, end - begin, (int)j->lo, (int)j->hi, j->stream, j->first + begin);
+    break;
+  default:
+    fill_int((int *)j->v + begin, sizeof(int), end - begin, (int)j->lo, (int)j->hi, j->stream, j->first + begin);
+  }
+}
+
+static void fill(void *v, int type, size_t n, double lo, double hi, unsigned int stream, unsigned long long first){
+
+  fill_job j = { v, type, lo, hi, stream, first };
+
+  if (n >= RNG_PAR_MIN) pool_for(n, fill_range, &j);
+  else fill_range(&j, 0, n);
+}
+
+void rng_float(float *v, size_t n, float lo, float hi, unsigned int stream, unsigned long long first){
+  fill(v, FILL_FLOAT, n, lo, hi, stream, first);
+}
+
+void rng_double(double *v, size_t n, double lo, double hi, unsigned int stream, unsigned long long first){
+  fill(v, FILL_DOUBLE, n, lo, hi, stream, first);
+}
+
+void rng_int(int *v, size_t n, int lo, int hi, unsigned int stream, unsigned long long first){
+  fill(v, FILL_INT, n, lo, hi, stream, first);
+}
+
+void rng_int16(int16_t *v, size_t n, int lo, int hi, unsigned int stream, unsigned long long first){
+  fill(v, FILL_INT16, n, lo, hi, stream, first);
+}
+
+void rng_int64(int64_t *v, size_t n, int lo, int hi, unsigned int stream, unsigned long long first){
+  fill(v, FILL_INT64, n, lo, hi, stream, first);
+}
+
+void rng_half(uint16_t *v, size_t n, float lo, float hi, unsigned int stream, unsigned long long first){
+  fill(v, FILL_HALF, n, lo, hi, stream, first);
+}
+
+void rng_bf16(uint16_t *v, size_t n, float lo, float hi, unsigned int stream, unsigned long long first){
+  fill(v, FILL_BF16, n, lo, hi, stream, first);
+}
+
+/* Characters from [0-9A-Za-z] */
+void rng_alnum(char *v, size_t n, unsigned int stream, unsigned long long first){
+
+  static const char alnum[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+  uint32_t r[4];
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    unsigned long long e = first + i;
+    if (i == 0 || (e & 3) == 0) rng_block(stream, e >> 2, r);
+    v[i] = alnum[((uint64_t)r[e & 3] * 62) >> 32];
+  }
+}
@@ -0,0 +1,56 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Counter-based random numbers.
+ *
+ * Every value is a pure function of (seed, stream, index): element i
+ * of a stream is computed from a Philox4x32-10 block keyed by the seed,
+ * without any generator state. A buffer can therefore be filled in
+ * bulk, in any order, or split into ranges filled by different threads,
+ * and the result depends only on --seed. The fill functions write
+ * elements first .. first+n-1 of the stream into v[0] .. v[n-1].
+ *
+ * Kernels take their inputs from the named streams below, so the float
+ * and double variants of a kernel see the same values, up to rounding.
+ * The fp16 and bf16 fills (see half.h) round the float values; the
+ * int16 and int64 fills store the values of rng_int() in those widths.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RNG_DEFAULT_SEED 12345ULL
+
+enum { RNG_X = 1, RNG_Y, RNG_A, RNG_SCALAR, RNG_TEXT, RNG_PHRASE, RNG_B };
+
+void rng_seed(unsigned long long seed);
+unsigned long long rng_get_seed(void);
+unsigned int rng_u32(unsigned int stream, unsigned long long i);
+double rng_uniform(unsigned int stream, unsigned long long i);
+void rng_float(float *v, size_t n, float lo, float hi, unsigned int stream, unsigned long long first);
+void rng_double(double *v, size_t n, double lo, double hi, unsigned int stream, unsigned long long first);
+void rng_int(int *v, size_t n, int lo, int hi, unsigned int stream, unsigned long long first);
+void rng_int16(int16_t *v, size_t n, int lo, int hi, unsigned int stream, unsigned long long first);
+void rng_int64(int64_t *v, size_t n, int lo, int hi, unsigned int stream, unsigned long long first);
+void rng_half(uint16_t *v, size_t n, float lo, float hi, unsigned int stream, unsigned long long first);
+void rng_bf16(uint16_t *v, size_t n, float lo, float hi, unsigned int stream, unsigned long long first);
+void rng_alnum(char *v, size_t n, unsigned int stream, unsigned long long first);
@@ -0,0 +1,335 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+/*
+ * Roofline model.
+ *
+ * The machine is calibrated once per process with the kernels of the
+ * selected instruction set (see simd.h): AXPY and dot product streams
+ * measure the bandwidth of each cache level and of main memory, and
+ * the GEMM micro-kernel, on packed panels that stay in L1, measures
+ * the peak multiply-add rate the kernels can reach. Both are measured
+ * again if the instruction set changes. Each kernel run is then
+ * placed on the roofline using its arithmetic intensity (flops/bytes)
+ * and the level its working set fits in.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "utils.h"
+#include "report.h"
+#include "roofline.h"
+#include "simd.h"
+
+/* Depth of the packed panels in the peak probe, and micro-kernel calls between clock reads */
+#define PEAK_KC 128
+#define PEAK_CALLS 1000
+
+/* Elements the bandwidth probe streams between clock reads */
+#define STREAM_ELEMS (1UL << 20)
+
+/* Minimum time per probe measurement and number of measurements */
+#define PROBE_MIN_TIME 0.02
+#define PROBE_TRIALS 5
+
+/* Main memory probe: 4x the last level cache, within these bounds */
+#define DRAM_MIN_BYTES (64.0*1024*1024)
+#define DRAM_MAX_BYTES (1024.0*1024*1024)
+
+static roof_machine machine;
+static int calibrated = 0;
+
+/* volatile sink so the probes cannot be optimised away */
+static volatile double sink;
+
+
+static double seconds(struct timespec *t1, struct timespec *t2){
+
+  struct timespec d;
+
+  sub_time_hr(&d, t1, t2);
+  return d.tv_sec + (double)d.tv_nsec/1000000000;
+}
+
+/*
+ * Best bandwidth in GB/s over a working set of ws bytes, streamed by
+ * the selected instruction set's kernels: AXPY (two reads and a write
+ * per element, as the STREAM triad) and a dot product (two reads), so
+ * the roof holds both for kernels that write and for reductions.
+ */
+static double bandwidth_probe(double ws){
+
+  size_t n = (size_t)(ws / (3 * sizeof(double)));
+  double *x, *y;
+  double best = 0.0, t;
+  struct timespec t1, t2;
+  size_t i, calls;
+  int trial, dot;
+
+  if (n < 64) n = 64;
+  calls = (n < STREAM_ELEMS) ? STREAM_ELEMS / n : 1;
+  /* aligned as the kernels' buffers, so vector accesses do not split cache lines */
+  if (posix_memalign((void **)&x, 64, n * sizeof(double)) != 0) x = NULL;
+  if (posix_memalign((void **)&y, 64, n * sizeof(double)) != 0) y = NULL;
+  if (!x || !y) {
+    free(x);
+    free(y);
+    return 0.0;
+  }
+
+  for (i = 0; i < n; i++) {
+    x[i] = 1.0;
+    y[i] = 0.0;
+  }
+
+  for (dot = 0; dot < 2; dot++) {
+    for (trial = 0; trial < PROBE_TRIALS; trial++) {
+      long reps = 0;
+
+      clock_gettime(CLOCK, &t1);
+      do {
+        for (i = 0; i < calls; i++) {
+          if (dot) sink += simd->ddot(x, y, n);
+          else simd->daxpy(1e-3, x, y, n);
+        }
+        reps += calls;
+        clock_gettime(CLOCK, &t2);
+        t = seconds(&t1, &t2);
+      } while (t < PROBE_MIN_TIME);
+
+      t = (dot ? 2.0 : 3.0) * n * sizeof(double) * reps / t / 1e9;
+      if (t > best) best = t;
+    }
+  }
+
+  sink += y[n/2];
+  free(x);
+  free(y);
+
+  return best;
+}
+
+/*
+ * Peak multiply-add rate in GFLOP/s of the selected instruction set,
+ * double precision if dp is set: the GEMM micro-kernel updates one
+ * tile of C again and again from panels of PEAK_KC columns of A and
+ * rows of B.
+ */
+static double peak_probe(int dp){
+
+  int mr = dp ? simd->dgemm_mr : simd->sgemm_mr, nr = dp ? simd->dgemm_nr : simd->sgemm_nr;
+  size_t elem = dp ? sizeof(double) : sizeof(float);
+  void *a = malloc(mr * PEAK_KC * elem), *b = malloc(PEAK_KC * nr * elem), *c = calloc(mr * nr, elem);
+  double best = 0.0, t;
+  struct timespec t1, t2;
+  long calls;
+  int i, trial;
+
+  if (!a || !b || !c) {
+    free(a);
+    free(b);
+    free(c);
+    return 0.0;
+  }
+
+  /* small values, so C stays finite and normal however long the probe runs */
+  for (i = 0; i < mr * PEAK_KC; i++) {
+    if (dp) ((double *)a)[i] = 1e-6;
+    else ((float *)a)[i] = 1e-6f;
+  }
+  for (i = 0; i < PEAK_KC * nr; i++) {
+    if (dp) ((double *)b)[i] = 1.0;
+    else ((float *)b)[i] = 1.0f;
+  }
+
+  for (trial = 0; trial < PROBE_TRIALS; trial++) {
+    calls = 0;
+    clock_gettime(CLOCK, &t1);
+    do {
+      for (i = 0; i < PEAK_CALLS; i++) {
+        if (dp) simd->dgemm(PEAK_KC, a, b, c, nr);
+        else simd->sgemm(PEAK_KC, a, b, c, nr);
+      }
+      calls += PEAK_CALLS;
+      clock_gettime(CLOCK, &t2);
+      t = seconds(&t1, &t2);
+    } while (t < PROBE_MIN_TIME);
+
+    t = 2.0 * mr * nr * PEAK_KC * calls / t / 1e9;
+    if (t > best) best = t;
+  }
+
+  sink += dp ? ((double *)c)[0] : ((float *)c)[0];
+  free(a);
+  free(b);
+  free(c);
+
+  return best;
+}
+
+/* Working set of each level's bandwidth probe */
+static double probe_ws[ROOF_MAX_LEVELS];
+
+/* The bandwidths and peaks for the instruction set now selected */
+static void calibrate_isa(void){
+
+  int i;
+
+  machine.isa = simd_isa();
+  for (i = 0; i < machine.nlevels; i++) {
+    roof_level *l = &machine.level[i];
+    l->gbytes = bandwidth_probe(probe_ws[i]);
+    /* a cache level streams fastest well inside its capacity */
+    if (l->capacity > 0) l->gbytes = fmax(l->gbytes, bandwidth_probe(0.5 * probe_ws[i]));
+  }
+  /* a working set that fits a level fits the ones beyond it too */
+  for (i = machine.nlevels - 2; i >= 0; i--)
+    machine.level[i].gbytes = fmax(machine.level[i].gbytes, machine.level[i+1].gbytes);
+  machine.peak_dp = peak_probe(1);
+  machine.peak_sp = peak_probe(0);
+}
+
+static void print_calibration(void){
+
+  int i;
+
+  fprintf(stderr, "\n--- Roofline calibration (%s)\n", machine.isa);
+  fprintf(stderr, "------------------------------------------------------------------------------------\n");
+  fprintf(stderr, "|\n");
+  for (i = 0; i < machine.nlevels; i++) {
+    roof_level *l = &machine.level[i];
+    if (l->capacity > 0) fprintf(stderr, "| %-5s %10.0f KiB   stream %9.2f GB/s\n", l->name, l->capacity/1024, l->gbytes);
+    else fprintf(stderr, "| %-5s %14s   stream %9.2f GB/s\n", l->name, "", l->gbytes);
+  }
+  fprintf(stderr, "| Peak %9.2f GFLOP/s single   %9.2f GFLOP/s double   (%s GEMM micro-kernel)\n",
+          machine.peak_sp, machine.peak_dp, machine.isa);
+  fprintf(stderr, "|\n");
+  fprintf(stderr, "------------------------------------------------------------------------------------\n");
+}
+
+/*
+ * Measure the machine once and print the calibration table. Each
+ * cache level is probed with working sets of a quarter and half its
+ * capacity, main memory with four times the last level cache.
+ */
+roof_machine *roofline_calibrate(void){
+
+  double sizes[ROOF_MAX_LEVELS-1];
+  double dram;
+  int i, n;
+
+  if (calibrated) {
+    if (strcmp(machine.isa, simd_isa()) != 0) {
+      calibrate_isa();
+      print_calibration();
+    }
+    return &machine;
+  }
+
+  memset(sizes, 0, sizeof(sizes));
+  n = cache_sizes(sizes, ROOF_MAX_LEVELS-1);
+
+  machine.nlevels = 0;
+  for (i = 0; i < n; i++) {
+    roof_level *l = &machine.level[machine.nlevels];
+    if (sizes[i] == 0) continue;
+    snprintf(l->name, sizeof(l->name), "L%d", i+1);
+    l->capacity = sizes[i];
+    probe_ws[machine.nlevels++] = 0.5 * sizes[i];
+  }
+
+  dram = (n > 0) ? 4.0 * sizes[n-1] : DRAM_MIN_BYTES;
+  if (dram < DRAM_MIN_BYTES) dram = DRAM_MIN_BYTES;
+  if (dram > DRAM_MAX_BYTES) dram = DRAM_MAX_BYTES;
+  strcpy(machine.level[machine.nlevels].name, "DRAM");
+  machine.level[machine.nlevels].capacity = 0;
+  probe_ws[machine.nlevels++] = dram;
+
+  calibrate_isa();
+  calibrated = 1;
+  print_calibration();
+
+  return &machine;
+}
+
+/*
+ * Place a result on the roofline: pick the bandwidth of the smallest
+ * level that holds the kernel's working set, take the attainable rate
+ * as min(peak, AI * bandwidth) and the achieved fraction of it. The
+ * peaks are floating-point multiply-add rates, so integer kernels are
+ * placed against bandwidth alone. The probes run on one thread, so runs
+ * on more threads get no roof.
+ */
+void roofline_apply(bench_record *r){
+
+  static int warned = 0;
+  roof_machine *m;
+  roof_level *l;
+  double peak, bw;
+  int i, fp;
+
+  r->ai = (r->bytes > 0) ? r->flops / r->bytes : 0.0;
+  if (r->threads > 1) {
+    if (!warned) fprintf(stderr, "NOTE: the roofline is calibrated on one thread, no roof for runs on more threads\n");
+    warned = 1;
+    return;
+  }
+
+  m = roofline_calibrate();
+  l = &m->level[m->nlevels-1];
+  peak = (strcmp(r->dtype, "double") == 0) ? m->peak_dp : m->peak_sp;
+  fp = strcmp(r->dtype, "double") == 0 || strcmp(r->dtype, "float") == 0 ||
+       strcmp(r->dtype, "fp16") == 0 || strcmp(r->dtype, "bf16") == 0;
+
+  if (r->footprint > 0) {
+    for (i = 0; i < m->nlevels; i++) {
+      if (m->level[i].capacity == 0 || r->footprint <= m->level[i].capacity) {
+        l = &m->level[i];
+        break;
+      }
+    }
+  }
+
+  bw = l->gbytes;
+
+  if (r->flops == 0 || !fp) {
+    /* pure data movement (e.g. fileparse) or integer arithmetic, which
+       no floating-point peak bounds: bandwidth is the only roof */
+    r->roof_gflops = 0.0;
+    r->roof_frac = (bw > 0) ? r->gbytes / bw : 0.0;
+    snprintf(r->roof_bound, sizeof(r->roof_bound), "%s", l->name);
+  } else if (r->ai * bw < peak) {
+    r->roof_gflops = r->ai * bw;
+    r->roof_frac = r->gflops / r->roof_gflops;
+    snprintf(r->roof_bound, sizeof(r->roof_bound), "%s", l->name);
+  } else {
+    r->roof_gflops = peak;
+    r->roof_frac = r->gflops / peak;
+    snprintf(r->roof_bound, sizeof(r->roof_bound), "compute");
+  }
+
+  if (r->roof_frac > 1.0)
+    fprintf(stderr, "WARNING: %s reached %.0f%% of its %s roof, the calibration underestimates the machine\n",
+            r->kernel, 100.0 * r->roof_frac, r->roof_bound);
+}
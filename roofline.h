@@ -0,0 +1,41 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+#define ROOF_MAX_LEVELS 5
+
+/* One level of the memory hierarchy and its measured bandwidth */
+typedef struct {
+  char name[8];              /* "L1", "L2", "L3" or "DRAM" */
+  double capacity;           /* bytes; 0 for DRAM */
+  double gbytes;             /* measured GB/s */
+} roof_level;
+
+/* Calibrated machine balance */
+typedef struct {
+  int nlevels;
+  roof_level level[ROOF_MAX_LEVELS];
+  double peak_sp;            /* single precision GFLOP/s */
+  double peak_dp;            /* double precision GFLOP/s */
+  const char *isa;           /* instruction set the peaks were measured with */
+} roof_machine;
+
+roof_machine *roofline_calibrate(void);
+void roofline_apply(bench_record *);
@@ -0,0 +1,1477 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+#include "simd.h"
+#include "half.h"
+
+
+/*
+ * Scalar C loops, as the kernels were written originally; what the
+ * compiler makes of them depends on the flags in platform_inc.
+ */
+
+static double scalar_sdot(const float *x, const float *y, unsigned long n){
+
+  float result = 0.0;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) result = result + x[i] * y[i];
+
+  return result;
+}
+
+static double scalar_ddot(const double *x, const double *y, unsigned long n){
+
+  double result = 0.0;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) result = result + x[i] * y[i];
+
+  return result;
+}
+
+static void scalar_saxpy(float a, const float *x, float *y, unsigned long n){
+
+  unsigned long i;
+
+  for (i = 0; i < n; i++) y[i] = a * x[i] + y[i];
+}
+
+static void scalar_daxpy(double a, const double *x, double *y, unsigned long n){
+
+  unsigned long i;
+
+  for (i = 0; i < n; i++) y[i] = a * x[i] + y[i];
+}
+
+static void scalar_sscal(float a, float *x, unsigned long n){
+
+  unsigned long i;
+
+  for (i = 0; i < n; i++) x[i] = a * x[i];
+}
+
+static void scalar_dscal(double a, double *x, unsigned long n){
+
+  unsigned long i;
+
+  for (i = 0; i < n; i++) x[i] = a * x[i];
+}
+
+static double scalar_ssumsq(const float *x, unsigned long n){
+
+  float sum = 0.0;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) sum = sum + x[i] * x[i];
+
+  return sum;
+}
+
+static double scalar_dsumsq(const double *x, unsigned long n){
+
+  double sum = 0.0;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) sum = sum + x[i] * x[i];
+
+  return sum;
+}
+
+/* Blue's three sums; NaN fails both tests and propagates through the medium sum */
+static void scalar_snrm2(const float *x, unsigned long n, float sum[3]){
+
+  const float tsml = BLUE_TSML(FLT_MIN_EXP), tbig = BLUE_TBIG(FLT_MAX_EXP, FLT_MANT_DIG);
+  const float ssml = BLUE_SSML(FLT_MIN_EXP, FLT_MANT_DIG), sbig = BLUE_SBIG(FLT_MAX_EXP, FLT_MANT_DIG);
+  float ax;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) {
+    ax = fabsf(x[i]);
+    if (ax > tbig) sum[0] += (ax * sbig) * (ax * sbig);
+    else if (ax < tsml) sum[2] += (ax * ssml) * (ax * ssml);
+    else sum[1] += ax * ax;
+  }
+}
+
+static void scalar_dnrm2(const double *x, unsigned long n, double sum[3]){
+
+  const double tsml = BLUE_TSML(DBL_MIN_EXP), tbig = BLUE_TBIG(DBL_MAX_EXP, DBL_MANT_DIG);
+  const double ssml = BLUE_SSML(DBL_MIN_EXP, DBL_MANT_DIG), sbig = BLUE_SBIG(DBL_MAX_EXP, DBL_MANT_DIG);
+  double ax;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) {
+    ax = fabs(x[i]);
+    if (ax > tbig) sum[0] += (ax * sbig) * (ax * sbig);
+    else if (ax < tsml) sum[2] += (ax * ssml) * (ax * ssml);
+    else sum[1] += ax * ax;
+  }
+}
+
+/* 4 x 4 tiles, accumulated in a local array */
+static void scalar_sgemm(unsigned long kc, const float *a, const float *b, float *c, unsigned long ldc){
+
+  float t[4][4] = { { 0.0f } };
+  unsigned long p;
+  int i, j;
+
+  for (p = 0; p < kc; p++)
+    for (i = 0; i < 4; i++)
+      for (j = 0; j < 4; j++) t[i][j] += a[p * 4 + i] * b[p * 4 + j];
+
+  for (i = 0; i < 4; i++)
+    for (j = 0; j < 4; j++) c[i * ldc + j] += t[i][j];
+}
+
+static void scalar_dgemm(unsigned long kc, const double *a, const double *b, double *c, unsigned long ldc){
+
+  double t[4][4] = { { 0.0 } };
+  unsigned long p;
+  int i, j;
+
+  for (p = 0; p < kc; p++)
+    for (i = 0; i < 4; i++)
+      for (j = 0; j < 4; j++) t[i][j] += a[p * 4 + i] * b[p * 4 + j];
+
+  for (i = 0; i < 4; i++)
+    for (j = 0; j < 4; j++) c[i * ldc + j] += t[i][j];
+}
+
+/* fp16 and bf16 to and from float, by the portable conversions of half.c */
+static void scalar_h2s(const uint16_t *h, float *x, unsigned long n){
+
+  unsigned long i;
+
+  for (i = 0; i < n; i++) x[i] = half_to_float(h[i]);
+}
+
+static void scalar_s2h(const float *x, uint16_t *h, unsigned long n){
+
+  unsigned long i;
+
+  for (i = 0; i < n; i++) h[i] = half_from_float(x[i]);
+}
+
+static void scalar_b2s(const uint16_t *h, float *x, unsigned long n){
+
+  unsigned long i;
+
+  for (i = 0; i < n; i++) x[i] = bf16_to_float(h[i]);
+}
+
+static void scalar_s2b(const float *x, uint16_t *h, unsigned long n){
+
+  unsigned long i;
+
+  for (i = 0; i < n; i++) h[i] = bf16_from_float(x[i]);
+}
+
+/* Integer kernels: products and sums widened, int16 results saturated */
+static int16_t sat16(int v){ return (int16_t)(v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v); }
+
+static long long scalar_i16dot(const int16_t *x, const int16_t *y, unsigned long n){
+
+  long long result = 0;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) result = result + x[i] * y[i];
+
+  return result;
+}
+
+static void scalar_i16axpy(int a, const int16_t *x, int16_t *y, unsigned long n){
+
+  unsigned long i;
+
+  for (i = 0; i < n; i++) y[i] = sat16(a * x[i] + y[i]);
+}
+
+static void scalar_i16scal(int a, int16_t *x, unsigned long n){
+
+  unsigned long i;
+
+  for (i = 0; i < n; i++) x[i] = sat16(a * x[i]);
+}
+
+static long long scalar_i32dot(const int32_t *x, const int32_t *y, unsigned long n){
+
+  long long result = 0;
+  unsigned long i;
+
+  for (i = 0; i < n; i++) result = result + (long long) x[i] * y[i];
+
+  return result;
+}
+
+static const simd_kernels scalar_kernels = {
+  "scalar", scalar_sdot, scalar_ddot, scalar_saxpy, scalar_daxpy,
+  scalar_sscal, scalar_dscal, scalar_ssumsq, scalar_dsumsq, scalar_snrm2, scalar_dnrm2,
+  4, 4, scalar_sgemm, 4, 4, scalar_dgemm,
+  scalar_h2s, scalar_s2h, scalar_b2s, scalar_s2b,
+  scalar_i16dot, scalar_i16axpy, scalar_i16scal, scalar_i32dot
+};
+
+#ifdef SIMD_X86
+
+/*
+ * SSE2: 4 floats or 2 doubles per vector, separate multiply and add.
+ */
+
+__attribute__((target("sse2")))
+static double sse2_sdot(const float *x, const float *y, unsigned long n){
+
+  __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps(), s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+  float lane[4], result;
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+    s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(y + i + 4)));
+    s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(x + i + 8), _mm_loadu_ps(y + i + 8)));
+    s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(x + i + 12), _mm_loadu_ps(y + i + 12)));
+  }
+  for (; i + 4 <= n; i += 4) s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+
+  _mm_storeu_ps(lane, _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3)));
+  result = (lane[0] + lane[1]) + (lane[2] + lane[3]);
+  for (; i < n; i++) result += x[i] * y[i];
+
+  return result;
+}
+
+__attribute__((target("sse2")))
+static double sse2_ddot(const double *x, const double *y, unsigned long n){
+
+  __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd(), s2 = _mm_setzero_pd(), s3 = _mm_setzero_pd();
+  double lane[2], result;
+  unsigned long i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    s2 = _mm_add_pd(s2, _mm_mul_pd(_mm_loadu_pd(x + i + 4), _mm_loadu_pd(y + i + 4)));
+    s3 = _mm_add_pd(s3, _mm_mul_pd(_mm_loadu_pd(x + i + 6), _mm_loadu_pd(y + i + 6)));
+  }
+  for (; i + 2 <= n; i += 2) s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+
+  _mm_storeu_pd(lane, _mm_add_pd(_mm_add_pd(s0, s1), _mm_add_pd(s2, s3)));
+  result = lane[0] + lane[1];
+  for (; i < n; i++) result += x[i] * y[i];
+
+  return result;
+}
+
+__attribute__((target("sse2")))
+static void sse2_saxpy(float a, const float *x, float *y, unsigned long n){
+
+  __m128 va = _mm_set1_ps(a);
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_mul_ps(va, _mm_loadu_ps(x + i)), _mm_loadu_ps(y + i)));
+    _mm_storeu_ps(y + i + 4, _mm_add_ps(_mm_mul_ps(va, _mm_loadu_ps(x + i + 4)), _mm_loadu_ps(y + i + 4)));
+    _mm_storeu_ps(y + i + 8, _mm_add_ps(_mm_mul_ps(va, _mm_loadu_ps(x + i + 8)), _mm_loadu_ps(y + i + 8)));
+    _mm_storeu_ps(y + i + 12, _mm_add_ps(_mm_mul_ps(va, _mm_loadu_ps(x + i + 12)), _mm_loadu_ps(y + i + 12)));
+  }
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_mul_ps(va, _mm_loadu_ps(x + i)), _mm_loadu_ps(y + i)));
+  for (; i < n; i++) y[i] = a * x[i] + y[i];
+}
+
+__attribute__((target("sse2")))
+static void sse2_daxpy(double a, const double *x, double *y, unsigned long n){
+
+  __m128d va = _mm_set1_pd(a);
+  unsigned long i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    _mm_storeu_pd(y + i, _mm_add_pd(_mm_mul_pd(va, _mm_loadu_pd(x + i)), _mm_loadu_pd(y + i)));
+    _mm_storeu_pd(y + i + 2, _mm_add_pd(_mm_mul_pd(va, _mm_loadu_pd(x + i + 2)), _mm_loadu_pd(y + i + 2)));
+    _mm_storeu_pd(y + i + 4, _mm_add_pd(_mm_mul_pd(va, _mm_loadu_pd(x + i + 4)), _mm_loadu_pd(y + i + 4)));
+    _mm_storeu_pd(y + i + 6, _mm_add_pd(_mm_mul_pd(va, _mm_loadu_pd(x + i + 6)), _mm_loadu_pd(y + i + 6)));
+  }
+  for (; i + 2 <= n; i += 2)
+    _mm_storeu_pd(y + i, _mm_add_pd(_mm_mul_pd(va, _mm_loadu_pd(x + i)), _mm_loadu_pd(y + i)));
+  for (; i < n; i++) y[i] = a * x[i] + y[i];
+}
+
+__attribute__((target("sse2")))
+static void sse2_sscal(float a, float *x, unsigned long n){
+
+  __m128 va = _mm_set1_ps(a);
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    _mm_storeu_ps(x + i, _mm_mul_ps(va, _mm_loadu_ps(x + i)));
+    _mm_storeu_ps(x + i + 4, _mm_mul_ps(va, _mm_loadu_ps(x + i + 4)));
+    _mm_storeu_ps(x + i + 8, _mm_mul_ps(va, _mm_loadu_ps(x + i + 8)));
+    _mm_storeu_ps(x + i + 12, _mm_mul_ps(va, _mm_loadu_ps(x + i + 12)));
+  }
+  for (; i + 4 <= n; i += 4) _mm_storeu_ps(x + i, _mm_mul_ps(va, _mm_loadu_ps(x + i)));
+  for (; i < n; i++) x[i] = a * x[i];
+}
+
+__attribute__((target("sse2")))
+static void sse2_dscal(double a, double *x, unsigned long n){
+
+  __m128d va = _mm_set1_pd(a);
+  unsigned long i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    _mm_storeu_pd(x + i, _mm_mul_pd(va, _mm_loadu_pd(x + i)));
+    _mm_storeu_pd(x + i + 2, _mm_mul_pd(va, _mm_loadu_pd(x + i + 2)));
+    _mm_storeu_pd(x + i + 4, _mm_mul_pd(va, _mm_loadu_pd(x + i + 4)));
+    _mm_storeu_pd(x + i + 6, _mm_mul_pd(va, _mm_loadu_pd(x + i + 6)));
+  }
+  for (; i + 2 <= n; i += 2) _mm_storeu_pd(x + i, _mm_mul_pd(va, _mm_loadu_pd(x + i)));
+  for (; i < n; i++) x[i] = a * x[i];
+}
+
+static double sse2_ssumsq(const float *x, unsigned long n){ return sse2_sdot(x, x, n); }
+static double sse2_dsumsq(const double *x, unsigned long n){ return sse2_ddot(x, x, n); }
+
+/*
+ * Blue's sums on whole vectors: compare masks pick the lanes of each
+ * sum, so the other lanes add zero. NaN fails both compares and goes
+ * into the medium sum. The remainder is left to the scalar loop.
+ */
+__attribute__((target("sse2")))
+static void sse2_snrm2(const float *x, unsigned long n, float sum[3]){
+
+  const __m128 tsml = _mm_set1_ps(BLUE_TSML(FLT_MIN_EXP)), tbig = _mm_set1_ps(BLUE_TBIG(FLT_MAX_EXP, FLT_MANT_DIG));
+  const __m128 ssml = _mm_set1_ps(BLUE_SSML(FLT_MIN_EXP, FLT_MANT_DIG)), sbig = _mm_set1_ps(BLUE_SBIG(FLT_MAX_EXP, FLT_MANT_DIG));
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  __m128 big = _mm_setzero_ps(), med = _mm_setzero_ps(), sml = _mm_setzero_ps(), ax, mb, ms, v;
+  float lane[3][4];
+  unsigned long i = 0;
+  int k;
+
+  for (; i + 4 <= n; i += 4) {
+    ax = _mm_andnot_ps(sign, _mm_loadu_ps(x + i));
+    mb = _mm_cmpgt_ps(ax, tbig);
+    ms = _mm_cmplt_ps(ax, tsml);
+    v = _mm_and_ps(mb, _mm_mul_ps(ax, sbig));
+    big = _mm_add_ps(big, _mm_mul_ps(v, v));
+    v = _mm_and_ps(ms, _mm_mul_ps(ax, ssml));
+    sml = _mm_add_ps(sml, _mm_mul_ps(v, v));
+    v = _mm_andnot_ps(_mm_or_ps(mb, ms), ax);
+    med = _mm_add_ps(med, _mm_mul_ps(v, v));
+  }
+
+  _mm_storeu_ps(lane[0], big);
+  _mm_storeu_ps(lane[1], med);
+  _mm_storeu_ps(lane[2], sml);
+  for (k = 0; k < 3; k++) sum[k] += (lane[k][0] + lane[k][1]) + (lane[k][2] + lane[k][3]);
+  scalar_snrm2(x + i, n - i, sum);
+}
+
+__attribute__((target("sse2")))
+static void sse2_dnrm2(const double *x, unsigned long n, double sum[3]){
+
+  const __m128d tsml = _mm_set1_pd(BLUE_TSML(DBL_MIN_EXP)), tbig = _mm_set1_pd(BLUE_TBIG(DBL_MAX_EXP, DBL_MANT_DIG));
+  const __m128d ssml = _mm_set1_pd(BLUE_SSML(DBL_MIN_EXP, DBL_MANT_DIG)), sbig = _mm_set1_pd(BLUE_SBIG(DBL_MAX_EXP, DBL_MANT_DIG));
+  const __m128d sign = _mm_set1_pd(-0.0);
+  __m128d big = _mm_setzero_pd(), med = _mm_setzero_pd(), sml = _mm_setzero_pd(), ax, mb, ms, v;
+  double lane[3][2];
+  unsigned long i = 0;
+  int k;
+
+  for (; i + 2 <= n; i += 2) {
+    ax = _mm_andnot_pd(sign, _mm_loadu_pd(x + i));
+    mb = _mm_cmpgt_pd(ax, tbig);
+    ms = _mm_cmplt_pd(ax, tsml);
+    v = _mm_and_pd(mb, _mm_mul_pd(ax, sbig));
+    big = _mm_add_pd(big, _mm_mul_pd(v, v));
+    v = _mm_and_pd(ms, _mm_mul_pd(ax, ssml));
+    sml = _mm_add_pd(sml, _mm_mul_pd(v, v));
+    v = _mm_andnot_pd(_mm_or_pd(mb, ms), ax);
+    med = _mm_add_pd(med, _mm_mul_pd(v, v));
+  }
+
+  _mm_storeu_pd(lane[0], big);
+  _mm_storeu_pd(lane[1], med);
+  _mm_storeu_pd(lane[2], sml);
+  for (k = 0; k < 3; k++) sum[k] += lane[k][0] + lane[k][1];
+  scalar_dnrm2(x + i, n - i, sum);
+}
+
+/* 4 x 8 float and 4 x 4 double tiles, two vectors per row */
+__attribute__((target("sse2")))
+static void sse2_sgemm(unsigned long kc, const float *a, const float *b, float *c, unsigned long ldc){
+
+  __m128 c0[4], c1[4], b0, b1, ai;
+  unsigned long p;
+  int i;
+
+  for (i = 0; i < 4; i++) c0[i] = c1[i] = _mm_setzero_ps();
+  for (p = 0; p < kc; p++) {
+    b0 = _mm_loadu_ps(b + p * 8);
+    b1 = _mm_loadu_ps(b + p * 8 + 4);
+    for (i = 0; i < 4; i++) {
+      ai = _mm_set1_ps(a[p * 4 + i]);
+      c0[i] = _mm_add_ps(c0[i], _mm_mul_ps(ai, b0));
+      c1[i] = _mm_add_ps(c1[i], _mm_mul_ps(ai, b1));
+    }
+  }
+
+  for (i = 0; i < 4; i++) {
+    _mm_storeu_ps(c + i * ldc, _mm_add_ps(_mm_loadu_ps(c + i * ldc), c0[i]));
+    _mm_storeu_ps(c + i * ldc + 4, _mm_add_ps(_mm_loadu_ps(c + i * ldc + 4), c1[i]));
+  }
+}
+
+__attribute__((target("sse2")))
+static void sse2_dgemm(unsigned long kc, const double *a, const double *b, double *c, unsigned long ldc){
+
+  __m128d c0[4], c1[4], b0, b1, ai;
+  unsigned long p;
+  int i;
+
+  for (i = 0; i < 4; i++) c0[i] = c1[i] = _mm_setzero_pd();
+  for (p = 0; p < kc; p++) {
+    b0 = _mm_loadu_pd(b + p * 4);
+    b1 = _mm_loadu_pd(b + p * 4 + 2);
+    for (i = 0; i < 4; i++) {
+      ai = _mm_set1_pd(a[p * 4 + i]);
+      c0[i] = _mm_add_pd(c0[i], _mm_mul_pd(ai, b0));
+      c1[i] = _mm_add_pd(c1[i], _mm_mul_pd(ai, b1));
+    }
+  }
+
+  for (i = 0; i < 4; i++) {
+    _mm_storeu_pd(c + i * ldc, _mm_add_pd(_mm_loadu_pd(c + i * ldc), c0[i]));
+    _mm_storeu_pd(c + i * ldc + 2, _mm_add_pd(_mm_loadu_pd(c + i * ldc + 2), c1[i]));
+  }
+}
+
+/*
+ * SSE2 has no fp16 or bf16 conversions, so they are done on the bit
+ * patterns in 32-bit lanes, after F. Giesen's SSE2 versions of the
+ * routines in half.c: fp16 is rebiased by a multiply, which also
+ * normalises subnormals, and rounded back with the magic constants of
+ * half_from_float(). A bf16 value is the top half of a float: it is
+ * widened by interleaving with zeros and rounded by adding 0x7fff plus
+ * the lowest bit kept. The 16-bit halves are packed offset by 0x8000,
+ * as the pack saturates signed.
+ */
+__attribute__((target("sse2")))
+static __m128i sse2_pack16(__m128i lo, __m128i hi){
+
+  __m128i bias = _mm_set1_epi32(0x8000);
+
+  return _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(lo, bias), _mm_sub_epi32(hi, bias)), _mm_set1_epi16((short) 0x8000));
+}
+
+__attribute__((target("sse2")))
+static __m128 sse2_half_widen(__m128i h){
+
+  __m128i expmant = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+  __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expmant), 16);
+  __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expmant, 13)), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+  __m128i infnan = _mm_and_si128(_mm_cmpgt_epi32(expmant, _mm_set1_epi32(0x7bff)), _mm_set1_epi32(255 << 23));
+
+  return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infnan)));
+}
+
+__attribute__((target("sse2")))
+static __m128i sse2_half_round(__m128 f){
+
+  __m128 sign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32(0x80000000u)));
+  __m128 absf = _mm_xor_ps(f, sign);
+  __m128i u = _mm_castps_si128(absf), magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+  __m128i regular = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), u);
+  __m128i special = _mm_or_si128(_mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(absf, absf)), _mm_set1_epi32(0x200)),
+                                 _mm_set1_epi32(0x7c00));
+  __m128i sub = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), u);
+  __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absf, _mm_castsi128_ps(magic))), magic);
+  __m128i odd = _mm_srai_epi32(_mm_slli_epi32(u, 31 - 13), 31);
+  __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(u, _mm_set1_epi32(0xfff - ((127 - 15) << 23))), odd), 13);
+  __m128i r = _mm_or_si128(_mm_and_si128(sub, subnormal), _mm_andnot_si128(sub, normal));
+
+  r = _mm_or_si128(_mm_and_si128(regular, r), _mm_andnot_si128(regular, special));
+
+  return _mm_or_si128(r, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+}
+
+__attribute__((target("sse2")))
+static void sse2_h2s(const uint16_t *h, float *x, unsigned long n){
+
+  __m128i v, zero = _mm_setzero_si128();
+  unsigned long i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    v = _mm_loadu_si128((const __m128i *) (h + i));
+    _mm_storeu_ps(x + i, sse2_half_widen(_mm_unpacklo_epi16(v, zero)));
+    _mm_storeu_ps(x + i + 4, sse2_half_widen(_mm_unpackhi_epi16(v, zero)));
+  }
+  for (; i < n; i++) x[i] = half_to_float(h[i]);
+}
+
+__attribute__((target("sse2")))
+static void sse2_s2h(const float *x, uint16_t *h, unsigned long n){
+
+  unsigned long i = 0;
+
+  for (; i + 8 <= n; i += 8)
+    _mm_storeu_si128((__m128i *) (h + i), sse2_pack16(sse2_half_round(_mm_loadu_ps(x + i)), sse2_half_round(_mm_loadu_ps(x + i + 4))));
+  for (; i < n; i++) h[i] = half_from_float(x[i]);
+}
+
+__attribute__((target("sse2")))
+static void sse2_b2s(const uint16_t *h, float *x, unsigned long n){
+
+  __m128i v, zero = _mm_setzero_si128();
+  unsigned long i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    v = _mm_loadu_si128((const __m128i *) (h + i));
+    _mm_storeu_ps(x + i, _mm_castsi128_ps(_mm_unpacklo_epi16(zero, v)));
+    _mm_storeu_ps(x + i + 4, _mm_castsi128_ps(_mm_unpackhi_epi16(zero, v)));
+  }
+  for (; i < n; i++) x[i] = bf16_to_float(h[i]);
+}
+
+__attribute__((target("sse2")))
+static __m128i sse2_bf16_round(__m128 f){
+
+  __m128i u = _mm_castps_si128(f), one = _mm_set1_epi32(1);
+  __m128i r = _mm_add_epi32(u, _mm_add_epi32(_mm_set1_epi32(0x7fff), _mm_and_si128(_mm_srli_epi32(u, 16), one)));
+  __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(f, f));
+
+  r = _mm_srli_epi32(r, 16);
+  u = _mm_or_si128(_mm_srli_epi32(u, 16), _mm_set1_epi32(0x40));
+
+  return _mm_or_si128(_mm_and_si128(nan, u), _mm_andnot_si128(nan, r));
+}
+
+__attribute__((target("sse2")))
+static void sse2_s2b(const float *x, uint16_t *h, unsigned long n){
+
+  unsigned long i = 0;
+
+  for (; i + 8 <= n; i += 8)
+    _mm_storeu_si128((__m128i *) (h + i), sse2_pack16(sse2_bf16_round(_mm_loadu_ps(x + i)), sse2_bf16_round(_mm_loadu_ps(x + i + 4))));
+  for (; i < n; i++) h[i] = bf16_from_float(x[i]);
+}
+
+/*
+ * pmaddwd multiplies int16 pairs exactly and adds each pair into 32
+ * bits, which wraps for one input only: two pairs of -32768 sum to
+ * 2^31 and come out as INT32_MIN, which no other pair sum reaches. The
+ * dot product splits the pair sums into their signed high and unsigned
+ * low 16 bits, adds 2^16 to the high half of INT32_MIN lanes to undo
+ * the wrap, sums the halves in separate 32-bit lanes that cannot
+ * overflow within I16_BLOCK elements, and adds the lanes into 64 bits
+ * after each block. AXPY multiplies interleaved (x, y) pairs
+ * by (a, 1); the packs back to int16 saturate.
+ */
+#define I16_BLOCK 65536
+
+__attribute__((target("sse2")))
+static long long sse2_i16dot(const int16_t *x, const int16_t *y, unsigned long n){
+
+  __m128i hi, lo, m0, m1, mask = _mm_set1_epi32(0xffff), wrap = _mm_set1_epi32(INT32_MIN);
+  int lane_hi[4], lane_lo[4], k;
+  long long result = 0;
+  unsigned long i = 0, end;
+
+  while (i + 16 <= n) {
+    end = (n - i < I16_BLOCK) ? n : i + I16_BLOCK;
+    hi = lo = _mm_setzero_si128();
+    for (; i + 16 <= end; i += 16) {
+      m0 = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (x + i)), _mm_loadu_si128((const __m128i *) (y + i)));
+      m1 = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (x + i + 8)), _mm_loadu_si128((const __m128i *) (y + i + 8)));
+      hi = _mm_add_epi32(hi, _mm_add_epi32(_mm_srai_epi32(m0, 16), _mm_srai_epi32(m1, 16)));
+      hi = _mm_sub_epi32(hi, _mm_slli_epi32(_mm_add_epi32(_mm_cmpeq_epi32(m0, wrap), _mm_cmpeq_epi32(m1, wrap)), 16));
+      lo = _mm_add_epi32(lo, _mm_add_epi32(_mm_and_si128(m0, mask), _mm_and_si128(m1, mask)));
+    }
+    _mm_storeu_si128((__m128i *) lane_hi, hi);
+    _mm_storeu_si128((__m128i *) lane_lo, lo);
+    for (k = 0; k < 4; k++) result += (long long) lane_hi[k] * 65536 + lane_lo[k];
+  }
+  for (; i < n; i++) result += x[i] * y[i];
+
+  return result;
+}
+
+__attribute__((target("sse2")))
+static void sse2_i16axpy(int a, const int16_t *x, int16_t *y, unsigned long n){
+
+  __m128i va = _mm_set1_epi32((a & 0xffff) | (1 << 16)), vx, vy;
+  unsigned long i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    vx = _mm_loadu_si128((const __m128i *) (x + i));
+    vy = _mm_loadu_si128((const __m128i *) (y + i));
+    _mm_storeu_si128((__m128i *) (y + i), _mm_packs_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(vx, vy), va),
+                                                          _mm_madd_epi16(_mm_unpackhi_epi16(vx, vy), va)));
+  }
+  for (; i < n; i++) y[i] = sat16(a * x[i] + y[i]);
+}
+
+/* The low and high halves of the 32-bit products, interleaved and packed */
+__attribute__((target("sse2")))
+static void sse2_i16scal(int a, int16_t *x, unsigned long n){
+
+  __m128i va = _mm_set1_epi16((short) a), vx, lo, hi;
+  unsigned long i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    vx = _mm_loadu_si128((const __m128i *) (x + i));
+    lo = _mm_mullo_epi16(vx, va);
+    hi = _mm_mulhi_epi16(vx, va);
+    _mm_storeu_si128((__m128i *) (x + i), _mm_packs_epi32(_mm_unpacklo_epi16(lo, hi), _mm_unpackhi_epi16(lo, hi)));
+  }
+  for (; i < n; i++) x[i] = sat16(a * x[i]);
+}
+
+/*
+ * Signed 64-bit products of the even 32-bit lanes of x and y. SSE2
+ * multiplies unsigned only; a negative lane adds 2^32 times the other
+ * lane to the product, which is taken off again.
+ */
+__attribute__((target("sse2")))
+static __m128i sse2_mul_epi32(__m128i x, __m128i y){
+
+  __m128i fix = _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(x, 31), y), _mm_and_si128(_mm_srai_epi32(y, 31), x));
+
+  return _mm_sub_epi64(_mm_mul_epu32(x, y), _mm_slli_epi64(fix, 32));
+}
+
+__attribute__((target("sse2")))
+static long long sse2_i32dot(const int32_t *x, const int32_t *y, unsigned long n){
+
+  __m128i s0 = _mm_setzero_si128(), s1 = _mm_setzero_si128(), vx, vy;
+  long long lane[2], result;
+  unsigned long i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    vx = _mm_loadu_si128((const __m128i *) (x + i));
+    vy = _mm_loadu_si128((const __m128i *) (y + i));
+    s0 = _mm_add_epi64(s0, sse2_mul_epi32(vx, vy));
+    s1 = _mm_add_epi64(s1, sse2_mul_epi32(_mm_srli_epi64(vx, 32), _mm_srli_epi64(vy, 32)));
+  }
+
+  _mm_storeu_si128((__m128i *) lane, _mm_add_epi64(s0, s1));
+  result = lane[0] + lane[1];
+  for (; i < n; i++) result += (long long) x[i] * y[i];
+
+  return result;
+}
+
+static const simd_kernels sse2_kernels = {
+  "sse2", sse2_sdot, sse2_ddot, sse2_saxpy, sse2_daxpy,
+  sse2_sscal, sse2_dscal, sse2_ssumsq, sse2_dsumsq, sse2_snrm2, sse2_dnrm2,
+  4, 8, sse2_sgemm, 4, 4, sse2_dgemm,
+  sse2_h2s, sse2_s2h, sse2_b2s, sse2_s2b,
+  sse2_i16dot, sse2_i16axpy, sse2_i16scal, sse2_i32dot
+};
+
+
+/*
+ * AVX2: 8 floats or 4 doubles per vector, fused multiply-add.
+ */
+
+__attribute__((target("avx2,fma")))
+static double avx2_sdot(const float *x, const float *y, unsigned long n){
+
+  __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps(), s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+  __m128 h;
+  float result;
+  unsigned long i = 0;
+
+  for (; i + 32 <= n; i += 32) {
+    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), s0);
+    s1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), s1);
+    s2 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 16), _mm256_loadu_ps(y + i + 16), s2);
+    s3 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 24), _mm256_loadu_ps(y + i + 24), s3);
+  }
+  for (; i + 8 <= n; i += 8) s0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), s0);
+
+  s0 = _mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3));
+  h = _mm_add_ps(_mm256_castps256_ps128(s0), _mm256_extractf128_ps(s0, 1));
+  h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+  h = _mm_add_ss(h, _mm_movehdup_ps(h));
+  result = _mm_cvtss_f32(h);
+  for (; i < n; i++) result += x[i] * y[i];
+
+  return result;
+}
+
+__attribute__((target("avx2,fma")))
+static double avx2_ddot(const double *x, const double *y, unsigned long n){
+
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+  __m128d h;
+  double result;
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+    s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), s1);
+    s2 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 8), _mm256_loadu_pd(y + i + 8), s2);
+    s3 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12), s3);
+  }
+  for (; i + 4 <= n; i += 4) s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+
+  s0 = _mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3));
+  h = _mm_add_pd(_mm256_castpd256_pd128(s0), _mm256_extractf128_pd(s0, 1));
+  result = _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+  for (; i < n; i++) result += x[i] * y[i];
+
+  return result;
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_saxpy(float a, const float *x, float *y, unsigned long n){
+
+  __m256 va = _mm256_set1_ps(a);
+  unsigned long i = 0;
+
+  for (; i + 32 <= n; i += 32) {
+    _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    _mm256_storeu_ps(y + i + 8, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8)));
+    _mm256_storeu_ps(y + i + 16, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i + 16), _mm256_loadu_ps(y + i + 16)));
+    _mm256_storeu_ps(y + i + 24, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i + 24), _mm256_loadu_ps(y + i + 24)));
+  }
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+  for (; i < n; i++) y[i] = a * x[i] + y[i];
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_daxpy(double a, const double *x, double *y, unsigned long n){
+
+  __m256d va = _mm256_set1_pd(a);
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    _mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    _mm256_storeu_pd(y + i + 4, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+    _mm256_storeu_pd(y + i + 8, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i + 8), _mm256_loadu_pd(y + i + 8)));
+    _mm256_storeu_pd(y + i + 12, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12)));
+  }
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+  for (; i < n; i++) y[i] = a * x[i] + y[i];
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_sscal(float a, float *x, unsigned long n){
+
+  __m256 va = _mm256_set1_ps(a);
+  unsigned long i = 0;
+
+  for (; i + 32 <= n; i += 32) {
+    _mm256_storeu_ps(x + i, _mm256_mul_ps(va, _mm256_loadu_ps(x + i)));
+    _mm256_storeu_ps(x + i + 8, _mm256_mul_ps(va, _mm256_loadu_ps(x + i + 8)));
+    _mm256_storeu_ps(x + i + 16, _mm256_mul_ps(va, _mm256_loadu_ps(x + i + 16)));
+    _mm256_storeu_ps(x + i + 24, _mm256_mul_ps(va, _mm256_loadu_ps(x + i + 24)));
+  }
+  for (; i + 8 <= n; i += 8) _mm256_storeu_ps(x + i, _mm256_mul_ps(va, _mm256_loadu_ps(x + i)));
+  for (; i < n; i++) x[i] = a * x[i];
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_dscal(double a, double *x, unsigned long n){
+
+  __m256d va = _mm256_set1_pd(a);
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    _mm256_storeu_pd(x + i, _mm256_mul_pd(va, _mm256_loadu_pd(x + i)));
+    _mm256_storeu_pd(x + i + 4, _mm256_mul_pd(va, _mm256_loadu_pd(x + i + 4)));
+    _mm256_storeu_pd(x + i + 8, _mm256_mul_pd(va, _mm256_loadu_pd(x + i + 8)));
+    _mm256_storeu_pd(x + i + 12, _mm256_mul_pd(va, _mm256_loadu_pd(x + i + 12)));
+  }
+  for (; i + 4 <= n; i += 4) _mm256_storeu_pd(x + i, _mm256_mul_pd(va, _mm256_loadu_pd(x + i)));
+  for (; i < n; i++) x[i] = a * x[i];
+}
+
+static double avx2_ssumsq(const float *x, unsigned long n){ return avx2_sdot(x, x, n); }
+static double avx2_dsumsq(const double *x, unsigned long n){ return avx2_ddot(x, x, n); }
+
+__attribute__((target("avx2,fma")))
+static void avx2_snrm2(const float *x, unsigned long n, float sum[3]){
+
+  const __m256 tsml = _mm256_set1_ps(BLUE_TSML(FLT_MIN_EXP)), tbig = _mm256_set1_ps(BLUE_TBIG(FLT_MAX_EXP, FLT_MANT_DIG));
+  const __m256 ssml = _mm256_set1_ps(BLUE_SSML(FLT_MIN_EXP, FLT_MANT_DIG)), sbig = _mm256_set1_ps(BLUE_SBIG(FLT_MAX_EXP, FLT_MANT_DIG));
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  __m256 big = _mm256_setzero_ps(), med = _mm256_setzero_ps(), sml = _mm256_setzero_ps(), ax, mb, ms, v;
+  float lane[3][8];
+  unsigned long i = 0;
+  int k;
+
+  for (; i + 8 <= n; i += 8) {
+    ax = _mm256_andnot_ps(sign, _mm256_loadu_ps(x + i));
+    mb = _mm256_cmp_ps(ax, tbig, _CMP_GT_OQ);
+    ms = _mm256_cmp_ps(ax, tsml, _CMP_LT_OQ);
+    v = _mm256_and_ps(mb, _mm256_mul_ps(ax, sbig));
+    big = _mm256_fmadd_ps(v, v, big);
+    v = _mm256_and_ps(ms, _mm256_mul_ps(ax, ssml));
+    sml = _mm256_fmadd_ps(v, v, sml);
+    v = _mm256_andnot_ps(_mm256_or_ps(mb, ms), ax);
+    med = _mm256_fmadd_ps(v, v, med);
+  }
+
+  _mm256_storeu_ps(lane[0], big);
+  _mm256_storeu_ps(lane[1], med);
+  _mm256_storeu_ps(lane[2], sml);
+  for (k = 0; k < 3; k++)
+    sum[k] += ((lane[k][0] + lane[k][1]) + (lane[k][2] + lane[k][3])) + ((lane[k][4] + lane[k][5]) + (lane[k][6] + lane[k][7]));
+  scalar_snrm2(x + i, n - i, sum);
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_dnrm2(const double *x, unsigned long n, double sum[3]){
+
+  const __m256d tsml = _mm256_set1_pd(BLUE_TSML(DBL_MIN_EXP)), tbig = _mm256_set1_pd(BLUE_TBIG(DBL_MAX_EXP, DBL_MANT_DIG));
+  const __m256d ssml = _mm256_set1_pd(BLUE_SSML(DBL_MIN_EXP, DBL_MANT_DIG)), sbig = _mm256_set1_pd(BLUE_SBIG(DBL_MAX_EXP, DBL_MANT_DIG));
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  __m256d big = _mm256_setzero_pd(), med = _mm256_setzero_pd(), sml = _mm256_setzero_pd(), ax, mb, ms, v;
+  double lane[3][4];
+  unsigned long i = 0;
+  int k;
+
+  for (; i + 4 <= n; i += 4) {
+    ax = _mm256_andnot_pd(sign, _mm256_loadu_pd(x + i));
+    mb = _mm256_cmp_pd(ax, tbig, _CMP_GT_OQ);
+    ms = _mm256_cmp_pd(ax, tsml, _CMP_LT_OQ);
+    v = _mm256_and_pd(mb, _mm256_mul_pd(ax, sbig));
+    big = _mm256_fmadd_pd(v, v, big);
+    v = _mm256_and_pd(ms, _mm256_mul_pd(ax, ssml));
+    sml = _mm256_fmadd_pd(v, v, sml);
+    v = _mm256_andnot_pd(_mm256_or_pd(mb, ms), ax);
+    med = _mm256_fmadd_pd(v, v, med);
+  }
+
+  _mm256_storeu_pd(lane[0], big);
+  _mm256_storeu_pd(lane[1], med);
+  _mm256_storeu_pd(lane[2], sml);
+  for (k = 0; k < 3; k++) sum[k] += (lane[k][0] + lane[k][1]) + (lane[k][2] + lane[k][3]);
+  scalar_dnrm2(x + i, n - i, sum);
+}
+
+/* 6 x 16 float and 6 x 8 double tiles, two vectors per row: 12 accumulators */
+__attribute__((target("avx2,fma")))
+static void avx2_sgemm(unsigned long kc, const float *a, const float *b, float *c, unsigned long ldc){
+
+  __m256 c0[6], c1[6], b0, b1, ai;
+  unsigned long p;
+  int i;
+
+  for (i = 0; i < 6; i++) c0[i] = c1[i] = _mm256_setzero_ps();
+  for (p = 0; p < kc; p++) {
+    b0 = _mm256_loadu_ps(b + p * 16);
+    b1 = _mm256_loadu_ps(b + p * 16 + 8);
+    for (i = 0; i < 6; i++) {
+      ai = _mm256_set1_ps(a[p * 6 + i]);
+      c0[i] = _mm256_fmadd_ps(ai, b0, c0[i]);
+      c1[i] = _mm256_fmadd_ps(ai, b1, c1[i]);
+    }
+  }
+
+  for (i = 0; i < 6; i++) {
+    _mm256_storeu_ps(c + i * ldc, _mm256_add_ps(_mm256_loadu_ps(c + i * ldc), c0[i]));
+    _mm256_storeu_ps(c + i * ldc + 8, _mm256_add_ps(_mm256_loadu_ps(c + i * ldc + 8), c1[i]));
+  }
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_dgemm(unsigned long kc, const double *a, const double *b, double *c, unsigned long ldc){
+
+  __m256d c0[6], c1[6], b0, b1, ai;
+  unsigned long p;
+  int i;
+
+  for (i = 0; i < 6; i++) c0[i] = c1[i] = _mm256_setzero_pd();
+  for (p = 0; p < kc; p++) {
+    b0 = _mm256_loadu_pd(b + p * 8);
+    b1 = _mm256_loadu_pd(b + p * 8 + 4);
+    for (i = 0; i < 6; i++) {
+      ai = _mm256_set1_pd(a[p * 6 + i]);
+      c0[i] = _mm256_fmadd_pd(ai, b0, c0[i]);
+      c1[i] = _mm256_fmadd_pd(ai, b1, c1[i]);
+    }
+  }
+
+  for (i = 0; i < 6; i++) {
+    _mm256_storeu_pd(c + i * ldc, _mm256_add_pd(_mm256_loadu_pd(c + i * ldc), c0[i]));
+    _mm256_storeu_pd(c + i * ldc + 4, _mm256_add_pd(_mm256_loadu_pd(c + i * ldc + 4), c1[i]));
+  }
+}
+
+/* fp16 by F16C, bf16 as for SSE2 */
+__attribute__((target("avx2,fma,f16c")))
+static void avx2_h2s(const uint16_t *h, float *x, unsigned long n){
+
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    _mm256_storeu_ps(x + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (h + i))));
+    _mm256_storeu_ps(x + i + 8, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (h + i + 8))));
+  }
+  for (; i < n; i++) x[i] = half_to_float(h[i]);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static void avx2_s2h(const float *x, uint16_t *h, unsigned long n){
+
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    _mm_storeu_si128((__m128i *) (h + i), _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT));
+    _mm_storeu_si128((__m128i *) (h + i + 8), _mm256_cvtps_ph(_mm256_loadu_ps(x + i + 8), _MM_FROUND_TO_NEAREST_INT));
+  }
+  for (; i < n; i++) h[i] = half_from_float(x[i]);
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_b2s(const uint16_t *h, float *x, unsigned long n){
+
+  __m256i v;
+  unsigned long i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) (h + i)));
+    _mm256_storeu_ps(x + i, _mm256_castsi256_ps(_mm256_slli_epi32(v, 16)));
+  }
+  for (; i < n; i++) x[i] = bf16_to_float(h[i]);
+}
+
+__attribute__((target("avx2,fma")))
+static __m256i avx2_bf16_round(__m256 f){
+
+  __m256i u = _mm256_castps_si256(f), one = _mm256_set1_epi32(1);
+  __m256i r = _mm256_add_epi32(u, _mm256_add_epi32(_mm256_set1_epi32(0x7fff), _mm256_and_si256(_mm256_srli_epi32(u, 16), one)));
+  __m256 nan = _mm256_cmp_ps(f, f, _CMP_UNORD_Q);
+
+  r = _mm256_srli_epi32(r, 16);
+  u = _mm256_or_si256(_mm256_srli_epi32(u, 16), _mm256_set1_epi32(0x40));
+
+  return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(r), _mm256_castsi256_ps(u), nan));
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_s2b(const float *x, uint16_t *h, unsigned long n){
+
+  __m256i v;
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    /* the pack interleaves the 128-bit lanes of its operands */
+    v = _mm256_packus_epi32(avx2_bf16_round(_mm256_loadu_ps(x + i)), avx2_bf16_round(_mm256_loadu_ps(x + i + 8)));
+    _mm256_storeu_si256((__m256i *) (h + i), _mm256_permute4x64_epi64(v, 0xd8));
+  }
+  for (; i < n; i++) h[i] = bf16_from_float(x[i]);
+}
+
+/* As for SSE2; the unpacks and packs work within 128-bit lanes, so the elements stay in order */
+__attribute__((target("avx2,fma")))
+static long long avx2_i16dot(const int16_t *x, const int16_t *y, unsigned long n){
+
+  __m256i hi, lo, m0, m1, mask = _mm256_set1_epi32(0xffff), wrap = _mm256_set1_epi32(INT32_MIN);
+  int lane_hi[8], lane_lo[8], k;
+  long long result = 0;
+  unsigned long i = 0, end;
+
+  while (i + 32 <= n) {
+    end = (n - i < I16_BLOCK) ? n : i + I16_BLOCK;
+    hi = lo = _mm256_setzero_si256();
+    for (; i + 32 <= end; i += 32) {
+      m0 = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *) (x + i)), _mm256_loadu_si256((const __m256i *) (y + i)));
+      m1 = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *) (x + i + 16)), _mm256_loadu_si256((const __m256i *) (y + i + 16)));
+      hi = _mm256_add_epi32(hi, _mm256_add_epi32(_mm256_srai_epi32(m0, 16), _mm256_srai_epi32(m1, 16)));
+      hi = _mm256_sub_epi32(hi, _mm256_slli_epi32(_mm256_add_epi32(_mm256_cmpeq_epi32(m0, wrap), _mm256_cmpeq_epi32(m1, wrap)), 16));
+      lo = _mm256_add_epi32(lo, _mm256_add_epi32(_mm256_and_si256(m0, mask), _mm256_and_si256(m1, mask)));
+    }
+    _mm256_storeu_si256((__m256i *) lane_hi, hi);
+    _mm256_storeu_si256((__m256i *) lane_lo, lo);
+    for (k = 0; k < 8; k++) result += (long long) lane_hi[k] * 65536 + lane_lo[k];
+  }
+  for (; i < n; i++) result += x[i] * y[i];
+
+  return result;
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_i16axpy(int a, const int16_t *x, int16_t *y, unsigned long n){
+
+  __m256i va = _mm256_set1_epi32((a & 0xffff) | (1 << 16)), vx, vy;
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    vx = _mm256_loadu_si256((const __m256i *) (x + i));
+    vy = _mm256_loadu_si256((const __m256i *) (y + i));
+    _mm256_storeu_si256((__m256i *) (y + i), _mm256_packs_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(vx, vy), va),
+                                                                _mm256_madd_epi16(_mm256_unpackhi_epi16(vx, vy), va)));
+  }
+  for (; i < n; i++) y[i] = sat16(a * x[i] + y[i]);
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_i16scal(int a, int16_t *x, unsigned long n){
+
+  __m256i va = _mm256_set1_epi16((short) a), vx, lo, hi;
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    vx = _mm256_loadu_si256((const __m256i *) (x + i));
+    lo = _mm256_mullo_epi16(vx, va);
+    hi = _mm256_mulhi_epi16(vx, va);
+    _mm256_storeu_si256((__m256i *) (x + i), _mm256_packs_epi32(_mm256_unpacklo_epi16(lo, hi), _mm256_unpackhi_epi16(lo, hi)));
+  }
+  for (; i < n; i++) x[i] = sat16(a * x[i]);
+}
+
+/* Even lanes multiplied signed, odd lanes shifted down onto them */
+__attribute__((target("avx2,fma")))
+static long long avx2_i32dot(const int32_t *x, const int32_t *y, unsigned long n){
+
+  __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256(), vx, vy;
+  long long lane[4], result;
+  unsigned long i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    vx = _mm256_loadu_si256((const __m256i *) (x + i));
+    vy = _mm256_loadu_si256((const __m256i *) (y + i));
+    s0 = _mm256_add_epi64(s0, _mm256_mul_epi32(vx, vy));
+    s1 = _mm256_add_epi64(s1, _mm256_mul_epi32(_mm256_srli_epi64(vx, 32), _mm256_srli_epi64(vy, 32)));
+  }
+
+  _mm256_storeu_si256((__m256i *) lane, _mm256_add_epi64(s0, s1));
+  result = (lane[0] + lane[1]) + (lane[2] + lane[3]);
+  for (; i < n; i++) result += (long long) x[i] * y[i];
+
+  return result;
+}
+
+static const simd_kernels avx2_kernels = {
+  "avx2", avx2_sdot, avx2_ddot, avx2_saxpy, avx2_daxpy,
+  avx2_sscal, avx2_dscal, avx2_ssumsq, avx2_dsumsq, avx2_snrm2, avx2_dnrm2,
+  6, 16, avx2_sgemm, 6, 8, avx2_dgemm,
+  avx2_h2s, avx2_s2h, avx2_b2s, avx2_s2b,
+  avx2_i16dot, avx2_i16axpy, avx2_i16scal, avx2_i32dot
+};
+
+
+/*
+ * AVX-512: 16 floats or 8 doubles per vector, fused multiply-add, and
+ * masked loads and stores for the remainder instead of a scalar loop.
+ */
+
+__attribute__((target("avx512f")))
+static double avx512_sdot(const float *x, const float *y, unsigned long n){
+
+  __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps(), s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+  unsigned long i = 0;
+
+  for (; i + 64 <= n; i += 64) {
+    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), s0);
+    s1 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16), s1);
+    s2 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 32), _mm512_loadu_ps(y + i + 32), s2);
+    s3 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 48), _mm512_loadu_ps(y + i + 48), s3);
+  }
+  for (; i + 16 <= n; i += 16) s0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), s0);
+  if (i < n) {
+    __mmask16 m = (__mmask16)((1u << (n - i)) - 1);
+    s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i), s1);
+  }
+
+  return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(s0, s1), _mm512_add_ps(s2, s3)));
+}
+
+__attribute__((target("avx512f")))
+static double avx512_ddot(const double *x, const double *y, unsigned long n){
+
+  __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd(), s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+  unsigned long i = 0;
+
+  for (; i + 32 <= n; i += 32) {
+    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+    s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), s1);
+    s2 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16), s2);
+    s3 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24), s3);
+  }
+  for (; i + 8 <= n; i += 8) s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+  if (i < n) {
+    __mmask8 m = (__mmask8)((1u << (n - i)) - 1);
+    s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, x + i), _mm512_maskz_loadu_pd(m, y + i), s1);
+  }
+
+  return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+}
+
+__attribute__((target("avx512f")))
+static void avx512_saxpy(float a, const float *x, float *y, unsigned long n){
+
+  __m512 va = _mm512_set1_ps(a);
+  unsigned long i = 0;
+
+  for (; i + 64 <= n; i += 64) {
+    _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    _mm512_storeu_ps(y + i + 16, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16)));
+    _mm512_storeu_ps(y + i + 32, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i + 32), _mm512_loadu_ps(y + i + 32)));
+    _mm512_storeu_ps(y + i + 48, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i + 48), _mm512_loadu_ps(y + i + 48)));
+  }
+  for (; i + 16 <= n; i += 16)
+    _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+  if (i < n) {
+    __mmask16 m = (__mmask16)((1u << (n - i)) - 1);
+    _mm512_mask_storeu_ps(y + i, m, _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i)));
+  }
+}
+
+__attribute__((target("avx512f")))
+static void avx512_daxpy(double a, const double *x, double *y, unsigned long n){
+
+  __m512d va = _mm512_set1_pd(a);
+  unsigned long i = 0;
+
+  for (; i + 32 <= n; i += 32) {
+    _mm512_storeu_pd(y + i, _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    _mm512_storeu_pd(y + i + 8, _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8)));
+    _mm512_storeu_pd(y + i + 16, _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16)));
+    _mm512_storeu_pd(y + i + 24, _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24)));
+  }
+  for (; i + 8 <= n; i += 8)
+    _mm512_storeu_pd(y + i, _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+  if (i < n) {
+    __mmask8 m = (__mmask8)((1u << (n - i)) - 1);
+    _mm512_mask_storeu_pd(y + i, m, _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(m, x + i), _mm512_maskz_loadu_pd(m, y + i)));
+  }
+}
+
+__attribute__((target("avx512f")))
+static void avx512_sscal(float a, float *x, unsigned long n){
+
+  __m512 va = _mm512_set1_ps(a);
+  unsigned long i = 0;
+
+  for (; i + 64 <= n; i += 64) {
+    _mm512_storeu_ps(x + i, _mm512_mul_ps(va, _mm512_loadu_ps(x + i)));
+    _mm512_storeu_ps(x + i + 16, _mm512_mul_ps(va, _mm512_loadu_ps(x + i + 16)));
+    _mm512_storeu_ps(x + i + 32, _mm512_mul_ps(va, _mm512_loadu_ps(x + i + 32)));
+    _mm512_storeu_ps(x + i + 48, _mm512_mul_ps(va, _mm512_loadu_ps(x + i + 48)));
+  }
+  for (; i + 16 <= n; i += 16) _mm512_storeu_ps(x + i, _mm512_mul_ps(va, _mm512_loadu_ps(x + i)));
+  if (i < n) {
+    __mmask16 m = (__mmask16)((1u << (n - i)) - 1);
+    _mm512_mask_storeu_ps(x + i, m, _mm512_mul_ps(va, _mm512_maskz_loadu_ps(m, x + i)));
+  }
+}
+
+__attribute__((target("avx512f")))
+static void avx512_dscal(double a, double *x, unsigned long n){
+
+  __m512d va = _mm512_set1_pd(a);
+  unsigned long i = 0;
+
+  for (; i + 32 <= n; i += 32) {
+    _mm512_storeu_pd(x + i, _mm512_mul_pd(va, _mm512_loadu_pd(x + i)));
+    _mm512_storeu_pd(x + i + 8, _mm512_mul_pd(va, _mm512_loadu_pd(x + i + 8)));
+    _mm512_storeu_pd(x + i + 16, _mm512_mul_pd(va, _mm512_loadu_pd(x + i + 16)));
+    _mm512_storeu_pd(x + i + 24, _mm512_mul_pd(va, _mm512_loadu_pd(x + i + 24)));
+  }
+  for (; i + 8 <= n; i += 8) _mm512_storeu_pd(x + i, _mm512_mul_pd(va, _mm512_loadu_pd(x + i)));
+  if (i < n) {
+    __mmask8 m = (__mmask8)((1u << (n - i)) - 1);
+    _mm512_mask_storeu_pd(x + i, m, _mm512_mul_pd(va, _mm512_maskz_loadu_pd(m, x + i)));
+  }
+}
+
+static double avx512_ssumsq(const float *x, unsigned long n){ return avx512_sdot(x, x, n); }
+static double avx512_dsumsq(const double *x, unsigned long n){ return avx512_ddot(x, x, n); }
+
+/* The lanes of each sum are picked with mask registers; the remainder with a masked load */
+__attribute__((target("avx512f")))
+static void avx512_snrm2(const float *x, unsigned long n, float sum[3]){
+
+  const __m512 tsml = _mm512_set1_ps(BLUE_TSML(FLT_MIN_EXP)), tbig = _mm512_set1_ps(BLUE_TBIG(FLT_MAX_EXP, FLT_MANT_DIG));
+  const __m512 ssml = _mm512_set1_ps(BLUE_SSML(FLT_MIN_EXP, FLT_MANT_DIG)), sbig = _mm512_set1_ps(BLUE_SBIG(FLT_MAX_EXP, FLT_MANT_DIG));
+  __m512 big = _mm512_setzero_ps(), med = _mm512_setzero_ps(), sml = _mm512_setzero_ps(), ax, v;
+  __mmask16 mb, ms;
+  unsigned long i = 0;
+
+  for (; i < n; i += 16) {
+    if (i + 16 <= n) ax = _mm512_abs_ps(_mm512_loadu_ps(x + i));
+    else ax = _mm512_abs_ps(_mm512_maskz_loadu_ps((__mmask16)((1u << (n - i)) - 1), x + i));
+    mb = _mm512_cmp_ps_mask(ax, tbig, _CMP_GT_OQ);
+    ms = _mm512_cmp_ps_mask(ax, tsml, _CMP_LT_OQ);
+    v = _mm512_mul_ps(ax, sbig);
+    big = _mm512_mask3_fmadd_ps(v, v, big, mb);
+    v = _mm512_mul_ps(ax, ssml);
+    sml = _mm512_mask3_fmadd_ps(v, v, sml, ms);
+    med = _mm512_mask3_fmadd_ps(ax, ax, med, (__mmask16) ~(mb | ms));
+  }
+
+  sum[0] += _mm512_reduce_add_ps(big);
+  sum[1] += _mm512_reduce_add_ps(med);
+  sum[2] += _mm512_reduce_add_ps(sml);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_dnrm2(const double *x, unsigned long n, double sum[3]){
+
+  const __m512d tsml = _mm512_set1_pd(BLUE_TSML(DBL_MIN_EXP)), tbig = _mm512_set1_pd(BLUE_TBIG(DBL_MAX_EXP, DBL_MANT_DIG));
+  const __m512d ssml = _mm512_set1_pd(BLUE_SSML(DBL_MIN_EXP, DBL_MANT_DIG)), sbig = _mm512_set1_pd(BLUE_SBIG(DBL_MAX_EXP, DBL_MANT_DIG));
+  __m512d big = _mm512_setzero_pd(), med = _mm512_setzero_pd(), sml = _mm512_setzero_pd(), ax, v;
+  __mmask8 mb, ms;
+  unsigned long i = 0;
+
+  for (; i < n; i += 8) {
+    if (i + 8 <= n) ax = _mm512_abs_pd(_mm512_loadu_pd(x + i));
+    else ax = _mm512_abs_pd(_mm512_maskz_loadu_pd((__mmask8)((1u << (n - i)) - 1), x + i));
+    mb = _mm512_cmp_pd_mask(ax, tbig, _CMP_GT_OQ);
+    ms = _mm512_cmp_pd_mask(ax, tsml, _CMP_LT_OQ);
+    v = _mm512_mul_pd(ax, sbig);
+    big = _mm512_mask3_fmadd_pd(v, v, big, mb);
+    v = _mm512_mul_pd(ax, ssml);
+    sml = _mm512_mask3_fmadd_pd(v, v, sml, ms);
+    med = _mm512_mask3_fmadd_pd(ax, ax, med, (__mmask8) ~(mb | ms));
+  }
+
+  sum[0] += _mm512_reduce_add_pd(big);
+  sum[1] += _mm512_reduce_add_pd(med);
+  sum[2] += _mm512_reduce_add_pd(sml);
+}
+
+/* 8 x 32 float and 8 x 16 double tiles, two vectors per row: 16 of the 32 registers */
+__attribute__((target("avx512f")))
+static void avx512_sgemm(unsigned long kc, const float *a, const float *b, float *c, unsigned long ldc){
+
+  __m512 c0[8], c1[8], b0, b1, ai;
+  unsigned long p;
+  int i;
+
+  for (i = 0; i < 8; i++) c0[i] = c1[i] = _mm512_setzero_ps();
+  for (p = 0; p < kc; p++) {
+    b0 = _mm512_loadu_ps(b + p * 32);
+    b1 = _mm512_loadu_ps(b + p * 32 + 16);
+    for (i = 0; i < 8; i++) {
+      ai = _mm512_set1_ps(a[p * 8 + i]);
+      c0[i] = _mm512_fmadd_ps(ai, b0, c0[i]);
+      c1[i] = _mm512_fmadd_ps(ai, b1, c1[i]);
+    }
+  }
+
+  for (i = 0; i < 8; i++) {
+    _mm512_storeu_ps(c + i * ldc, _mm512_add_ps(_mm512_loadu_ps(c + i * ldc), c0[i]));
+    _mm512_storeu_ps(c + i * ldc + 16, _mm512_add_ps(_mm512_loadu_ps(c + i * ldc + 16), c1[i]));
+  }
+}
+
+__attribute__((target("avx512f")))
+static void avx512_dgemm(unsigned long kc, const double *a, const double *b, double *c, unsigned long ldc){
+
+  __m512d c0[8], c1[8], b0, b1, ai;
+  unsigned long p;
+  int i;
+
+  for (i = 0; i < 8; i++) c0[i] = c1[i] = _mm512_setzero_pd();
+  for (p = 0; p < kc; p++) {
+    b0 = _mm512_loadu_pd(b + p * 16);
+    b1 = _mm512_loadu_pd(b + p * 16 + 8);
+    for (i = 0; i < 8; i++) {
+      ai = _mm512_set1_pd(a[p * 8 + i]);
+      c0[i] = _mm512_fmadd_pd(ai, b0, c0[i]);
+      c1[i] = _mm512_fmadd_pd(ai, b1, c1[i]);
+    }
+  }
+
+  for (i = 0; i < 8; i++) {
+    _mm512_storeu_pd(c + i * ldc, _mm512_add_pd(_mm512_loadu_pd(c + i * ldc), c0[i]));
+    _mm512_storeu_pd(c + i * ldc + 8, _mm512_add_pd(_mm512_loadu_pd(c + i * ldc + 8), c1[i]));
+  }
+}
+
+/*
+ * fp16 by the AVX-512 conversions, bf16 by integer widening and
+ * rounding; the down-convert of AVX-512F narrows the halves. The
+ * remainder is converted one element at a time, as 16-bit masked
+ * loads need AVX-512BW.
+ */
+__attribute__((target("avx512f")))
+static void avx512_h2s(const uint16_t *h, float *x, unsigned long n){
+
+  unsigned long i = 0;
+
+  for (; i + 32 <= n; i += 32) {
+    _mm512_storeu_ps(x + i, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *) (h + i))));
+    _mm512_storeu_ps(x + i + 16, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *) (h + i + 16))));
+  }
+  for (; i < n; i++) x[i] = half_to_float(h[i]);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_s2h(const float *x, uint16_t *h, unsigned long n){
+
+  unsigned long i = 0;
+
+  for (; i + 32 <= n; i += 32) {
+    _mm256_storeu_si256((__m256i *) (h + i), _mm512_cvtps_ph(_mm512_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT));
+    _mm256_storeu_si256((__m256i *) (h + i + 16), _mm512_cvtps_ph(_mm512_loadu_ps(x + i + 16), _MM_FROUND_TO_NEAREST_INT));
+  }
+  for (; i < n; i++) h[i] = half_from_float(x[i]);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_b2s(const uint16_t *h, float *x, unsigned long n){
+
+  __m512i v;
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    v = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *) (h + i)));
+    _mm512_storeu_ps(x + i, _mm512_castsi512_ps(_mm512_slli_epi32(v, 16)));
+  }
+  for (; i < n; i++) x[i] = bf16_to_float(h[i]);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_s2b(const float *x, uint16_t *h, unsigned long n){
+
+  __m512 f;
+  __m512i u, r;
+  __mmask16 nan;
+  unsigned long i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    f = _mm512_loadu_ps(x + i);
+    u = _mm512_castps_si512(f);
+    nan = _mm512_cmp_ps_mask(f, f, _CMP_UNORD_Q);
+    r = _mm512_add_epi32(u, _mm512_add_epi32(_mm512_set1_epi32(0x7fff),
+                                             _mm512_and_si512(_mm512_srli_epi32(u, 16), _mm512_set1_epi32(1))));
+    r = _mm512_mask_mov_epi32(_mm512_srli_epi32(r, 16), nan, _mm512_or_si512(_mm512_srli_epi32(u, 16), _mm512_set1_epi32(0x40)));
+    _mm256_storeu_si256((__m256i *) (h + i), _mm512_cvtepi32_epi16(r));
+  }
+  for (; i < n; i++) h[i] = bf16_from_float(x[i]);
+}
+
+/*
+ * The int16 kernels are those of AVX2, as 512-bit word multiplies and
+ * packs need AVX-512BW; the int32 dot product multiplies 8 even lanes
+ * at a time and takes the remainder with a masked load.
+ */
+__attribute__((target("avx512f")))
+static long long avx512_i32dot(const int32_t *x, const int32_t *y, unsigned long n){
+
+  __m512i s0 = _mm512_setzero_si512(), s1 = _mm512_setzero_si512(), vx, vy;
+  unsigned long i = 0;
+
+  for (; i < n; i += 16) {
+    if (i + 16 <= n) {
+      vx = _mm512_loadu_si512(x + i);
+      vy = _mm512_loadu_si512(y + i);
+    } else {
+      __mmask16 m = (__mmask16)((1u << (n - i)) - 1);
+      vx = _mm512_maskz_loadu_epi32(m, x + i);
+      vy = _mm512_maskz_loadu_epi32(m, y + i);
+    }
+    s0 = _mm512_add_epi64(s0, _mm512_mul_epi32(vx, vy));
+    s1 = _mm512_add_epi64(s1, _mm512_mul_epi32(_mm512_srli_epi64(vx, 32), _mm512_srli_epi64(vy, 32)));
+  }
+
+  return _mm512_reduce_add_epi64(_mm512_add_epi64(s0, s1));
+}
+
+static const simd_kernels avx512_kernels = {
+  "avx512", avx512_sdot, avx512_ddot, avx512_saxpy, avx512_daxpy,
+  avx512_sscal, avx512_dscal, avx512_ssumsq, avx512_dsumsq, avx512_snrm2, avx512_dnrm2,
+  8, 32, avx512_sgemm, 8, 16, avx512_dgemm,
+  avx512_h2s, avx512_s2h, avx512_b2s, avx512_s2b,
+  avx2_i16dot, avx2_i16axpy, avx2_i16scal, avx512_i32dot
+};
+
+#endif
+
+const simd_kernels *simd = &scalar_kernels;
+
+/* Whether this CPU can run the kernels in k */
+static int simd_supported(const simd_kernels *k){
+
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (k == &avx512_kernels) return __builtin_cpu_supports("avx512f");
+  if (k == &avx2_kernels) return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+  if (k == &sse2_kernels) return __builtin_cpu_supports("sse2");
+#endif
+  return k == &scalar_kernels;
+}
+
+/* The instruction sets in this build, widest first */
+static const simd_kernels *all_kernels[] = {
+#ifdef SIMD_X86
+  &avx512_kernels, &avx2_kernels, &sse2_kernels,
+#endif
+  &scalar_kernels, NULL
+};
+
+/*
+ * Use the instruction set named isa, or the widest this CPU supports
+ * for "auto". Returns 0 on success, -1 if isa is unknown or the CPU
+ * does not support it.
+ */
+int simd_select(const char *isa){
+
+  int i;
+
+  for (i = 0; all_kernels[i] != NULL; i++) {
+    if (strcmp(isa, "auto") == 0 ? simd_supported(all_kernels[i]) : strcmp(isa, all_kernels[i]->name) == 0) {
+      if (!simd_supported(all_kernels[i])) {
+        fprintf(stderr, "ERROR: this CPU does not support %s\n", isa);
+        return -1;
+      }
+      simd = all_kernels[i];
+      return 0;
+    }
+  }
+
+  fprintf(stderr, "ERROR: unknown instruction set \"%s\", expected auto", isa);
+  for (i = 0; all_kernels[i] != NULL; i++) fprintf(stderr, ", %s", all_kernels[i]->name);
+  fprintf(stderr, "\n");
+
+  return -1;
+}
+
+const char *simd_isa(void){ return simd->name; }
+
+/* The instruction sets in this build, marking those the CPU supports */
+void simd_list(FILE *f){
+
+  int i;
+
+  for (i = 0; all_kernels[i] != NULL; i++)
+    fprintf(f, "%s%s%s", i ? " " : "", all_kernels[i]->name, simd_supported(all_kernels[i]) ? "" : "(n/a)");
+  fprintf(f, "\n");
+}
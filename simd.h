@@ -0,0 +1,99 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Vector instruction set kernels.
+ *
+ * Each simd_kernels table holds the float and double dot product,
+ * AXPY, scaling, sum of squares and the three sums of Blue's norm
+ * (see reduce.h) for one instruction set: plain C loops (scalar),
+ * SSE2, AVX2 with FMA and F16C, and AVX-512. The vector versions keep
+ * four accumulators and unroll by four vectors, so reductions are not
+ * bound by the latency of one add chain. They are compiled with
+ * target attributes, so one binary carries all of them, and
+ * simd_select() picks the best the CPU supports (cpuid) unless an
+ * instruction set is forced with --isa.
+ *
+ * The table also holds the GEMM micro-kernel of each type (see
+ * gemm.h): C += A * B for an mr x nr tile of C, row-major with rows
+ * ldc apart, from kc columns of A packed mr elements per column and kc
+ * rows of B packed nr elements per row. The tile is sized to keep its
+ * accumulators in the registers of the instruction set.
+ *
+ * Last come the conversions of n fp16 (h) or bf16 (b) values to float
+ * (s) and back (see half.h), rounding to nearest even; the kernels on
+ * 16-bit data convert blocks to float and run the float kernels on
+ * them.
+ *
+ * The integer kernels widen: the int16 dot product multiplies pairs
+ * into 32 bits (pmaddwd) and sums in 64, the int32 one multiplies and
+ * sums in 64 bits, and int16 AXPY and scaling compute in 32 bits and
+ * saturate the result to int16. The dot products are exact over the
+ * whole range of their types.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+typedef struct {
+  const char *name;
+  double (*sdot)(const float *x, const float *y, unsigned long n);
+  double (*ddot)(const double *x, const double *y, unsigned long n);
+  void (*saxpy)(float a, const float *x, float *y, unsigned long n);
+  void (*daxpy)(double a, const double *x, double *y, unsigned long n);
+  void (*sscal)(float a, float *x, unsigned long n);
+  void (*dscal)(double a, double *x, unsigned long n);
+  double (*ssumsq)(const float *x, unsigned long n);
+  double (*dsumsq)(const double *x, unsigned long n);
+  void (*snrm2)(const float *x, unsigned long n, float sum[3]);
+  void (*dnrm2)(const double *x, unsigned long n, double sum[3]);
+  int sgemm_mr, sgemm_nr;
+  void (*sgemm)(unsigned long kc, const float *a, const float *b, float *c, unsigned long ldc);
+  int dgemm_mr, dgemm_nr;
+  void (*dgemm)(unsigned long kc, const double *a, const double *b, double *c, unsigned long ldc);
+  void (*h2s)(const uint16_t *h, float *x, unsigned long n);
+  void (*s2h)(const float *x, uint16_t *h, unsigned long n);
+  void (*b2s)(const uint16_t *h, float *x, unsigned long n);
+  void (*s2b)(const float *x, uint16_t *h, unsigned long n);
+  long long (*i16dot)(const int16_t *x, const int16_t *y, unsigned long n);
+  void (*i16axpy)(int a, const int16_t *x, int16_t *y, unsigned long n);
+  void (*i16scal)(int a, int16_t *x, unsigned long n);
+  long long (*i32dot)(const int32_t *x, const int32_t *y, unsigned long n);
+} simd_kernels;
+
+/*
+ * Blue's thresholds and scaling factors for a binary type with t
+ * digits and exponents in [emin, emax] (FLT_MIN_EXP and so on):
+ * squares of elements in [tsml, tbig] neither overflow nor underflow,
+ * bigger elements are scaled by sbig and smaller ones by ssml. The
+ * nrm2 kernels add the squares of the big, medium and small elements
+ * of x, scaled so, to sum[0], sum[1] and sum[2].
+ */
+#define BLUE_TSML(emin) ldexp(1.0, -((1 - (emin)) / 2))
+#define BLUE_TBIG(emax, t) ldexp(1.0, ((emax) - (t) + 1) / 2)
+#define BLUE_SSML(emin, t) ldexp(1.0, ((t) - (emin) + 1) / 2)
+#define BLUE_SBIG(emax, t) ldexp(1.0, -(((emax) + (t)) / 2))
+
+extern const simd_kernels *simd;
+
+int simd_select(const char *isa);
+const char *simd_isa(void);
+void simd_list(FILE *f);
@@ -0,0 +1,297 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "memory.h"
+#include "steal.h"
+
+#define STEAL_MAX_THREADS 1024
+
+/* A worker's chunks [top, bottom), padded to a cache line of its own */
+typedef struct {
+  pthread_mutex_t lock;
+  unsigned long top, bottom;
+  char pad[64];
+} deque;
+
+static int nthreads = 1;
+static int started = 0;
+static pthread_t threads[STEAL_MAX_THREADS];
+static deque deques[STEAL_MAX_THREADS];
+static int cpus[STEAL_MAX_THREADS];
+static int ncpus = 0;
+
+/* The current job, guarded by lock */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+static unsigned long generation = 0;
+static int running = 0;                  /* workers yet to finish the job */
+static int stopping = 0;
+static par_fn job_fn;
+static void (*job_each)(void *arg);      /* set for a steal_each() job */
+static void *job_arg;
+static unsigned long job_n, job_chunks;
+
+/* Result of every chunk of the current job */
+static double *results = NULL;
+static unsigned long nresults = 0;
+
+static __thread int in_steal = 0;
+static __thread int self = 0;            /* this thread's worker number */
+
+
+/* Chunk c of job_chunks near-equal chunks of [0, job_n) */
+static void run_chunk(unsigned long c){
+
+  unsigned long size = job_n / job_chunks, rem = job_n % job_chunks;
+  unsigned long begin = c * size + (c < rem ? c : rem);
+  unsigned long end = begin + size + (c < rem);
+
+  results[c] = (begin < end) ? job_fn(job_arg, begin, end) : 0.0;
+}
+
+/* Take the chunk at the front of worker t's deque; returns 0 if empty */
+static int pop(int t, unsigned long *c){
+
+  deque *d = &deques[t];
+  int found = 0;
+
+  pthread_mutex_lock(&d->lock);
+  if (d->top < d->bottom) {
+    *c = d->top++;
+    found = 1;
+  }
+  pthread_mutex_unlock(&d->lock);
+
+  return found;
+}
+
+/*
+ * Move the back half of another worker's deque into worker t's, which
+ * is empty; victims are tried round robin from t + 1. Returns 0 if
+ * every deque was empty, and then the job has no chunks left to start.
+ */
+static int steal(int t){
+
+  unsigned long top = 0, bottom = 0;
+  int i;
+
+  for (i = 1; i < nthreads && top == bottom; i++) {
+    deque *d = &deques[(t + i) % nthreads];
+    pthread_mutex_lock(&d->lock);
+    if (d->top < d->bottom) {
+      top = d->bottom - (d->bottom - d->top + 1) / 2;
+      bottom = d->bottom;
+      d->bottom = top;
+    }
+    pthread_mutex_unlock(&d->lock);
+  }
+  if (top == bottom) return 0;
+
+  pthread_mutex_lock(&deques[t].lock);
+  deques[t].top = top;
+  deques[t].bottom = bottom;
+  pthread_mutex_unlock(&deques[t].lock);
+
+  return 1;
+}
+
+static void run_worker(int t){
+
+  unsigned long c;
+
+  do {
+    while (pop(t, &c)) run_chunk(c);
+  } while (steal(t));
+}
+
+static void *worker(void *p){
+
+  int t = (int)(long)p;
+  unsigned long seen = 0;
+
+  in_steal = 1;
+  self = t;
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    while (generation == seen && !stopping) pthread_cond_wait(&start, &lock);
+    if (stopping) break;
+    seen = generation;
+    pthread_mutex_unlock(&lock);
+
+    if (job_each) job_each(job_arg);
+    else run_worker(t);
+
+    pthread_mutex_lock(&lock);
+    if (--running == 0) pthread_cond_signal(&done);
+  }
+  pthread_mutex_unlock(&lock);
+
+  return NULL;
+}
+
+/*
+ * Start n workers in all, including the calling thread; n <= 0 takes
+ * one per CPU on the benchmark thread's node. Returns the number started.
+ */
+int steal_start(int n){
+
+  pthread_attr_t attr;
+  int local, t;
+
+  ncpus = mem_cpus(cpus, STEAL_MAX_THREADS, &local);
+  if (n <= 0) n = local;
+  if (n > STEAL_MAX_THREADS) n = STEAL_MAX_THREADS;
+
+  for (t = 0; t < n; t++) {
+    pthread_mutex_init(&deques[t].lock, NULL);
+    deques[t].top = deques[t].bottom = 0;
+  }
+  started = n;
+
+  generation = 0;
+  stopping = 0;
+  nthreads = 1;
+  for (t = 1; t < n; t++) {
+    pthread_attr_init(&attr);
+#ifdef __linux__
+    if (mem_pinned() >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus[t % ncpus], &set);
+      pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    }
+#endif
+    if (pthread_create(&threads[t], &attr, worker, (void *)(long)t) != 0) {
+      fprintf(stderr, "WARNING: could only start %d kernel threads\n", t);
+      pthread_attr_destroy(&attr);
+      break;
+    }
+    pthread_attr_destroy(&attr);
+    nthreads = t + 1;
+  }
+
+  return nthreads;
+}
+
+int steal_threads(void){ return nthreads; }
+
+int steal_thread(void){ return self; }
+
+double steal_for(unsigned long n, unsigned long grain, par_fn fn, void *arg){
+
+  unsigned long chunks, c, first;
+  double sum = 0.0;
+  int t;
+
+  if (nthreads == 1 || in_steal || n < 2) return n ? fn(arg, 0, n) : 0.0;
+
+  chunks = grain ? (n + grain - 1) / grain : (unsigned long)nthreads;
+  if (chunks > n) chunks = n;
+  if (chunks > nresults) {
+    double *r = realloc(results, chunks * sizeof(double));
+    if (r == NULL) return fn(arg, 0, n);
+    results = r;
+    nresults = chunks;
+  }
+
+  /* worker t starts with the t-th contiguous run of chunks */
+  for (t = 0, first = 0; t < nthreads; t++) {
+    unsigned long last = chunks * (t + 1) / nthreads;
+    deques[t].top = first;
+    deques[t].bottom = last;
+    first = last;
+  }
+
+  pthread_mutex_lock(&lock);
+  job_fn = fn;
+  job_arg = arg;
+  job_n = n;
+  job_chunks = chunks;
+  running = nthreads - 1;
+  generation++;
+  pthread_cond_broadcast(&start);
+  pthread_mutex_unlock(&lock);
+
+  in_steal = 1;
+  run_worker(0);
+  in_steal = 0;
+
+  pthread_mutex_lock(&lock);
+  while (running > 0) pthread_cond_wait(&done, &lock);
+  pthread_mutex_unlock(&lock);
+
+  for (c = 0; c < chunks; c++) sum += results[c];
+
+  return sum;
+}
+
+/* Run fn once on every worker, the calling thread included */
+void steal_each(void (*fn)(void *arg), void *arg){
+
+  if (nthreads == 1 || in_steal) {
+    fn(arg);
+    return;
+  }
+
+  pthread_mutex_lock(&lock);
+  job_each = fn;
+  job_arg = arg;
+  running = nthreads - 1;
+  generation++;
+  pthread_cond_broadcast(&start);
+  pthread_mutex_unlock(&lock);
+
+  fn(arg);
+
+  pthread_mutex_lock(&lock);
+  while (running > 0) pthread_cond_wait(&done, &lock);
+  job_each = NULL;
+  pthread_mutex_unlock(&lock);
+}
+
+void steal_stop(void){
+
+  int t;
+
+  if (!started) return;
+  pthread_mutex_lock(&lock);
+  stopping = 1;
+  pthread_cond_broadcast(&start);
+  pthread_mutex_unlock(&lock);
+
+  for (t = 1; t < nthreads; t++) pthread_join(threads[t], NULL);
+  for (t = 0; t < started; t++) pthread_mutex_destroy(&deques[t].lock);
+  nthreads = 1;
+  started = 0;
+}
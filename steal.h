@@ -0,0 +1,45 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Work-stealing runtime on pthreads, the threaded kernels' backend
+ * when there is no OpenMP or when --runtime=steal asks for it.
+ *
+ * steal_for() cuts [0, n) into chunks of about grain iterations (one
+ * chunk per worker if grain is 0) and deals them out in order, worker
+ * t getting the t-th contiguous run of chunks in a deque of its own.
+ * A worker takes chunks from the front of its deque; once it is empty
+ * it steals the back half of another worker's deque, so irregular
+ * loops balance themselves. Each chunk's result is kept and the
+ * results are summed in chunk order, so the sum does not depend on
+ * which worker ran what. The calling thread is worker 0, workers are
+ * pinned as in pool_start(), and a steal_for() inside a chunk runs
+ * inline. steal_each() runs a function once on every worker.
+ */
+
+#include "par.h"
+
+int steal_start(int nthreads);
+int steal_threads(void);
+int steal_thread(void);
+double steal_for(unsigned long n, unsigned long grain, par_fn fn, void *arg);
+void steal_each(void (*fn)(void *arg), void *arg);
+void steal_stop(void);
@@ -27,570 +27,856 @@
 #include <time.h>
 
 #include "level1.h"
+#include "memory.h"
+#include "par.h"
+#include "pool.h"
+#include "rng.h"
 #include "utils.h"
 
 #define REPS 100
 
+/* Stencil state: two work buffers of size^2 or size^3 elements, with halos */
+typedef struct {
+	unsigned int size;
+	int dims;
+	size_t elem;
+	void *a0;
+	void *a1;
+} stencil_state;
 
-void float_stencil27(unsigned int size){
 
-	int i, j, k, iter;
-	int n = size-2;
-	float fac = 1.0/26;
+static stencil_state *stencil_alloc(unsigned long size, int dims, size_t elem, char *title){
+
+	size_t count = (dims == 3) ? (size_t)size*size*size : (size_t)size*size;
+	stencil_state *s = calloc(1, sizeof(stencil_state));
+
+	if(s==NULL) return NULL;
+
+	s->size = size;
+	s->dims = dims;
+	s->elem = elem;
 
 	/* Work buffers, with halos */
-	float *a0 = (float*)malloc(sizeof(float)*size*size*size);
-	float *a1 = (float*)malloc(sizeof(float)*size*size*size);
+	s->a0 = mem_alloc(elem*count);
+	s->a1 = mem_alloc(elem*count);
 
-	if(a0==NULL||a1==NULL){
+	if(s->a0==NULL||s->a1==NULL){
 		/* Something went wrong in the memory allocation here, fail gracefully */
-		printf("27-point Single Precision Stencil Error: Unable to allocate memory\n");
+		printf("%s Error: Unable to allocate memory\n", title);
+		mem_free(s->a0);
+		mem_free(s->a1);
+		free(s);
+		return NULL;
 	}
 
-	struct timespec start, end;
+	return s;
+}
+
+static void stencil_teardown(void *p){
+
+	stencil_state *s = p;
+
+	mem_free(s->a0);
+	mem_free(s->a1);
+	free(s);
+}
 
-	/* zero all of array (including halos) */
-	for (i = 0; i < size; i++) {
+/* Number of interior points updated by one sweep */
+static double stencil_points(stencil_state *s){
+
+	double n = s->size-2;
+
+	return (s->dims == 3) ? n*n*n : n*n;
+}
+
+/*
+ * One sweep reads a0 and writes a1, then copies a1 back into a0.
+ * An N-point stencil sums N-1 neighbours and scales the sum, N-1 flops.
+ */
+static double stencil_bytes(void *p){ stencil_state *s = p; return 4.0*stencil_points(s)*s->elem; }
+static double stencil_footprint(void *p){ stencil_state *s = p; return 2.0*stencil_points(s)*s->elem; }
+
+static double stencil27_flops(void *p){ return 26.0*stencil_points(p); }
+static double stencil19_flops(void *p){ return 18.0*stencil_points(p); }
+static double stencil9_flops(void *p){ return 8.0*stencil_points(p); }
+static double stencil5_flops(void *p){ return 4.0*stencil_points(p); }
+
+
+/*
+ * Fill a0 for the current size: zero halos, random interior. The
+ * planes (rows in 2D) are split over the setup threads, and a1 is
+ * zeroed alongside so both buffers are first touched plane by plane
+ * by the same thread.
+ */
+static void float_stencil3d_planes(void *p, unsigned long begin, unsigned long end){
+
+	stencil_state *s = p;
+	int i, j, k;
+	int size = s->size;
+	int n = size-2;
+	float *a0 = s->a0;
+	float *a1 = s->a1;
+
+	for (i = begin; i < (int)end; i++) {
+		/* zero the plane (including halos) */
 		for (j = 0; j < size; j++) {
 			for (k = 0; k < size; k++) {
 				a0[i*size*size+j*size+k] = 0.0;
+				a1[i*size*size+j*size+k] = 0.0;
 			}
 		}
-	}
+		if (i < 1 || i > n) continue;
 
-	/* use random numbers to fill interior */
-	for (i = 1; i < n+1; i++) {
+		/* use random numbers to fill interior, one row at a time */
 		for (j = 1; j < n+1; j++) {
-			for (k = 1; k < n+1; k++) {
-				a0[i*size*size+j*size+k] = (float) rand()/ (float)(1.0 + RAND_MAX);
-			}
+			rng_float(&a0[i*size*size+j*size+1], n, 0.0, 1.0, RNG_X, ((unsigned long long)(i-1)*n+(j-1))*n);
 		}
 	}
+}
 
-	/* run main computation on host */
-	clock_gettime(CLOCK, &start);
-	for (iter = 0; iter < REPS; iter++) {
-
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				for (k = 1; k < n+1; k++) {
-					a1[i*size*size+j*size+k] = (
-							a0[i*size*size+(j-1)*size+k] + a0[i*size*size+(j+1)*size+k] +
-							a0[(i-1)*size*size+j*size+k] + a0[(i+1)*size*size+j*size+k] +
-							a0[(i-1)*size*size+(j-1)*size+k] + a0[(i-1)*size*size+(j+1)*size+k] +
-							a0[(i+1)*size*size+(j-1)*size+k] + a0[(i+1)*size*size+(j+1)*size+k] +
-
-							a0[i*size*size+(j-1)*size+(k-1)] + a0[i*size*size+(j+1)*size+(k-1)] +
-							a0[(i-1)*size*size+j*size+(k-1)] + a0[(i+1)*size*size+j*size+(k-1)] +
-							a0[(i-1)*size*size+(j-1)*size+(k-1)] + a0[(i-1)*size*size+(j+1)*size+(k-1)] +
-							a0[(i+1)*size*size+(j-1)*size+(k-1)] + a0[(i+1)*size*size+(j+1)*size+(k-1)] +
-
-							a0[i*size*size+(j-1)*size+(k+1)] + a0[i*size*size+(j+1)*size+(k+1)] +
-							a0[(i-1)*size*size+j*size+(k+1)] + a0[(i+1)*size*size+j*size+(k+1)] +
-							a0[(i-1)*size*size+(j-1)*size+(k+1)] + a0[(i-1)*size*size+(j+1)*size+(k+1)] +
-							a0[(i+1)*size*size+(j-1)*size+(k+1)] + a0[(i+1)*size*size+(j+1)*size+(k+1)] +
-
-							a0[i*size*size+j*size+(k-1)] + a0[i*size*size+j*size+(k+1)]
-						) * fac;
-				}
-			}
-		}
-
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				for (k = 1; k < n+1; k++) {
-					a0[i*size*size+j*size+k] = a1[i*size*size+j*size+k];
-				}
-			}
-		}
+static void float_stencil3d_init(stencil_state *s){ pool_for(s->size, float_stencil3d_planes, s); }
 
-	} /* end iteration loop */
+static void *float_stencil3d_setup(unsigned long size, char *title){
 
-	clock_gettime(CLOCK, &end);
-	elapsed_time_hr(start, end, "Single Precision Stencil - 27 point");
+	stencil_state *s = stencil_alloc(size, 3, sizeof(float), title);
 
-	/* Free malloc'd memory to prevent leaks */
-	free(a0);
-	free(a1);
+	if(s==NULL) return NULL;
+	float_stencil3d_init(s);
 
+	return s;
 }
 
+static void double_stencil3d_planes(void *p, unsigned long begin, unsigned long end){
 
-void double_stencil27(unsigned int size){
-
-	int i, j, k, iter;
+	stencil_state *s = p;
+	int i, j, k;
+	int size = s->size;
 	int n = size-2;
-	double fac = 1.0/26;
+	double *a0 = s->a0;
+	double *a1 = s->a1;
 
-	/* Work buffers, with halos */
-	double *a0 = (double*)malloc(sizeof(double)*size*size*size);
-	double *a1 = (double*)malloc(sizeof(double)*size*size*size);
-
-	if(a0==NULL||a1==NULL){
-		/* Something went wrong in the memory allocation here, fail gracefully */
-		printf("27-point Double Precision Stencil Error: Unable to allocate memory\n");
-	}
-
-	struct timespec start, end;
-
-	/* zero all of array (including halos) */
-	for (i = 0; i < size; i++) {
+	for (i = begin; i < (int)end; i++) {
+		/* zero the plane (including halos) */
 		for (j = 0; j < size; j++) {
 			for (k = 0; k < size; k++) {
 				a0[i*size*size+j*size+k] = 0.0;
+				a1[i*size*size+j*size+k] = 0.0;
 			}
 		}
-	}
+		if (i < 1 || i > n) continue;
 
-	/* use random numbers to fill interior */
-	for (i = 1; i < n+1; i++) {
+		/* use random numbers to fill interior, one row at a time */
 		for (j = 1; j < n+1; j++) {
-			for (k = 1; k < n+1; k++) {
-				a0[i*size*size+j*size+k] = (double) rand()/ (double)(1.0 + RAND_MAX);
-			}
+			rng_double(&a0[i*size*size+j*size+1], n, 0.0, 1.0, RNG_X, ((unsigned long long)(i-1)*n+(j-1))*n);
 		}
 	}
+}
 
-	/* run main computation on host */
-	clock_gettime(CLOCK, &start);
-	for (iter = 0; iter < REPS; iter++) {
-
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				for (k = 1; k < n+1; k++) {
-					a1[i*size*size+j*size+k] = (
-							a0[i*size*size+(j-1)*size+k] + a0[i*size*size+(j+1)*size+k] +
-							a0[(i-1)*size*size+j*size+k] + a0[(i+1)*size*size+j*size+k] +
-							a0[(i-1)*size*size+(j-1)*size+k] + a0[(i-1)*size*size+(j+1)*size+k] +
-							a0[(i+1)*size*size+(j-1)*size+k] + a0[(i+1)*size*size+(j+1)*size+k] +
-
-							a0[i*size*size+(j-1)*size+(k-1)] + a0[i*size*size+(j+1)*size+(k-1)] +
-							a0[(i-1)*size*size+j*size+(k-1)] + a0[(i+1)*size*size+j*size+(k-1)] +
-							a0[(i-1)*size*size+(j-1)*size+(k-1)] + a0[(i-1)*size*size+(j+1)*size+(k-1)] +
-							a0[(i+1)*size*size+(j-1)*size+(k-1)] + a0[(i+1)*size*size+(j+1)*size+(k-1)] +
-
-							a0[i*size*size+(j-1)*size+(k+1)] + a0[i*size*size+(j+1)*size+(k+1)] +
-							a0[(i-1)*size*size+j*size+(k+1)] + a0[(i+1)*size*size+j*size+(k+1)] +
-							a0[(i-1)*size*size+(j-1)*size+(k+1)] + a0[(i-1)*size*size+(j+1)*size+(k+1)] +
-							a0[(i+1)*size*size+(j-1)*size+(k+1)] + a0[(i+1)*size*size+(j+1)*size+(k+1)] +
-
-							a0[i*size*size+j*size+(k-1)] + a0[i*size*size+j*size+(k+1)]
-					) * fac;
-				}
-			}
-		}
+static void double_stencil3d_init(stencil_state *s){ pool_for(s->size, double_stencil3d_planes, s); }
 
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				for (k = 1; k < n+1; k++) {
-					a0[i*size*size+j*size+k] = a1[i*size*size+j*size+k];
-				}
-			}
-		}
-	} /* end iteration loop */
+static void *double_stencil3d_setup(unsigned long size, char *title){
 
-	clock_gettime(CLOCK, &end);
-	elapsed_time_hr(start, end, "Double Precision Stencil - 27 point");
+	stencil_state *s = stencil_alloc(size, 3, sizeof(double), title);
 
-	/* Free malloc'd memory to prevent leaks */
-	free(a0);
-	free(a1);
+	if(s==NULL) return NULL;
+	double_stencil3d_init(s);
 
+	return s;
 }
 
+static void float_stencil2d_rows(void *p, unsigned long begin, unsigned long end){
 
-void float_stencil19(unsigned int size){
-
-
-	int i, j, k, iter;
+	stencil_state *s = p;
+	int i, j;
+	int size = s->size;
 	int n = size-2;
-	float fac = 1.0/18;
+	float *a0 = s->a0;
+	float *a1 = s->a1;
 
-	/* Work buffers, with halos */
-	float *a0 = (float*)malloc(sizeof(float)*size*size*size);
-	float *a1 = (float*)malloc(sizeof(float)*size*size*size);
+	for (i = begin; i < (int)end; i++) {
+		/* zero the row (including halos) */
+		for (j = 0; j < size; j++) {
+			a0[i*size+j] = 0.0;
+			a1[i*size+j] = 0.0;
+		}
+		if (i < 1 || i > n) continue;
 
-	if(a0==NULL||a1==NULL){
-		/* Something went wrong in the memory allocation here, fail gracefully */
-		printf("19-point Single Precision Stencil Error: Unable to allocate memory\n");
+		/* use random numbers to fill interior */
+		rng_float(&a0[i*size+1], n, 0.0, 1.0, RNG_X, (unsigned long long)(i-1)*n);
 	}
+}
+
+static void float_stencil2d_init(stencil_state *s){ pool_for(s->size, float_stencil2d_rows, s); }
+
+static void *float_stencil2d_setup(unsigned long size, char *title){
+
+	stencil_state *s = stencil_alloc(size, 2, sizeof(float), title);
+
+	if(s==NULL) return NULL;
+	float_stencil2d_init(s);
+
+	return s;
+}
+
+static void double_stencil2d_rows(void *p, unsigned long begin, unsigned long end){
+
+	stencil_state *s = p;
+	int i, j;
+	int size = s->size;
+	int n = size-2;
+	double *a0 = s->a0;
+	double *a1 = s->a1;
 
-	struct timespec start,end;
-	/* zero all of array (including halos) */
-	for (i = 0; i < size; i++) {
+	for (i = begin; i < (int)end; i++) {
+		/* zero the row (including halos) */
 		for (j = 0; j < size; j++) {
-			for (k = 0; k < size; k++) {
-				a0[i*size*size+j*size+k] = 0.0;
-			}
+			a0[i*size+j] = 0.0;
+			a1[i*size+j] = 0.0;
 		}
+		if (i < 1 || i > n) continue;
+
+		/* use random numbers to fill interior */
+		rng_double(&a0[i*size+1], n, 0.0, 1.0, RNG_X, (unsigned long long)(i-1)*n);
 	}
+}
 
-	/* use random numbers to fill interior */
-	for (i = 1; i < n+1; i++) {
+static void double_stencil2d_init(stencil_state *s){ pool_for(s->size, double_stencil2d_rows, s); }
+
+static void *double_stencil2d_setup(unsigned long size, char *title){
+
+	stencil_state *s = stencil_alloc(size, 2, sizeof(double), title);
+
+	if(s==NULL) return NULL;
+	double_stencil2d_init(s);
+
+	return s;
+}
+
+/*
+ * A smaller grid reuses the leading part of both buffers. The layout
+ * depends on the size, so a0 is filled again for the new one.
+ */
+static int stencil_resize(void *p, unsigned long size){
+
+	stencil_state *s = p;
+
+	s->size = size;
+	if(s->dims == 3){
+		if(s->elem == sizeof(float)) float_stencil3d_init(s);
+		else double_stencil3d_init(s);
+	} else {
+		if(s->elem == sizeof(float)) float_stencil2d_init(s);
+		else double_stencil2d_init(s);
+	}
+
+	return 0;
+}
+
+static void *float_stencil27_setup(unsigned long size){ return float_stencil3d_setup(size, "27-point Single Precision Stencil"); }
+static void *double_stencil27_setup(unsigned long size){ return double_stencil3d_setup(size, "27-point Double Precision Stencil"); }
+static void *float_stencil19_setup(unsigned long size){ return float_stencil3d_setup(size, "19-point Single Precision Stencil"); }
+static void *double_stencil19_setup(unsigned long size){ return double_stencil3d_setup(size, "19-point Double Precision Stencil"); }
+static void *float_stencil9_setup(unsigned long size){ return float_stencil2d_setup(size, "9-point Single Precision Stencil"); }
+static void *double_stencil9_setup(unsigned long size){ return double_stencil2d_setup(size, "9-point Double Precision Stencil"); }
+static void *float_stencil5_setup(unsigned long size){ return float_stencil2d_setup(size, "5-point Single Precision Stencil"); }
+static void *double_stencil5_setup(unsigned long size){ return double_stencil2d_setup(size, "5-point Double Precision Stencil"); }
+
+
+/*
+ * A sweep reads a0 and writes a1 over the interior planes (rows in 2D)
+ * [begin, end), counted from the first interior one; the copy back into
+ * a0 is a second pass, so the threaded variants can split both by
+ * planes without a thread overwriting points its neighbours still read.
+ */
+static double float_stencil3d_copy_range(void *p, unsigned long begin, unsigned long end){
+
+	stencil_state *s = p;
+	int i, j, k;
+	int size = s->size;
+	int n = size-2;
+	float *a0 = s->a0;
+	float *a1 = s->a1;
+
+	for (i = begin+1; i < (int)end+1; i++) {
 		for (j = 1; j < n+1; j++) {
 			for (k = 1; k < n+1; k++) {
-				a0[i*size*size+j*size+k] = (float) rand()/ (float)(1.0 + RAND_MAX);
+				a0[i*size*size+j*size+k] = a1[i*size*size+j*size+k];
 			}
 		}
 	}
 
-	/* run main computation on host */
-	clock_gettime(CLOCK, &start);
-	for (iter = 0; iter < REPS; iter++) {
+	return 0.0;
+}
 
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				for (k = 1; k < n+1; k++) {
-					a1[i*size*size+j*size+k] = (
-							a0[i*size*size+(j-1)*size+k] + a0[i*size*size+(j+1)*size+k] +
-							a0[(i-1)*size*size+j*size+k] + a0[(i+1)*size*size+j*size+k] +
-							a0[(i-1)*size*size+(j-1)*size+k] + a0[(i-1)*size*size+(j+1)*size+k] +
-							a0[(i+1)*size*size+(j-1)*size+k] + a0[(i+1)*size*size+(j+1)*size+k] +
+static double float_stencil3d_copy(stencil_state *s){
 
-							a0[i*size*size+(j-1)*size+(k-1)] + a0[i*size*size+(j+1)*size+(k-1)] +
-							a0[(i-1)*size*size+j*size+(k-1)] + a0[(i+1)*size*size+j*size+(k-1)] +
+	int size = s->size;
 
-							a0[i*size*size+(j-1)*size+(k+1)] + a0[i*size*size+(j+1)*size+(k+1)] +
-							a0[(i-1)*size*size+j*size+(k+1)] + a0[(i+1)*size*size+j*size+(k+1)] +
+	float_stencil3d_copy_range(s, 0, size-2);
+	return ((float *)s->a0)[(size/2)*size*size+(size/2)*size+size/2];
+}
 
-							a0[i*size*size+j*size+(k-1)] + a0[i*size*size+j*size+(k+1)]
-					) * fac;
-				}
-			}
-		}
+static double float_stencil3d_copy_parallel(stencil_state *s){
 
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				for (k = 1; k < n+1; k++) {
-					a0[i*size*size+j*size+k] = a1[i*size*size+j*size+k];
-				}
-			}
-		}
-	} /* end iteration loop */
+	int size = s->size;
 
-	clock_gettime(CLOCK, &end);
-	elapsed_time_hr(start, end, "Single Precision Stencil - 19 point");
+	par_for(size-2, float_stencil3d_copy_range, s);
+	return ((float *)s->a0)[(size/2)*size*size+(size/2)*size+size/2];
+}
 
-	/* Free malloc'd memory to prevent leaks */
-	free(a0);
-	free(a1);
+static double float_stencil2d_copy_range(void *p, unsigned long begin, unsigned long end){
 
+	stencil_state *s = p;
+	int i, j;
+	int size = s->size;
+	int n = size-2;
+	float *a0 = s->a0;
+	float *a1 = s->a1;
+
+	for (i = begin+1; i < (int)end+1; i++) {
+		for (j = 1; j < n+1; j++) {
+			a0[i*size+j] = a1[i*size+j];
+		}
+	}
+
+	return 0.0;
 }
 
+static double float_stencil2d_copy(stencil_state *s){
 
-void double_stencil19(unsigned int size){
+	int size = s->size;
 
-	int i, j, k, iter;
-	int n = size-2;
-	double fac = 1.0/18;
+	float_stencil2d_copy_range(s, 0, size-2);
+	return ((float *)s->a0)[(size/2)*size+size/2];
+}
 
-	/* Work buffers, with halos */
-	double *a0 = (double*)malloc(sizeof(double)*size*size*size);
-	double *a1 = (double*)malloc(sizeof(double)*size*size*size);
+static double float_stencil2d_copy_parallel(stencil_state *s){
 
-	if(a0==NULL||a1==NULL){
-		/* Something went wrong in the memory allocation here, fail gracefully */
-		printf("19-point Double Precision Stencil Error: Unable to allocate memory\n");
-	}
+	int size = s->size;
 
-	struct timespec start,end;
-	/* zero all of array (including halos) */
-	for (i = 0; i < size; i++) {
-		for (j = 0; j < size; j++) {
-			for (k = 0; k < size; k++) {
-				a0[i*size*size+j*size+k] = 0.0;
-			}
-		}
-	}
+	par_for(size-2, float_stencil2d_copy_range, s);
+	return ((float *)s->a0)[(size/2)*size+size/2];
+}
 
-	/* use random numbers to fill interior */
-	for (i = 1; i < n+1; i++) {
+static double double_stencil3d_copy_range(void *p, unsigned long begin, unsigned long end){
+
+	stencil_state *s = p;
+	int i, j, k;
+	int size = s->size;
+	int n = size-2;
+	double *a0 = s->a0;
+	double *a1 = s->a1;
+
+	for (i = begin+1; i < (int)end+1; i++) {
 		for (j = 1; j < n+1; j++) {
 			for (k = 1; k < n+1; k++) {
-				a0[i*size*size+j*size+k] = (double) rand()/ (double)(1.0 + RAND_MAX);
+				a0[i*size*size+j*size+k] = a1[i*size*size+j*size+k];
 			}
 		}
 	}
 
-	/* run main computation on host */
-	clock_gettime(CLOCK, &start);
-	for (iter = 0; iter < REPS; iter++) {
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				for (k = 1; k < n+1; k++) {
-					a1[i*size*size+j*size+k] = (
-							a0[i*size*size+(j-1)*size+k] + a0[i*size*size+(j+1)*size+k] +
-							a0[(i-1)*size*size+j*size+k] + a0[(i+1)*size*size+j*size+k] +
-							a0[(i-1)*size*size+(j-1)*size+k] + a0[(i-1)*size*size+(j+1)*size+k] +
-							a0[(i+1)*size*size+(j-1)*size+k] + a0[(i+1)*size*size+(j+1)*size+k] +
-
-							a0[i*size*size+(j-1)*size+(k-1)] + a0[i*size*size+(j+1)*size+(k-1)] +
-							a0[(i-1)*size*size+j*size+(k-1)] + a0[(i+1)*size*size+j*size+(k-1)] +
-
-							a0[i*size*size+(j-1)*size+(k+1)] + a0[i*size*size+(j+1)*size+(k+1)] +
-							a0[(i-1)*size*size+j*size+(k+1)] + a0[(i+1)*size*size+j*size+(k+1)] +
-
-							a0[i*size*size+j*size+(k-1)] + a0[i*size*size+j*size+(k+1)]
-					) * fac;
-				}
-			}
-		}
-
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				for (k = 1; k < n+1; k++) {
-					a0[i*size*size+j*size+k] = a1[i*size*size+j*size+k];
-				}
-			}
-		}
-	} /* end iteration loop */
+	return 0.0;
+}
 
-	clock_gettime(CLOCK, &end);
-	elapsed_time_hr(start, end, "Double Precision Stencil - 19 point");
+static double double_stencil3d_copy(stencil_state *s){
 
-	/* Free malloc'd memory to prevent leaks */
-	free(a0);
-	free(a1);
+	int size = s->size;
 
+	double_stencil3d_copy_range(s, 0, size-2);
+	return ((double *)s->a0)[(size/2)*size*size+(size/2)*size+size/2];
 }
 
+static double double_stencil3d_copy_parallel(stencil_state *s){
 
-void float_stencil9(unsigned int size){
+	int size = s->size;
 
-	int i, j, iter;
-	int n = size-2;
-	float fac = 1.0/8;
+	par_for(size-2, double_stencil3d_copy_range, s);
+	return ((double *)s->a0)[(size/2)*size*size+(size/2)*size+size/2];
+}
 
-	/* Work buffers, with halos */
-	float *a0 = (float*)malloc(sizeof(float)*size*size);
-	float *a1 = (float*)malloc(sizeof(float)*size*size);
+static double double_stencil2d_copy_range(void *p, unsigned long begin, unsigned long end){
 
-	if(a0==NULL||a1==NULL){
-		/* Something went wrong in the memory allocation here, fail gracefully */
-		printf("9-point Single Precision Stencil Error: Unable to allocate memory\n");
-	}
+	stencil_state *s = p;
+	int i, j;
+	int size = s->size;
+	int n = size-2;
+	double *a0 = s->a0;
+	double *a1 = s->a1;
 
-	struct timespec start,end;
-	/* zero all of array (including halos) */
-	for (i = 0; i < size; i++) {
-		for (j = 0; j < size; j++) {
-			a0[i*size+j] = 0.0;
+	for (i = begin+1; i < (int)end+1; i++) {
+		for (j = 1; j < n+1; j++) {
+			a0[i*size+j] = a1[i*size+j];
 		}
 	}
 
-	/* use random numbers to fill interior */
-	for (i = 1; i < n+1; i++) {
+	return 0.0;
+}
+
+static double double_stencil2d_copy(stencil_state *s){
+
+	int size = s->size;
+
+	double_stencil2d_copy_range(s, 0, size-2);
+	return ((double *)s->a0)[(size/2)*size+size/2];
+}
+
+static double double_stencil2d_copy_parallel(stencil_state *s){
+
+	int size = s->size;
+
+	par_for(size-2, double_stencil2d_copy_range, s);
+	return ((double *)s->a0)[(size/2)*size+size/2];
+}
+
+static double float_stencil27_sweep(void *p, unsigned long begin, unsigned long end){
+
+	stencil_state *s = p;
+	int i, j, k;
+	int size = s->size;
+	int n = size-2;
+	float fac = 1.0/26;
+	float *a0 = s->a0;
+	float *a1 = s->a1;
+
+	for (i = begin+1; i < (int)end+1; i++) {
 		for (j = 1; j < n+1; j++) {
-			a0[i*size+j] = (float) rand()/ (float)(1.0 + RAND_MAX);
+			for (k = 1; k < n+1; k++) {
+				a1[i*size*size+j*size+k] = (
+						a0[i*size*size+(j-1)*size+k] + a0[i*size*size+(j+1)*size+k] +
+						a0[(i-1)*size*size+j*size+k] + a0[(i+1)*size*size+j*size+k] +
+						a0[(i-1)*size*size+(j-1)*size+k] + a0[(i-1)*size*size+(j+1)*size+k] +
+						a0[(i+1)*size*size+(j-1)*size+k] + a0[(i+1)*size*size+(j+1)*size+k] +
+
+						a0[i*size*size+(j-1)*size+(k-1)] + a0[i*size*size+(j+1)*size+(k-1)] +
+						a0[(i-1)*size*size+j*size+(k-1)] + a0[(i+1)*size*size+j*size+(k-1)] +
+						a0[(i-1)*size*size+(j-1)*size+(k-1)] + a0[(i-1)*size*size+(j+1)*size+(k-1)] +
+						a0[(i+1)*size*size+(j-1)*size+(k-1)] + a0[(i+1)*size*size+(j+1)*size+(k-1)] +
+
+						a0[i*size*size+(j-1)*size+(k+1)] + a0[i*size*size+(j+1)*size+(k+1)] +
+						a0[(i-1)*size*size+j*size+(k+1)] + a0[(i+1)*size*size+j*size+(k+1)] +
+						a0[(i-1)*size*size+(j-1)*size+(k+1)] + a0[(i-1)*size*size+(j+1)*size+(k+1)] +
+						a0[(i+1)*size*size+(j-1)*size+(k+1)] + a0[(i+1)*size*size+(j+1)*size+(k+1)] +
+
+						a0[i*size*size+j*size+(k-1)] + a0[i*size*size+j*size+(k+1)]
+					) * fac;
+			}
 		}
 	}
 
-	/* run main computation on host */
-	clock_gettime(CLOCK, &start);
-	for (iter = 0; iter < REPS; iter++) {
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				a1[i*size+j] = (
-						a0[i*size+(j-1)] + a0[i*size+(j+1)] +
-						a0[(i-1)*size+j] + a0[(i+1)*size+j] +
-						a0[(i-1)*size+(j-1)] + a0[(i-1)*size+(j+1)] +
-						a0[(i+1)*size+(j-1)] + a0[(i+1)*size+(j+1)]
+	return 0.0;
+}
+
+static double float_stencil27_compute(void *p){
 
+	stencil_state *s = p;
+
+	float_stencil27_sweep(s, 0, s->size-2);
+	return float_stencil3d_copy(s);
+}
+
+static double float_stencil27_parallel(void *p){
+
+	stencil_state *s = p;
+
+	par_for(s->size-2, float_stencil27_sweep, s);
+	return float_stencil3d_copy_parallel(s);
+}
+
+static double double_stencil27_sweep(void *p, unsigned long begin, unsigned long end){
+
+	stencil_state *s = p;
+	int i, j, k;
+	int size = s->size;
+	int n = size-2;
+	double fac = 1.0/26;
+	double *a0 = s->a0;
+	double *a1 = s->a1;
+
+	for (i = begin+1; i < (int)end+1; i++) {
+		for (j = 1; j < n+1; j++) {
+			for (k = 1; k < n+1; k++) {
+				a1[i*size*size+j*size+k] = (
+						a0[i*size*size+(j-1)*size+k] + a0[i*size*size+(j+1)*size+k] +
+						a0[(i-1)*size*size+j*size+k] + a0[(i+1)*size*size+j*size+k] +
+						a0[(i-1)*size*size+(j-1)*size+k] + a0[(i-1)*size*size+(j+1)*size+k] +
+						a0[(i+1)*size*size+(j-1)*size+k] + a0[(i+1)*size*size+(j+1)*size+k] +
+
+						a0[i*size*size+(j-1)*size+(k-1)] + a0[i*size*size+(j+1)*size+(k-1)] +
+						a0[(i-1)*size*size+j*size+(k-1)] + a0[(i+1)*size*size+j*size+(k-1)] +
+						a0[(i-1)*size*size+(j-1)*size+(k-1)] + a0[(i-1)*size*size+(j+1)*size+(k-1)] +
+						a0[(i+1)*size*size+(j-1)*size+(k-1)] + a0[(i+1)*size*size+(j+1)*size+(k-1)] +
+
+						a0[i*size*size+(j-1)*size+(k+1)] + a0[i*size*size+(j+1)*size+(k+1)] +
+						a0[(i-1)*size*size+j*size+(k+1)] + a0[(i+1)*size*size+j*size+(k+1)] +
+						a0[(i-1)*size*size+(j-1)*size+(k+1)] + a0[(i-1)*size*size+(j+1)*size+(k+1)] +
+						a0[(i+1)*size*size+(j-1)*size+(k+1)] + a0[(i+1)*size*size+(j+1)*size+(k+1)] +
+
+						a0[i*size*size+j*size+(k-1)] + a0[i*size*size+j*size+(k+1)]
 				) * fac;
 			}
 		}
+	}
 
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				a0[i*size+j] = a1[i*size+j];
-			}
-		}
-	} /* end iteration loop */
+	return 0.0;
+}
 
-	clock_gettime(CLOCK, &end);
-	elapsed_time_hr(start, end, "Single Precision Stencil - 9 point");
+static double double_stencil27_compute(void *p){
 
-	/* Free malloc'd memory to prevent leaks */
-	free(a0);
-	free(a1);
+	stencil_state *s = p;
 
+	double_stencil27_sweep(s, 0, s->size-2);
+	return double_stencil3d_copy(s);
 }
 
+static double double_stencil27_parallel(void *p){
+
+	stencil_state *s = p;
 
-void double_stencil9(unsigned int size){
+	par_for(s->size-2, double_stencil27_sweep, s);
+	return double_stencil3d_copy_parallel(s);
+}
+
+static double float_stencil19_sweep(void *p, unsigned long begin, unsigned long end){
 
-	int i, j, iter;
+	stencil_state *s = p;
+	int i, j, k;
+	int size = s->size;
 	int n = size-2;
-	double fac = 1.0/8;
+	float fac = 1.0/18;
+	float *a0 = s->a0;
+	float *a1 = s->a1;
 
-	/* Work buffers, with halos */
-	double *a0 = (double*)malloc(sizeof(double)*size*size);
-	double *a1 = (double*)malloc(sizeof(double)*size*size);
+	for (i = begin+1; i < (int)end+1; i++) {
+		for (j = 1; j < n+1; j++) {
+			for (k = 1; k < n+1; k++) {
+				a1[i*size*size+j*size+k] = (
+						a0[i*size*size+(j-1)*size+k] + a0[i*size*size+(j+1)*size+k] +
+						a0[(i-1)*size*size+j*size+k] + a0[(i+1)*size*size+j*size+k] +
+						a0[(i-1)*size*size+(j-1)*size+k] + a0[(i-1)*size*size+(j+1)*size+k] +
+						a0[(i+1)*size*size+(j-1)*size+k] + a0[(i+1)*size*size+(j+1)*size+k] +
 
-	if(a0==NULL||a1==NULL){
-		/* Something went wrong in the memory allocation here, fail gracefully */
-		printf("9-point Double Precision Stencil Error: Unable to allocate memory\n");
-	}
+						a0[i*size*size+(j-1)*size+(k-1)] + a0[i*size*size+(j+1)*size+(k-1)] +
+						a0[(i-1)*size*size+j*size+(k-1)] + a0[(i+1)*size*size+j*size+(k-1)] +
 
-	struct timespec start,end;
-	/* zero all of array (including halos) */
-	for (i = 0; i < size; i++) {
-		for (j = 0; j < size; j++) {
-			a0[i*size+j] = 0.0;
+						a0[i*size*size+(j-1)*size+(k+1)] + a0[i*size*size+(j+1)*size+(k+1)] +
+						a0[(i-1)*size*size+j*size+(k+1)] + a0[(i+1)*size*size+j*size+(k+1)] +
+
+						a0[i*size*size+j*size+(k-1)] + a0[i*size*size+j*size+(k+1)]
+				) * fac;
+			}
 		}
 	}
 
-	/* use random numbers to fill interior */
-	for (i = 1; i < n+1; i++) {
+	return 0.0;
+}
+
+static double float_stencil19_compute(void *p){
+
+	stencil_state *s = p;
+
+	float_stencil19_sweep(s, 0, s->size-2);
+	return float_stencil3d_copy(s);
+}
+
+static double float_stencil19_parallel(void *p){
+
+	stencil_state *s = p;
+
+	par_for(s->size-2, float_stencil19_sweep, s);
+	return float_stencil3d_copy_parallel(s);
+}
+
+static double double_stencil19_sweep(void *p, unsigned long begin, unsigned long end){
+
+	stencil_state *s = p;
+	int i, j, k;
+	int size = s->size;
+	int n = size-2;
+	double fac = 1.0/18;
+	double *a0 = s->a0;
+	double *a1 = s->a1;
+
+	for (i = begin+1; i < (int)end+1; i++) {
 		for (j = 1; j < n+1; j++) {
-			a0[i*size+j] = (double) rand()/ (double)(1.0 + RAND_MAX);
-		}
-	}
+			for (k = 1; k < n+1; k++) {
+				a1[i*size*size+j*size+k] = (
+						a0[i*size*size+(j-1)*size+k] + a0[i*size*size+(j+1)*size+k] +
+						a0[(i-1)*size*size+j*size+k] + a0[(i+1)*size*size+j*size+k] +
+						a0[(i-1)*size*size+(j-1)*size+k] + a0[(i-1)*size*size+(j+1)*size+k] +
+						a0[(i+1)*size*size+(j-1)*size+k] + a0[(i+1)*size*size+(j+1)*size+k] +
 
-	/* run main computation on host */
-	clock_gettime(CLOCK, &start);
-	for (iter = 0; iter < REPS; iter++) {
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				a1[i*size+j] = (
-						a0[i*size+(j-1)] + a0[i*size+(j+1)] +
-						a0[(i-1)*size+j] + a0[(i+1)*size+j] +
-						a0[(i-1)*size+(j-1)] + a0[(i-1)*size+(j+1)] +
-						a0[(i+1)*size+(j-1)] + a0[(i+1)*size+(j+1)]
+						a0[i*size*size+(j-1)*size+(k-1)] + a0[i*size*size+(j+1)*size+(k-1)] +
+						a0[(i-1)*size*size+j*size+(k-1)] + a0[(i+1)*size*size+j*size+(k-1)] +
+
+						a0[i*size*size+(j-1)*size+(k+1)] + a0[i*size*size+(j+1)*size+(k+1)] +
+						a0[(i-1)*size*size+j*size+(k+1)] + a0[(i+1)*size*size+j*size+(k+1)] +
+
+						a0[i*size*size+j*size+(k-1)] + a0[i*size*size+j*size+(k+1)]
 				) * fac;
 			}
 		}
+	}
 
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				a0[i*size+j] = a1[i*size+j];
-			}
-		}
-	} /* end iteration loop */
+	return 0.0;
+}
 
-	clock_gettime(CLOCK, &end);
-	elapsed_time_hr(start, end, "Double Precision Stencil - 9 point");
+static double double_stencil19_compute(void *p){
 
-	/* Free malloc'd memory to prevent leaks */
-	free(a0);
-	free(a1);
+	stencil_state *s = p;
 
+	double_stencil19_sweep(s, 0, s->size-2);
+	return double_stencil3d_copy(s);
 }
 
+static double double_stencil19_parallel(void *p){
+
+	stencil_state *s = p;
+
+	par_for(s->size-2, double_stencil19_sweep, s);
+	return double_stencil3d_copy_parallel(s);
+}
 
-void float_stencil5(unsigned int size){
+static double float_stencil9_sweep(void *p, unsigned long begin, unsigned long end){
 
-	int i, j, iter;
+	stencil_state *s = p;
+	int i, j;
+	int size = s->size;
 	int n = size-2;
 	float fac = 1.0/8;
+	float *a0 = s->a0;
+	float *a1 = s->a1;
 
-	/* Work buffers, with halos */
-	float *a0 = (float*)malloc(sizeof(float)*size*size);
-	float *a1 = (float*)malloc(sizeof(float)*size*size);
-
-	if(a0==NULL||a1==NULL){
-		/* Something went wrong in the memory allocation here, fail gracefully */
-		printf("9-point Single Precision Stencil Error: Unable to allocate memory\n");
-	}
+	for (i = begin+1; i < (int)end+1; i++) {
+		for (j = 1; j < n+1; j++) {
+			a1[i*size+j] = (
+					a0[i*size+(j-1)] + a0[i*size+(j+1)] +
+					a0[(i-1)*size+j] + a0[(i+1)*size+j] +
+					a0[(i-1)*size+(j-1)] + a0[(i-1)*size+(j+1)] +
+					a0[(i+1)*size+(j-1)] + a0[(i+1)*size+(j+1)]
 
-	struct timespec start,end;
-	/* zero all of array (including halos) */
-	for (i = 0; i < size; i++) {
-		for (j = 0; j < size; j++) {
-			a0[i*size+j] = 0.0;
+			) * fac;
 		}
 	}
 
-	/* use random numbers to fill interior */
-	for (i = 1; i < n+1; i++) {
+	return 0.0;
+}
+
+static double float_stencil9_compute(void *p){
+
+	stencil_state *s = p;
+
+	float_stencil9_sweep(s, 0, s->size-2);
+	return float_stencil2d_copy(s);
+}
+
+static double float_stencil9_parallel(void *p){
+
+	stencil_state *s = p;
+
+	par_for(s->size-2, float_stencil9_sweep, s);
+	return float_stencil2d_copy_parallel(s);
+}
+
+static double double_stencil9_sweep(void *p, unsigned long begin, unsigned long end){
+
+	stencil_state *s = p;
+	int i, j;
+	int size = s->size;
+	int n = size-2;
+	double fac = 1.0/8;
+	double *a0 = s->a0;
+	double *a1 = s->a1;
+
+	for (i = begin+1; i < (int)end+1; i++) {
 		for (j = 1; j < n+1; j++) {
-			a0[i*size+j] = (float) rand()/ (float)(1.0 + RAND_MAX);
+			a1[i*size+j] = (
+					a0[i*size+(j-1)] + a0[i*size+(j+1)] +
+					a0[(i-1)*size+j] + a0[(i+1)*size+j] +
+					a0[(i-1)*size+(j-1)] + a0[(i-1)*size+(j+1)] +
+					a0[(i+1)*size+(j-1)] + a0[(i+1)*size+(j+1)]
+			) * fac;
 		}
 	}
 
-	/* run main computation on host */
-	clock_gettime(CLOCK, &start);
-	for (iter = 0; iter < REPS; iter++) {
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				a1[i*size+j] = (
-						a0[i*size+(j-1)] + a0[i*size+(j+1)] +
-						a0[(i-1)*size+j] + a0[(i+1)*size+j]
+	return 0.0;
+}
 
-				) * fac;
-			}
-		}
+static double double_stencil9_compute(void *p){
 
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				a0[i*size+j] = a1[i*size+j];
-			}
-		}
-	} /* end iteration loop */
+	stencil_state *s = p;
 
-	clock_gettime(CLOCK, &end);
-	elapsed_time_hr(start, end, "Single Precision Stencil - 5 point");
+	double_stencil9_sweep(s, 0, s->size-2);
+	return double_stencil2d_copy(s);
+}
+
+static double double_stencil9_parallel(void *p){
 
-	/* Free malloc'd memory to prevent leaks */
-	free(a0);
-	free(a1);
+	stencil_state *s = p;
 
+	par_for(s->size-2, double_stencil9_sweep, s);
+	return double_stencil2d_copy_parallel(s);
 }
 
-void double_stencil5(unsigned int size){
+static double float_stencil5_sweep(void *p, unsigned long begin, unsigned long end){
 
-	int i, j, iter;
+	stencil_state *s = p;
+	int i, j;
+	int size = s->size;
 	int n = size-2;
-	double fac = 1.0/8;
+	float fac = 1.0/4;
+	float *a0 = s->a0;
+	float *a1 = s->a1;
 
-	/* Work buffers, with halos */
-	double *a0 = (double*)malloc(sizeof(double)*size*size);
-	double *a1 = (double*)malloc(sizeof(double)*size*size);
+	for (i = begin+1; i < (int)end+1; i++) {
+		for (j = 1; j < n+1; j++) {
+			a1[i*size+j] = (
+					a0[i*size+(j-1)] + a0[i*size+(j+1)] +
+					a0[(i-1)*size+j] + a0[(i+1)*size+j]
 
-	if(a0==NULL||a1==NULL){
-		/* Something went wrong in the memory allocation here, fail gracefully */
-		printf("9-point Double Precision Stencil Error: Unable to allocate memory\n");
+			) * fac;
+		}
 	}
 
-	struct timespec start,end;
+	return 0.0;
+}
 
-	/* zero all of array (including halos) */
-	for (i = 0; i < size; i++) {
-		for (j = 0; j < size; j++) {
-			a0[i*size+j] = 0.0;
-		}
-	}
+static double float_stencil5_compute(void *p){
 
-	/* use random numbers to fill interior */
-	for (i = 1; i < n+1; i++) {
+	stencil_state *s = p;
+
+	float_stencil5_sweep(s, 0, s->size-2);
+	return float_stencil2d_copy(s);
+}
+
+static double float_stencil5_parallel(void *p){
+
+	stencil_state *s = p;
+
+	par_for(s->size-2, float_stencil5_sweep, s);
+	return float_stencil2d_copy_parallel(s);
+}
+
+static double double_stencil5_sweep(void *p, unsigned long begin, unsigned long end){
+
+	stencil_state *s = p;
+	int i, j;
+	int size = s->size;
+	int n = size-2;
+	double fac = 1.0/4;
+	double *a0 = s->a0;
+	double *a1 = s->a1;
+
+	for (i = begin+1; i < (int)end+1; i++) {
 		for (j = 1; j < n+1; j++) {
-			a0[i*size+j] = (double) rand()/ (double)(1.0 + RAND_MAX);
+			a1[i*size+j] = ( a0[i*size+(j-1)] + a0[i*size+(j+1)] +
+					a0[(i-1)*size+j] + a0[(i+1)*size+j] ) * fac;
 		}
 	}
 
-	/* run main computation on host */
-	clock_gettime(CLOCK, &start);
-	for (iter = 0; iter < REPS; iter++) {
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				a1[i*size+j] = ( a0[i*size+(j-1)] + a0[i*size+(j+1)] +
-						a0[(i-1)*size+j] + a0[(i+1)*size+j] ) * fac;
-			}
-		}
+	return 0.0;
+}
 
-		for (i = 1; i < n+1; i++) {
-			for (j = 1; j < n+1; j++) {
-				a0[i*size+j] = a1[i*size+j];
-			}
-		}
+static double double_stencil5_compute(void *p){
+
+	stencil_state *s = p;
+
+	double_stencil5_sweep(s, 0, s->size-2);
+	return double_stencil2d_copy(s);
+}
 
-	} /* end iteration loop */
+static double double_stencil5_parallel(void *p){
 
-	clock_gettime(CLOCK, &end);
-	elapsed_time_hr(start, end, "Double Precision Stencil - 5 point");
+	stencil_state *s = p;
 
-	/* Free malloc'd memory to prevent leaks */
-	free(a0);
-	free(a1);
+	par_for(s->size-2, double_stencil5_sweep, s);
+	return double_stencil2d_copy_parallel(s);
+}
+
+
+/*
+ * Reference sweep for verify. Neighbours are the points differing in
+ * at most maxoff coordinates: 3 for 27 points, 2 for 19 and 9 points,
+ * 1 for 5 points. The sum is taken in long double and scaled by fac
+ * rounded to the kernel's type, as the kernels do.
+ */
+static long double stencil_at(stencil_state *s, void *a, int i, int j, int k){
+
+	size_t size = s->size;
+	size_t idx = (s->dims == 3) ? (i*size+j)*size+k : i*size+j;
+
+	if(s->elem == sizeof(float)) return ((float *)a)[idx];
+	return ((double *)a)[idx];
+}
+
+static double stencil_verify(const kernel_t *k, void *p, double *tol){
+
+	stencil_state *s = p;
+	int points = atoi(k->op);
+	int maxoff = (points == 27) ? 3 : (points == 5) ? 1 : 2;
+	int kr = (s->dims == 3) ? 1 : 0;
+	int n = s->size-2;
+	size_t count = (s->dims == 3) ? (size_t)s->size*s->size*s->size : (size_t)s->size*s->size;
+	long double fac = (s->elem == sizeof(float)) ? (long double)(float)(1.0/(points-1)) : (long double)(1.0/(points-1));
+	void *old = malloc(count*s->elem);
+	double err = 0, e;
+	int i, j, kk, di, dj, dk;
+
+	if(old==NULL) return -1;
+	memcpy(old, s->a0, count*s->elem);
+	k->compute(s);
 
+	for (i = 1; i < n+1; i++) {
+		for (j = 1; j < n+1; j++) {
+			for (kk = kr; kk < (kr ? n+1 : 1); kk++) {
+				long double sum = 0, scale = 0;
+				for (di = -1; di <= 1; di++) {
+					for (dj = -1; dj <= 1; dj++) {
+						for (dk = -kr; dk <= kr; dk++) {
+							int off = (di != 0) + (dj != 0) + (dk != 0);
+							if(off == 0 || off > maxoff) continue;
+							long double v = stencil_at(s, old, i+di, j+dj, kk+dk);
+							sum += v;
+							scale += fabsl(v);
+						}
+					}
+				}
+				e = verify_error(stencil_at(s, s->a0, i, j, kk), sum*fac, scale*fac);
+				if(e > err) err = e;
+			}
+		}
+	}
+
+	/* points-2 additions, the scaling and the rounding of fac */
+	*tol = verify_tolerance(k->dtype, points);
+
+	free(old);
+	return err;
 }
+
+const kernel_t stencil_kernels[] = {
+	{"stencil", "27", "float", "Single Precision Stencil - 27 point", REPS,
+	 float_stencil27_setup, float_stencil27_compute, stencil_teardown, stencil27_flops, stencil_bytes,
+	 NULL, stencil_footprint, stencil_resize, stencil_verify, float_stencil27_parallel, NULL},
+	{"stencil", "27", "double", "Double Precision Stencil - 27 point", REPS,
+	 double_stencil27_setup, double_stencil27_compute, stencil_teardown, stencil27_flops, stencil_bytes,
+	 NULL, stencil_footprint, stencil_resize, stencil_verify, double_stencil27_parallel, NULL},
+	{"stencil", "19", "float", "Single Precision Stencil - 19 point", REPS,
+	 float_stencil19_setup, float_stencil19_compute, stencil_teardown, stencil19_flops, stencil_bytes,
+	 NULL, stencil_footprint, stencil_resize, stencil_verify, float_stencil19_parallel, NULL},
+	{"stencil", "19", "double", "Double Precision Stencil - 19 point", REPS,
+	 double_stencil19_setup, double_stencil19_compute, stencil_teardown, stencil19_flops, stencil_bytes,
+	 NULL, stencil_footprint, stencil_resize, stencil_verify, double_stencil19_parallel, NULL},
+	{"stencil", "9", "float", "Single Precision Stencil - 9 point", REPS,
+	 float_stencil9_setup, float_stencil9_compute, stencil_teardown, stencil9_flops, stencil_bytes,
+	 NULL, stencil_footprint, stencil_resize, stencil_verify, float_stencil9_parallel, NULL},
+	{"stencil", "9", "double", "Double Precision Stencil - 9 point", REPS,
+	 double_stencil9_setup, double_stencil9_compute, stencil_teardown, stencil9_flops, stencil_bytes,
+	 NULL, stencil_footprint, stencil_resize, stencil_verify, double_stencil9_parallel, NULL},
+	{"stencil", "5", "float", "Single Precision Stencil - 5 point", REPS,
+	 float_stencil5_setup, float_stencil5_compute, stencil_teardown, stencil5_flops, stencil_bytes,
+	 NULL, stencil_footprint, stencil_resize, stencil_verify, float_stencil5_parallel, NULL},
+	{"stencil", "5", "double", "Double Precision Stencil - 5 point", REPS,
+	 double_stencil5_setup, double_stencil5_compute, stencil_teardown, stencil5_flops, stencil_bytes,
+	 NULL, stencil_footprint, stencil_resize, stencil_verify, double_stencil5_parallel, NULL},
+	{NULL}
+};
@@ -0,0 +1,206 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "level1.h"
+#include "utils.h"
+#include "report.h"
+#include "suite.h"
+
+#define SUITE_LINE_LEN 1024
+
+/* One line of the plan */
+typedef struct {
+  int line;
+  char bench[64], op[64], dtype[64], algo[64];
+  char kernels[SUITE_LINE_LEN];
+  unsigned long size;
+  unsigned long *sizes;                 /* size range, NULL for a single size */
+  int nsizes;
+  unsigned long reps;
+  unsigned long warmup;
+} suite_entry;
+
+
+/* Copy a value into a fixed size field; returns -1 if it does not fit */
+static int set_string(char *field, size_t len, const char *value){
+
+  if (strlen(value) >= len) return -1;
+  strcpy(field, value);
+  return 0;
+}
+
+/* Parse a non-negative number that must make up the whole value */
+static int set_number(unsigned long *field, const char *value){
+
+  char *end;
+
+  if (!isdigit((unsigned char)*value)) return -1;
+  *field = strtoul(value, &end, 10);
+  return *end == '\0' ? 0 : -1;
+}
+
+/* Apply one key=value setting to the entry; returns -1 if it is not valid */
+static int set_key(suite_entry *e, char *token, const char *path){
+
+  char *key = token, *value = strchr(token, '=');
+  int rc;
+
+  if (strncmp(key, "--", 2) == 0) key += 2;
+  if (value == NULL) {
+    fprintf(stderr, "ERROR: %s:%d: expected key=value, got \"%s\"\n", path, e->line, token);
+    return -1;
+  }
+  *value++ = '\0';
+
+  if (strcmp(key, "bench") == 0) rc = set_string(e->bench, sizeof(e->bench), value);
+  else if (strcmp(key, "op") == 0) rc = set_string(e->op, sizeof(e->op), value);
+  else if (strcmp(key, "dtype") == 0) rc = set_string(e->dtype, sizeof(e->dtype), value);
+  else if (strcmp(key, "algo") == 0) rc = set_string(e->algo, sizeof(e->algo), value);
+  else if (strcmp(key, "kernels") == 0) rc = set_string(e->kernels, sizeof(e->kernels), value);
+  else if (strcmp(key, "reps") == 0) rc = set_number(&e->reps, value);
+  else if (strcmp(key, "warmup") == 0) rc = set_number(&e->warmup, value);
+  else if (strcmp(key, "size") == 0 || strcmp(key, "size-range") == 0) {
+    free(e->sizes);
+    e->sizes = NULL;
+    if (strchr(value, ':') != NULL) {
+      e->nsizes = size_range(value, &e->sizes);
+      rc = (e->nsizes > 0) ? 0 : -1;
+      if (rc != 0) e->sizes = NULL;
+    } else rc = (set_number(&e->size, value) == 0 && e->size > 0) ? 0 : -1;
+  } else {
+    fprintf(stderr, "ERROR: %s:%d: unknown key \"%s\"\n", path, e->line, key);
+    return -1;
+  }
+
+  if (rc != 0) fprintf(stderr, "ERROR: %s:%d: invalid %s \"%s\"\n", path, e->line, key, value);
+
+  return rc;
+}
+
+/*
+ * Read the plan into a list of entries; returns the number of entries,
+ * or -1 after reporting the first line that is not valid.
+ */
+static int suite_read(const char *path, unsigned int size, unsigned long reps, suite_entry **entries){
+
+  char buf[SUITE_LINE_LEN];
+  suite_entry *list = NULL, *e;
+  int n = 0, max = 0, line = 0;
+  FILE *f;
+
+  f = fopen(path, "r");
+  if (f == NULL) {
+    fprintf(stderr, "ERROR: unable to open suite \"%s\"\n", path);
+    return -1;
+  }
+
+  while (fgets(buf, sizeof(buf), f) != NULL) {
+    char *token, *hash = strchr(buf, '#');
+
+    line++;
+    if (hash != NULL) *hash = '\0';
+    token = strtok(buf, " \t\r\n");
+    if (token == NULL) continue;
+
+    if (n == max) {
+      suite_entry *l;
+      max = max ? 2 * max : 16;
+      l = realloc(list, max * sizeof(suite_entry));
+      if (l == NULL) {
+        fprintf(stderr, "ERROR: unable to allocate %d suite entries\n", max);
+        goto fail;
+      }
+      list = l;
+    }
+
+    e = &list[n++];
+    memset(e, 0, sizeof(*e));
+    e->line = line;
+    strcpy(e->bench, "blas_op");
+    strcpy(e->op, "dot_product");
+    strcpy(e->dtype, "double");
+    strcpy(e->algo, "normal");
+    e->size = size;
+    e->reps = reps;
+    e->warmup = bench_config.warmup;
+
+    for (; token != NULL; token = strtok(NULL, " \t\r\n"))
+      if (set_key(e, token, path) != 0) goto fail;
+  }
+
+  fclose(f);
+  *entries = list;
+  return n;
+
+fail:
+  fclose(f);
+  while (n > 0) free(list[--n].sizes);
+  free(list);
+  return -1;
+}
+
+/* Run every entry of the plan in path; returns the OR of their exit codes */
+int suite_run(const char *path, unsigned int size, unsigned long reps){
+
+  suite_entry *entries = NULL;
+  unsigned long warmup = bench_config.warmup;
+  int n, i, rv = 0;
+
+  n = suite_read(path, size, reps, &entries);
+  if (n < 0) return 1;
+  if (n == 0) {
+    fprintf(stderr, "ERROR: suite \"%s\" has no entries\n", path);
+    return 1;
+  }
+  fprintf(stderr, "Suite %s: %d entries.\n", path, n);
+
+  bench_config.keep = 1;
+  report_collect(1);
+
+  for (i = 0; i < n; i++) {
+    suite_entry *e = &entries[i];
+
+    bench_config.warmup = e->warmup;
+    bench_config.sizes = e->sizes;
+    bench_config.nsizes = e->sizes ? e->nsizes : 0;
+
+    if (e->kernels[0] != '\0') rv |= bench_run(e->kernels, e->size, e->reps);
+    else rv |= bench_level1(e->bench, e->size, e->reps, e->op, e->dtype, e->algo);
+
+    free(e->sizes);
+  }
+
+  bench_config.warmup = warmup;
+  bench_config.sizes = NULL;
+  bench_config.nsizes = 0;
+  bench_config.keep = 0;
+  bench_release();
+
+  report_summary();
+  free(entries);
+
+  return rv;
+}
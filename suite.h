@@ -0,0 +1,43 @@
+/* Copyright (c) 2015 The University of Edinburgh. */
+
+/* 
+* This software was developed as part of the                       
+* EC FP7 funded project Adept (Project ID: 610490)                 
+* www.adept-project.eu                                            
+*/
+
+/* Licensed under the Apache License, Version 2.0 (the "License"); */
+/* you may not use this file except in compliance with the License. */
+/* You may obtain a copy of the License at */
+
+/*     http://www.apache.org/licenses/LICENSE-2.0 */
+
+/* Unless required by applicable law or agreed to in writing, software */
+/* distributed under the License is distributed on an "AS IS" BASIS, */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. */
+/* See the License for the specific language governing permissions and */
+/* limitations under the License. */
+
+
+/*
+ * Benchmark suites.
+ *
+ * A suite file is a run plan: one entry per line, each a list of
+ * key=value settings named after the long command line options, e.g.
+ *
+ *   # acceptance run
+ *   bench=blas_op op=axpy dtype=float size=1000000 reps=50
+ *   bench=stencil op=27 dtype=double size=16:256:x2
+ *   bench=cg algo=mixed size=20000
+ *   kernels=blas_op/dot_product/float,blas_op/dot_product/double size=4096 warmup=5
+ *
+ * Keys are bench, op, dtype, algo, kernels, size (a single size or a
+ * start:end[:step] range as for --size-range), reps and warmup; what an
+ * entry leaves out comes from the command line or the usual defaults.
+ * The whole plan is checked before anything runs, then every entry
+ * runs in one process, reusing a kernel's buffers from one entry to
+ * the next where the sizes allow, and a summary of all the results
+ * closes the report.
+ */
+
+int suite_run(const char *path, unsigned int size, unsigned long reps);
@@ -21,11 +21,21 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
+#include <math.h>
+#include <string.h>
 #include <signal.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
 
 #include "utils.h"
 
+volatile sig_atomic_t stop;
+
 #ifdef __MACH__
 void clock_gettime (void* clk, struct timespec *ts){
 	clock_serv_t cclock;
@@ -108,61 +118,133 @@ void interrupt_handler(int signum){
   stop = 1;
 }
 
-void discrete_elapsed_hr(struct timespec* oh_array, struct timespec* res_array, int* iter, char* title){
+/* Fill oh_array with OVERHEAD_SAMPLES pairs of back-to-back clock reads */
+void timer_overhead_hr(struct timespec* oh_array){
+
+  int i;
+
+  for(i=0;i<OVERHEAD_SAMPLES;i++){
+    clock_gettime(CLOCK, &oh_array[2*i]);
+    clock_gettime(CLOCK, &oh_array[2*i+1]);
+  }
+
+}
+
+static int compare_double(const void *a, const void *b){
+
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+/* Two-sided 95% Student t quantile for n-1 degrees of freedom */
+static double t95(int n){
 
-  /* This computes the overhead from the array you give it AND then removes this from the results array */
+  static const double table[] = { 0.0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365,
+                                  2.306, 2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131,
+                                  2.120, 2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069,
+                                  2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+  int df = n - 1;
 
-  double tminus = 0;
-  double tcum = 0;
+  if (df < 1) return 0.0;
+  if (df <= 30) return table[df];
+  return 1.960;
+}
+
+void discrete_stats_hr(struct timespec* oh_array, struct timespec* res_array, int iter, time_stats* st){
+
+  /* This computes the overhead from the array you give it AND then removes this from the results */
+
+  int i = 0;
   int count = 0;
   int retval = 0;
-  int i = 0;
+  int overhead_status = 0;
+  double cum_overhead = 0;
+  double sum = 0;
+  double sq = 0;
+  double *t;
 
   struct timespec overhead;
   struct timespec result;
-  double cum_overhead = 0;
-  int overhead_status = 0;
-
 
-  /* The overhead array is always 1000 values long */
-  for(i=0;i<1000;i++){
+  /* The overhead array is always OVERHEAD_SAMPLES pairs long */
+  for(i=0;i<OVERHEAD_SAMPLES;i++){
     overhead_status = sub_time_hr(&overhead, &oh_array[2*i], &oh_array[2*i+1]);
     if (overhead_status == 1){
-      printf("Error computing overhead for %s\n", title);
+      printf("Error computing timer overhead\n");
     }
     cum_overhead += (overhead.tv_sec+((double)overhead.tv_nsec/1000000000));
   }
 
-  double mean_oh;
-  if (cum_overhead == 0){
-    mean_oh = 0;
-  }
-  else{
-    mean_oh = cum_overhead/1000;
-  }
+  memset(st, 0, sizeof(time_stats));
+  st->overhead = cum_overhead/OVERHEAD_SAMPLES;
+
+  t = malloc((iter > 0 ? iter : 1) * sizeof(double));
+  if (t == NULL) return;
 
-  /* Accumulate the difference between the results values and remove mean overhead */
-  for (i=0;i<*iter;i++){
+  /* Collect each repetition with the mean overhead removed */
+  for (i=0;i<iter;i++){
     retval = sub_time_hr(&result, &res_array[2*i], &res_array[2*i+1]);
     if (retval!=1){
-      tminus = (result.tv_sec+((double)result.tv_nsec/1000000000)) - mean_oh;
-      tcum += tminus;
+      t[count] = (result.tv_sec+((double)result.tv_nsec/1000000000)) - st->overhead;
+      if (t[count] < 0) t[count] = 0;
+      sum += t[count];
       count++;
     }
   }
-  double cumulative = tcum/count;
+
+  st->n = count;
+  if (count == 0){
+    free(t);
+    return;
+  }
+
+  qsort(t, count, sizeof(double), compare_double);
+
+  st->min = t[0];
+  st->max = t[count-1];
+  st->mean = sum/count;
+  st->median = (count % 2) ? t[count/2] : 0.5*(t[count/2-1] + t[count/2]);
+  st->p95 = t[(int)ceil(0.95*count) - 1];
+
+  for (i=0;i<count;i++){
+    sq += (t[i] - st->mean)*(t[i] - st->mean);
+  }
+  st->stddev = (count > 1) ? sqrt(sq/(count-1)) : 0.0;
+  st->ci95 = (count > 1) ? t95(count)*st->stddev/sqrt(count) : 0.0;
+
+  free(t);
+}
+
+void print_stats_hr(time_stats* st, char* title){
 
   printf("\n--- %s\n", title);
   printf("--- Timings ------------------------------------------------------------------------\n");
   printf("|\n");
-  printf("| Iterations %d   ", *iter);
-  printf("Mean time(adjusted) %.9lf s   ", cumulative);
-  printf("Mean overhead %.9lf s\n", mean_oh);
+  printf("| Iterations %d   ", st->n);
+  printf("Mean overhead %.9lf s (removed)\n", st->overhead);
+  printf("| Min %.9lf s   ", st->min);
+  printf("Median %.9lf s   ", st->median);
+  printf("Mean %.9lf s\n", st->mean);
+  printf("| P95 %.9lf s   ", st->p95);
+  printf("Max %.9lf s   ", st->max);
+  printf("Stddev %.9lf s\n", st->stddev);
+  printf("| 95%% CI of mean %.9lf - %.9lf s\n", st->mean - st->ci95, st->mean + st->ci95);
   printf("|\n");
   printf("------------------------------------------------------------------------------------\n");
 
 }
 
+void discrete_elapsed_hr(struct timespec* oh_array, struct timespec* res_array, int* iter, char* title){
+
+  time_stats st;
+
+  discrete_stats_hr(oh_array, res_array, *iter, &st);
+  print_stats_hr(&st, title);
+
+}
+
 int sub_time_hr(struct timespec* result, struct timespec* start, struct timespec* end)
 {
 
@@ -181,3 +263,268 @@ int file_exists(char *filename){
   struct stat buffer;
   return (stat(filename, &buffer) == 0);
 }
+
+/*
+ * Fill sizes[] with the capacity in bytes of each data or unified
+ * cache level of cpu0, L1 first. Returns the number of levels found.
+ */
+int cache_sizes(double *sizes, int max){
+
+  char path[128], buf[64];
+  int idx, level, n = 0;
+  FILE *f;
+
+  for (idx = 0; idx < 16; idx++) {
+    double size;
+    char unit = 'B';
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", idx);
+    if ((f = fopen(path, "r")) == NULL) break;
+    if (fgets(buf, sizeof(buf), f) == NULL) buf[0] = '\0';
+    fclose(f);
+    if (strncmp(buf, "Instruction", 11) == 0) continue;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", idx);
+    if ((f = fopen(path, "r")) == NULL) continue;
+    if (fscanf(f, "%d", &level) != 1) level = 0;
+    fclose(f);
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", idx);
+    if ((f = fopen(path, "r")) == NULL) continue;
+    if (fscanf(f, "%lf%c", &size, &unit) < 1) size = 0;
+    fclose(f);
+
+    if (unit == 'K') size *= 1024;
+    else if (unit == 'M') size *= 1024*1024;
+
+    if (level >= 1 && level <= max && size > 0) {
+      sizes[level-1] = size;
+      if (level > n) n = level;
+    }
+  }
+
+  return n;
+}
+
+/* Smallest flush buffer, for machines whose caches cannot be read */
+#define FLUSH_MIN_BYTES (8*1024*1024)
+
+static unsigned char *flush_buf = NULL;
+static size_t flush_len = 0;
+static int flush_parts = 0;
+static volatile unsigned char flush_sink;
+
+/*
+ * Size the flush buffer for parts threads flushing together: twice the
+ * last level cache, and at least twice the private caches of a core
+ * (the level below the last) for each thread, so that every part
+ * replaces the private caches of the core flushing it. The buffer is
+ * allocated on first use and grown for more threads. Returns 0 if the
+ * buffer is ready.
+ */
+int cache_flush_init(int parts){
+
+  double sizes[4] = { 0, 0, 0, 0 };
+  size_t len;
+  int n;
+
+  if(parts <= flush_parts) return flush_len == 0;
+
+  n = cache_sizes(sizes, 4);
+  len = (n > 0) ? (size_t)(2 * sizes[n-1]) : 0;
+  if(n > 1 && len < (size_t)(2 * sizes[n-2]) * parts) len = (size_t)(2 * sizes[n-2]) * parts;
+  if(len < FLUSH_MIN_BYTES) len = FLUSH_MIN_BYTES;
+
+  free(flush_buf);
+  flush_parts = parts;
+  flush_len = len;
+  flush_buf = malloc(flush_len);
+  if(flush_buf == NULL){
+    fprintf(stderr, "WARNING: unable to allocate %lu byte cache flush buffer, caches stay warm\n",
+            (unsigned long)flush_len);
+    flush_len = 0;
+    return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * Evict the data caches by writing and then reading part of parts
+ * equal parts of the flush buffer, so lines of the previous
+ * repetition, dirty or clean, are replaced. Each thread of a threaded
+ * kernel flushes its own part, after cache_flush_init(parts).
+ */
+void cache_flush_part(int part, int parts){
+
+  size_t i, begin, end;
+  unsigned char acc = 0;
+
+  if(flush_len == 0 || parts > flush_parts) return;
+
+  begin = flush_len / parts * part / 64 * 64;
+  end = (part == parts - 1) ? flush_len : flush_len / parts * (part + 1) / 64 * 64;
+  for(i=begin;i<end;i+=64) flush_buf[i]++;
+  for(i=begin;i<end;i+=64) acc += flush_buf[i];
+  flush_sink = acc;
+}
+
+/* Evict the data caches from the calling thread, with the whole flush buffer */
+void cache_flush(void){
+
+  if(cache_flush_init(1) == 0) cache_flush_part(0, 1);
+}
+
+const char *perf_event_names[PERF_NEVENTS] = {
+  "cycles", "instructions", "llc_misses", "branch_misses", "dtlb_misses"
+};
+
+#ifdef __linux__
+
+static const struct {
+  unsigned int type;
+  unsigned long long config;
+} perf_events[PERF_NEVENTS] = {
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+  { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+};
+
+/* The calling thread's id, for perf_open() */
+int perf_tid(void){
+
+  return (int)syscall(__NR_gettid);
+}
+
+/*
+ * Open the events as one group led by cycles for each of the n threads
+ * tid (the calling thread if tid is NULL), counting user space of this
+ * process only so that the default perf_event_paranoid setting is
+ * enough. Events the PMU or the kernel refuses on any of the threads
+ * are left out. Returns the number of events opened; 0 means counters
+ * are not available and perf_start/perf_stop do nothing.
+ */
+int perf_open(perf_counters* pc, const int *tid, int n){
+
+  static int warned = 0;
+  struct perf_event_attr attr;
+  int i, t;
+
+  memset(pc, 0, sizeof(*pc));
+  if(tid == NULL) n = 1;
+  if(n > PERF_MAX_THREADS) n = PERF_MAX_THREADS;
+  pc->nthreads = n;
+
+  for(i=0;i<PERF_NEVENTS;i++) pc->count[i] = 0.0;
+
+  for(t=0;t<n;t++){
+    pc->leader[t] = -1;
+    for(i=0;i<PERF_NEVENTS;i++){
+      pc->fd[t][i] = -1;
+      if(pc->count[i] < 0) continue;
+
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = perf_events[i].type;
+      attr.config = perf_events[i].config;
+      attr.disabled = (pc->leader[t] == -1);
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      pc->fd[t][i] = syscall(__NR_perf_event_open, &attr, tid ? tid[t] : 0, -1, pc->leader[t], 0);
+      if(pc->fd[t][i] < 0){
+        pc->fd[t][i] = -1;
+        pc->count[i] = -1.0;
+        continue;
+      }
+      if(pc->leader[t] == -1) pc->leader[t] = pc->fd[t][i];
+    }
+  }
+
+  for(i=0;i<PERF_NEVENTS;i++)
+    if(pc->count[i] >= 0) pc->nopen++;
+  if(pc->nopen == 0) perf_close(pc);
+
+  if(pc->nopen == 0 && !warned){
+    fprintf(stderr, "WARNING: hardware counters not available (check /proc/sys/kernel/perf_event_paranoid), "
+                    "continuing with timings only\n");
+    warned = 1;
+  }
+
+  return pc->nopen;
+}
+
+void perf_start(perf_counters* pc){
+
+  int t;
+
+  for(t=0;t<pc->nthreads;t++){
+    if(pc->leader[t] < 0) continue;
+    ioctl(pc->leader[t], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(pc->leader[t], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+/* Stop the groups and add their counts, each scaled if it was multiplexed */
+void perf_stop(perf_counters* pc){
+
+  unsigned long long buf[3 + PERF_NEVENTS];
+  double scale;
+  int i, j, t;
+
+  for(t=0;t<pc->nthreads;t++)
+    if(pc->leader[t] >= 0) ioctl(pc->leader[t], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+  for(t=0;t<pc->nthreads;t++){
+    if(pc->leader[t] < 0) continue;
+    if(read(pc->leader[t], buf, sizeof(buf)) < (ssize_t)(3 * sizeof(buf[0]))) continue;
+    if(buf[2] == 0) continue;
+    scale = (buf[2] < buf[1]) ? (double)buf[1] / buf[2] : 1.0;
+
+    for(i=0, j=0; i<PERF_NEVENTS && j<(int)buf[0]; i++){
+      if(pc->fd[t][i] < 0) continue;
+      if(pc->count[i] >= 0) pc->count[i] += scale * buf[3+j];
+      j++;
+    }
+  }
+  if(pc->nopen > 0) pc->regions++;
+}
+
+void perf_close(perf_counters* pc){
+
+  int i, t;
+
+  for(t=0;t<pc->nthreads;t++){
+    for(i=0;i<PERF_NEVENTS;i++){
+      if(pc->fd[t][i] >= 0) close(pc->fd[t][i]);
+      pc->fd[t][i] = -1;
+    }
+    pc->leader[t] = -1;
+  }
+}
+
+#else
+
+int perf_tid(void){ return 0; }
+
+int perf_open(perf_counters* pc, const int *tid, int n){
+
+  int i;
+
+  (void)tid;
+  (void)n;
+  memset(pc, 0, sizeof(*pc));
+  for(i=0;i<PERF_NEVENTS;i++) pc->count[i] = -1.0;
+  return 0;
+}
+
+void perf_start(perf_counters* pc){ (void)pc; }
+void perf_stop(perf_counters* pc){ (void)pc; }
+void perf_close(perf_counters* pc){ (void)pc; }
+
+#endif
@@ -36,7 +36,39 @@ void clock_gettime (void*, struct timespec *);
 #endif
 
 #include <signal.h>
-volatile sig_atomic_t stop;
+extern volatile sig_atomic_t stop;
+
+/* Number of back-to-back clock reads used to estimate timer overhead */
+#define OVERHEAD_SAMPLES 1000
+
+/* Summary statistics of per-repetition timings, in seconds */
+typedef struct {
+  int n;             /* number of valid repetitions */
+  double overhead;   /* mean timer overhead, already removed below */
+  double min;
+  double median;
+  double mean;
+  double p95;
+  double max;
+  double stddev;
+  double ci95;       /* half width of the 95% confidence interval of the mean */
+} time_stats;
+
+/* Hardware counters collected around each timed region, one group per thread */
+enum { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES, PERF_BRANCH_MISSES, PERF_DTLB_MISSES, PERF_NEVENTS };
+
+#define PERF_MAX_THREADS 1024
+
+typedef struct {
+  int nthreads;                 /* threads counted */
+  int fd[PERF_MAX_THREADS][PERF_NEVENTS];  /* -1 where the event could not be opened */
+  int leader[PERF_MAX_THREADS]; /* group leader fd of each thread, -1 if none opened */
+  int nopen;                    /* events counted on every thread */
+  unsigned long regions;        /* number of start/stop pairs accumulated */
+  double count[PERF_NEVENTS];   /* totals over the threads, scaled for multiplexing */
+} perf_counters;
+
+extern const char *perf_event_names[PERF_NEVENTS];
 
 double elapsed_time_hr(struct timespec, struct timespec, char *);
 void loop_timer(unsigned long);
@@ -44,5 +76,17 @@ void loop_timer_nop(unsigned long);
 void warmup_loop(unsigned long);
 void interrupt_handler(int);
 void discrete_elapsed_hr(struct timespec*, struct timespec*, int*, char*);
+void discrete_stats_hr(struct timespec*, struct timespec*, int, time_stats*);
+void print_stats_hr(time_stats*, char*);
+void timer_overhead_hr(struct timespec*);
 int sub_time_hr(struct timespec*, struct timespec*, struct timespec*);
 int file_exists(char *);
+int cache_sizes(double *, int);
+int cache_flush_init(int);
+void cache_flush_part(int, int);
+void cache_flush(void);
+int perf_tid(void);
+int perf_open(perf_counters*, const int *, int);
+void perf_start(perf_counters*);
+void perf_stop(perf_counters*);
+void perf_close(perf_counters*);